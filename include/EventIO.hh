@@ -55,6 +55,7 @@
 #define HAVE_64BIT_INT 1
 #include "io_basic.h"
 #include "eventio_registry.h"
+#include "io_index.h"
 #include <stdexcept>
 #include <limits.h>
 
@@ -176,6 +177,12 @@ namespace eventio
             bool IsSearchable(void) const { return item_header.can_search; }
             /// Search for a specific sub-item
             int Search(size_t sub);
+            /// Search for a sub-item of specific type and identifier
+            int Search(size_t sub, long ident);
+            /// Directory of all sub-items (returns their number or <0)
+            int Directory(const IO_SUB_ITEM_ENTRY **entries);
+            /// Go to the sub-item with given index in the directory
+            int GoTo(int index);
             /// Rewind to beginning of data area
             int Rewind(void);
             /// Completely undo getting this item, i.e. rewind to beginning of its header.
@@ -1176,6 +1183,7 @@ namespace eventio
          bool local_output;
          bool throw_on_error;
          bool external_buffer;
+         IO_INDEX *index;
 
       public:
          EventIO(size_t initial_size=65536, size_t max_size=100000000);
@@ -1220,6 +1228,8 @@ namespace eventio
          int Append(const EventIO& ev2);
          /// Copy a sub-item to another I/O buffer as top-level item.
          int Copy(const EventIO::Item& item);
+         /// Write a sub-item directly as top-level item, without a copy.
+         int WriteItem(const EventIO::Item& item);
 
          /// The item type found by the last Find() call.
          unsigned long ItemType(void) const { return search_header.type; }
@@ -1237,6 +1247,13 @@ namespace eventio
          int List(int verbosity=0);
          int Write(void);
 
+         /// Random access to input files through a block index.
+         int LoadIndex(const char *fname=0);
+         int BuildIndex(void);
+         const IO_INDEX *Index(void) const { return index; }
+         int SeekToEvent(long event);
+         int SeekToType(unsigned long type, long k=0);
+
          bool SetThrow(bool on=true) { bool t=throw_on_error; 
             throw_on_error=on; return t; }
          bool SetExtended(bool on=true) { bool t=iobuf->extended;
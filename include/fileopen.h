@@ -53,6 +53,7 @@ struct incpath *get_include_path(void);
 void set_permissive_pipes(int p);
 void enable_permissive_pipes(void);
 void disable_permissive_pipes(void);
+void set_seekable_zstd(int blocks_per_frame);
 
 #ifdef __cplusplus
 }
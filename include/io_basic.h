@@ -63,6 +63,10 @@ extern "C" {
 
 /* Indicate add-on features */
 #define EVENTIO_HAVE_TOTAL 1
+#define EVENTIO_HAVE_READ_AHEAD 1
+#ifdef OS_UNIX
+# define EVENTIO_HAVE_MMAP 1
+#endif
 
 typedef unsigned char BYTE;
 
@@ -82,6 +86,52 @@ struct _struct_IO_ITEM_HEADER
 };
 typedef struct _struct_IO_ITEM_HEADER IO_ITEM_HEADER;
 
+/** One entry in the directory of sub-items of a searchable item. */
+
+struct _struct_IO_SUB_ITEM_ENTRY
+{
+   unsigned long type;  /**< The type number of the sub-item. */
+   unsigned version;    /**< The version number of the sub-item. */
+   long ident;          /**< Identity number of the sub-item. */
+   int can_search;      /**< Set to 1 if the sub-item consists of sub-items only. */
+   int user_flag;       /**< The user flag bit of the sub-item header. */
+   int use_extension;   /**< Non-zero if the sub-item header has the extension field. */
+   long offset;         /**< Offset of the sub-item header in the I/O buffer. */
+   long length;         /**< Length of the data field of the sub-item. */
+};
+typedef struct _struct_IO_SUB_ITEM_ENTRY IO_SUB_ITEM_ENTRY;
+
+/** A piece of caller-owned data for gather output with write_io_block_gather(). */
+
+struct _struct_IO_SEGMENT
+{
+   const void *data;    /**< Start of the data. */
+   size_t length;       /**< Length of the data in bytes. */
+};
+typedef struct _struct_IO_SEGMENT IO_SEGMENT;
+
+/** Number of segments passed to the system in one gather-write call. */
+#ifndef IO_GATHER_MAX_IOV
+#define IO_GATHER_MAX_IOV 64
+#endif
+
+struct _struct_IO_BUFFER;
+
+/** Entry points of an optional module doing the I/O of an I/O buffer in
+    the background (see io_prefetch.h and io_writebehind.h). The module installs them on the
+    I/O buffer while it is active, so that the core functions need not
+    be linked with it. */
+
+struct io_block_hooks
+{
+   int (*find_block) (struct _struct_IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+   int (*read_block) (struct _struct_IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+   int (*skip_block) (struct _struct_IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+   int64_t (*block_offset) (struct _struct_IO_BUFFER *iobuf);
+   int (*write_block) (struct _struct_IO_BUFFER *iobuf, size_t length);
+   int (*stop) (struct _struct_IO_BUFFER *iobuf);
+};
+
 /** The IO_BUFFER structure contains all data needed the manage the stuff. */
 
 struct _struct_IO_BUFFER
@@ -124,6 +174,28 @@ struct _struct_IO_BUFFER
    long total_input;  /**< Sum of bytes read by read_io_block calls */
    long total_output; /**< Sum of bytes written by write_io_block calls */
 #endif
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   BYTE *ra_buffer;   /**< Read-ahead buffer for raw input via input_fileno. */
+   long ra_length;    /**< Length of read-ahead buffer (0: default, <0: disabled). */
+   long ra_pos;       /**< Offset of next unconsumed byte in read-ahead buffer. */
+   long ra_end;       /**< Offset after the last valid byte in read-ahead buffer. */
+   int ra_fileno;     /**< The input_fileno to which the buffered data belongs. */
+#endif
+#ifdef EVENTIO_HAVE_MMAP
+   BYTE *mm_data;     /**< Start of memory-mapped input file or NULL if not used. */
+   size_t mm_length;  /**< Length of the memory-mapped input file. */
+   size_t mm_pos;     /**< Offset of next unread byte in the mapped input file. */
+   BYTE *mm_buffer;   /**< Own buffer set aside while 'buffer' points into the mapped file. */
+   long mm_buflen;    /**< Length of the buffer set aside. */
+   int mm_is_allocated; /**< The 'is_allocated' flag of the buffer set aside. */
+#endif
+   struct io_prefetch_struct *prefetch; /**< Background reader, if active (see io_prefetch.h). */
+   const struct io_block_hooks *input_hooks; /**< Input functions of the background reader, if active. */
+   struct io_writebehind_struct *writebehind; /**< Background writer, if active (see io_writebehind.h). */
+   const struct io_block_hooks *output_hooks; /**< Output functions of the background writer, if active. */
+   struct io_item_directory_struct *item_dir; /**< Sub-item directories per level, built on demand. */
+   struct io_stats_struct *stats; /**< Decoding and I/O statistics, if active (see io_stats.h). */
+   long last_failed_length; /**< Buffer length at which the last extension failed. */
 };
 typedef struct _struct_IO_BUFFER IO_BUFFER;
 typedef int (*IO_USER_FUNCTION) (unsigned char *, long, int);
@@ -143,6 +215,8 @@ typedef int (*IO_USER_FUNCTION) (unsigned char *, long, int);
 #  define IO_BUFFER_MAXIMUM_LENGTH 3000000L
 # endif
 #endif
+/* Size of read-ahead buffer for raw input through input_fileno. */
+#define IO_READ_AHEAD_LENGTH 262144L
 
 /* ------------------- Macro definitions ---------------------- */
 
@@ -206,10 +280,15 @@ int32_t get_scount32 (IO_BUFFER *iobuf);
 int16_t get_scount16 (IO_BUFFER *iobuf);
 void put_vector_of_int_scount (const int *vec, int num, IO_BUFFER *iobuf);
 void get_vector_of_int_scount (int *vec, int num, IO_BUFFER *iobuf);
+void get_vector_of_count32 (uint32_t *vec, int num, IO_BUFFER *iobuf);
+void get_vector_of_scount32 (int32_t *vec, int num, IO_BUFFER *iobuf);
 void put_vector_of_uint16_scount_differential (uint16_t *vec, int num, IO_BUFFER *iobuf);
 void get_vector_of_uint16_scount_differential (uint16_t *vec, int num, IO_BUFFER *iobuf);
 void put_vector_of_uint32_scount_differential (uint32_t *vec, int num, IO_BUFFER *iobuf);
 void get_vector_of_uint32_scount_differential (uint32_t *vec, int num, IO_BUFFER *iobuf);
+void put_vector_of_uint16_packed (const uint16_t *vec, int num, IO_BUFFER *iobuf);
+void get_vector_of_uint16_packed (uint16_t *vec, int num, IO_BUFFER *iobuf);
+const char *eventio_swap_method (void);
 
 /* ... 16 bits integer data types ... */
 /* ... (native) ... */
@@ -283,6 +362,9 @@ void fltp_to_sfloat (const float *fnum, uint16_t *snum);
 void put_sfloat (double dnum, IO_BUFFER *iobuf);
 double dbl_from_sfloat(const uint16_t *snum);
 double get_sfloat (IO_BUFFER *iobuf);
+void put_vector_of_sfloat (const float *fvec, int num, IO_BUFFER *iobuf);
+void get_vector_of_sfloat (float *fvec, int num, IO_BUFFER *iobuf);
+const char *eventio_sfloat_method (void);
 
 /* General item management: */
 int put_item_begin (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
@@ -299,6 +381,11 @@ long next_subitem_ident (IO_BUFFER *iobuf);
 int skip_subitem (IO_BUFFER *iobuf);
 int search_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
     IO_ITEM_HEADER *sub_item_header);
+int search_sub_item_ident (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+    IO_ITEM_HEADER *sub_item_header, long ident);
+int get_sub_item_directory (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+    const IO_SUB_ITEM_ENTRY **entries);
+int goto_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, int index);
 int rewind_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
 int remove_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
 int list_sub_items (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
@@ -311,11 +398,22 @@ int find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
 int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
 int skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
 int list_io_blocks (IO_BUFFER *iobuf, int verbosity);
+int64_t io_block_offset (IO_BUFFER *iobuf);
+int seek_io_block (IO_BUFFER *iobuf, int64_t offset);
+#ifdef EVENTIO_HAVE_MMAP
+int map_io_buffer_input (IO_BUFFER *iobuf, int fd);
+void unmap_io_buffer_input (IO_BUFFER *iobuf);
+#endif
 
 int copy_item_to_io_block (IO_BUFFER *iobuf2, IO_BUFFER *iobuf,
     const IO_ITEM_HEADER *item_header);
 int append_io_block_as_item (IO_BUFFER *iobuf,
     IO_ITEM_HEADER *item_header, BYTE *_buffer, long length);
+int append_io_sub_items (IO_BUFFER *iobuf, IO_BUFFER *from);
+int write_io_block_gather (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+    const IO_SEGMENT *seg, int nseg);
+int write_item_as_io_block (IO_BUFFER *iobuf2, IO_BUFFER *iobuf,
+    const IO_ITEM_HEADER *item_header);
     
 /* Registry hook: */
 
@@ -0,0 +1,142 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_columns.h
+ *  @short Column-wise tables of event-level quantities in eventio format.
+ *
+ *  A column table has named columns of 32-bit integers, floats, or
+ *  doubles, optionally with a variable number of values per row
+ *  (like pixel amplitudes). Rows are collected in chunks and each
+ *  chunk is written as a pair of top-level I/O blocks: a small one
+ *  with the number of rows and the minimum and maximum of each column,
+ *  followed by one with the data of each column in a separate
+ *  sub-item, compressed with zlib where available.
+ *
+ *  Readers can thus skip whole chunks, without reading them, for which
+ *  the statistics show that no row can pass a range cut, and decode
+ *  only the columns actually needed. The table definition is written
+ *  as a separate block before the first chunk. Several tables can be
+ *  interleaved in one file, told apart by their table ID.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef IO_COLUMNS_H__LOADED          /* Ignore if included a second time */
+
+#define IO_COLUMNS_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+#include "io_basic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Item types, outside of the range used by sim_telarray (2000 to 2999 and
+   beyond) and listed in EventioRegisteredNames.dat. */
+#define IO_TYPE_COLUMN_TABLE 1500  /**< Table name and column definitions */
+#define IO_TYPE_COLUMN_STATS 1501  /**< Rows and value ranges of the next chunk */
+#define IO_TYPE_COLUMN_CHUNK 1502  /**< Column data of one chunk */
+#define IO_TYPE_COLUMN_DATA  1503  /**< Data of one column, sub-item of a chunk */
+
+/** Types of column values (all kept as double in memory). */
+#define COL_INT32  1
+#define COL_FLOAT  2
+#define COL_DOUBLE 3
+/** Flag for columns with a variable number of values per row. */
+#define COL_ARRAY  0x10
+
+#define COL_MAX_COLUMNS 64  /**< Maximum number of columns per table */
+#define COL_MAX_CUTS 16     /**< Maximum number of range cuts per table */
+#define COL_NAME_LEN 32     /**< Space for column and table names */
+
+/** One column with its values in the current chunk. */
+struct io_column_struct
+{
+   char name[COL_NAME_LEN];  /**< Column name */
+   int type;                 /**< COL_INT32, COL_FLOAT, or COL_DOUBLE, possibly with COL_ARRAY */
+   int selected;             /**< Decoded when reading (all if none selected) */
+   int decoded;              /**< Values of the current chunk are available */
+   size_t num_values;        /**< Values in the current chunk */
+   size_t max_values;        /**< Values allocated */
+   double *values;           /**< Values of all rows in the current chunk */
+   size_t *first;            /**< Index of the first value of each row (arrays only) */
+   double vmin, vmax;        /**< Range of values in the current chunk */
+};
+typedef struct io_column_struct IO_COLUMN;
+
+/** A range cut, applied to whole chunks by their statistics. */
+struct io_column_cut_struct
+{
+   int icol;                 /**< Column index */
+   double vmin, vmax;        /**< Accepted range of values */
+};
+
+/** A column table, for writing or reading. */
+struct io_column_table_struct
+{
+   char name[COL_NAME_LEN];  /**< Table name */
+   int table_id;             /**< Ident of all blocks of this table */
+   int num_columns;          /**< Number of columns defined */
+   IO_COLUMN column[COL_MAX_COLUMNS];
+   size_t num_rows;          /**< Complete rows in the current chunk */
+   size_t max_rows;          /**< Rows per chunk when writing */
+   size_t max_row_index;     /**< Space for row indices of array columns */
+   int compress;             /**< Compress column data when writing (if supported) */
+   int num_cuts;             /**< Number of range cuts used when reading */
+   struct io_column_cut_struct cut[COL_MAX_CUTS];
+   long num_chunks;          /**< Chunks written or read so far */
+   long chunks_skipped;      /**< Chunks skipped due to cuts when reading */
+   long total_rows;          /**< Rows written or read so far */
+   IO_BUFFER *scratch;       /**< For decompressed data when reading */
+};
+typedef struct io_column_table_struct IO_COLUMN_TABLE;
+
+IO_COLUMN_TABLE *allocate_column_table (const char *name, int table_id,
+   size_t max_rows);
+void free_column_table (IO_COLUMN_TABLE *tab);
+int add_column (IO_COLUMN_TABLE *tab, const char *name, int type);
+int find_column (const IO_COLUMN_TABLE *tab, const char *name);
+
+int write_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab);
+int set_column_value (IO_COLUMN_TABLE *tab, int icol, double value);
+int set_column_values (IO_COLUMN_TABLE *tab, int icol, const double *values, size_t num);
+int end_column_row (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab);
+int flush_column_chunk (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab);
+
+int read_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab);
+int find_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab, const char *name);
+int select_column (IO_COLUMN_TABLE *tab, const char *name);
+int add_column_cut (IO_COLUMN_TABLE *tab, const char *name, double vmin, double vmax);
+long read_column_chunk (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab);
+int column_row_passes (const IO_COLUMN_TABLE *tab, size_t irow);
+double get_column_value (const IO_COLUMN_TABLE *tab, int icol, size_t irow);
+size_t get_column_values (const IO_COLUMN_TABLE *tab, int icol, size_t irow,
+   const double **values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
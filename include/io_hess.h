@@ -570,6 +570,21 @@ void show_hessio_max (void);
 #define SHOWER_FLAG    0x400
 #define CALSUM_FLAG    0x800
 
+/** Kinds of event data sub-items to be decoded with an EventProjection: */
+
+#define PROJ_ADC_SUMS      0x001  /**< Telescope ADC sums */
+#define PROJ_ADC_SAMPLES   0x002  /**< Telescope ADC samples (traces) */
+#define PROJ_PIXEL_TIMING  0x004  /**< Pixel timing parameters */
+#define PROJ_IMAGE         0x008  /**< Image parameters */
+#define PROJ_PIXEL_CALIB   0x010  /**< Calibrated pixel intensities */
+#define PROJ_AUX_TRACES    0x020  /**< Auxiliary digital/analog traces */
+#define PROJ_PIXEL_LISTS   0x040  /**< Trigger and image pixel lists */
+#define PROJ_PIXELTRG_TIME 0x080  /**< Pixel trigger times */
+#define PROJ_TRACKING      0x100  /**< Telescope tracking data */
+#define PROJ_SHOWER        0x200  /**< Reconstructed shower parameters */
+#define PROJ_ALL           0x3ff
+#define PROJ_LAZY_SAMPLES  0x1000 /**< Keep ADC samples undecoded until decode_adc_samples() */
+
 /* ================ I/O item types: ======================== */
 
 /** Never change the following numbers after MC data is created:
@@ -929,6 +944,8 @@ struct simtel_time_struct
 /** Use HTime rather than the plain struct name in any code. */
 typedef struct simtel_time_struct HTime;
 
+struct _struct_IO_BUFFER;
+
 /** ADC data (either sampled or sum mode) */
 
 struct simtel_tel_event_adc_struct
@@ -949,11 +966,49 @@ struct simtel_tel_event_adc_struct
    uint8_t significant[H_MAX_PIX];  ///< Was amplitude large enough to record it? Bit 0: sum, 1: samples.
    uint8_t adc_known[H_MAX_GAINS][H_MAX_PIX]; ///< Was individual channel recorded? Bit 0: sum, 1: samples, 2: ADC was in saturation.
    uint32_t adc_sum[H_MAX_GAINS][H_MAX_PIX];  ///< Sum of ADC values.
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   uint16_t *adc_sample_buf; ///< Pulses sampled, allocated as needed (see alloc_adc_samples()).
+   int sample_gains;   ///< Number of gains in the layout of adc_sample_buf.
+   int sample_pixels;  ///< Number of pixels per gain in the layout of adc_sample_buf.
+   int sample_stride;  ///< Number of samples per pixel in the layout of adc_sample_buf.
+   size_t sample_capacity; ///< Number of samples for which adc_sample_buf has space.
+#else
    uint16_t adc_sample[H_MAX_GAINS][H_MAX_PIX][H_MAX_SLICES]; ///< Pulses sampled.
+#endif
+   uint16_t *slice_buf; ///< Slice-major copy of the samples, see adc_slice_major().
+   size_t slice_capacity; ///< Number of samples for which slice_buf has space.
+   int slice_known;    ///< Bit pattern of gains for which slice_buf is up to date.
+   /** Copy of an ADC samples item read with PROJ_LAZY_SAMPLES but not yet decoded. */
+   struct _struct_IO_BUFFER *pending_samples;
+   int pending_what;   ///< Non-zero while samples are pending: the flags for decoding them.
+   int dirty_first;    ///< First pixel with samples stored since they were last cleared.
+   int dirty_end;      ///< Beyond the last such pixel (no such pixels if not above dirty_first).
 };
 /** Use AdcData rather than the plain struct name in any code. */
 typedef struct simtel_tel_event_adc_struct AdcData;
 
+/** Samples read with PROJ_LAZY_SAMPLES but not decoded yet, thus not
+    included in the known bits. See decode_adc_samples(). */
+#define ADC_SAMPLES_PENDING(raw) ((raw)->pending_what != 0 && \
+   (raw)->pending_samples != NULL)
+
+/** The samples of one channel (igain, ipix) of ADC data, for use in code
+    which should work with or without HESSIO_DYNAMIC_SAMPLES defined.
+    Element isamp is at ADC_SAMPLES(raw,igain,ipix)[isamp]. */
+#ifdef HESSIO_DYNAMIC_SAMPLES
+#define ADC_SAMPLES(raw,igain,ipix) ((raw)->adc_sample_buf + \
+   ((size_t)(igain)*(size_t)(raw)->sample_pixels + (size_t)(ipix)) * \
+   (size_t)(raw)->sample_stride)
+#else
+#define ADC_SAMPLES(raw,igain,ipix) ((raw)->adc_sample[igain][ipix])
+#endif
+
+/** The samples of all pixels at slice isamp, in a slice-major view as
+    returned by adc_slice_major(): element ipix is at ADC_SLICE(view,raw,isamp)[ipix].
+    Each slice starts at a multiple of 64 bytes. */
+#define ADC_SLICE_STRIDE(raw) (((size_t)(raw)->num_pixels+31) & ~(size_t)31)
+#define ADC_SLICE(view,raw,isamp) ((view) + (size_t)(isamp)*ADC_SLICE_STRIDE(raw))
+
 /** Auxiliary digital trace (derived from FADC samples) */
 
 struct simtel_aux_digital_trace
@@ -1162,6 +1217,7 @@ struct simtel_tel_event_data_struct
    PixelTrgTime pixeltrg_time; ///< Times when individual pixels fired.
    AuxTraceD aux_trace_d[MAX_AUX_TRACE_D]; ///< Optional auxiliary digital traces.
    AuxTraceA aux_trace_a[MAX_AUX_TRACE_A]; ///< Optional auxiliary analog traces.
+   int dirty;              ///< Data was read in since the last hs_event_recycle().
 };
 /** Use TelEvent rather than the plain struct name in any code. */
 typedef struct simtel_tel_event_data_struct TelEvent;
@@ -1281,6 +1337,20 @@ struct simtel_event_data_struct
 /** Use FullEvent rather than the plain struct name in any code. */
 typedef struct simtel_event_data_struct FullEvent;
 
+/** Selection of what parts of an event should actually be decoded.
+    Sub-items of telescopes not selected and of kinds not selected are
+    skipped with only their headers being looked at. */
+
+struct simtel_event_projection_struct
+{
+   int what;         ///< As the 'what' argument of read_simtel_event(), e.g. RAWDATA_FLAG|IMAGE_FLAG.
+   int parts;        ///< Bit pattern of sub-item kinds to decode (PROJ_... flags).
+   int num_tel;      ///< Number of selected telescopes; zero means all telescopes.
+   int tel_id[H_MAX_TEL]; ///< IDs of selected telescopes.
+};
+/** Use EventProjection rather than the plain struct name in any code. */
+typedef struct simtel_event_projection_struct EventProjection;
+
 /** Monte Carlo shower profile (sort of histogram). */
 
 struct simtel_mc_shower_profile_struct
@@ -1609,10 +1679,18 @@ struct simtel_all_data_struct
    MCPixelMonitor mcpixmon[H_MAX_TEL];
    RunStat run_stat;
    MCRunStat mc_run_stat;
+   struct mem_arena_struct *arena; ///< Memory of per-telescope sub-structures, see alloc_hess_run_data().
 };
 /** Use AllHessData rather than the plain struct name in any code. */
 typedef struct simtel_all_data_struct AllHessData;
 
+/** Sub-structures per telescope set up by alloc_hess_run_data(). */
+#define HS_ALLOC_RAW    0x01  /**< AdcData */
+#define HS_ALLOC_PIXTM  0x02  /**< PixelTiming */
+#define HS_ALLOC_IMG    0x04  /**< Two sets of ImgData */
+#define HS_ALLOC_PIXCAL 0x08  /**< PixelCalibrated */
+#define HS_ALLOC_ALL    0x0f
+
 /* For the temporary benefit of montecarloreader/include/EventioReader.hh in HESS source tree: */
 #ifndef __MAKECINT__
 #define hess_all_data_struct simtel_all_data_struct
@@ -1629,6 +1707,32 @@ typedef struct simtel_all_data_struct AllHessData;
 
 void hs_reset_env(void);
 
+/** Telescope index lookup tables etc., see use_hessio_context(). */
+typedef struct hessio_context_struct HESSIO_CONTEXT;
+HESSIO_CONTEXT *allocate_hessio_context (void);
+void free_hessio_context (HESSIO_CONTEXT *ctx);
+HESSIO_CONTEXT *use_hessio_context (HESSIO_CONTEXT *ctx);
+HESSIO_CONTEXT *current_hessio_context (void);
+int set_hessio_decode_threads (int nthreads);
+int set_hessio_packed_samples (int on);
+
+void init_event_projection (EventProjection *proj, int what);
+int add_projection_telescope (EventProjection *proj, int tel_id);
+int projection_has_telescope (const EventProjection *proj, int tel_id);
+int read_simtel_televent_projected (IO_BUFFER *iobuf, TelEvent *te, 
+   const EventProjection *proj);
+int read_simtel_event_projected (IO_BUFFER *iobuf, FullEvent *ev, 
+   const EventProjection *proj);
+
+int alloc_adc_samples (AdcData *raw, int num_gains, int num_pixels, int num_samples);
+void free_adc_data (AdcData *raw);
+int alloc_hess_run_data (AllHessData *hsdata, int parts);
+void release_hess_run_data (AllHessData *hsdata);
+void free_hess_run_data (AllHessData *hsdata);
+const uint16_t *adc_slice_major (AdcData *raw, int igain);
+int decode_adc_samples (AdcData *raw);
+int hs_event_recycle (AllHessData *hsdata);
+
 void set_tel_idx_ref (int iref);
 void set_tel_idx (int ntel, int *idx);
 int find_tel_idx (int tel_id);
@@ -0,0 +1,106 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_index.h
+ *  @short Index of top-level I/O blocks for random access to eventio files.
+ *
+ *  An index lists file offset, type, version, ident, and length
+ *  of each top-level I/O block of an eventio data file, plus the
+ *  event (or shower) number for the blocks carrying one. It can be
+ *  kept in a sidecar file (by convention the data file name with
+ *  '.evidx' appended) and allows to position the input directly at
+ *  a given event or block, rather than scanning from the start.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef IO_INDEX_H__LOADED            /* Ignore if included a second time */
+
+#define IO_INDEX_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+#include "io_basic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** File name suffix of sidecar index files. */
+#define IO_INDEX_SUFFIX ".evidx"
+
+/** One entry in the block index, for each top-level I/O block. */
+struct io_index_entry_struct
+{
+   int64_t offset;        /**< Byte offset of the sync tag in the data file */
+   int64_t length;        /**< Length of the data, excluding the header */
+   long ident;            /**< The block ident */
+   long event;            /**< Event or shower number, if applicable, or -1 */
+   unsigned long type;    /**< The block type */
+   unsigned version;      /**< The block version */
+};
+typedef struct io_index_entry_struct IO_INDEX_ENTRY;
+
+/** Reference to an index entry, for lookup by event number. */
+struct io_index_event_struct
+{
+   long event;            /**< Event number of the entry */
+   size_t entry;          /**< Entry number */
+};
+typedef struct io_index_event_struct IO_INDEX_EVENT;
+
+/** The index of all top-level I/O blocks in a data file. */
+struct io_index_struct
+{
+   size_t num_entries;     /**< Number of entries in use */
+   size_t max_entries;     /**< Number of entries allocated */
+   int64_t indexed_length; /**< Bytes of the data file covered by the index */
+   IO_INDEX_ENTRY *entry;  /**< The entries, in file order */
+   size_t num_sorted;      /**< Entries covered by 'by_event' (else linear search) */
+   size_t num_by_event;    /**< Number of elements in 'by_event' */
+   IO_INDEX_EVENT *by_event; /**< Entries other than MC showers, sorted by
+                                  event number and then by entry number */
+};
+typedef struct io_index_struct IO_INDEX;
+
+IO_INDEX *allocate_io_index (void);
+void free_io_index (IO_INDEX *idx);
+int add_io_index_entry (IO_INDEX *idx, int64_t offset,
+   const IO_ITEM_HEADER *item_header);
+long build_io_index (IO_BUFFER *iobuf, IO_INDEX *idx);
+int sort_io_index (IO_INDEX *idx);
+int write_io_index (const IO_INDEX *idx, const char *fname);
+IO_INDEX *read_io_index (const char *fname);
+int check_io_index (const IO_INDEX *idx, const char *data_fname,
+   const char *index_fname);
+char *io_index_fname (const char *data_fname);
+long find_io_index_event (const IO_INDEX *idx, long event);
+long find_io_index_type (const IO_INDEX *idx, unsigned long type, long k);
+int seek_to_event (IO_BUFFER *iobuf, const IO_INDEX *idx, long event);
+int seek_to_type (IO_BUFFER *iobuf, const IO_INDEX *idx, unsigned long type, long k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_prefetch.h
+ *  @short Background prefetching of I/O blocks from the input of an I/O buffer.
+ *
+ *  With prefetching started on an I/O buffer, a reader thread finds
+ *  and reads the next few top-level I/O blocks into a pool of buffers
+ *  while the application is busy decoding the current one. The
+ *  application keeps using find_io_block(), read_io_block(), and
+ *  skip_io_block() as before; these take the blocks from the pool,
+ *  through the input hooks installed on the I/O buffer, so that only
+ *  programs actually starting the prefetching get this module linked.
+ *  Prefetching requires the library to be compiled with thread
+ *  support (_REENTRANT or EVENTIO_THREADS defined); otherwise
+ *  start_io_prefetch() fails and input continues to be read
+ *  synchronously.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef IO_PREFETCH_H__LOADED            /* Ignore if included a second time */
+
+#define IO_PREFETCH_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+#include "io_basic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default number of I/O blocks to read ahead. */
+#define IO_PREFETCH_DEFAULT_BLOCKS 4
+
+int start_io_prefetch (IO_BUFFER *iobuf, int nblocks);
+int stop_io_prefetch (IO_BUFFER *iobuf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
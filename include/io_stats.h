@@ -0,0 +1,86 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_stats.h
+ *  @short Per-type timing and byte counters for decoding and block I/O.
+ *
+ *  When enabled, either with start_io_stats() or by setting the
+ *  environment variable EVENTIO_STATS to the name of an output file
+ *  ("-" for standard output, "+" for standard error), the eventio core
+ *  accumulates per item type and nesting level the number of items,
+ *  their bytes, and the wall-clock and CPU time spent between
+ *  get_item_begin() and get_item_end(), both including and excluding
+ *  the time of sub-items. Calls of read_io_block() and write_io_block()
+ *  are accounted per type of top-level item. The accumulated
+ *  statistics are written in JSON format by report_io_stats() and,
+ *  with a file name given, at program exit.
+ *  The core functions only call this module through hooks installed
+ *  by start_io_stats(). Programs linked against the static library
+ *  only include the module (and thus the check of EVENTIO_STATS)
+ *  if they refer to any of the functions declared here.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef IO_STATS_H__LOADED            /* Ignore if included a second time */
+
+#define IO_STATS_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+#include "io_basic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Kinds of operations accounted. */
+#define IO_STATS_ITEM 1  /**< get_item_begin() to get_item_end() */
+#define IO_STATS_READ 2  /**< read_io_block() */
+#define IO_STATS_WRITE 3 /**< write_io_block() */
+
+/** Called by the eventio core while statistics are active. */
+struct io_stats_hooks
+{
+   void (*item_begin) (IO_BUFFER *iobuf, int ilevel);
+   void (*item_end) (IO_BUFFER *iobuf, unsigned long type, int ilevel, long bytes);
+   void (*block_begin) (IO_BUFFER *iobuf);
+   void (*block_end) (IO_BUFFER *iobuf, int op, unsigned long type, long bytes);
+   void (*release) (IO_BUFFER *iobuf);
+};
+
+/* Defined in eventio.c, such that the core does not depend on this module. */
+extern int io_stats_active;
+extern const struct io_stats_hooks *io_stats_hooks;
+
+int start_io_stats (const char *fname);
+void stop_io_stats (void);
+void reset_io_stats (void);
+int report_io_stats (FILE *f);
+void io_stats_check_env (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
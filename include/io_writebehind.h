@@ -0,0 +1,66 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_writebehind.h
+ *  @short Asynchronous output of I/O blocks from an I/O buffer.
+ *
+ *  With write-behind started on an I/O buffer, write_io_block() only
+ *  queues the completed top-level block for a writer thread (through
+ *  the output hooks installed on the I/O buffer, so that only programs
+ *  using write-behind need this module linked) and returns with a
+ *  fresh buffer, so that the application can go on filling the
+ *  next block while the previous one goes to the output file, pipe,
+ *  or user function. Blocks are written strictly in the order queued,
+ *  each to the output set in the I/O buffer at the time it was queued.
+ *  Before closing an output file (or writing to it in other ways) the
+ *  application must call flush_io_writebehind() as a fence.
+ *  Without thread support (_REENTRANT or EVENTIO_THREADS defined)
+ *  start_io_writebehind() fails and output stays synchronous.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef IO_WRITEBEHIND_H__LOADED            /* Ignore if included a second time */
+
+#define IO_WRITEBEHIND_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+#include "io_basic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default number of I/O blocks which can be queued for output. */
+#define IO_WRITEBEHIND_DEFAULT_BLOCKS 4
+
+int start_io_writebehind (IO_BUFFER *iobuf, int nblocks);
+int flush_io_writebehind (IO_BUFFER *iobuf);
+int stop_io_writebehind (IO_BUFFER *iobuf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
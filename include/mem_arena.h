@@ -0,0 +1,66 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file mem_arena.h
+ *  @short Arena (pool) allocator for data structures of the same lifetime.
+ *
+ *  Memory is taken in large chunks, handed out in pieces aligned to
+ *  64 bytes, and only ever given back all at once. After a reset, the
+ *  same chunks are used again, in the same order, so that allocating
+ *  the same sizes again (like for the telescopes of the next run with
+ *  the same configuration) ends up at the same addresses, without
+ *  further heap fragmentation or page faults. Chunks can be backed by
+ *  huge pages, where the system supports that.
+ *  An arena is not thread-safe.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#ifndef MEM_ARENA_H__LOADED           /* Ignore if included a second time */
+
+#define MEM_ARENA_H__LOADED 1
+
+#ifndef INITIAL_H__LOADED
+#include "initial.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_ARENA_HUGE_PAGES 0x01  /**< Back chunks by huge pages if possible */
+
+typedef struct mem_arena_struct MEM_ARENA;
+
+MEM_ARENA *allocate_mem_arena (size_t chunk_size, int flags);
+void free_mem_arena (MEM_ARENA *arena);
+void reset_mem_arena (MEM_ARENA *arena);
+int reserve_mem_arena (MEM_ARENA *arena, size_t size);
+void *mem_arena_calloc (MEM_ARENA *arena, size_t num, size_t size);
+size_t mem_arena_used (const MEM_ARENA *arena, size_t *total);
+int mem_arena_owns (const MEM_ARENA *arena, const void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -50,7 +50,7 @@ namespace eventio
 EventIO::EventIO (size_t initial_size, size_t max_size) :
    iobuf(0), toplevel(0), input_fname(""), output_fname(""),
    local_input(false), local_output(false), throw_on_error(false),
-   external_buffer(false)
+   external_buffer(false), index(0)
 {
    if ( max_size < initial_size )
       max_size = initial_size;
@@ -76,7 +76,7 @@ EventIO::EventIO (size_t initial_size, size_t max_size) :
 EventIO::EventIO (IO_BUFFER *bf) : iobuf(bf), toplevel(0), 
    input_fname(""), output_fname(""),
    local_input(false), local_output(false), throw_on_error(false),
-   external_buffer(true)
+   external_buffer(true), index(0)
 {
 }
 
@@ -87,7 +87,7 @@ EventIO::EventIO (IO_BUFFER *bf) : iobuf(bf), toplevel(0),
 EventIO::EventIO (UNUSED_PAR2(const EventIO& ,eventio) /* unused, throw logic error if called */) :
    iobuf(0), toplevel(0), input_fname(""), output_fname(""),
    local_input(false), local_output(false), throw_on_error(false),
-   external_buffer(false)
+   external_buffer(false), index(0)
 { 
    throw std::logic_error(std::string("I/O buffers should not be copy-constructed.\n"));
 }
@@ -176,6 +176,11 @@ int EventIO::OpenInput (FILE *f)
 int EventIO::CloseInput (void)
 {
    int rc = 0;
+   if ( index != 0 )
+   {
+      free_io_index(index);
+      index = 0;
+   }
    if ( iobuf->user_function != 0 )
       CloseFunction();
    if ( local_input && iobuf->input_file != 0 )
@@ -344,6 +349,81 @@ int EventIO::Write (void)
    return write_io_block(iobuf);
 }
 
+/// Load the block index for the current input.
+/// An index which no longer matches the input file (because that was
+/// rewritten or appended to) is not used; see BuildIndex() instead.
+///
+/// @param fname The name of the index file. By default the sidecar
+///              index file of the input file name ('.evidx' appended).
+/// @return 0 (OK), -1 (no such index or a stale one)
+
+int EventIO::LoadIndex (const char *fname)
+{
+   IO_INDEX *idx;
+   char *s = 0;
+   if ( fname == 0 )
+   {
+      if ( input_fname.empty() || input_fname == "-" )
+         return -1;
+      fname = s = io_index_fname(input_fname.c_str());
+   }
+   idx = read_io_index(fname);
+   if ( idx != 0 && !input_fname.empty() && input_fname != "-" &&
+        check_io_index(idx,input_fname.c_str(),fname) != 0 )
+   {
+      free_io_index(idx);
+      idx = 0;
+   }
+   free(s);
+   if ( idx == 0 )
+      return -1;
+   if ( index != 0 )
+      free_io_index(index);
+   index = idx;
+   return 0;
+}
+
+/// Build the block index by scanning the input from its current position,
+/// replacing any index loaded or built before.
+/// Afterwards the input is at its end; use SeekToEvent() or SeekToType().
+///
+/// @return Number of blocks indexed or -1 (error)
+
+int EventIO::BuildIndex (void)
+{
+   if ( toplevel != 0 )
+      toplevel->Done();
+   if ( index != 0 )
+      free_io_index(index);
+   if ( (index = allocate_io_index()) == 0 )
+      return -1;
+   return (int) build_io_index(iobuf,index);
+}
+
+/// Position the input at the first block of the given event,
+/// such that the next Find() gets it.
+///
+/// @return 0 (OK), -1 (no index, event not in index, or seek failed)
+
+int EventIO::SeekToEvent (long event)
+{
+   if ( toplevel != 0 )
+      toplevel->Done();
+   return seek_to_event(iobuf,index,event);
+}
+
+/// Position the input at the k-th block (counting from 0) of the given type,
+/// such that the next Find() gets it.
+///
+/// @return 0 (OK), -1 (no index, block not in index, or seek failed)
+
+int EventIO::SeekToType (unsigned long type, long k)
+{
+   if ( toplevel != 0 )
+      toplevel->Done();
+   return seek_to_type(iobuf,index,type,k);
+}
+
 /// Append one full I/O block at the current writing position into another one.
 
 int EventIO::Append(const EventIO& ev2)
@@ -361,6 +441,15 @@ int EventIO::Copy(const EventIO::Item& item)
    return copy_item_to_io_block (iobuf,item.iobuf,&item.item_header);
 }
 
+/// Write a sub-item directly as top-level item, without a copy.
+
+int EventIO::WriteItem(const EventIO::Item& item)
+{
+   if ( iobuf == 0 || item.iobuf == 0 )
+      return -1;
+   return write_item_as_io_block (iobuf,item.iobuf,&item.item_header);
+}
+
 // ===================== EventIO::Item methods ===========================
 
 /// Item constuctor for toplevel item takes the EventIO buffer as first argument.
@@ -583,6 +672,60 @@ int EventIO::Item::Search (size_t sub)
    return rc = search_sub_item(iobuf,&item_header,&sub_item_header);
 }
 
+/// Search the current item, starting at the current reading position,
+/// for the next sub-item of a specific type and identifier.
+///
+/// Typically used to pick out the data of particular telescopes.
+/// Like the other search, it uses the directory of sub-items
+/// built on the first search within the item.
+///
+/// @param sub The type of sub-item that we are searching for (0: any type).
+/// @param ident The identifier of the wanted sub-item.
+/// @return  0 (O.k., sub-item was found),
+///         -1 (error),
+///         -2 (no such sub-item),
+///         -3 (cannot skip sub-items).
+
+int EventIO::Item::Search (size_t sub, long ident)
+{
+   IO_ITEM_HEADER sub_item_header;
+   sub_item_header.type = sub;
+   if ( iobuf == 0 )
+      return rc = -1;
+   return rc = search_sub_item_ident(iobuf,&item_header,&sub_item_header,ident);
+}
+
+/// Get the directory of all sub-items of a searchable item.
+///
+/// The entries (type, identifier, header offset, and length of
+/// each sub-item) remain valid while this item is being read.
+///
+/// @param entries Set to point to the first entry.
+/// @return  Number of sub-items (>=0), -1 (error), -3 (not searchable).
+
+int EventIO::Item::Directory (const IO_SUB_ITEM_ENTRY **entries)
+{
+   if ( iobuf == 0 )
+      return rc = -1;
+   int n = get_sub_item_directory(iobuf,&item_header,entries);
+   rc = (n < 0) ? n : 0;
+   return n;
+}
+
+/// Go to a sub-item by its index in the directory of sub-items.
+///
+/// The sub-item can then be immediately opened as a new Eventio::Item.
+///
+/// @param index Index of the sub-item (0 to number of sub-items - 1).
+/// @return  0 (ok), -1 (error), -2 (no such sub-item), -3 (not searchable).
+
+int EventIO::Item::GoTo (int index)
+{
+   if ( iobuf == 0 )
+      return rc = -1;
+   return rc = goto_sub_item(iobuf,&item_header,index);
+}
+
 /// Rewind to beginning of the data area of the current item.
 ///
 /// You can restart searching for specific sub-items again.
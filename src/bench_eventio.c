@@ -0,0 +1,582 @@
+/* ============================================================================
+
+Copyright (C) 2026  agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/**
+ *  @file bench_eventio.c
+ *  @short Micro-benchmarks for the eventio primitives.
+ *
+ *  Measures the throughput of the variable-length count encodings,
+ *  vector and sfloat conversions, nested item handling, and of
+ *  finding and reading I/O blocks from a file (through a file
+ *  descriptor, a stdio stream, or a memory-mapped file).
+ *  All data is generated with a fixed seed, thus results from
+ *  different versions of the library can be compared directly.
+ *
+ *  @author agent
+ *  @date   2026
+ */
+
+/** @defgroup bench_eventio_c The bench_eventio program */
+/** @{ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include <time.h>
+#ifdef OS_UNIX
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+static int scale = 1;            /**< Multiplier for number of repetitions */
+static const char *only = NULL;  /**< Only run benchmarks with this in their name */
+static double sink = 0.;         /**< Keeps the compiler from optimizing away results */
+
+static double now (void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/** Deterministic pseudo-random numbers (64-bit LCG). */
+static uint64_t rnd_state = 12345;
+static uint32_t rnd (void)
+{
+   rnd_state = rnd_state * 6364136223846793005ULL + 1442695040888963407ULL;
+   return (uint32_t) (rnd_state >> 32);
+}
+
+/** Random value with a spread of magnitudes, as typical for counts. */
+static uint32_t rnd_count (void)
+{
+   uint32_t r = rnd();
+   return r >> (r % 29 + 3);
+}
+
+static int wanted (const char *name)
+{
+   return ( only == NULL || strstr(name,only) != NULL );
+}
+
+static void report (const char *name, double nops, double nbytes, double t)
+{
+   printf("%-34s %12.0f %10.2f %10.1f\n", name, nops,
+      (t > 0. && nops > 0.) ? 1e9*t/nops : 0.,
+      (t > 0.) ? nbytes/t/1e6 : 0.);
+}
+
+/* ---------------------- start_put, start_get -------------------- */
+/**
+ *  Begin a (top-level) item for writing, or go back to the start
+ *  of its data for reading as if it had just been read from a file.
+ */
+
+static void start_put (IO_BUFFER *iobuf, IO_ITEM_HEADER *ih)
+{
+   iobuf->item_level = 0;
+   iobuf->data = iobuf->buffer;
+   iobuf->w_remaining = -1;
+   ih->type = 99;
+   ih->version = 0;
+   ih->ident = 0;
+   put_item_begin(iobuf,ih);
+}
+
+static long start_get (IO_BUFFER *iobuf)
+{
+   long n = (long) (iobuf->data - iobuf->buffer) - 16;
+   iobuf->data = iobuf->buffer + 16;
+   iobuf->r_remaining = n;
+   return n;
+}
+
+/* ------------------------ bench_counts ---------------------- */
+/**
+ *  Variable-length unsigned and signed integers.
+ */
+
+static void bench_counts (IO_BUFFER *iobuf)
+{
+   const int num = 1<<18, nrep = 40*scale;
+   IO_ITEM_HEADER ih;
+   uint32_t *val = (uint32_t *) malloc(num*sizeof(uint32_t));
+   int32_t *ival = (int32_t *) malloc(num*sizeof(int32_t));
+   uint16_t *sval = (uint16_t *) malloc(num*sizeof(uint16_t));
+   int i, irep, m;
+   long n = 0;
+   double t, tp, tg;
+   uintmax_t usum = 0;
+   intmax_t ssum = 0;
+
+   for ( i=0; i<num; i++ )
+   {
+      val[i] = rnd_count();
+      ival[i] = (rnd() & 1) ? (int32_t) (val[i]>>1) : -(int32_t) (val[i]>>1);
+      sval[i] = (uint16_t) (300 + (rnd() % 40)); /* Like ADC samples */
+   }
+
+   for ( m=0; m<7; m++ )
+   {
+      static const char *name[] = { "count", "count32", "count16",
+         "scount", "scount32", "scount16", "vector_of_int_scount" };
+      char pname[64], gname[64];
+      if ( !wanted(name[m]) )
+         continue;
+      tp = tg = 0.;
+      for ( irep=0; irep<nrep; irep++ )
+      {
+         start_put(iobuf,&ih);
+         t = now();
+         switch ( m )
+         {
+            case 0: for ( i=0; i<num; i++ ) put_count(val[i],iobuf); break;
+            case 1: for ( i=0; i<num; i++ ) put_count32(val[i],iobuf); break;
+            case 2: for ( i=0; i<num; i++ ) put_count16((uint16_t)val[i],iobuf); break;
+            case 3: for ( i=0; i<num; i++ ) put_scount(ival[i],iobuf); break;
+            case 4: for ( i=0; i<num; i++ ) put_scount32(ival[i],iobuf); break;
+            case 5: for ( i=0; i<num; i++ ) put_scount16((int16_t)ival[i],iobuf); break;
+            case 6: put_vector_of_int_scount((int *) ival,num,iobuf); break;
+         }
+         tp += now() - t;
+         n = start_get(iobuf);
+         t = now();
+         switch ( m )
+         {
+            case 0: for ( i=0; i<num; i++ ) usum += get_count(iobuf); break;
+            case 1: for ( i=0; i<num; i++ ) usum += get_count32(iobuf); break;
+            case 2: for ( i=0; i<num; i++ ) usum += get_count16(iobuf); break;
+            case 3: for ( i=0; i<num; i++ ) ssum += get_scount(iobuf); break;
+            case 4: for ( i=0; i<num; i++ ) ssum += get_scount32(iobuf); break;
+            case 5: for ( i=0; i<num; i++ ) ssum += get_scount16(iobuf); break;
+            case 6: get_vector_of_int_scount((int *) ival,num,iobuf); ssum += ival[num-1]; break;
+         }
+         tg += now() - t;
+      }
+      snprintf(pname,sizeof(pname),"put_%s",name[m]);
+      snprintf(gname,sizeof(gname),"get_%s",name[m]);
+      report(pname,(double)nrep*num,(double)nrep*n,tp);
+      report(gname,(double)nrep*num,(double)nrep*n,tg);
+   }
+
+   /* Vector functions for the differential scount encoding of ADC samples */
+   for ( m=0; m<2; m++ )
+   {
+      static const char *name[] = { "vector_of_count32", "vector_of_uint16_scount_diff" };
+      char pname[64], gname[64];
+      if ( !wanted(name[m]) )
+         continue;
+      tp = tg = 0.;
+      for ( irep=0; irep<nrep; irep++ )
+      {
+         start_put(iobuf,&ih);
+         t = now();
+         if ( m == 0 )
+            for ( i=0; i<num; i++ ) put_count32(val[i],iobuf);
+         else
+            put_vector_of_uint16_scount_differential(sval,num,iobuf);
+         tp += now() - t;
+         n = start_get(iobuf);
+         t = now();
+         if ( m == 0 )
+            get_vector_of_count32(val,num,iobuf);
+         else
+            get_vector_of_uint16_scount_differential(sval,num,iobuf);
+         tg += now() - t;
+      }
+      snprintf(pname,sizeof(pname),"put_%s",name[m]);
+      snprintf(gname,sizeof(gname),"get_%s",name[m]);
+      if ( m == 1 ) /* The other one has no vector function for output */
+         report(pname,(double)nrep*num,(double)nrep*n,tp);
+      report(gname,(double)nrep*num,(double)nrep*n,tg);
+   }
+
+   sink += (double) usum + (double) ssum;
+   free(val);
+   free(ival);
+   free(sval);
+}
+
+/* ------------------------ bench_vectors ---------------------- */
+/**
+ *  Fixed-size vector functions, in native and reversed byte order.
+ */
+
+static void bench_vectors (IO_BUFFER *iobuf)
+{
+   const int num = 1<<20, nrep = 20*scale;
+   IO_ITEM_HEADER ih;
+   void *vec = calloc((size_t)num,8);
+   int bo, ty, irep, i;
+   static const char *tname[] = { "uint16", "int32", "float", "double", "byte" };
+   static const int tsize[] = { 2, 4, 4, 8, 1 };
+
+   for ( i=0; i<num; i++ )
+      ((uint16_t *) vec)[i] = (uint16_t) rnd();
+
+   for ( ty=0; ty<5; ty++ )
+   {
+      for ( bo=0; bo<=1; bo++ )
+      {
+         char name[64], pname[72], gname[72];
+         double tp = 0., tg = 0., t;
+         snprintf(name,sizeof(name),"vector_of_%s%s",tname[ty],bo?" (swapped)":"");
+         snprintf(pname,sizeof(pname),"put_%s",name);
+         snprintf(gname,sizeof(gname),"get_%s",name);
+         if ( !wanted(name) || (bo && ty == 4) )
+            continue;
+         for ( irep=0; irep<nrep; irep++ )
+         {
+            iobuf->byte_order = bo;
+            start_put(iobuf,&ih);
+            t = now();
+            switch ( ty )
+            {
+               case 0: put_vector_of_uint16((uint16_t *) vec,num,iobuf); break;
+               case 1: put_vector_of_int32((int32_t *) vec,num,iobuf); break;
+               case 2: put_vector_of_float((float *) vec,num,iobuf); break;
+               case 3: put_vector_of_double((double *) vec,num,iobuf); break;
+               case 4: put_vector_of_byte((BYTE *) vec,num,iobuf); break;
+            }
+            tp += now() - t;
+            start_get(iobuf);
+            t = now();
+            switch ( ty )
+            {
+               case 0: get_vector_of_uint16((uint16_t *) vec,num,iobuf); break;
+               case 1: get_vector_of_int32((int32_t *) vec,num,iobuf); break;
+               case 2: get_vector_of_float((float *) vec,num,iobuf); break;
+               case 3: get_vector_of_double((double *) vec,num,iobuf); break;
+               case 4: get_vector_of_byte((BYTE *) vec,num,iobuf); break;
+            }
+            tg += now() - t;
+            iobuf->byte_order = 0;
+         }
+         report(pname,(double)nrep*num,(double)nrep*num*tsize[ty],tp);
+         report(gname,(double)nrep*num,(double)nrep*num*tsize[ty],tg);
+      }
+   }
+
+   free(vec);
+}
+
+/* ------------------------ bench_sfloat ---------------------- */
+/**
+ *  Conversion to and from 16-bit floating point numbers.
+ */
+
+static void bench_sfloat (IO_BUFFER *iobuf)
+{
+   const int num = 1<<18, nrep = 20*scale;
+   IO_ITEM_HEADER ih;
+   float *fval = (float *) malloc(num*sizeof(float));
+   uint16_t *sval = (uint16_t *) malloc(num*sizeof(uint16_t));
+   int i, irep;
+   double t, t1 = 0., t2 = 0., t3 = 0., t4 = 0., t5 = 0., t6 = 0., sum = 0.;
+
+   if ( !wanted("sfloat") )
+   {
+      free(fval);
+      free(sval);
+      return;
+   }
+   for ( i=0; i<num; i++ )
+      fval[i] = (float) ((int) (rnd() % 200000) - 100000) * 1e-3f;
+
+   for ( irep=0; irep<nrep; irep++ )
+   {
+      t = now();
+      for ( i=0; i<num; i++ )
+         fltp_to_sfloat(&fval[i],&sval[i]);
+      t1 += now() - t;
+      t = now();
+      for ( i=0; i<num; i++ )
+         sum += dbl_from_sfloat(&sval[i]);
+      t2 += now() - t;
+      start_put(iobuf,&ih);
+      t = now();
+      for ( i=0; i<num; i++ )
+         put_sfloat(fval[i],iobuf);
+      t3 += now() - t;
+      start_get(iobuf);
+      t = now();
+      for ( i=0; i<num; i++ )
+         sum += get_sfloat(iobuf);
+      t4 += now() - t;
+      start_put(iobuf,&ih);
+      t = now();
+      put_vector_of_sfloat(fval,num,iobuf);
+      t5 += now() - t;
+      start_get(iobuf);
+      t = now();
+      get_vector_of_sfloat(fval,num,iobuf);
+      t6 += now() - t;
+      sum += fval[num-1];
+   }
+   report("fltp_to_sfloat",(double)nrep*num,(double)nrep*num*2,t1);
+   report("dbl_from_sfloat",(double)nrep*num,(double)nrep*num*2,t2);
+   report("put_sfloat",(double)nrep*num,(double)nrep*num*2,t3);
+   report("get_sfloat",(double)nrep*num,(double)nrep*num*2,t4);
+   report("put_vector_of_sfloat",(double)nrep*num,(double)nrep*num*2,t5);
+   report("get_vector_of_sfloat",(double)nrep*num,(double)nrep*num*2,t6);
+
+   sink += sum;
+   free(fval);
+   free(sval);
+}
+
+/** Output function discarding the data, for in-memory item benchmarks. */
+static int discard_block (unsigned char *buffer, long length, int flag)
+{
+   (void) buffer; (void) length; (void) flag;
+   return 0;
+}
+
+/* ------------------------ bench_items ---------------------- */
+/**
+ *  Nested items, like telescope data within events: each top-level
+ *  item has 'nsub' sub-items with 'nsub2' sub-sub-items each.
+ */
+
+static void bench_items (IO_BUFFER *iobuf)
+{
+   const int nsub = 32, nsub2 = 4, nrep = 20000*scale;
+   IO_ITEM_HEADER ih, ih1, ih2;
+   int irep, i, j;
+   long n = 0, sum = 0;
+   double t, tp = 0., tg = 0.;
+
+   if ( !wanted("item") )
+      return;
+   iobuf->user_function = discard_block;
+   iobuf->item_level = 0;
+   iobuf->data = iobuf->buffer;
+   iobuf->w_remaining = -1;
+   for ( irep=0; irep<nrep; irep++ )
+   {
+      t = now();
+      ih.type = 2010;
+      ih.version = 0;
+      ih.ident = irep;
+      put_item_begin(iobuf,&ih);
+      for ( i=0; i<nsub; i++ )
+      {
+         ih1.type = 2200+i;
+         ih1.version = 1;
+         ih1.ident = i;
+         put_item_begin(iobuf,&ih1);
+         for ( j=0; j<nsub2; j++ )
+         {
+            ih2.type = 2011+j;
+            ih2.version = 0;
+            ih2.ident = j;
+            put_item_begin(iobuf,&ih2);
+            put_int32(i*j,iobuf);
+            put_item_end(iobuf,&ih2);
+         }
+         put_item_end(iobuf,&ih1);
+      }
+      put_item_end(iobuf,&ih); /* The block contents stay in the buffer. */
+      tp += now() - t;
+      n = iobuf->item_length[0] + 16;
+
+      /* Pretend the block had just been read and decode it again. */
+      iobuf->data_pending = 0;
+      t = now();
+      ih.type = 2010;
+      get_item_begin(iobuf,&ih);
+      for ( i=0; i<nsub; i++ )
+      {
+         ih1.type = 2200+i;
+         get_item_begin(iobuf,&ih1);
+         for ( j=0; j<nsub2; j++ )
+         {
+            ih2.type = 2011+j;
+            get_item_begin(iobuf,&ih2);
+            sum += get_int32(iobuf);
+            get_item_end(iobuf,&ih2);
+         }
+         get_item_end(iobuf,&ih1);
+      }
+      get_item_end(iobuf,&ih);
+      tg += now() - t;
+   }
+   iobuf->user_function = NULL;
+   report("put_item_begin/end (nested)",(double)nrep*(1+nsub*(1+nsub2)),(double)nrep*n,tp);
+   report("get_item_begin/end (nested)",(double)nrep*(1+nsub*(1+nsub2)),(double)nrep*n,tg);
+   sink += sum;
+}
+
+/* ------------------------ bench_blocks ---------------------- */
+/**
+ *  Writing I/O blocks to a file and finding and reading them
+ *  back through the various input methods.
+ */
+
+static int bench_blocks (const char *dir)
+{
+   const int nblocks = 2000*scale, blen = 64000;
+   char fname[1024];
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER ih;
+   BYTE *payload;
+   int i, m, fd, nb;
+   double t, nbytes;
+
+   if ( !wanted("block") )
+      return 0;
+   snprintf(fname,sizeof(fname),"%s/bench_eventio_XXXXXX",dir);
+   if ( (fd = mkstemp(fname)) < 0 )
+   {
+      perror(fname);
+      return -1;
+   }
+   if ( (iobuf = allocate_io_buffer(blen+1024)) == NULL ||
+        (payload = (BYTE *) malloc(blen)) == NULL )
+      return -1;
+   for ( i=0; i<blen; i++ )
+      payload[i] = (BYTE) rnd();
+
+   iobuf->output_fileno = fd;
+   t = now();
+   for ( i=0; i<nblocks; i++ )
+   {
+      ih.type = 2010;
+      ih.version = 0;
+      ih.ident = i;
+      put_item_begin(iobuf,&ih);
+      put_vector_of_byte(payload,blen-(i%1000),iobuf);
+      put_item_end(iobuf,&ih);
+   }
+   fsync(fd);
+   t = now() - t;
+   nbytes = (double) lseek(fd,0,SEEK_CUR);
+   report("write_io_block (fd)",(double)nblocks,nbytes,t);
+   iobuf->output_fileno = -1;
+
+   for ( m=0; m<3; m++ )
+   {
+      static const char *name[] = { "find+read_io_block (fd)",
+         "find+read_io_block (stdio)", "find+read_io_block (mmap)" };
+      FILE *f = NULL;
+      lseek(fd,0,SEEK_SET);
+      if ( m == 0 )
+         iobuf->input_fileno = fd;
+      else if ( m == 1 )
+      {
+         if ( (f = fopen(fname,"r")) == NULL )
+            continue;
+         iobuf->input_file = f;
+      }
+      else
+      {
+#ifdef EVENTIO_HAVE_MMAP
+         if ( map_io_buffer_input(iobuf,fd) != 0 )
+            continue;
+#else
+         continue;
+#endif
+      }
+      nb = 0;
+      t = now();
+      while ( find_io_block(iobuf,&ih) == 0 && read_io_block(iobuf,&ih) == 0 )
+         nb++;
+      t = now() - t;
+      report(name[m],(double)nb,nbytes,t);
+#ifdef EVENTIO_HAVE_MMAP
+      if ( m == 2 )
+         unmap_io_buffer_input(iobuf);
+#endif
+      if ( f != NULL )
+         fclose(f);
+      iobuf->input_file = NULL;
+      iobuf->input_fileno = -1;
+   }
+
+   close(fd);
+   unlink(fname);
+   free(payload);
+   free_io_buffer(iobuf);
+   return 0;
+}
+
+static void syntax (const char *prg)
+{
+   fprintf(stderr,"Micro-benchmarks for eventio primitives.\n");
+   fprintf(stderr,"Syntax: %s [ -n scale ] [ -d tmpdir ] [ name-pattern ]\n", prg);
+   fprintf(stderr,"Options:\n");
+   fprintf(stderr,"  -n scale   Multiply the number of repetitions by that factor.\n");
+   fprintf(stderr,"  -d tmpdir  Directory for the temporary file of block I/O tests\n");
+   fprintf(stderr,"             (default: $TMPDIR or /tmp).\n");
+   fprintf(stderr,"Only benchmarks with the name pattern in their name are run.\n");
+   exit(1);
+}
+
+int main (int argc, char **argv)
+{
+   IO_BUFFER *iobuf;
+   const char *prg = argv[0];
+   const char *dir = getenv("TMPDIR");
+
+   if ( dir == NULL || *dir == '\0' )
+      dir = "/tmp";
+
+   while ( argc > 1 && argv[1][0] == '-' )
+   {
+      if ( strcmp(argv[1],"-n") == 0 && argc > 2 )
+      {
+         if ( (scale = atoi(argv[2])) < 1 )
+            scale = 1;
+         argc--;
+         argv++;
+      }
+      else if ( strcmp(argv[1],"-d") == 0 && argc > 2 )
+      {
+         dir = argv[2];
+         argc--;
+         argv++;
+      }
+      else
+         syntax(prg);
+      argc--;
+      argv++;
+   }
+   if ( argc > 2 )
+      syntax(prg);
+   if ( argc > 1 )
+      only = argv[1];
+
+   if ( (iobuf = allocate_io_buffer(10000000)) == NULL )
+      exit(1);
+   iobuf->max_length = 20000000;
+
+   printf("%-34s %12s %10s %10s\n","Benchmark","Operations","ns/op","MB/s");
+   bench_counts(iobuf);
+   bench_vectors(iobuf);
+   bench_sfloat(iobuf);
+   bench_items(iobuf);
+   free_io_buffer(iobuf);
+   if ( bench_blocks(dir) != 0 )
+      exit(1);
+
+   if ( sink == 0.123 ) /* Practically never */
+      printf("\n");
+   return 0;
+}
+
+/** @} */
@@ -210,7 +210,16 @@
 #endif
 #ifdef OS_UNIX
 #include <unistd.h>
+#include <sys/uio.h>
+#include <errno.h>
 #endif
+#ifdef EVENTIO_HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+#include <pthread.h>
+#endif
+#include "io_stats.h"
 
 #ifdef __GLIBC__
 # ifdef __GNUC__
@@ -223,6 +232,19 @@
 # endif
 #endif
 
+/* SSE2 is always available on x86_64 and used for bulk varint decoding. */
+#if defined(__SSE2__) && defined(__GNUC__) && !defined(NO_SIMD)
+# include <emmintrin.h>
+# define HAVE_SSE2_VARINT 1
+#endif
+
+/* Byte-order conversion of vectors with SSSE3 or AVX2, if available at run-time. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ >= 5 || defined(__clang__)) && !defined(NO_SIMD)
+# include <immintrin.h>
+# define HAVE_BSWAP_DISPATCH 1
+#endif
+
 #define IO_BUFFER_MINIMUM_SIZE 32L
 
 /* Author: Konrad Bernloehr */
@@ -233,6 +255,36 @@
   (ssize_t) fread((void *)buf,(size_t)1,(size_t)nb,stdin) : \
   read(fd,(void *)buf,(size_t)nb) )
 
+#ifdef EVENTIO_HAVE_MMAP
+static void mm_restore_buffer (IO_BUFFER *iobuf);
+#endif
+
+/*
+ *  For each level of nesting, the directory of the sub-items of a
+ *  searchable item (the one at that level being read) is built
+ *  upon first use by walking over the sub-item headers only.
+ *  Reading the header of another item at the same level with
+ *  get_item_begin() marks the directory as no longer valid.
+ */
+
+struct io_item_directory_struct
+{
+   int n;           /**< Number of entries, -1: not built, -2: not usable. */
+   int nalloc;      /**< Number of entries allocated. */
+   long start;      /**< The item_start_offset of the item described. */
+   long length;     /**< The item_length of the item described. */
+   IO_SUB_ITEM_ENTRY *entry; /**< The sub-items in the order found. */
+};
+
+static void free_item_directories (IO_BUFFER *iobuf);
+static const IO_SUB_ITEM_ENTRY *item_dir_lookup (IO_BUFFER *iobuf, 
+   int ilevel, long pos, int exact);
+
+/** Non-zero while statistics are being collected (see io_stats.h). */
+int io_stats_active = 0;
+/** The functions collecting them, installed by start_io_stats(). */
+const struct io_stats_hooks *io_stats_hooks = NULL;
+
 #ifdef BUG_CHECK
 static void bug_check (IO_BUFFER *iobuf)
 {
@@ -475,6 +527,38 @@ IO_BUFFER *allocate_io_buffer (size_t buflen)
    buf->total_input = buf->total_output = 0;
 #endif
 
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   /* The read-ahead buffer is only allocated once it is actually needed.
+      Its size can be changed with an environment variable "EVENTIO_READ_AHEAD",
+      where a value of "0" or "off" disables read-ahead. */
+   buf->ra_buffer = NULL;
+   buf->ra_length = 0;
+   buf->ra_pos = buf->ra_end = 0;
+   buf->ra_fileno = -1;
+   const char *sra = getenv("EVENTIO_READ_AHEAD");
+   if ( sra != NULL )
+   {
+      if ( *sra == '0' || strcasecmp(sra,"off") == 0 )
+         buf->ra_length = -1;
+      else
+         buf->ra_length = io_buffer_size_spec(sra);
+   }
+#endif
+
+#ifdef EVENTIO_HAVE_MMAP
+   buf->mm_data = buf->mm_buffer = NULL;
+   buf->mm_length = buf->mm_pos = 0;
+   buf->mm_buflen = 0;
+   buf->mm_is_allocated = 0;
+#endif
+   buf->prefetch = NULL;
+   buf->input_hooks = NULL;
+   buf->writebehind = NULL;
+   buf->output_hooks = NULL;
+   buf->item_dir = NULL;
+   buf->stats = NULL;
+   buf->last_failed_length = 0;
+
    return(buf);
 }
 
@@ -502,7 +586,6 @@ int extend_io_buffer (IO_BUFFER *iobuf, unsigned next_byte, long increment)
 {
    long new_length, offset, remaining;
    BYTE *tptr;
-   static long last_failed_length;
 
    /* NULL argument passed? */
    if ( iobuf == (IO_BUFFER *) NULL )
@@ -546,13 +629,10 @@ int extend_io_buffer (IO_BUFFER *iobuf, unsigned next_byte, long increment)
    /* buffer status is actually checked. */
    if ( (new_length = iobuf->buflen + increment) > iobuf->max_length )
    {
-      /* The following comparison is not strictly multi-threading safe */
-      /* but is not considered a problem since it can only result in */
-      /* too many warning messages and is only encountered in rare cases. */
-      if ( iobuf->buflen != last_failed_length )
+      if ( iobuf->buflen != iobuf->last_failed_length )
       {
          char msg[256];
-         last_failed_length = iobuf->buflen;
+         iobuf->last_failed_length = iobuf->buflen;
          (void) sprintf(msg,
              "Cannot extend I/O buffer of length %ld by another %ld bytes",
              iobuf->buflen,increment);
@@ -617,8 +697,23 @@ void free_io_buffer (IO_BUFFER *iobuf)
 {
    if ( iobuf != (IO_BUFFER *) NULL )
    {
+      if ( iobuf->input_hooks != NULL )
+         (*iobuf->input_hooks->stop)(iobuf);
+      if ( iobuf->output_hooks != NULL )
+         (*iobuf->output_hooks->stop)(iobuf);
+#ifdef EVENTIO_HAVE_MMAP
+      unmap_io_buffer_input(iobuf);
+#endif
       if ( iobuf->buffer != (BYTE *) NULL && iobuf->is_allocated )
          free((void *)iobuf->buffer);
+#ifdef EVENTIO_HAVE_READ_AHEAD
+      if ( iobuf->ra_buffer != (BYTE *) NULL )
+         free((void *)iobuf->ra_buffer);
+#endif
+      if ( iobuf->item_dir != NULL )
+         free_item_directories(iobuf);
+      if ( iobuf->stats != NULL )
+         (*io_stats_hooks->release)(iobuf);
       free((void *)iobuf);
    }
 }
@@ -1394,10 +1489,267 @@ void put_vector_of_int_scount (const int *vec, int num, IO_BUFFER *iobuf)
 void get_vector_of_int_scount (int *vec, int num, IO_BUFFER *iobuf)
 {
    int i;
+   if ( sizeof(int) == sizeof(int32_t) )
+   {
+      get_vector_of_scount32((int32_t *) vec,num,iobuf);
+      return;
+   }
    for (i=0; i<num; i++)
       vec[i] = get_scount32(iobuf);
 }
 
+/* ------------------------ count32_decode ---------------------- */
+/**
+ *  Decode one count32 value at a given position, without any check
+ *  of the remaining data (up to 9 bytes may be accessed).
+ *  Results are the same as with get_count32().
+ *
+ *  @return Number of bytes used.
+ */
+
+static int count32_decode (const BYTE *p, uint32_t *val)
+{
+   uint32_t v0 = p[0];
+
+   if ( (v0 & 0x80) == 0 )
+   {
+      *val = v0;
+      return 1;
+   }
+   if ( (v0 & 0xc0) == 0x80 )
+   {
+      *val = ((v0&0x3f)<<8) | (uint32_t) p[1];
+      return 2;
+   }
+   if ( (v0 & 0xe0) == 0xc0 )
+   {
+      *val = ((v0&0x1f)<<16) | ((uint32_t) p[1]<<8) | (uint32_t) p[2];
+      return 3;
+   }
+   if ( (v0 & 0xf0) == 0xe0 )
+   {
+      *val = ((v0&0x0f)<<24) | ((uint32_t) p[1]<<16) | 
+             ((uint32_t) p[2]<<8) | (uint32_t) p[3];
+      return 4;
+   }
+   if ( (v0 & 0xf8) == 0xf0 )
+   {
+      if ( (v0 & 0x07) != 0x00 )
+         Warning("Data too large in get_count32 function, clipped.");
+      *val = ((uint32_t) p[1]<<24) | ((uint32_t) p[2]<<16) | 
+             ((uint32_t) p[3]<<8) | (uint32_t) p[4];
+      return 5;
+   }
+   Warning("Data too large in get_count32 function.");
+   *val = 0;
+   if ( (v0 & 0xfc) == 0xf8 )
+      return 6;
+   if ( (v0 & 0xfe) == 0xfc )
+      return 7;
+   if ( (v0 & 0xff) == 0xfe )
+      return 8;
+   return 9;
+}
+
+#ifdef HAVE_SSE2_VARINT
+/* -------------------------- zz_decode_epi8 --------------------- */
+/**
+ *  Turn sixteen one-byte scount values into signed bytes:
+ *  (u>>1) ^ -(u&1), all within 8 bits.
+ */
+
+static inline __m128i zz_decode_epi8 (__m128i b)
+{
+   __m128i h = _mm_and_si128(_mm_srli_epi16(b,1),_mm_set1_epi8(0x7f));
+   __m128i s = _mm_sub_epi8(_mm_setzero_si128(),_mm_and_si128(b,_mm_set1_epi8(1)));
+   return _mm_xor_si128(h,s);
+}
+
+/* -------------------------- diff_prefix_u16 -------------------- */
+/**
+ *  Decode sixteen one-byte scount differences and store the running
+ *  sum, starting from 'val', as uint16_t. Arithmetic in 16-bit lanes
+ *  is modulo 2^16, so the stored values are the same as with the
+ *  scalar 32-bit accumulation.
+ *
+ *  @return The new running sum (as far as relevant for uint16_t).
+ */
+
+static inline int32_t diff_prefix_u16 (__m128i b, uint16_t *out, int32_t val)
+{
+   __m128i d = zz_decode_epi8(b);
+   __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(d,d),8);
+   __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(d,d),8);
+
+   /* Inclusive prefix sums within each group of eight */
+   lo = _mm_add_epi16(lo,_mm_slli_si128(lo,2));
+   hi = _mm_add_epi16(hi,_mm_slli_si128(hi,2));
+   lo = _mm_add_epi16(lo,_mm_slli_si128(lo,4));
+   hi = _mm_add_epi16(hi,_mm_slli_si128(hi,4));
+   lo = _mm_add_epi16(lo,_mm_slli_si128(lo,8));
+   hi = _mm_add_epi16(hi,_mm_slli_si128(hi,8));
+
+   lo = _mm_add_epi16(lo,_mm_set1_epi16((short) val));
+   /* Carry the last sum of the lower group into the upper group */
+   hi = _mm_add_epi16(hi,_mm_unpackhi_epi64(_mm_shufflehi_epi16(lo,0xff),
+                                            _mm_shufflehi_epi16(lo,0xff)));
+   _mm_storeu_si128((__m128i *) out,lo);
+   _mm_storeu_si128((__m128i *) (out+8),hi);
+
+   return (int32_t) (uint16_t) _mm_extract_epi16(hi,7);
+}
+
+/* -------------------------- diff_prefix_u32 -------------------- */
+/**
+ *  Decode sixteen one-byte scount differences and store the running
+ *  sum, starting from 'val', as uint32_t.
+ *
+ *  @return The new running sum.
+ */
+
+static inline int32_t diff_prefix_u32 (__m128i b, uint32_t *out, int32_t val)
+{
+   __m128i d = zz_decode_epi8(b);
+   __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(d,d),8);
+   __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(d,d),8);
+   __m128i x[4], base = _mm_set1_epi32(val);
+   int k;
+
+   x[0] = _mm_srai_epi32(_mm_unpacklo_epi16(lo,lo),16);
+   x[1] = _mm_srai_epi32(_mm_unpackhi_epi16(lo,lo),16);
+   x[2] = _mm_srai_epi32(_mm_unpacklo_epi16(hi,hi),16);
+   x[3] = _mm_srai_epi32(_mm_unpackhi_epi16(hi,hi),16);
+   for ( k=0; k<4; k++ )
+   {
+      x[k] = _mm_add_epi32(x[k],_mm_slli_si128(x[k],4));
+      x[k] = _mm_add_epi32(x[k],_mm_slli_si128(x[k],8));
+      x[k] = _mm_add_epi32(x[k],base);
+      _mm_storeu_si128((__m128i *) (out+4*k),x[k]);
+      base = _mm_shuffle_epi32(x[k],0xff);
+   }
+
+   return (int32_t) _mm_cvtsi128_si32(base);
+}
+#endif
+
+/* ------------------------- count32_bulk ----------------------- */
+/**
+ *  Decode as many count32 values as can be done without checking
+ *  for the end of the data with each value. With 'zigzag' set, the
+ *  values are converted to signed values as in get_scount32().
+ *  Runs of one-byte values are handled 16 at a time with SSE2.
+ *
+ *  @return Number of values decoded (the rest to be done with checks).
+ */
+
+static int count32_bulk (uint32_t *vec, int num, IO_BUFFER *iobuf, int zigzag)
+{
+   BYTE *p = iobuf->data;
+   const BYTE *end = p + (iobuf->r_remaining > 0 ? iobuf->r_remaining : 0);
+   int i = 0;
+
+   while ( i < num )
+   {
+      /* Each value takes at most 9 bytes; that many are safe to decode. */
+      long safe = (long) (end - p) / 9;
+      int stop = (safe < (long) (num - i)) ? i + (int) safe : num;
+      if ( stop <= i )
+         break;
+      while ( i < stop )
+      {
+         uint32_t u;
+#ifdef HAVE_SSE2_VARINT
+         if ( stop - i >= 16 )
+         {
+            __m128i b = _mm_loadu_si128((const __m128i *) p);
+            int m = _mm_movemask_epi8(b);
+            if ( m == 0 ) /* Sixteen one-byte values */
+            {
+               const __m128i zero = _mm_setzero_si128();
+               __m128i lo, hi;
+               if ( zigzag )
+               {
+                  b = zz_decode_epi8(b);
+                  lo = _mm_srai_epi16(_mm_unpacklo_epi8(b,b),8);
+                  hi = _mm_srai_epi16(_mm_unpackhi_epi8(b,b),8);
+                  _mm_storeu_si128((__m128i *)(vec+i),   _mm_srai_epi32(_mm_unpacklo_epi16(lo,lo),16));
+                  _mm_storeu_si128((__m128i *)(vec+i+4), _mm_srai_epi32(_mm_unpackhi_epi16(lo,lo),16));
+                  _mm_storeu_si128((__m128i *)(vec+i+8), _mm_srai_epi32(_mm_unpacklo_epi16(hi,hi),16));
+                  _mm_storeu_si128((__m128i *)(vec+i+12),_mm_srai_epi32(_mm_unpackhi_epi16(hi,hi),16));
+               }
+               else
+               {
+                  lo = _mm_unpacklo_epi8(b,zero);
+                  hi = _mm_unpackhi_epi8(b,zero);
+                  _mm_storeu_si128((__m128i *)(vec+i),   _mm_unpacklo_epi16(lo,zero));
+                  _mm_storeu_si128((__m128i *)(vec+i+4), _mm_unpackhi_epi16(lo,zero));
+                  _mm_storeu_si128((__m128i *)(vec+i+8), _mm_unpacklo_epi16(hi,zero));
+                  _mm_storeu_si128((__m128i *)(vec+i+12),_mm_unpackhi_epi16(hi,zero));
+               }
+               i += 16;
+               p += 16;
+               continue;
+            }
+            else
+            {
+               /* One-byte values before the first multi-byte value. */
+               int k, n1 = __builtin_ctz((unsigned) m);
+               for ( k=0; k<n1; k++ )
+               {
+                  u = p[k];
+                  vec[i+k] = zigzag ? ((u>>1) ^ (uint32_t)(-(int32_t)(u&1))) : u;
+               }
+               i += n1;
+               p += n1;
+            }
+         }
+#endif
+         p += count32_decode(p,&u);
+         vec[i++] = zigzag ? ((u>>1) ^ (uint32_t)(-(int32_t)(u&1))) : u;
+      }
+   }
+
+   iobuf->r_remaining -= (long) (p - iobuf->data);
+   iobuf->data = p;
+   return i;
+}
+
+/* -------------------- get_vector_of_count32 ------------------- */
+/**
+ *  @short Get an array of count32 data from an I/O buffer.
+ *
+ *  Results are the same as calling get_count32() for each element
+ *  but the bounds of the data are checked only once for most of
+ *  the elements and runs of small values are decoded in bulk.
+ */
+
+void get_vector_of_count32 (uint32_t *vec, int num, IO_BUFFER *iobuf)
+{
+   int i;
+   if ( vec == NULL || num <= 0 )
+      return;
+   for ( i=count32_bulk(vec,num,iobuf,0); i<num; i++ )
+      vec[i] = get_count32(iobuf);
+}
+
+/* -------------------- get_vector_of_scount32 ------------------ */
+/**
+ *  @short Get an array of scount32 data from an I/O buffer.
+ *
+ *  Results are the same as calling get_scount32() for each element
+ *  but the bounds of the data are checked only once for most of
+ *  the elements and runs of small values are decoded in bulk.
+ */
+
+void get_vector_of_scount32 (int32_t *vec, int num, IO_BUFFER *iobuf)
+{
+   int i;
+   if ( vec == NULL || num <= 0 )
+      return;
+   for ( i=count32_bulk((uint32_t *)vec,num,iobuf,1); i<num; i++ )
+      vec[i] = get_scount32(iobuf);
+}
+
 /* ----------- put_vector_of_uint16_scount_differential -------- */
 /**
  *  @short Put an array of uint16_t as differential scount data into an I/O buffer.
@@ -1442,96 +1794,123 @@ void put_vector_of_uint16_scount_differential (uint16_t *vec, int num, IO_BUFFER
 /**
  *  @short Get an array of uint16_t as differential scount data from an I/O buffer.
  *
- *  For optimization reasons it is assumed that the data has been written
- *  in a consistent way and is complete. Only minimal tests for remaining data
- *  in the buffer are made - while the slower generic version would check for
- *  each extracted number.
+ *  For optimization reasons the remaining data is checked only once
+ *  per run of values that could not go beyond the end of the data
+ *  (three bytes per value at most), and runs of sixteen one-byte
+ *  differences get decoded and summed up in one go with SSE2.
+ *  Only near the end of the data the generic, checking, version
+ *  is used. Results are the same as with get_adcsample_differential()
+ *  in io_hess.c (which now uses this function).
  *
  */
 
 void get_vector_of_uint16_scount_differential (uint16_t *vec, int num, IO_BUFFER *iobuf)
 {
-#if 0
-   /* Generic version, via get_scount32, get_count32, get_byte: identical to get_adcsample_differential */
-   int i;
-   int32_t val = 0;
-   for ( i=0; i<num; i++ )
-   {
-      /* Largest possible changes are within +- 65535. */
-      val += get_scount32(iobuf);
-      vec[i] = (uint16_t) val;
-   }
-#else
-   /* Do everything directly in a more optimized way */
-   int i;
+   int i = 0;
    int32_t val = 0;
    BYTE v0, v1, v2;
-   BYTE *data0 = iobuf->data;
-   for ( i=0; i<num; i++ )
+   BYTE *p = iobuf->data;
+   const BYTE *end = p + (iobuf->r_remaining > 0 ? iobuf->r_remaining : 0);
+
+   while ( i < num )
    {
-      v0 = *(iobuf->data);
-      if ( (v0 & 0x80) == 0 ) /* One-byte count (-64 to +63) */
-      {
-         if ( (v0 & 0x01) == 0 ) /* positive */
-            val += (v0>>1);
-         else                    /* negative */
-            val -= (v0>>1) + 1;
-         iobuf->data++;
-      }
-      else if ( (v0 & 0xc0) == 0x80 ) /* Two-byte count (-8192 to +8191) */
-      {
-         v1 = iobuf->data[1];
-         if ( (v1 & 0x01) == 0 ) /* positive */
-            /* Tried '+' and '|' here but no difference seen in performance. */
-            /* Whether using int16_t or int32_t for the intermediate does not make a difference either. */
-            val += (((int16_t) (v0&0x3f)) << 7) | (int16_t) (v1>>1);
-         else                    /* negative */
-            val -= ((((int16_t) (v0&0x3f)) << 7) | (int16_t) (v1>>1)) + (int16_t) 1;
-         iobuf->data        += 2;
-      }
-      else if ( (v0 & 0xe0) == 0xc0 ) /* Three-byte count (-1048576 to +1048575) */
-      {
-         v1 = iobuf->data[1];
-         v2 = iobuf->data[2];
-         if ( (v2 & 0x01) == 0 ) /* positive */
-            val += (((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1);
-         else                    /* negative */
-            val -= ((((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1)) + 1;
-         iobuf->data        += 3;
-      }
-      else
+      /* Valid data uses at most three bytes per value. */
+      long safe = (long) (end - p) / 3;
+      int stop = (safe < (long) (num - i)) ? i + (int) safe : num;
+      if ( stop <= i )
+         break;
+      while ( i < stop )
       {
-         int dr = 3;
-         Warning("Invalid uint16_scount_differential data.");
-         val = 0;
-         if ( (v0 & 0xf0) == 0xe0 )
-            dr = 4;
-         else if ( (v0 & 0xf8) == 0xf0 )
-            dr = 5;
-         else if ( (v0 & 0xfc) == 0xf8 )
-            dr = 6;
-         else if ( (v0 & 0xfe) == 0xfc )
-            dr = 7;
-         else if ( (v0 & 0xff) == 0xfe )
-            dr = 8;
+#ifdef HAVE_SSE2_VARINT
+         if ( stop - i >= 16 )
+         {
+            __m128i b = _mm_loadu_si128((const __m128i *) p);
+            int m = _mm_movemask_epi8(b);
+            if ( m == 0 ) /* Sixteen one-byte differences */
+            {
+               val = diff_prefix_u16(b,vec+i,val);
+               i += 16;
+               p += 16;
+               continue;
+            }
+            else
+            {
+               int k, n1 = __builtin_ctz((unsigned) m);
+               for ( k=0; k<n1; k++ )
+               {
+                  val += ((int32_t) (p[k]>>1)) ^ (-(int32_t) (p[k]&1));
+                  vec[i+k] = (uint16_t) val;
+               }
+               i += n1;
+               p += n1;
+            }
+         }
+#endif
+         v0 = *p;
+         if ( (v0 & 0x80) == 0 ) /* One-byte count (-64 to +63) */
+         {
+            if ( (v0 & 0x01) == 0 ) /* positive */
+               val += (v0>>1);
+            else                    /* negative */
+               val -= (v0>>1) + 1;
+            p++;
+         }
+         else if ( (v0 & 0xc0) == 0x80 ) /* Two-byte count (-8192 to +8191) */
+         {
+            v1 = p[1];
+            if ( (v1 & 0x01) == 0 ) /* positive */
+               /* Tried '+' and '|' here but no difference seen in performance. */
+               /* Whether using int16_t or int32_t for the intermediate does not make a difference either. */
+               val += (((int16_t) (v0&0x3f)) << 7) | (int16_t) (v1>>1);
+            else                    /* negative */
+               val -= ((((int16_t) (v0&0x3f)) << 7) | (int16_t) (v1>>1)) + (int16_t) 1;
+            p += 2;
+         }
+         else if ( (v0 & 0xe0) == 0xc0 ) /* Three-byte count (-1048576 to +1048575) */
+         {
+            v1 = p[1];
+            v2 = p[2];
+            if ( (v2 & 0x01) == 0 ) /* positive */
+               val += (((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1);
+            else                    /* negative */
+               val -= ((((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1)) + 1;
+            p += 3;
+         }
          else
-            dr = 9;
-         iobuf->data += dr;
+         {
+            int dr = 3;
+            Warning("Invalid uint16_scount_differential data.");
+            val = 0;
+            if ( (v0 & 0xf0) == 0xe0 )
+               dr = 4;
+            else if ( (v0 & 0xf8) == 0xf0 )
+               dr = 5;
+            else if ( (v0 & 0xfc) == 0xf8 )
+               dr = 6;
+            else if ( (v0 & 0xfe) == 0xfc )
+               dr = 7;
+            else if ( (v0 & 0xff) == 0xfe )
+               dr = 8;
+            else
+               dr = 9;
+            p += dr;
+            vec[i++] = (uint16_t) val;
+            break; /* Skipped more than accounted for */
+         }
+         vec[i++] = (uint16_t) val;
       }
+   }
+   iobuf->r_remaining -= (long) (p - iobuf->data);
+   iobuf->data = p;
+
+   /* Whatever is left near the end of the data, with all checks. */
+   for ( ; i<num; i++ )
+   {
+      val += get_scount32(iobuf);
       vec[i] = (uint16_t) val;
-#ifdef BUG_CHECK
-      if ( iobuf->r_remaining <= (iobuf->data - data0)
-      {
-         Warning("I/O buffer reading exhausted");
-         break;
-      }
-#endif
    }
-   iobuf->r_remaining -= (iobuf->data - data0);
-#endif
 }
 
-
 /* ----------- put_vector_of_uint16_scount_differential -------- */
 /**
  *  @short Put an array of uint16_t as differential scount data into an I/O buffer.
@@ -1561,163 +1940,559 @@ void put_vector_of_uint32_scount_differential (uint32_t *vec, int num, IO_BUFFER
 /**
  *  @short Get an array of uint32_t as differential scount data from an I/O buffer.
  *
- *  For optimization reasons it is assumed that the data has been written
- *  in a consistent way and is complete. Only minimal tests for remaining data
- *  in the buffer are made - while the slower generic version would check for
- *  each extracted number.
+ *  Same scheme as get_vector_of_uint16_scount_differential(),
+ *  with up to five bytes per value.
  *
  */
 
 void get_vector_of_uint32_scount_differential (uint32_t *vec, int num, IO_BUFFER *iobuf)
 {
-#if 0
-   /* Generic version, via get_scount32, get_count32, get_byte: identical to get_adcsample_differential */
-   int i;
-   int32_t val = 0;
-   for ( i=0; i<num; i++ )
-   {
-      /* Assume that largest possible changes are within -2^31 to 2^31-1. */
-      val += get_scount32(iobuf);
-      vec[i] = (uint32_t) val;
-   }
-#else
-   /* Do everything directly in a more optimized way */
-   int i;
+   int i = 0;
    int32_t val = 0;
    BYTE v0, v1, v2, v3, v4;
-   BYTE *data0 = iobuf->data;
-   for ( i=0; i<num; i++ )
+   BYTE *p = iobuf->data;
+   const BYTE *end = p + (iobuf->r_remaining > 0 ? iobuf->r_remaining : 0);
+
+   while ( i < num )
    {
-      v0 = *(iobuf->data);
-      if ( (v0 & 0x80) == 0 ) /* One-byte count (6 bits + sign: -64 to +63) */
-      {
-         if ( (v0 & 0x01) == 0 ) /* positive */
-            val += (v0>>1);
-         else                    /* negative */
-            val -= (v0>>1) + 1;
-         iobuf->data++;
-      }
-      else if ( (v0 & 0xc0) == 0x80 ) /* Two-byte count (13+: -8192 to +8191) */
-      {
-         v1 = iobuf->data[1];
-         if ( (v1 & 0x01) == 0 ) /* positive */
-            val += (((int32_t) (v0&0x3f)) << 7) | (int32_t) (v1>>1);
-         else                    /* negative */
-            val -= ((((int32_t) (v0&0x3f)) << 7) | (int32_t) (v1>>1)) + 1;
-         iobuf->data += 2;
-      }
-      else if ( (v0 & 0xe0) == 0xc0 ) /* Three-byte count (20+: -1048576 to +1048575) */
-      {
-         v1 = iobuf->data[1];
-         v2 = iobuf->data[2];
-         if ( (v2 & 0x01) == 0 ) /* positive */
-            val += (((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1);
-         else                    /* negative */
-            val -= ((((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1)) + 1;
-         iobuf->data += 3;
-      }
-      else if ( (v0 & 0xf0) == 0xe0 ) /* Four-byte count (27+: -134217728 to +134217727) */
-      {
-         v1 = iobuf->data[1];
-         v2 = iobuf->data[2];
-         v3 = iobuf->data[3];
-         if ( (v3 & 0x01) == 0 ) /* positive */
-            val += (((int32_t) (v0&0x0f)) << 23) | (((int32_t) v1) << 15) | (((int32_t) v2) << 7) | (int32_t) (v3>>1);
-         else                    /* negative */
-            val -= ((((int32_t) (v0&0x0f)) << 23) | (((int32_t) v1) << 15) | (((int32_t) v2) << 7) | (int32_t) (v3>>1)) + 1;
-         iobuf->data += 4;
-      }
-      else if ( (v0 & 0xf8) == 0xf0 ) /* Five-byte count (34+: -17179869184 to +17179869183) */
-      {
-         v1 = iobuf->data[1];
-         v2 = iobuf->data[2];
-         v3 = iobuf->data[3];
-         v4 = iobuf->data[4];
-         /* The format would allow bits 32 and 33 being set but we ignore this here. */
-         if ( (v4 & 0x01) == 0 ) /* positive */
-            val += (((int64_t) (v0&0x07)) << 31) | (((int32_t) v1) << 23) | 
-                   (((int32_t) v2) <<15) | (((int32_t) v3) << 7) | (int32_t) (v4>>1);
-         else                    /* negative */
-            val -= ((((int64_t) (v0&0x07)) << 31) | (((int32_t) v1) << 23) | 
-                   (((int32_t) v2) <<15) | (((int32_t) v3) << 7) | (int32_t) (v4>>1)) + 1;
-         iobuf->data += 5;
-      }
-      else
+      /* Valid data uses at most five bytes per value. */
+      long safe = (long) (end - p) / 5;
+      int stop = (safe < (long) (num - i)) ? i + (int) safe : num;
+      if ( stop <= i )
+         break;
+      while ( i < stop )
       {
-         int dr = 3;
-         Warning("Invalid uint32_scount_differential data.");
-         val = 0;
-         if ( (v0 & 0xfc) == 0xf8 )
-            dr = 6;
-         else if ( (v0 & 0xfe) == 0xfc )
-            dr = 7;
-         else if ( (v0 & 0xff) == 0xfe )
-            dr = 8;
+#ifdef HAVE_SSE2_VARINT
+         if ( stop - i >= 16 )
+         {
+            __m128i b = _mm_loadu_si128((const __m128i *) p);
+            int m = _mm_movemask_epi8(b);
+            if ( m == 0 ) /* Sixteen one-byte differences */
+            {
+               val = diff_prefix_u32(b,vec+i,val);
+               i += 16;
+               p += 16;
+               continue;
+            }
+            else
+            {
+               int k, n1 = __builtin_ctz((unsigned) m);
+               for ( k=0; k<n1; k++ )
+               {
+                  val += ((int32_t) (p[k]>>1)) ^ (-(int32_t) (p[k]&1));
+                  vec[i+k] = (uint32_t) val;
+               }
+               i += n1;
+               p += n1;
+            }
+         }
+#endif
+         v0 = *p;
+         if ( (v0 & 0x80) == 0 ) /* One-byte count (6 bits + sign: -64 to +63) */
+         {
+            if ( (v0 & 0x01) == 0 ) /* positive */
+               val += (v0>>1);
+            else                    /* negative */
+               val -= (v0>>1) + 1;
+            p++;
+         }
+         else if ( (v0 & 0xc0) == 0x80 ) /* Two-byte count (13+: -8192 to +8191) */
+         {
+            v1 = p[1];
+            if ( (v1 & 0x01) == 0 ) /* positive */
+               val += (((int32_t) (v0&0x3f)) << 7) | (int32_t) (v1>>1);
+            else                    /* negative */
+               val -= ((((int32_t) (v0&0x3f)) << 7) | (int32_t) (v1>>1)) + 1;
+            p += 2;
+         }
+         else if ( (v0 & 0xe0) == 0xc0 ) /* Three-byte count (20+: -1048576 to +1048575) */
+         {
+            v1 = p[1];
+            v2 = p[2];
+            if ( (v2 & 0x01) == 0 ) /* positive */
+               val += (((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1);
+            else                    /* negative */
+               val -= ((((int32_t) (v0&0x1f)) << 15) | (((int32_t) v1) << 7) | (int32_t) (v2>>1)) + 1;
+            p += 3;
+         }
+         else if ( (v0 & 0xf0) == 0xe0 ) /* Four-byte count (27+: -134217728 to +134217727) */
+         {
+            v1 = p[1];
+            v2 = p[2];
+            v3 = p[3];
+            if ( (v3 & 0x01) == 0 ) /* positive */
+               val += (((int32_t) (v0&0x0f)) << 23) | (((int32_t) v1) << 15) | (((int32_t) v2) << 7) | (int32_t) (v3>>1);
+            else                    /* negative */
+               val -= ((((int32_t) (v0&0x0f)) << 23) | (((int32_t) v1) << 15) | (((int32_t) v2) << 7) | (int32_t) (v3>>1)) + 1;
+            p += 4;
+         }
+         else if ( (v0 & 0xf8) == 0xf0 ) /* Five-byte count (34+: -17179869184 to +17179869183) */
+         {
+            v1 = p[1];
+            v2 = p[2];
+            v3 = p[3];
+            v4 = p[4];
+            /* The format would allow bits 32 and 33 being set but we ignore this here. */
+            if ( (v4 & 0x01) == 0 ) /* positive */
+               val += (((int64_t) (v0&0x07)) << 31) | (((int32_t) v1) << 23) | 
+                      (((int32_t) v2) <<15) | (((int32_t) v3) << 7) | (int32_t) (v4>>1);
+            else                    /* negative */
+               val -= ((((int64_t) (v0&0x07)) << 31) | (((int32_t) v1) << 23) | 
+                      (((int32_t) v2) <<15) | (((int32_t) v3) << 7) | (int32_t) (v4>>1)) + 1;
+            p += 5;
+         }
          else
-            dr = 9;
-         iobuf->data += dr;
+         {
+            int dr = 3;
+            Warning("Invalid uint32_scount_differential data.");
+            val = 0;
+            if ( (v0 & 0xfc) == 0xf8 )
+               dr = 6;
+            else if ( (v0 & 0xfe) == 0xfc )
+               dr = 7;
+            else if ( (v0 & 0xff) == 0xfe )
+               dr = 8;
+            else
+               dr = 9;
+            p += dr;
+            vec[i++] = (uint32_t) val;
+            break; /* Skipped more than accounted for */
+         }
+         vec[i++] = (uint32_t) val;
       }
+   }
+   iobuf->r_remaining -= (long) (p - iobuf->data);
+   iobuf->data = p;
+
+   /* Whatever is left near the end of the data, with all checks. */
+   for ( ; i<num; i++ )
+   {
+      val += get_scount32(iobuf);
       vec[i] = (uint32_t) val;
-#ifdef BUG_CHECK
-      if ( iobuf->r_remaining <= (iobuf->data - data0)
-      {
-         Warning("I/O buffer reading exhausted");
-         break;
-      }
-#endif
    }
-   iobuf->r_remaining -= (iobuf->data - data0);
-#endif
 }
 
-
-/* -------------------------- put_short ------------------------ */
+/* ------------------ put_vector_of_uint16_packed ----------------- */
 /**
- *  @short Put a two-byte integer on an I/O buffer.
- *
- *  Put a two-byte integer on an I/O buffer with least
- *  significant byte first. Should be machine independent
- *  as long as 'short' and 'unsigned short' are 16-bit integers,
- *  the two's complement is used for negative numbers, and
- *  the '>>' operator does a logical shift with unsigned short.
- *  Although the 'num' argument is a 4-byte integer on most
- *  machines, the value shoud be in the range -32768 to 32767.
- *
- *  @param  num     The number to be saved. Should fit into a
- *                  short integer and will be truncated otherwise.
+ *  @short Put an array of uint16_t as a base value plus bit-packed residuals.
+ *
+ *  The smallest value is stored as a count, followed by one byte with
+ *  the number of bits (0 to 16) needed for the largest difference to
+ *  it, and the differences of all values to the smallest one, packed
+ *  with that many bits each, least significant bits first, into
+ *  (num*nbits+7)/8 bytes. For traces with a pedestal and small
+ *  fluctuations this is more compact than differential scount data,
+ *  and neither encoding nor decoding has branches depending on the data.
+ *
+ *  @param  vec     The values to be saved.
+ *  @param  num     The number of values.
  *  @param  iobuf   The output buffer descriptor.
  *
  *  @return (none)
  */
 
-void put_short(int num, IO_BUFFER *iobuf)
+void put_vector_of_uint16_packed (const uint16_t *vec, int num, IO_BUFFER *iobuf)
 {
-   union
+   uint16_t vmin, vmax;
+   uint64_t acc = 0;
+   int i, nbits = 0, nacc = 0;
+   long nb;
+   BYTE *p;
+
+   if ( vec == NULL || num <= 0 )
+      return;
+   vmin = vmax = vec[0];
+   for ( i=1; i<num; i++ )
    {
-      int16_t sval;
-      BYTE cval[2];
-   } val[2];
+      vmin = (vec[i] < vmin) ? vec[i] : vmin;
+      vmax = (vec[i] > vmax) ? vec[i] : vmax;
+   }
+   while ( nbits < 16 && ((uint32_t) (vmax - vmin) >> nbits) != 0 )
+      nbits++;
 
-   if ( (iobuf->w_remaining-=2) < 0 )
-      if ( extend_io_buffer(iobuf,256,IO_BUFFER_LENGTH_INCREMENT) < 0 )
+   put_count32(vmin,iobuf);
+   put_byte(nbits,iobuf);
+   if ( (nb = ((long) num * nbits + 7) / 8) == 0 )
+      return;
+   if ( (iobuf->w_remaining-=nb) < 0 )
+      if ( extend_io_buffer(iobuf,256,nb+IO_BUFFER_LENGTH_INCREMENT) < 0 )
          return;
 
-   if ( iobuf->byte_order == 0)
-      val[1].sval = (int16_t) num;
-   else
+   p = iobuf->data;
+   for ( i=0; i<num; i++ )
    {
-      val[0].sval = (int16_t) num;
-      val[1].cval[0] = val[0].cval[1];
-      val[1].cval[1] = val[0].cval[0];
+      acc |= ((uint64_t) (uint16_t) (vec[i] - vmin)) << nacc;
+      nacc += nbits;
+      if ( nacc >= 32 ) /* Four bytes at a time */
+      {
+         p[0] = (BYTE) acc;
+         p[1] = (BYTE) (acc >> 8);
+         p[2] = (BYTE) (acc >> 16);
+         p[3] = (BYTE) (acc >> 24);
+         p += 4;
+         acc >>= 32;
+         nacc -= 32;
+      }
    }
-
-   COPY_BYTES((void *)iobuf->data,(void *)&val[1].sval,(size_t)2);
-   iobuf->data += 2;
+   for ( ; nacc > 0; nacc -= 8 )
+   {
+      *p++ = (BYTE) acc;
+      acc >>= 8;
+   }
+   iobuf->data = p;
 }
 
-/* -------------------------- put_int16 ------------------------ */
-/** @short Same as put_short(). */
-
+/* ------------------ get_vector_of_uint16_packed ----------------- */
+/**
+ *  @short Get an array of uint16_t stored as a base value plus bit-packed
+ *         residuals (see put_vector_of_uint16_packed()).
+ *
+ *  Each value is extracted from the four bytes starting at the byte
+ *  with its first bit, independent of all other values, which leaves
+ *  the compiler free to vectorize. Only for the last few values, where
+ *  that would read beyond the packed data, the bytes are checked.
+ *
+ *  @param  vec     The values to be loaded.
+ *  @param  num     The number of values.
+ *  @param  iobuf   The input buffer descriptor.
+ *
+ *  @return (none)
+ */
+
+void get_vector_of_uint16_packed (uint16_t *vec, int num, IO_BUFFER *iobuf)
+{
+   uint32_t base, mask;
+   int i, nbits, nfast;
+   long nb;
+   const BYTE *p;
+
+   if ( vec == NULL || num <= 0 )
+      return;
+   base = get_count32(iobuf);
+   nbits = get_byte(iobuf);
+   if ( nbits < 0 || nbits > 16 )
+   {
+      Warning("Invalid bit width in packed uint16 data.");
+      iobuf->r_remaining = -1;
+      memset(vec,0,num*sizeof(uint16_t));
+      return;
+   }
+   if ( nbits == 0 )
+   {
+      for ( i=0; i<num; i++ )
+         vec[i] = (uint16_t) base;
+      return;
+   }
+   nb = ((long) num * nbits + 7) / 8;
+   if ( (iobuf->r_remaining-=nb) < 0 )
+      return;
+
+   p = iobuf->data;
+   mask = (1U << nbits) - 1;
+   /* Values whose first byte is at least four bytes before the end. */
+   nfast = (nb >= 4) ? (int) ((8*(nb-4)+7) / nbits) + 1 : 0;
+   if ( nfast > num )
+      nfast = num;
+   for ( i=0; i<nfast; i++ )
+   {
+      uint32_t bitpos = (uint32_t) i * (uint32_t) nbits;
+      const BYTE *q = p + (bitpos >> 3);
+      uint32_t w = (uint32_t) q[0] | ((uint32_t) q[1] << 8) |
+                   ((uint32_t) q[2] << 16) | ((uint32_t) q[3] << 24);
+      vec[i] = (uint16_t) (base + ((w >> (bitpos & 7)) & mask));
+   }
+   for ( ; i<num; i++ )
+   {
+      uint32_t bitpos = (uint32_t) i * (uint32_t) nbits;
+      long k = (long) (bitpos >> 3), j;
+      uint32_t w = 0;
+      for ( j=0; j<4 && k+j<nb; j++ )
+         w |= (uint32_t) p[k+j] << (8*j);
+      vec[i] = (uint16_t) (base + ((w >> (bitpos & 7)) & mask));
+   }
+   iobuf->data += nb;
+}
+
+/* ------------------------ swap_copy_generic ------------------- */
+/**
+ *  Copy 'num' elements of 'size' bytes each (2, 4, or 8) with
+ *  the byte order of each element reversed. Source and target
+ *  must not overlap.
+ */
+
+static void swap_copy_generic (BYTE *dst, const BYTE *src, size_t num, int size)
+{
+   size_t i;
+
+   switch ( size )
+   {
+      case 2:
+         for ( i=0; i<num; i++, src+=2, dst+=2 )
+         {
+            dst[0] = src[1];
+            dst[1] = src[0];
+         }
+         break;
+#ifdef HAVE_BYTESWAP
+      case 4:
+         for ( i=0; i<num; i++, src+=4, dst+=4 )
+         {
+            uint32_t v;
+            COPY_BYTES((void *) &v,(const void *) src,(size_t)4);
+            v = __builtin_bswap32(v);
+            COPY_BYTES((void *) dst,(const void *) &v,(size_t)4);
+         }
+         break;
+      case 8:
+         for ( i=0; i<num; i++, src+=8, dst+=8 )
+         {
+            uint64_t v;
+            COPY_BYTES((void *) &v,(const void *) src,(size_t)8);
+            v = __builtin_bswap64(v);
+            COPY_BYTES((void *) dst,(const void *) &v,(size_t)8);
+         }
+         break;
+#endif
+      default:
+         for ( i=0; i<num; i++, src+=size, dst+=size )
+         {
+            int k;
+            for ( k=0; k<size; k++ )
+               dst[k] = src[size-1-k];
+         }
+   }
+}
+
+#ifdef HAVE_BSWAP_DISPATCH
+
+/* ------------------------ swap_copy_ssse3 --------------------- */
+/**
+ *  As swap_copy_generic() but sixteen bytes at a time with SSSE3.
+ */
+
+__attribute__((target("ssse3")))
+static void swap_copy_ssse3 (BYTE *dst, const BYTE *src, size_t num, int size)
+{
+   size_t nb = num*(size_t)size, i = 0;
+   __m128i mask;
+
+   if ( size == 2 )
+      mask = _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+   else if ( size == 4 )
+      mask = _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+   else
+      mask = _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+
+   for ( ; i+16 <= nb; i+=16 )
+      _mm_storeu_si128((__m128i *)(dst+i),
+         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src+i)),mask));
+   if ( i < nb )
+      swap_copy_generic(dst+i,src+i,(nb-i)/size,size);
+}
+
+/* ------------------------ swap_copy_avx2 ---------------------- */
+/**
+ *  As swap_copy_generic() but 32 bytes at a time with AVX2.
+ */
+
+__attribute__((target("avx2")))
+static void swap_copy_avx2 (BYTE *dst, const BYTE *src, size_t num, int size)
+{
+   size_t nb = num*(size_t)size, i = 0;
+   __m256i mask;
+
+   /* The shuffle works within each 128-bit lane, thus the mask repeats. */
+   if ( size == 2 )
+      mask = _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+                              1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+   else if ( size == 4 )
+      mask = _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+                              3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+   else
+      mask = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                              7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+
+   for ( ; i+32 <= nb; i+=32 )
+      _mm256_storeu_si256((__m256i *)(dst+i),
+         _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src+i)),mask));
+   if ( i < nb )
+      swap_copy_generic(dst+i,src+i,(nb-i)/size,size);
+}
+
+#endif
+
+typedef void (*SWAP_COPY_FUNC) (BYTE *dst, const BYTE *src, size_t num, int size);
+static SWAP_COPY_FUNC swap_copy_func = NULL;
+static const char *swap_copy_name = "generic";
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+static pthread_once_t swap_copy_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* ------------------------ select_swap_copy -------------------- */
+/**
+ *  Pick the best available byte swapping implementation for
+ *  the CPU we are running on. Setting the environment variable
+ *  EVENTIO_NO_SIMD forces the generic version.
+ *  Only to be called through init_swap_copy().
+ */
+
+static void select_swap_copy (void)
+{
+   SWAP_COPY_FUNC f = &swap_copy_generic;
+   const char *name = "generic";
+#ifdef HAVE_BSWAP_DISPATCH
+   if ( getenv("EVENTIO_NO_SIMD") == NULL )
+   {
+      __builtin_cpu_init();
+      if ( __builtin_cpu_supports("avx2") )
+      {
+         f = &swap_copy_avx2;
+         name = "avx2";
+      }
+      else if ( __builtin_cpu_supports("ssse3") )
+      {
+         f = &swap_copy_ssse3;
+         name = "ssse3";
+      }
+   }
+#endif
+   swap_copy_name = name;
+   swap_copy_func = f;
+}
+
+/* Make sure the implementation is selected, exactly once even with
+   several threads doing their first vector I/O at the same time. */
+
+static void init_swap_copy (void)
+{
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   (void) pthread_once(&swap_copy_once,select_swap_copy);
+#else
+   if ( swap_copy_func == NULL )
+      select_swap_copy();
+#endif
+}
+
+/* --------------------------- swap_copy ------------------------ */
+/**
+ *  Copy 'num' elements of 'size' bytes each with reversed byte order,
+ *  using the fastest implementation available.
+ */
+
+static void swap_copy (void *dst, const void *src, size_t num, int size)
+{
+   init_swap_copy();
+   (*swap_copy_func)((BYTE *) dst, (const BYTE *) src, num, size);
+}
+
+/* ------------------------ eventio_swap_method ----------------- */
+/**
+ *  @short Tell which implementation is used for byte-order conversion
+ *         of vectors ("avx2", "ssse3", or "generic").
+ */
+
+const char *eventio_swap_method (void)
+{
+   init_swap_copy();
+   return swap_copy_name;
+}
+
+/* ------------------------ put_vector_raw ---------------------- */
+/**
+ *  Put a vector of 'num' elements of 'size' bytes each into an I/O
+ *  buffer, with the byte order as requested for the buffer. Space is
+ *  reserved for the whole vector at once.
+ *
+ *  @return 0 (O.k.), -1 (buffer could not be extended).
+ */
+
+static int put_vector_raw (const void *vec, int num, int size, IO_BUFFER *iobuf)
+{
+   long nb = (long) num * size;
+
+   if ( num <= 0 )
+      return 0;
+   if ( (iobuf->w_remaining-=nb) < 0 )
+      if ( extend_io_buffer(iobuf,256,nb+IO_BUFFER_LENGTH_INCREMENT) < 0 )
+         return -1;
+
+   if ( iobuf->byte_order == 0 )
+      COPY_BYTES((void *)iobuf->data,vec,(size_t)nb);
+   else
+      swap_copy((void *)iobuf->data,vec,(size_t)num,size);
+   iobuf->data += nb;
+
+   return 0;
+}
+
+/* ------------------------ get_vector_raw ---------------------- */
+/**
+ *  Get a vector of 'num' elements of 'size' bytes each from an I/O
+ *  buffer, with byte order conversion as needed. The caller has to
+ *  make sure that enough data is available.
+ */
+
+static void get_vector_raw (void *vec, int num, int size, IO_BUFFER *iobuf)
+{
+   long nb = (long) num * size;
+
+   if ( num <= 0 )
+      return;
+   if ( iobuf->byte_order == 0 )
+      COPY_BYTES(vec,(void *)iobuf->data,(size_t)nb);
+   else
+      swap_copy(vec,(const void *)iobuf->data,(size_t)num,size);
+   iobuf->r_remaining -= nb;
+   iobuf->data += nb;
+}
+
+/* -------------------------- put_short ------------------------ */
+/**
+ *  @short Put a two-byte integer on an I/O buffer.
+ *
+ *  Put a two-byte integer on an I/O buffer with least
+ *  significant byte first. Should be machine independent
+ *  as long as 'short' and 'unsigned short' are 16-bit integers,
+ *  the two's complement is used for negative numbers, and
+ *  the '>>' operator does a logical shift with unsigned short.
+ *  Although the 'num' argument is a 4-byte integer on most
+ *  machines, the value shoud be in the range -32768 to 32767.
+ *
+ *  @param  num     The number to be saved. Should fit into a
+ *                  short integer and will be truncated otherwise.
+ *  @param  iobuf   The output buffer descriptor.
+ *
+ *  @return (none)
+ */
+
+void put_short(int num, IO_BUFFER *iobuf)
+{
+   union
+   {
+      int16_t sval;
+      BYTE cval[2];
+   } val[2];
+
+   if ( (iobuf->w_remaining-=2) < 0 )
+      if ( extend_io_buffer(iobuf,256,IO_BUFFER_LENGTH_INCREMENT) < 0 )
+         return;
+
+   if ( iobuf->byte_order == 0)
+      val[1].sval = (int16_t) num;
+   else
+   {
+      val[0].sval = (int16_t) num;
+      val[1].cval[0] = val[0].cval[1];
+      val[1].cval[1] = val[0].cval[0];
+   }
+
+   COPY_BYTES((void *)iobuf->data,(void *)&val[1].sval,(size_t)2);
+   iobuf->data += 2;
+}
+
+/* -------------------------- put_int16 ------------------------ */
+/** @short Same as put_short(). */
+
 void put_int16(int num, IO_BUFFER *iobuf)
 {
    put_short(num, iobuf);
@@ -1744,6 +2519,12 @@ void put_vector_of_short (const short *vec, int num, IO_BUFFER *iobuf)
       return;
    }
 
+   if ( sizeof(short) == 2 )
+   {
+      (void) put_vector_raw((const void *)vec,num,2,iobuf);
+      return;
+   }
+
    for (i=0; i<num; i++)
       put_short((int)vec[i],iobuf);
 }
@@ -1765,8 +2546,7 @@ void put_vector_of_int16 (const int16_t *vec, int num, IO_BUFFER *iobuf)
       return;
    }
 
-   for (i=0; i<num; i++)
-      put_int16((int)vec[i],iobuf);
+   (void) put_vector_raw((const void *)vec,num,2,iobuf);
 }
 
 /* ---------------------- put_vector_of_int --------------------- */
@@ -1810,33 +2590,7 @@ void put_vector_of_int (const int *vec, int num, IO_BUFFER *iobuf)
 
 void put_vector_of_uint16 (const uint16_t *uval, int num, IO_BUFFER *iobuf)
 {
-   int i;
-   union
-   {
-      uint16_t uval;
-      BYTE cval[2];
-   } val[2];
-
-   for (i=0; i<num; i++)
-   {
-      if ( (iobuf->w_remaining-=2) < 0 )
-         if ( extend_io_buffer(iobuf,256,IO_BUFFER_LENGTH_INCREMENT) < 0 )
-            return;
-
-      if ( iobuf->byte_order == 0)
-      {
-         COPY_BYTES((void *)iobuf->data,(const void *)(uval+i),(size_t)2);
-      }
-      else
-      {
-         val[0].uval = uval[i];
-         val[1].cval[0] = val[0].cval[1];
-         val[1].cval[1] = val[0].cval[0];
-         COPY_BYTES((void *)iobuf->data,(const void *)&val[1].uval,(size_t)2);
-      }
-
-      iobuf->data += 2;
-   }
+   (void) put_vector_raw((const void *)uval,num,2,iobuf);
 }
 
 /* ----------------- get_vector_of_uint16 ---------------------- */
@@ -1896,7 +2650,7 @@ void get_vector_of_uint16 (uint16_t *uval, int num, IO_BUFFER *iobuf)
    if ( iobuf->byte_order == 0)
       COPY_BYTES((void *)uval, (void *)iobuf->data, (size_t)(2*num));
    else
-      COPY_BYTES_SWAB((void *)uval, (void *)iobuf->data, (size_t)(2*num));
+      swap_copy((void *)uval, (void *)iobuf->data, (size_t)num, 2);
 
    iobuf->r_remaining -= (2*num);
    iobuf->data += 2*num;
@@ -2012,7 +2766,7 @@ void get_vector_of_short (short *vec, int num, IO_BUFFER *iobuf)
    if ( iobuf->byte_order == 0 )
       COPY_BYTES((void *) vec,(void *) iobuf->data,(size_t)(2*num));
    else
-      COPY_BYTES_SWAB((void *) vec,(void *) iobuf->data,(size_t)(2*num));
+      swap_copy((void *) vec,(void *) iobuf->data,(size_t)num, 2);
       
    iobuf->r_remaining -= (2*num);
    iobuf->data += 2*num;
@@ -2039,6 +2793,12 @@ void get_vector_of_int16 (int16_t *vec, int num, IO_BUFFER *iobuf)
       return;
    }
 
+   if ( iobuf->r_remaining >= 2*num )
+   {
+      get_vector_raw((void *)vec,num,2,iobuf);
+      return;
+   }
+
    for (i=0; i<num; i++)
       vec[i] = get_int16(iobuf);
 
@@ -2131,8 +2891,7 @@ void put_vector_of_int32 (const int32_t *vec, int num, IO_BUFFER *iobuf)
       return;
    }
 
-   for (i=0; i<num; i++)
-      put_int32(vec[i],iobuf);
+   (void) put_vector_raw((const void *)vec,num,4,iobuf);
 }
 
 /* --------------------------- get_int32 ----------------------- */
@@ -2190,14 +2949,6 @@ int32_t get_int32(IO_BUFFER *iobuf)
 
 void get_vector_of_int32 (int32_t *vec, int num, IO_BUFFER *iobuf)
 {
-   REGISTER int i;
-
-   union
-   {
-      int32_t lval;
-      BYTE cval[4];
-   } val[2];
-
    if ( num <= 0 )
       return;
 
@@ -2217,21 +2968,8 @@ void get_vector_of_int32 (int32_t *vec, int num, IO_BUFFER *iobuf)
    }
    else
    {
-      for ( i=0; i<num; i++ )
-      {
-         COPY_BYTES((void *)&val[0].lval,(void *)iobuf->data,(size_t)4);
-#ifndef HAVE_BYTESWAP
-         val[1].cval[0] = val[0].cval[3];
-         val[1].cval[1] = val[0].cval[2];
-         val[1].cval[2] = val[0].cval[1];
-         val[1].cval[3] = val[0].cval[0];
-         vec[i] = val[1].lval;
-#else
-/*         vec[i] = bswap_32(val[0].lval); */
-         vec[i] = __builtin_bswap32(val[0].lval);
-#endif
-         iobuf->data += 4;
-      }
+      swap_copy((void *) vec,(void *)iobuf->data,(size_t)num,4);
+      iobuf->data += 4*num;
    }
 
 #ifdef BUG_CHECK
@@ -2299,8 +3037,7 @@ void put_vector_of_uint32 (const uint32_t *vec, int num, IO_BUFFER *iobuf)
       return;
    }
 
-   for (i=0; i<num; i++)
-      put_uint32(vec[i],iobuf);
+   (void) put_vector_raw((const void *)vec,num,4,iobuf);
 }
 
 /* --------------------------- get_uint32 ----------------------- */
@@ -2359,14 +3096,6 @@ uint32_t get_uint32(IO_BUFFER *iobuf)
 
 void get_vector_of_uint32 (uint32_t *vec, int num, IO_BUFFER *iobuf)
 {
-   REGISTER int i;
-
-   union
-   {
-      uint32_t lval;
-      BYTE cval[4];
-   } val[2];
-
    if ( num <= 0 )
       return;
 
@@ -2386,21 +3115,8 @@ void get_vector_of_uint32 (uint32_t *vec, int num, IO_BUFFER *iobuf)
    }
    else
    {
-      for ( i=0; i<num; i++ )
-      {
-         COPY_BYTES((void *)&val[0].lval,(void *)iobuf->data,(size_t)4);
-#ifndef HAVE_BYTESWAP
-         val[1].cval[0] = val[0].cval[3];
-         val[1].cval[1] = val[0].cval[2];
-         val[1].cval[2] = val[0].cval[1];
-         val[1].cval[3] = val[0].cval[0];
-         vec[i] = val[1].lval;
-#else
-/*         vec[i] = bswap_32(val[0].lval); */
-         vec[i] = __builtin_bswap32(val[0].lval);
-#endif
-         iobuf->data += 4;
-      }
+      swap_copy((void *) vec,(void *)iobuf->data,(size_t)num,4);
+      iobuf->data += 4*num;
    }
 
 #ifdef BUG_CHECK
@@ -2607,45 +3323,8 @@ void get_vector_of_long (long *vec, int num, IO_BUFFER *iobuf)
 
 void put_vector_of_int64 (const int64_t *ival, int num, IO_BUFFER *iobuf)
 {
-   int i;
-   union
-   {
-      int64_t ival;
-      BYTE cval[8];
-   } val[2];
-
-   for (i=0; i<num; i++)
-   {
-      if ( (iobuf->w_remaining-=8) < 0 )
-         if ( extend_io_buffer(iobuf,256,IO_BUFFER_LENGTH_INCREMENT) < 0 )
-            return;
-
-      if ( iobuf->byte_order == 0)
-      {
-         COPY_BYTES((void *)iobuf->data,(const void *)(ival+i),(size_t)8);
-      }
-      else
-      {
-#ifndef HAVE_BYTESWAP
-         val[0].ival = ival[i];
-         val[1].cval[0] = val[0].cval[7];
-         val[1].cval[1] = val[0].cval[6];
-         val[1].cval[2] = val[0].cval[5];
-         val[1].cval[3] = val[0].cval[4];
-         val[1].cval[4] = val[0].cval[3];
-         val[1].cval[5] = val[0].cval[2];
-         val[1].cval[6] = val[0].cval[1];
-         val[1].cval[7] = val[0].cval[0];
-#else
-/*         val[1].ival = bswap_64(ival[i]); */
-         val[1].ival = __builtin_bswap64(ival[i]);
-#endif
-         COPY_BYTES((void *)iobuf->data,(const void *)&val[1].ival,(size_t)8);
-      }
-
-      iobuf->data += 8;
-   }
-}
+   (void) put_vector_raw((const void *)ival,num,8,iobuf);
+}
 
 /* ----------------- get_vector_of_int64 ---------------------- */
 /**
@@ -2663,42 +3342,16 @@ void put_vector_of_int64 (const int64_t *ival, int num, IO_BUFFER *iobuf)
 
 void get_vector_of_int64 (int64_t *ival, int num, IO_BUFFER *iobuf)
 {
-   int i;
-   union
-   {
-      int64_t ival;
-      BYTE cval[8];
-   } val[2];
+   int n = num;
 
-   for (i=0; i<num; i++)
+   /* Get as many as available, leaving r_remaining negative if short. */
+   if ( iobuf->r_remaining < 8L*num )
+      n = (iobuf->r_remaining > 0) ? (int) (iobuf->r_remaining/8) : 0;
+   get_vector_raw((void *)ival,n,8,iobuf);
+   if ( n < num )
    {
-      if ( (iobuf->r_remaining-=8) < 0 )
-         return;
-
-      if ( iobuf->byte_order == 0)
-      {
-         COPY_BYTES((void *)(ival+i),(void *)iobuf->data,(size_t)8);
-      }
-      else
-      {
-         COPY_BYTES((void *)&val[0].ival,(void *)iobuf->data,(size_t)8);
-#ifndef HAVE_BYTESWAP
-         val[1].cval[0] = val[0].cval[7];
-         val[1].cval[1] = val[0].cval[6];
-         val[1].cval[2] = val[0].cval[5];
-         val[1].cval[3] = val[0].cval[4];
-         val[1].cval[4] = val[0].cval[3];
-         val[1].cval[5] = val[0].cval[2];
-         val[1].cval[6] = val[0].cval[1];
-         val[1].cval[7] = val[0].cval[0];
-         ival[i] = val[1].ival;
-#else
-/*         ival[i] = bswap_64(val[0].ival); */
-         ival[i] = __builtin_bswap64(val[0].ival);
-#endif
-      }
-
-      iobuf->data += 8;
+      iobuf->r_remaining -= 8;
+      return;
    }
 
 #ifdef BUG_CHECK
@@ -2722,44 +3375,7 @@ void get_vector_of_int64 (int64_t *ival, int num, IO_BUFFER *iobuf)
 
 void put_vector_of_uint64 (const uint64_t *uval, int num, IO_BUFFER *iobuf)
 {
-   int i;
-   union
-   {
-      uint64_t uval;
-      BYTE cval[8];
-   } val[2];
-
-   for (i=0; i<num; i++)
-   {
-      if ( (iobuf->w_remaining-=8) < 0 )
-         if ( extend_io_buffer(iobuf,256,IO_BUFFER_LENGTH_INCREMENT) < 0 )
-            return;
-
-      if ( iobuf->byte_order == 0)
-      {
-         COPY_BYTES((void *)iobuf->data,(const void *)(uval+i),(size_t)8);
-      }
-      else
-      {
-#ifndef HAVE_BYTESWAP
-         val[0].uval = uval[i];
-         val[1].cval[0] = val[0].cval[7];
-         val[1].cval[1] = val[0].cval[6];
-         val[1].cval[2] = val[0].cval[5];
-         val[1].cval[3] = val[0].cval[4];
-         val[1].cval[4] = val[0].cval[3];
-         val[1].cval[5] = val[0].cval[2];
-         val[1].cval[6] = val[0].cval[1];
-         val[1].cval[7] = val[0].cval[0];
-#else
-/*         val[1].uval = bswap_64(uval[i]); */
-         val[1].uval = __builtin_bswap64(uval[i]);
-#endif
-         COPY_BYTES((void *)iobuf->data,(const void *)&val[1].uval,(size_t)8);
-      }
-
-      iobuf->data += 8;
-   }
+   (void) put_vector_raw((const void *)uval,num,8,iobuf);
 }
 
 /* ----------------- get_vector_of_uint64 ---------------------- */
@@ -2778,43 +3394,21 @@ void put_vector_of_uint64 (const uint64_t *uval, int num, IO_BUFFER *iobuf)
 
 void get_vector_of_uint64 (uint64_t *uval, int num, IO_BUFFER *iobuf)
 {
-   int i;
-   union
-   {
-      uint64_t uval;
-      BYTE cval[8];
-   } val[2];
+   int n = num;
 
-   for (i=0; i<num; i++)
+   /* Get as many as available, leaving r_remaining negative if short. */
+   if ( iobuf->r_remaining < 8L*num )
+      n = (iobuf->r_remaining > 0) ? (int) (iobuf->r_remaining/8) : 0;
+   get_vector_raw((void *)uval,n,8,iobuf);
+   if ( n < num )
    {
-      if ( (iobuf->r_remaining-=8) < 0 )
-         return;
+      iobuf->r_remaining -= 8;
+      return;
+   }
 
-      if ( iobuf->byte_order == 0)
-      {
-         COPY_BYTES((void *)(uval+i),(void *)iobuf->data,(size_t)8);
-      }
-      else
-      {
-         COPY_BYTES((void *)&val[0].uval,(void *)iobuf->data,(size_t)8);
-#ifndef HAVE_BYTESWAP
-         val[1].cval[0] = val[0].cval[7];
-         val[1].cval[1] = val[0].cval[6];
-         val[1].cval[2] = val[0].cval[5];
-         val[1].cval[3] = val[0].cval[4];
-         val[1].cval[4] = val[0].cval[3];
-         val[1].cval[5] = val[0].cval[2];
-         val[1].cval[6] = val[0].cval[1];
-         val[1].cval[7] = val[0].cval[0];
-         uval[i] = val[1].uval;
-#else
-/*         uval[i] = bswap_64(val[0].uval); */
-         uval[i] = __builtin_bswap64(val[0].uval);
+#ifdef BUG_CHECK
+   bug_check(iobuf);
 #endif
-      }
-
-      iobuf->data += 8;
-   }
 }
 
 #endif
@@ -3161,6 +3755,14 @@ void put_vector_of_float (const float *fvec, int num, IO_BUFFER *iobuf)
       return;
    }
 
+#ifdef IEEE_FLOAT_FORMAT
+   if ( sizeof(float) == 4 )
+   {
+      (void) put_vector_raw((const void *)fvec,num,4,iobuf);
+      return;
+   }
+#endif
+
    for (i=0; i<num; i++)
       put_real((double)fvec[i],iobuf);
 }
@@ -3294,6 +3896,14 @@ void get_vector_of_float (float *fvec, int num, IO_BUFFER *iobuf)
       return;
    }
 
+#ifdef IEEE_FLOAT_FORMAT
+   if ( sizeof(float) == 4 && iobuf->r_remaining >= 4*num )
+   {
+      get_vector_raw((void *)fvec,num,4,iobuf);
+      return;
+   }
+#endif
+
    for (i=0; i<num; i++)
       fvec[i] = (float) get_real(iobuf);
 #ifdef BUG_CHECK
@@ -3375,8 +3985,7 @@ void put_vector_of_double (const double *dvec, int num, IO_BUFFER *iobuf)
       return;
    }
 
-   for (i=0; i<num; i++)
-      put_double(dvec[i],iobuf);
+   (void) put_vector_raw((const void *)dvec,num,8,iobuf);
 }
 
 /* --------------------- get_double ------------------------- */
@@ -3449,6 +4058,12 @@ void get_vector_of_double (double *dvec, int num, IO_BUFFER *iobuf)
       return;
    }
 
+   if ( iobuf->r_remaining >= 8*num )
+   {
+      get_vector_raw((void *)dvec,num,8,iobuf);
+      return;
+   }
+
    for (i=0; i<num; i++)
       dvec[i] = get_double(iobuf);
 
@@ -3632,6 +4247,329 @@ double get_sfloat (IO_BUFFER *iobuf)
    return dbl_from_sfloat(&snum);
 }
 
+/* Bulk conversion of 16-bit floats. All variants give bit-for-bit the */
+/* same results as fltp_to_sfloat() and (float) dbl_from_sfloat(). */
+
+/* ---------------------- sfloat_pack_generic ------------------- */
+/**
+ *  Convert 'num' floats to 16-bit floats, one at a time.
+ */
+
+static void sfloat_pack_generic (uint16_t *snum, const float *fnum, size_t num)
+{
+   size_t i;
+   for ( i=0; i<num; i++ )
+      fltp_to_sfloat(&fnum[i],&snum[i]);
+}
+
+/* --------------------- sfloat_unpack_generic ------------------ */
+/**
+ *  Convert 'num' 16-bit floats to floats, one at a time.
+ */
+
+static void sfloat_unpack_generic (float *fnum, const uint16_t *snum, size_t num)
+{
+   size_t i;
+   for ( i=0; i<num; i++ )
+      fnum[i] = (float) dbl_from_sfloat(&snum[i]);
+}
+
+#if defined(HAVE_SSE2_VARINT) && defined(IEEE_FLOAT_FORMAT)
+
+/* Select bits from b where mask is set, otherwise from a. */
+#define SSE2_SELECT(a,b,mask) \
+   _mm_or_si128(_mm_and_si128(mask,b),_mm_andnot_si128(mask,a))
+
+/* ---------------------- sfloat_pack4_sse2 --------------------- */
+/**
+ *  Convert four floats (as bit patterns) to 16-bit floats, each in
+ *  the lower half of a 32-bit lane, without the sign bit.
+ *  The mantissa is truncated, as in fltp_to_sfloat(), and values
+ *  beyond the range of normalized 16-bit floats come out exactly
+ *  like there (including the NaN patterns of 65536 <= |x| < 131072).
+ */
+
+static inline __m128i sfloat_pack4_sse2 (__m128i u)
+{
+   const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+   __m128i a = _mm_and_si128(u,abs_mask);
+   __m128i e = _mm_srli_epi32(a,23);
+   __m128i m13 = _mm_srli_epi32(a,13);
+   /* Normalized, with float exponents 113 to 143 */
+   __m128i h = _mm_sub_epi32(m13,_mm_set1_epi32(112<<10));
+   /* De-normalized or zero: truncating conversion of the scaled value */
+   __m128i hden = _mm_cvttps_epi32(_mm_mul_ps(_mm_castsi128_ps(a),
+      _mm_set1_ps(16777216.f)));
+   /* Infinity and NaN (with the upper mantissa bits as they are) */
+   __m128i hnan = _mm_or_si128(_mm_and_si128(m13,_mm_set1_epi32(0x3ff)),
+      _mm_set1_epi32(0x7c00));
+
+   h = SSE2_SELECT(h,hden,_mm_cmplt_epi32(e,_mm_set1_epi32(113)));
+   h = SSE2_SELECT(h,_mm_set1_epi32(0x7c00),_mm_cmpgt_epi32(e,_mm_set1_epi32(143)));
+   h = SSE2_SELECT(h,hnan,_mm_cmpeq_epi32(e,_mm_set1_epi32(255)));
+   return h;
+}
+
+/* ---------------------- sfloat_pack8_sse2 --------------------- */
+/**
+ *  Convert eight floats to 16-bit floats with SSE2.
+ */
+
+static inline void sfloat_pack8_sse2 (uint16_t *snum, const float *fnum)
+{
+   __m128i u0 = _mm_castps_si128(_mm_loadu_ps(fnum));
+   __m128i u1 = _mm_castps_si128(_mm_loadu_ps(fnum+4));
+   /* Values without sign fit into signed 16 bits. */
+   __m128i h = _mm_packs_epi32(sfloat_pack4_sse2(u0),sfloat_pack4_sse2(u1));
+   __m128i s = _mm_packs_epi32(_mm_srai_epi32(u0,31),_mm_srai_epi32(u1,31));
+   _mm_storeu_si128((__m128i *)snum,
+      _mm_or_si128(h,_mm_and_si128(s,_mm_set1_epi16((short)0x8000))));
+}
+
+/* ---------------------- sfloat_pack_sse2 ---------------------- */
+/**
+ *  As sfloat_pack_generic() but eight values at a time with SSE2.
+ */
+
+static void sfloat_pack_sse2 (uint16_t *snum, const float *fnum, size_t num)
+{
+   size_t i = 0;
+
+   for ( ; i+8 <= num; i+=8 )
+      sfloat_pack8_sse2(snum+i,fnum+i);
+   if ( i < num )
+      sfloat_pack_generic(snum+i,fnum+i,num-i);
+}
+
+/* --------------------- sfloat_unpack4_sse2 -------------------- */
+/**
+ *  Convert four 16-bit floats, each in the lower half of a 32-bit
+ *  lane, to floats. NaN comes out as the given pattern.
+ */
+
+static __m128 sfloat_unpack4_sse2 (__m128i h, __m128i nan)
+{
+   __m128i e = _mm_and_si128(h,_mm_set1_epi32(0x7c00));
+   __m128i m = _mm_and_si128(h,_mm_set1_epi32(0x03ff));
+   __m128i s = _mm_slli_epi32(_mm_and_si128(h,_mm_set1_epi32(0x8000)),16);
+   /* Normalized */
+   __m128i f = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(h,_mm_set1_epi32(0x7fff)),13),
+      _mm_set1_epi32(112<<23));
+   /* De-normalized or zero, exact as the mantissa has only ten bits */
+   __m128i fden = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(m),
+      _mm_set1_ps(1.f/16777216.f)));
+   __m128i e31 = _mm_cmpeq_epi32(e,_mm_set1_epi32(0x7c00));
+   __m128i is_nan = _mm_andnot_si128(_mm_cmpeq_epi32(m,_mm_setzero_si128()),e31);
+
+   f = SSE2_SELECT(f,fden,_mm_cmpeq_epi32(e,_mm_setzero_si128()));
+   f = SSE2_SELECT(f,_mm_set1_epi32(0x7f800000),e31);
+   f = _mm_or_si128(f,s);
+   f = SSE2_SELECT(f,nan,is_nan);
+   return _mm_castsi128_ps(f);
+}
+
+/* --------------------- sfloat_unpack_sse2 --------------------- */
+/**
+ *  As sfloat_unpack_generic() but eight values at a time with SSE2.
+ */
+
+static void sfloat_unpack_sse2 (float *fnum, const uint16_t *snum, size_t num)
+{
+   const uint16_t snan = 0x7e00;
+   float fnan = (float) dbl_from_sfloat(&snan);
+   __m128i nan = _mm_castps_si128(_mm_set1_ps(fnan));
+   size_t i = 0;
+
+   for ( ; i+8 <= num; i+=8 )
+   {
+      __m128i h = _mm_loadu_si128((const __m128i *)(snum+i));
+      _mm_storeu_ps(fnum+i,
+         sfloat_unpack4_sse2(_mm_unpacklo_epi16(h,_mm_setzero_si128()),nan));
+      _mm_storeu_ps(fnum+i+4,
+         sfloat_unpack4_sse2(_mm_unpackhi_epi16(h,_mm_setzero_si128()),nan));
+   }
+   if ( i < num )
+      sfloat_unpack_generic(fnum+i,snum+i,num-i);
+}
+
+#undef SSE2_SELECT
+
+#endif
+
+#if defined(HAVE_BSWAP_DISPATCH) && defined(HAVE_SSE2_VARINT) && defined(IEEE_FLOAT_FORMAT)
+# define HAVE_F16C_DISPATCH 1
+
+/* ---------------------- sfloat_pack_f16c ---------------------- */
+/**
+ *  As sfloat_pack_generic() but eight values at a time with the F16C
+ *  conversion instruction, rounding towards zero. Groups with values
+ *  of 65536 or more, infinity or NaN, where fltp_to_sfloat() differs
+ *  from IEEE 754 conversion, go through the SSE2 code.
+ */
+
+__attribute__((target("avx,f16c")))
+static void sfloat_pack_f16c (uint16_t *snum, const float *fnum, size_t num)
+{
+   const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+   const __m256 limit = _mm256_set1_ps(65536.f);
+   size_t i = 0;
+
+   for ( ; i+8 <= num; i+=8 )
+   {
+      __m256 x = _mm256_loadu_ps(fnum+i);
+      if ( _mm256_movemask_ps(_mm256_cmp_ps(_mm256_and_ps(x,abs_mask),
+              limit,_CMP_NLT_UQ)) != 0 )
+         sfloat_pack8_sse2(snum+i,fnum+i); /* Inlined, thus VEX-encoded */
+      else
+         _mm_storeu_si128((__m128i *)(snum+i),
+            _mm256_cvtps_ph(x,_MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC));
+   }
+   if ( i < num )
+      sfloat_pack_generic(snum+i,fnum+i,num-i);
+}
+
+/* --------------------- sfloat_unpack_f16c --------------------- */
+/**
+ *  As sfloat_unpack_generic() but eight values at a time with the
+ *  F16C conversion instruction. NaN payloads are replaced by the
+ *  NaN which dbl_from_sfloat() returns.
+ */
+
+__attribute__((target("avx,f16c")))
+static void sfloat_unpack_f16c (float *fnum, const uint16_t *snum, size_t num)
+{
+   const uint16_t snan = 0x7e00;
+   __m256 nan = _mm256_set1_ps((float) dbl_from_sfloat(&snan));
+   size_t i = 0;
+
+   for ( ; i+8 <= num; i+=8 )
+   {
+      __m256 x = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(snum+i)));
+      _mm256_storeu_ps(fnum+i,
+         _mm256_blendv_ps(x,nan,_mm256_cmp_ps(x,x,_CMP_UNORD_Q)));
+   }
+   if ( i < num )
+      sfloat_unpack_generic(fnum+i,snum+i,num-i);
+}
+
+#endif
+
+typedef void (*SFLOAT_PACK_FUNC) (uint16_t *snum, const float *fnum, size_t num);
+typedef void (*SFLOAT_UNPACK_FUNC) (float *fnum, const uint16_t *snum, size_t num);
+static SFLOAT_PACK_FUNC sfloat_pack_func = NULL;
+static SFLOAT_UNPACK_FUNC sfloat_unpack_func = NULL;
+static const char *sfloat_name = "generic";
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+static pthread_once_t sfloat_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* ---------------------- select_sfloat_conv -------------------- */
+/**
+ *  Pick the best available implementation of bulk 16-bit float
+ *  conversion for the CPU we are running on. Setting the environment
+ *  variable EVENTIO_NO_SIMD forces the generic version.
+ *  Only to be called through init_sfloat_conv().
+ */
+
+static void select_sfloat_conv (void)
+{
+   SFLOAT_PACK_FUNC fp = &sfloat_pack_generic;
+   SFLOAT_UNPACK_FUNC fu = &sfloat_unpack_generic;
+   const char *name = "generic";
+#if defined(HAVE_SSE2_VARINT) && defined(IEEE_FLOAT_FORMAT)
+   if ( getenv("EVENTIO_NO_SIMD") == NULL )
+   {
+      fp = &sfloat_pack_sse2;
+      fu = &sfloat_unpack_sse2;
+      name = "sse2";
+# ifdef HAVE_F16C_DISPATCH
+      __builtin_cpu_init();
+      if ( __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c") )
+      {
+         fp = &sfloat_pack_f16c;
+         fu = &sfloat_unpack_f16c;
+         name = "f16c";
+      }
+# endif
+   }
+#endif
+   sfloat_name = name;
+   sfloat_unpack_func = fu;
+   sfloat_pack_func = fp;
+}
+
+/* As init_swap_copy(), select the implementation exactly once. */
+
+static void init_sfloat_conv (void)
+{
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   (void) pthread_once(&sfloat_once,select_sfloat_conv);
+#else
+   if ( sfloat_pack_func == NULL )
+      select_sfloat_conv();
+#endif
+}
+
+/* ----------------------- eventio_sfloat_method ---------------- */
+/**
+ *  @short Tell which implementation is used for bulk conversion
+ *         of 16-bit floats ("f16c", "sse2", or "generic").
+ */
+
+const char *eventio_sfloat_method (void)
+{
+   init_sfloat_conv();
+   return sfloat_name;
+}
+
+/* --------------------- put_vector_of_sfloat ------------------- */
+/**
+ * @short Put a vector of floats as 16-bit floats into an I/O buffer.
+ *
+ * The result is the same as with put_sfloat() for each element
+ * but the conversion is done for many elements at once.
+ */
+
+void put_vector_of_sfloat (const float *fvec, int num, IO_BUFFER *iobuf)
+{
+   uint16_t sbuf[256];
+   int i, n;
+
+   if ( fvec == (const float *) NULL || num <= 0 )
+      return;
+   init_sfloat_conv();
+   for ( i=0; i<num; i+=n )
+   {
+      n = (num-i > 256) ? 256 : num-i;
+      (*sfloat_pack_func)(sbuf,fvec+i,(size_t)n);
+      put_vector_of_uint16(sbuf,n,iobuf);
+   }
+}
+
+/* --------------------- get_vector_of_sfloat ------------------- */
+/**
+ * @short Get a vector of 16-bit floats from an I/O buffer, expanded to floats.
+ *
+ * The result is the same as with get_sfloat() for each element
+ * but the conversion is done for many elements at once.
+ */
+
+void get_vector_of_sfloat (float *fvec, int num, IO_BUFFER *iobuf)
+{
+   uint16_t sbuf[256];
+   int i, n;
+
+   if ( fvec == (float *) NULL || num <= 0 )
+      return;
+   init_sfloat_conv();
+   for ( i=0; i<num; i+=n )
+   {
+      n = (num-i > 256) ? 256 : num-i;
+      get_vector_of_uint16(sbuf,n,iobuf);
+      (*sfloat_unpack_func)(fvec+i,sbuf,(size_t)n);
+   }
+}
+
 /* ------------------------ put_item_begin ------------------------ */
 /**
  *  @short Begin putting another (sub-) item into the output buffer.
@@ -3705,6 +4643,10 @@ int put_item_begin_with_flags (IO_BUFFER *iobuf,
    /* When starting a top item, additional work has to be done. */
    if ( ilevel == 0 )
    {
+#ifdef EVENTIO_HAVE_MMAP
+      /* Never write into a memory-mapped input file. */
+      mm_restore_buffer(iobuf);
+#endif
       if ( iobuf->buffer == (BYTE *) NULL ||
            iobuf->buflen < 16 + (item_header->use_extension?4:0) )
          return -1;
@@ -4053,6 +4995,10 @@ int get_item_begin (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    /* For global offsets keep also track where header extensions were found. */
    iobuf->item_extension[ilevel] = item_header->use_extension;
 
+   /* Any sub-item directory of a previous item at this level is stale now. */
+   if ( iobuf->item_dir != NULL && ilevel < MAX_IO_ITEM_LEVEL )
+      iobuf->item_dir[ilevel].n = -1;
+
    /* Only data up to the end of the top item may be read, not up to */
    /* end of the allocated I/O buffer memory. */
    if ( ilevel == 0 )
@@ -4075,6 +5021,9 @@ int get_item_begin (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    if ( iobuf->r_remaining < 0 )
       return -1;
 
+   if ( io_stats_active )
+      (*io_stats_hooks->item_begin)(iobuf,item_header->level);
+
    return 0;
 }
 
@@ -4115,6 +5064,10 @@ int get_item_end (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    else
       return -1;
 
+   if ( io_stats_active && iobuf->stats != NULL )
+      (*io_stats_hooks->item_end)(iobuf, item_header->type, ilevel, iobuf->item_length[ilevel] +
+         (ilevel == 0 ? 16 : 12) + (iobuf->item_extension[ilevel] ? 4 : 0));
+
    /* If the item has a length specified, check it. */
    if ( iobuf->item_length[ilevel] >= 0 )
       if ( iobuf->item_length[ilevel] !=
@@ -4338,52 +5291,290 @@ int skip_subitem (IO_BUFFER *iobuf)
    IO_ITEM_HEADER item_header;
    int rc;
    
+   /* With a directory of the enclosing item we need not parse the header. */
+   if ( iobuf != (IO_BUFFER *) NULL && iobuf->item_dir != NULL &&
+        iobuf->item_level > 0 && iobuf->item_level < MAX_IO_ITEM_LEVEL )
+   {
+      int ilevel = iobuf->item_level - 1;
+      const IO_SUB_ITEM_ENTRY *e =
+         item_dir_lookup(iobuf, ilevel, (long) (iobuf->data-iobuf->buffer), 1);
+      if ( e != NULL )
+      {
+         iobuf->data = iobuf->buffer + e->offset + 12 +
+            (e->use_extension ? 4 : 0) + e->length;
+         iobuf->r_remaining = iobuf->item_length[0] + 
+            16 + (iobuf->item_extension[0]?4:0) -
+             (long) (iobuf->data - iobuf->buffer);
+         iobuf->w_remaining = 0;
+         return 0;
+      }
+   }
+
    item_header.type = 0;
    if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
       return rc;
    return get_item_end(iobuf,&item_header);
 }
 
-/* ---------------------- search_sub_item ------------------------ */
+/* ----------------- free_item_directories ----------------- */
 /**
- *  @short Search for an item of a specified type.
- *
- *  Search for an item of a specified type, starting at the current
- *  position in the I/O buffer. After successful action the
- *  buffer data pointer points to the beginning of the header
- *  of the first item of that type. If no such item is found,
- *  it points right after the end of the item of
- *  the next higher level.
- *
- *  @param  iobuf  The I/O buffer descriptor.
- *  @param  item_header The header of the item within which we search.
- *  @param  sub_item_header To be filled with what we found.
- *
- *  @return  0 (O.k., sub-item was found),
- *          -1 (error),
- *          -2 (no such sub-item),
- *          -3 (cannot skip sub-items),
- *
+ *  @short Release the sub-item directories of an I/O buffer.
  */
 
-int search_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, 
-   IO_ITEM_HEADER *sub_item_header)
+static void free_item_directories (IO_BUFFER *iobuf)
 {
-   int rc;
-   unsigned long type;
-   int old_level;
+   int ilevel;
 
-   if ( !item_header->can_search )
-      return -3;
-   old_level = item_header->level;
-   if ( old_level < 0 || old_level >= MAX_IO_ITEM_LEVEL )
-      return -1;
-   if ( iobuf->item_level < 1 || iobuf->item_level >= MAX_IO_ITEM_LEVEL )
-      return -1;
-   sub_item_header->level = old_level + 1;
-   type = sub_item_header->type;
+   for ( ilevel=0; ilevel<MAX_IO_ITEM_LEVEL; ilevel++ )
+      if ( iobuf->item_dir[ilevel].entry != NULL )
+         free(iobuf->item_dir[ilevel].entry);
+   free(iobuf->item_dir);
+   iobuf->item_dir = NULL;
+}
 
-   while ( iobuf->r_remaining > 0 )
+/* ----------------- build_item_directory ------------------ */
+/**
+ *  @short Walk over the sub-item headers of the item at given level.
+ *
+ *  @return  Number of sub-items (>=0) or -2 if the item cannot be
+ *           described by a directory (lengths unknown or inconsistent).
+ */
+
+static int build_item_directory (IO_BUFFER *iobuf, int ilevel)
+{
+   struct io_item_directory_struct *dir;
+   BYTE *previous_position = iobuf->data;
+   long previous_remaining = iobuf->r_remaining;
+   long pos, end;
+
+   if ( iobuf->item_dir == NULL )
+   {
+      int i;
+      if ( (iobuf->item_dir = (struct io_item_directory_struct *)
+            calloc(MAX_IO_ITEM_LEVEL,sizeof(struct io_item_directory_struct))) == NULL )
+         return -2;
+      for ( i=0; i<MAX_IO_ITEM_LEVEL; i++ )
+         iobuf->item_dir[i].n = -1;
+   }
+   dir = &iobuf->item_dir[ilevel];
+   dir->n = 0;
+   dir->start = pos = iobuf->item_start_offset[ilevel];
+   dir->length = iobuf->item_length[ilevel];
+   if ( dir->length < 0 )
+      return (dir->n = -2);
+   end = pos + dir->length;
+
+   while ( pos + 12 < end )
+   {
+      IO_SUB_ITEM_ENTRY *e;
+      unsigned long this_type;
+      size_t length, extension;
+
+      if ( dir->n >= dir->nalloc )
+      {
+         int nalloc = (dir->nalloc > 0) ? 2*dir->nalloc : 32;
+         IO_SUB_ITEM_ENTRY *entry = (IO_SUB_ITEM_ENTRY *)
+            realloc(dir->entry, nalloc*sizeof(IO_SUB_ITEM_ENTRY));
+         if ( entry == NULL )
+         {
+            dir->n = -2;
+            break;
+         }
+         dir->entry = entry;
+         dir->nalloc = nalloc;
+      }
+      e = &dir->entry[dir->n];
+
+      iobuf->data = iobuf->buffer + pos;
+      iobuf->r_remaining = end - pos;
+      this_type = (unsigned long) get_long(iobuf);
+      e->type = this_type & 0x0000ffffUL;
+      e->version = (unsigned) (this_type >> 20) & 0xfff;
+      e->user_flag = ((this_type & 0x00010000UL) != 0);
+      e->use_extension = ((this_type & 0x00020000UL) != 0);
+      e->ident = get_long(iobuf);
+      length = get_uint32(iobuf);
+      e->can_search = ((length & 0x40000000UL) != 0);
+      if ( (length & 0x80000000UL) != 0 )
+      {
+         e->use_extension = 1;
+         if ( pos + 16 >= end )
+         {
+            dir->n = -2;
+            break;
+         }
+         extension = get_uint32(iobuf);
+         length = (length & 0x3FFFFFFFUL) | ((extension & 0x0FFFUL) << 30);
+      }
+      else
+         length = (length & 0x3FFFFFFFUL);
+      e->offset = pos;
+      e->length = (long) length;
+
+      /* Anything odd is left to the header-by-header parsing. */
+      if ( (e->version & 0x800) != 0 ||
+           (long) (iobuf->data - iobuf->buffer) + e->length > end )
+      {
+         dir->n = -2;
+         break;
+      }
+      pos = (long) (iobuf->data - iobuf->buffer) + e->length;
+      dir->n++;
+   }
+
+   iobuf->data = previous_position;
+   iobuf->r_remaining = previous_remaining;
+   return dir->n;
+}
+
+/* ------------------- item_dir_lookup -------------------- */
+/**
+ *  @short Find the directory entry at or after a buffer offset.
+ *
+ *  Only a directory that was already built (and is still valid)
+ *  for the item at the given level is used.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *  @param  ilevel The level of the item whose sub-items are looked up.
+ *  @param  pos    The offset in the I/O buffer.
+ *  @param  exact  If non-zero, a sub-item must start at exactly that offset.
+ *
+ *  @return Pointer to the entry or NULL.
+ */
+
+static const IO_SUB_ITEM_ENTRY *item_dir_lookup (IO_BUFFER *iobuf, 
+   int ilevel, long pos, int exact)
+{
+   struct io_item_directory_struct *dir = &iobuf->item_dir[ilevel];
+   int lo = 0, hi;
+
+   if ( dir->n < 0 || dir->start != iobuf->item_start_offset[ilevel] ||
+        dir->length != iobuf->item_length[ilevel] )
+      return NULL;
+   hi = dir->n;
+   while ( lo < hi )
+   {
+      int mid = (lo+hi) / 2;
+      if ( dir->entry[mid].offset < pos )
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   if ( lo >= dir->n || (exact && dir->entry[lo].offset != pos) )
+      return NULL;
+   return &dir->entry[lo];
+}
+
+/* ------------------- item_directory --------------------- */
+/**
+ *  @short Get the (possibly newly built) directory for an item being read.
+ *
+ *  @return Pointer to the directory or NULL if not available.
+ */
+
+static struct io_item_directory_struct *item_directory (IO_BUFFER *iobuf,
+   IO_ITEM_HEADER *item_header)
+{
+   struct io_item_directory_struct *dir;
+   int ilevel = item_header->level;
+
+   if ( !item_header->can_search || ilevel < 0 ||
+        ilevel >= MAX_IO_ITEM_LEVEL || ilevel >= iobuf->item_level )
+      return NULL;
+   if ( iobuf->item_dir == NULL || 
+        (dir = &iobuf->item_dir[ilevel])->n == -1 ||
+        dir->start != iobuf->item_start_offset[ilevel] ||
+        dir->length != iobuf->item_length[ilevel] )
+   {
+      if ( build_item_directory(iobuf,ilevel) < 0 )
+         return NULL;
+      dir = &iobuf->item_dir[ilevel];
+   }
+   if ( dir->n < 0 )
+      return NULL;
+   return dir;
+}
+
+/* ---------------------- set_sub_item -------------------- */
+/**
+ *  @short Position the buffer at the header of a sub-item from
+ *         the directory, in the same way as search_sub_item() does.
+ */
+
+static void set_sub_item (IO_BUFFER *iobuf, int old_level,
+   const IO_SUB_ITEM_ENTRY *e, IO_ITEM_HEADER *sub_item_header)
+{
+   sub_item_header->type = e->type;
+   sub_item_header->version = e->version;
+   sub_item_header->can_search = e->can_search;
+   sub_item_header->level = old_level + 1;
+   sub_item_header->ident = e->ident;
+   sub_item_header->user_flag = e->user_flag;
+   sub_item_header->use_extension = e->use_extension;
+   sub_item_header->length = (size_t) e->length;
+
+   iobuf->data = iobuf->buffer + e->offset;
+   iobuf->r_remaining = iobuf->item_length[0] + 16 + 
+      (iobuf->item_extension[0]?4:0) -
+      (long) (iobuf->data-iobuf->buffer);
+   iobuf->w_remaining = -1;
+   iobuf->item_level = old_level + 1;
+}
+
+/* ------------------- find_sub_item ---------------------- */
+/**
+ *  @short Common code of search_sub_item() and search_sub_item_ident().
+ */
+
+static int find_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, 
+   IO_ITEM_HEADER *sub_item_header, int match_ident, long ident)
+{
+   int rc;
+   unsigned long type;
+   int old_level;
+   struct io_item_directory_struct *dir;
+
+   if ( !item_header->can_search )
+      return -3;
+   old_level = item_header->level;
+   if ( old_level < 0 || old_level >= MAX_IO_ITEM_LEVEL )
+      return -1;
+   if ( iobuf->item_level < 1 || iobuf->item_level >= MAX_IO_ITEM_LEVEL )
+      return -1;
+   sub_item_header->level = old_level + 1;
+   type = sub_item_header->type;
+
+   /* Unless the item is malformed, its directory does the search. */
+   if ( iobuf->item_level == old_level + 1 &&
+        (dir = item_directory(iobuf,item_header)) != NULL )
+   {
+      long pos = (long) (iobuf->data-iobuf->buffer);
+      const IO_SUB_ITEM_ENTRY *e = item_dir_lookup(iobuf,old_level,pos,0);
+      const IO_SUB_ITEM_ENTRY *e_end = dir->entry + dir->n;
+      for ( ; e != NULL && e < e_end; e++ )
+      {
+         if ( (e->type == type || type <= 0) &&
+              (!match_ident || e->ident == ident) )
+         {
+            set_sub_item(iobuf,old_level,e,sub_item_header);
+            return 0;   /* This is the right type of item. */
+         }
+      }
+      /* Not found: we end up after the last sub-item. */
+      if ( dir->n > 0 )
+      {
+         e = e_end - 1;
+         if ( e->offset + 12 + (e->use_extension ? 4 : 0) + e->length > pos )
+            iobuf->data = iobuf->buffer + 
+               (e->offset + 12 + (e->use_extension ? 4 : 0) + e->length);
+         iobuf->r_remaining = iobuf->item_length[0] + 16 + 
+            (iobuf->item_extension[0]?4:0) -
+            (long) (iobuf->data-iobuf->buffer);
+      }
+      return -2;
+   }
+
+   while ( iobuf->r_remaining > 0 )
    {
       sub_item_header->type = 0;
       rc = get_item_begin(iobuf,sub_item_header);
@@ -4392,7 +5583,8 @@ int search_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
          iobuf->item_level = old_level + 1;
          return(rc); /* Error or end of the item. */
       }
-      if ( sub_item_header->type == type || type <= 0 )
+      if ( (sub_item_header->type == type || type <= 0) &&
+           (!match_ident || sub_item_header->ident == ident) )
       {
          /* Similar to unget_item() we set the data pointing back
             to the beginning of the (sub-)block. */
@@ -4415,6 +5607,125 @@ int search_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
    return -2;
 }
 
+/* ---------------------- search_sub_item ------------------------ */
+/**
+ *  @short Search for an item of a specified type.
+ *
+ *  Search for an item of a specified type, starting at the current
+ *  position in the I/O buffer. After successful action the
+ *  buffer data pointer points to the beginning of the header
+ *  of the first item of that type. If no such item is found,
+ *  it points right after the end of the item of
+ *  the next higher level.
+ *  The first search within an item builds a directory of its
+ *  sub-items, such that further searches in the same item
+ *  need not parse the sub-item headers again.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *  @param  item_header The header of the item within which we search.
+ *  @param  sub_item_header To be filled with what we found.
+ *
+ *  @return  0 (O.k., sub-item was found),
+ *          -1 (error),
+ *          -2 (no such sub-item),
+ *          -3 (cannot skip sub-items),
+ *
+ */
+
+int search_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, 
+   IO_ITEM_HEADER *sub_item_header)
+{
+   return find_sub_item(iobuf, item_header, sub_item_header, 0, 0);
+}
+
+/* -------------------- search_sub_item_ident ---------------------- */
+/**
+ *  @short Search for an item of a specified type and identifier.
+ *
+ *  Like search_sub_item() but only a sub-item with the given
+ *  identity number (e.g. a telescope ID) is accepted.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *  @param  item_header The header of the item within which we search.
+ *  @param  sub_item_header To be filled with what we found.
+ *                  The type must be set before the call (0: any type).
+ *  @param  ident  The wanted identity number.
+ *
+ *  @return  0 (O.k., sub-item was found),
+ *          -1 (error),
+ *          -2 (no such sub-item),
+ *          -3 (cannot skip sub-items),
+ */
+
+int search_sub_item_ident (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, 
+   IO_ITEM_HEADER *sub_item_header, long ident)
+{
+   return find_sub_item(iobuf, item_header, sub_item_header, 1, ident);
+}
+
+/* -------------------- get_sub_item_directory --------------------- */
+/**
+ *  @short Get the directory of all sub-items of an item being read.
+ *
+ *  The directory lists type, identifier, header offset and length
+ *  of each sub-item, in the order in which they are in the item.
+ *  It remains valid until the header of another item at the same
+ *  level is read.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *  @param  item_header The header of the (searchable) item.
+ *  @param  entries Set to point to the first directory entry.
+ *
+ *  @return  Number of sub-items (>= 0),
+ *          -1 (error),
+ *          -3 (not a searchable item or not consistent).
+ */
+
+int get_sub_item_directory (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+    const IO_SUB_ITEM_ENTRY **entries)
+{
+   struct io_item_directory_struct *dir;
+
+   if ( iobuf == (IO_BUFFER *) NULL || item_header == (IO_ITEM_HEADER *) NULL )
+      return -1;
+   if ( (dir = item_directory(iobuf,item_header)) == NULL )
+      return item_header->can_search ? -1 : -3;
+   if ( entries != NULL )
+      *entries = dir->entry;
+   return dir->n;
+}
+
+/* ------------------------ goto_sub_item -------------------------- */
+/**
+ *  @short Position the I/O buffer at a sub-item from the directory.
+ *
+ *  After successful action the next get_item_begin() (or the
+ *  next_subitem_...() functions) will pick up the given sub-item,
+ *  regardless of the current position within the enclosing item.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *  @param  item_header The header of the (searchable) item.
+ *  @param  index  Index of the sub-item in the directory.
+ *
+ *  @return  0 (O.k.), -1 (error), -2 (no such sub-item),
+ *          -3 (not a searchable item).
+ */
+
+int goto_sub_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header, int index)
+{
+   IO_ITEM_HEADER sub_item_header;
+   struct io_item_directory_struct *dir;
+
+   if ( iobuf == (IO_BUFFER *) NULL || item_header == (IO_ITEM_HEADER *) NULL )
+      return -1;
+   if ( (dir = item_directory(iobuf,item_header)) == NULL )
+      return item_header->can_search ? -1 : -3;
+   if ( index < 0 || index >= dir->n )
+      return -2;
+   set_sub_item(iobuf,item_header->level,&dir->entry[index],&sub_item_header);
+   return 0;
+}
+
 /* ---------------------- rewind_item ----------------------- */
 /**
  *  @short Go back to the beginning of an item.
@@ -4681,6 +5992,9 @@ int reset_io_block (IO_BUFFER *iobuf)
 
    if ( iobuf == (IO_BUFFER *) NULL )
       return -1;
+#ifdef EVENTIO_HAVE_MMAP
+   unmap_io_buffer_input(iobuf);
+#endif
    iobuf->w_remaining = iobuf->r_remaining = -1L;
    iobuf->item_level = 0;
    iobuf->item_length[0] = iobuf->sub_item_length[0] = 0;
@@ -4699,27 +6013,19 @@ int reset_io_block (IO_BUFFER *iobuf)
    }
    iobuf->data = iobuf->buffer;
    iobuf->regular = 0;
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   /* Anything left over from a previous input is no longer valid. */
+   iobuf->ra_pos = iobuf->ra_end = 0;
+   iobuf->ra_fileno = -1;
+#endif
    /* Note: iobuf->extended mode is not reset */
 
    return 0;
 }
 
-/* ----------------------- write_io_block ------------------------ */
-/**
- *  @short Write an I/O block to the block's output.
- *
- *  The complete I/O block is written to the output destination,
- *  which can be raw I/O (through write), buffered I/O (through
- *  fwrite) or user-defined I/O (through a user funtion).
- *  All items must have been closed before.
- *
- *  @param  iobuf  The I/O buffer descriptor.
- *
- *  @return  0 (O.k.),  -1 (error),  -2 (item has no data)
- *
- */
+/* Actual work of write_io_block(), see below. */
 
-int write_io_block (IO_BUFFER *iobuf)
+static int write_io_block_body (IO_BUFFER *iobuf)
 {
    int rc;
    size_t length;
@@ -4750,6 +6056,10 @@ int write_io_block (IO_BUFFER *iobuf)
       Warning("Output cancelled due to invalid length of top item");
       rc = -1;
    }
+   else if ( iobuf->output_hooks != NULL ) /* Written by the background thread */
+   {
+      rc = (*iobuf->output_hooks->write_block)(iobuf,length);
+   }
    else if ( iobuf->output_fileno >= 0 )
    {
       if (write(iobuf->output_fileno,(char *)iobuf->buffer,(size_t)length) == -1 )
@@ -4792,6 +6102,598 @@ int write_io_block (IO_BUFFER *iobuf)
    return rc;
 }
 
+/* ----------------------- write_io_block ------------------------ */
+/**
+ *  @short Write an I/O block to the block's output.
+ *
+ *  The complete I/O block is written to the output destination,
+ *  which can be raw I/O (through write), buffered I/O (through
+ *  fwrite) or user-defined I/O (through a user funtion).
+ *  All items must have been closed before.
+ *
+ *  @param  iobuf  The I/O buffer descriptor.
+ *
+ *  @return  0 (O.k.),  -1 (error),  -2 (item has no data)
+ *
+ */
+
+int write_io_block (IO_BUFFER *iobuf)
+{
+   int rc;
+   unsigned long type = 0;
+   long length;
+
+   if ( !io_stats_active || iobuf == (IO_BUFFER *) NULL )
+      return write_io_block_body(iobuf);
+
+   /* Type and length must be taken before the buffer gets reset. */
+   length = 16 + (iobuf->item_extension[0]?4:0) + iobuf->item_length[0];
+   if ( iobuf->buffer != (BYTE *) NULL && length >= 16 )
+   {
+      BYTE *previous_position = iobuf->data;
+      long previous_remaining = iobuf->r_remaining;
+      iobuf->data = iobuf->buffer + 4;
+      iobuf->r_remaining = 4;
+      type = (unsigned long) get_uint32(iobuf) & 0x0000ffffUL;
+      iobuf->data = previous_position;
+      iobuf->r_remaining = previous_remaining;
+   }
+   (*io_stats_hooks->block_begin)(iobuf);
+   rc = write_io_block_body(iobuf);
+   (*io_stats_hooks->block_end)(iobuf, IO_STATS_WRITE, type, (rc == 0) ? length : 0);
+   return rc;
+}
+
+/* Output of a complete I/O block given as a list of segments, the first */
+/* of which starts with the sync tag. Unless the block goes directly to */
+/* a file, it is staged in the I/O buffer and written by write_io_block(). */
+
+static int write_io_segments (IO_BUFFER *iobuf, const IO_SEGMENT *seg, int nseg,
+   size_t total, long item_length, int ext)
+{
+   int rc = 0, iseg;
+
+   if ( iobuf->output_hooks != NULL ||
+        (iobuf->output_fileno < 0 && iobuf->output_file == (FILE *) NULL) )
+   {
+      BYTE *dest;
+#ifdef EVENTIO_HAVE_MMAP
+      /* Never write into a memory-mapped input file. */
+      mm_restore_buffer(iobuf);
+#endif
+      /* Only rewind: the buffer keeps its size for the next block. */
+      iobuf->item_level = 0;
+      iobuf->data = iobuf->buffer;
+      iobuf->r_remaining = iobuf->w_remaining = -1L;
+      if ( (size_t) iobuf->buflen < total )
+      {
+         if ( extend_io_buffer(iobuf,0,(long)(total-iobuf->buflen)) == -1 )
+         {
+            Warning("I/O buffer too small; block not written");
+            return -2;
+         }
+      }
+      dest = iobuf->buffer;
+      for ( iseg=0; iseg<nseg; iseg++ )
+      {
+         if ( seg[iseg].length > 0 )
+            memcpy((void *)dest, seg[iseg].data, seg[iseg].length);
+         dest += seg[iseg].length;
+      }
+      iobuf->data = dest;
+      iobuf->item_length[0] = item_length;
+      iobuf->sub_item_length[0] = 0;
+      iobuf->item_extension[0] = ext;
+      iobuf->w_remaining = iobuf->buflen - (long) total;
+      iobuf->item_level = 0;
+      return write_io_block(iobuf);
+   }
+
+   if ( io_stats_active )
+      (*io_stats_hooks->block_begin)(iobuf);
+
+   if ( iobuf->output_fileno >= 0 )
+   {
+#ifdef OS_UNIX
+      struct iovec iov[IO_GATHER_MAX_IOV];
+      int niov = 0;
+      iseg = 0;
+      while ( rc == 0 && (iseg < nseg || niov > 0) )
+      {
+         ssize_t nw;
+         int i;
+         /* Refill the vector with segments not yet written. */
+         while ( niov < IO_GATHER_MAX_IOV && iseg < nseg )
+         {
+            if ( seg[iseg].length > 0 )
+            {
+               iov[niov].iov_base = (void *) (uintptr_t) seg[iseg].data;
+               iov[niov].iov_len = seg[iseg].length;
+               niov++;
+            }
+            iseg++;
+         }
+         if ( niov == 0 )
+            break;
+         if ( (nw = writev(iobuf->output_fileno,iov,niov)) < 0 )
+         {
+            if ( errno == EINTR )
+               continue;
+            Warning("Output error for I/O buffer");
+            rc = -1;
+            break;
+         }
+         /* Drop what was written completely, adjust a partial segment. */
+         for ( i=0; i<niov && (size_t) nw >= iov[i].iov_len; i++ )
+            nw -= (ssize_t) iov[i].iov_len;
+         if ( i < niov )
+         {
+            iov[i].iov_base = (void *) ((char *) iov[i].iov_base + nw);
+            iov[i].iov_len -= (size_t) nw;
+         }
+         if ( i > 0 )
+         {
+            memmove(iov,iov+i,(size_t)(niov-i)*sizeof(iov[0]));
+            niov -= i;
+         }
+      }
+#else
+      for ( iseg=0; iseg<nseg && rc==0; iseg++ )
+      {
+         if ( seg[iseg].length > 0 &&
+              write(iobuf->output_fileno,(char *)seg[iseg].data,
+                 seg[iseg].length) == -1 )
+         {
+            Warning("Output error for I/O buffer");
+            rc = -1;
+         }
+      }
+#endif
+   }
+   else
+   {
+      for ( iseg=0; iseg<nseg && rc==0; iseg++ )
+      {
+         if ( seg[iseg].length > 0 &&
+              fwrite(seg[iseg].data,(size_t)1,seg[iseg].length,
+                 iobuf->output_file) != seg[iseg].length )
+         {
+            if ( ferror(iobuf->output_file) )
+            {
+               Warning("Output error for I/O buffer");
+               clearerr(iobuf->output_file);
+               rc = -1;
+            }
+         }
+      }
+   }
+
+#ifdef EVENTIO_HAVE_TOTAL
+   if ( rc == 0 )
+      iobuf->total_output += total;
+#endif
+
+   if ( io_stats_active )
+   {
+      unsigned long type = 0;
+      const BYTE *tp = NULL;
+      if ( nseg > 0 && seg[0].length >= 8 )
+         tp = (const BYTE *) seg[0].data + 4;
+      else if ( nseg > 1 && seg[0].length == 4 && seg[1].length >= 4 )
+         tp = (const BYTE *) seg[1].data;
+      if ( tp != NULL )
+      {
+         uint32_t word, sync = (uint32_t) 0xD41F8A37UL;
+         /* The type word is in the byte order of the sync tag. */
+         memcpy(&word,tp,4);
+         if ( memcmp(seg[0].data,&sync,4) != 0 )
+            word = ((word & 0xffU) << 24) | ((word & 0xff00U) << 8) |
+                   ((word >> 8) & 0xff00U) | (word >> 24);
+         type = (unsigned long) word & 0x0000ffffUL;
+      }
+      (*io_stats_hooks->block_end)(iobuf, IO_STATS_WRITE, type, (rc == 0) ? (long) total : 0);
+   }
+
+   return rc;
+}
+
+/* -------------------- write_io_block_gather --------------------- */
+/**
+ *  @short Write a top-level item whose data is given as separate segments.
+ *
+ *  The item header is built from the type, version, ident, user flag,
+ *  and 'can_search' flag of the item header, and the header and all
+ *  data segments are written with a single writev() call (or fwrite()
+ *  per segment) without first copying the data into the I/O buffer.
+ *  The data must be in the byte order of the machine.
+ *  Wrapping a complete I/O block as a sub-item works by passing it
+ *  without its first four (sync tag) bytes as a segment, with
+ *  'can_search' set. For output through a user function or a
+ *  write-behind thread the data still gets copied into the I/O buffer.
+ *
+ *  @param  iobuf        The I/O buffer descriptor for the output.
+ *  @param  item_header  The header of the item; the length is set here.
+ *  @param  seg          The data segments, in the order to be written.
+ *  @param  nseg         The number of data segments.
+ *
+ *  @return  0 (O.k.),  -1 (error),  -2 (not enough memory)
+ */
+
+int write_io_block_gather (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+   const IO_SEGMENT *seg, int nseg)
+{
+   uint32_t head[5], this_type, xbit = 0;
+   static const BYTE zero_pad[4] = { 0, 0, 0, 0 };
+   IO_SEGMENT local_seg[IO_GATHER_MAX_IOV];
+   IO_SEGMENT *all_seg = local_seg;
+   size_t length = 0, padding;
+   int i, nhead, nall, rc;
+
+   if ( iobuf == (IO_BUFFER *) NULL || item_header == (IO_ITEM_HEADER *) NULL ||
+        (seg == (const IO_SEGMENT *) NULL && nseg > 0) || nseg < 0 )
+      return -1;
+   if ( !item_header->type )
+      return -1;
+   if ( iobuf->item_level > 0 )
+   {
+      Warning("Output cancelled because item level is not 0");
+      return -1;
+   }
+
+   for ( i=0; i<nseg; i++ )
+      length += seg[i].length;
+   padding = (4 - length%4) % 4;
+   length += padding;
+   if ( (length >> 30) > 4095 )
+   {
+      Warning("I/O block is too long for data format.");
+      return -1;
+   }
+
+   item_header->level = 0;
+   item_header->length = length;
+   item_header->use_extension = (item_header->use_extension != 0) ||
+      (iobuf->extended != 0) || ((length >> 30) != 0);
+   if ( item_header->use_extension )
+      xbit = (uint32_t) 0x80000000UL;
+
+   this_type = (uint32_t) (item_header->type & 0x0000ffffL) |
+               ((uint32_t) item_header->version << 20);
+   if ( item_header->user_flag )
+      this_type |= 0x00010000UL;
+   if ( item_header->use_extension )
+      this_type |= 0x00020000UL;
+   head[0] = (uint32_t) 0xD41F8A37UL;
+   head[1] = this_type;
+   head[2] = (uint32_t) item_header->ident;
+   head[3] = (uint32_t) (length & 0x3FFFFFFFUL) | xbit |
+      (item_header->can_search ? (uint32_t) 0x40000000UL : 0);
+   head[4] = (uint32_t) ((length >> 30) & 0x0FFFUL);
+   nhead = item_header->use_extension ? 5 : 4;
+
+   nall = nseg + 2;
+   if ( nall > IO_GATHER_MAX_IOV )
+   {
+      if ( (all_seg = (IO_SEGMENT *) malloc(nall*sizeof(IO_SEGMENT))) == NULL )
+         return -2;
+   }
+   all_seg[0].data = head;
+   all_seg[0].length = 4 * (size_t) nhead;
+   for ( i=0; i<nseg; i++ )
+      all_seg[i+1] = seg[i];
+   all_seg[nseg+1].data = zero_pad;
+   all_seg[nseg+1].length = padding;
+
+   iobuf->byte_order = 0;
+   rc = write_io_segments(iobuf, all_seg, nall, 4*(size_t)nhead + length,
+      (long) length, item_header->use_extension);
+
+   if ( all_seg != local_seg )
+      free(all_seg);
+   return rc;
+}
+
+/** Find the first complete sync tag (in either byte order) in a memory area.
+ *  The candidate positions are located with memchr(), which is usually
+ *  vectorized, rather than comparing byte by byte.
+ *  @return Offset of the sync tag or -1 if none is found. */
+
+static long find_sync_tag (const BYTE *data, long n)
+{
+   long last = n - 3; /* A complete tag must start before this offset */
+   long pos = 0, pa = -1, pb = -1, pc;
+   const BYTE *p;
+
+   while ( pos < last )
+   {
+      if ( pa < pos )
+         pa = ((p = (const BYTE *) memchr(data+pos,0xD4,(size_t)(last-pos))) != NULL) ?
+              (long)(p-data) : last;
+      if ( pb < pos )
+         pb = ((p = (const BYTE *) memchr(data+pos,0x37,(size_t)(last-pos))) != NULL) ?
+              (long)(p-data) : last;
+      if ( (pc = (pa < pb) ? pa : pb) >= last )
+         break;
+      p = data + pc;
+      if ( (p[0] == 0xD4 && p[1] == 0x1F && p[2] == 0x8A && p[3] == 0x37) ||
+           (p[0] == 0x37 && p[1] == 0x8A && p[2] == 0x1F && p[3] == 0xD4) )
+         return pc;
+      pos = pc + 1;
+   }
+   return -1;
+}
+
+#ifdef EVENTIO_HAVE_READ_AHEAD
+
+/* ---------------------- Read-ahead for raw input ---------------------- */
+/*
+ *  With raw input through 'input_fileno' the sync tag search would
+ *  otherwise need one read() system call per byte. Instead, input is
+ *  read in large chunks into a separate read-ahead buffer from which
+ *  the sync tag search, the header and the data of each I/O block are
+ *  then served. Any application switching to a new input on the same
+ *  I/O buffer should call reset_io_block(), as was already needed
+ *  for the 'regular' flag.
+ */
+
+/** Check if read-ahead is used for the current raw input, setting it up if needed. */
+
+static int ra_active (IO_BUFFER *iobuf)
+{
+   if ( iobuf->input_fileno < 0 || iobuf->ra_length < 0 )
+      return 0;
+   if ( iobuf->ra_buffer == (BYTE *) NULL )
+   {
+      if ( iobuf->ra_length == 0 )
+         iobuf->ra_length = IO_READ_AHEAD_LENGTH;
+      else if ( iobuf->ra_length < 1024 )
+         iobuf->ra_length = 1024;
+      if ( (iobuf->ra_buffer = (BYTE *) malloc((size_t)iobuf->ra_length)) == NULL )
+      {
+         Warning("Allocating read-ahead buffer failed; reading byte by byte");
+         iobuf->ra_length = -1;
+         return 0;
+      }
+      iobuf->ra_pos = iobuf->ra_end = 0;
+      iobuf->ra_fileno = iobuf->input_fileno;
+   }
+   /* Data buffered from a different input is of no use any more. */
+   if ( iobuf->ra_fileno != iobuf->input_fileno )
+   {
+      iobuf->ra_pos = iobuf->ra_end = 0;
+      iobuf->ra_fileno = iobuf->input_fileno;
+   }
+   return 1;
+}
+
+/** Read more data into the read-ahead buffer, with a single read call.
+ *  @return Number of bytes added, 0 at end-of-file, -1 for read error. */
+
+static long ra_fill (IO_BUFFER *iobuf)
+{
+   ssize_t rb;
+   long avail = iobuf->ra_end - iobuf->ra_pos;
+
+   /* Move any remaining data to the beginning of the buffer. */
+   if ( iobuf->ra_pos > 0 )
+   {
+      if ( avail > 0 )
+         memmove((void *)iobuf->ra_buffer,
+            (void *)(iobuf->ra_buffer+iobuf->ra_pos), (size_t)avail);
+      iobuf->ra_pos = 0;
+      iobuf->ra_end = avail;
+   }
+   if ( iobuf->ra_end >= iobuf->ra_length )
+      return 0;
+   rb = READ_BYTES(iobuf->input_fileno,
+        (char *)(iobuf->ra_buffer+iobuf->ra_end),
+        iobuf->ra_length-iobuf->ra_end);
+   if ( rb < 0 )
+      return -1;
+   iobuf->ra_end += (long) rb;
+   return (long) rb;
+}
+
+/** Skip input up to the next sync tag, leaving it as the next unconsumed data.
+ *  @return 1 (found), 0 (end-of-file), -1 (read error) */
+
+static int ra_find_sync (IO_BUFFER *iobuf, long *skipped)
+{
+   long avail, off;
+   long rc;
+
+   for (;;)
+   {
+      avail = iobuf->ra_end - iobuf->ra_pos;
+      if ( avail >= 4 )
+      {
+         if ( (off = find_sync_tag(iobuf->ra_buffer+iobuf->ra_pos, avail)) >= 0 )
+         {
+            iobuf->ra_pos += off;
+            *skipped += off;
+            return 1;
+         }
+         /* The last three bytes could still be the start of a sync tag. */
+         *skipped += avail - 3;
+         iobuf->ra_pos = iobuf->ra_end - 3;
+      }
+      if ( (rc = ra_fill(iobuf)) <= 0 )
+         return (int) rc;
+   }
+}
+
+/** Read data from raw input, as far as possible served from the read-ahead buffer.
+ *  Larger requests beyond the buffered data are read directly into the target.
+ *  @return Number of bytes read (less than requested at end-of-file) or -1. */
+
+static ssize_t ra_read (IO_BUFFER *iobuf, BYTE *target, size_t nb)
+{
+   size_t nr = 0;
+   ssize_t rb;
+
+   while ( nr < nb )
+   {
+      size_t avail = (size_t) (iobuf->ra_end - iobuf->ra_pos);
+      if ( avail > 0 )
+      {
+         size_t nc = (avail < nb-nr) ? avail : nb-nr;
+         COPY_BYTES((void *)(target+nr),(void *)(iobuf->ra_buffer+iobuf->ra_pos),nc);
+         iobuf->ra_pos += (long) nc;
+         nr += nc;
+         continue;
+      }
+      if ( nb-nr >= (size_t) iobuf->ra_length/2 )
+      {
+         /* Buffer is empty and the rest is large: no need for an extra copy. */
+         iobuf->ra_pos = iobuf->ra_end = 0;
+         if ( (rb = READ_BYTES(iobuf->input_fileno,(char *)(target+nr),nb-nr)) > 0 )
+            nr += (size_t) rb;
+      }
+      else
+         rb = ra_fill(iobuf);
+      if ( rb < 0 )
+         return (nr > 0) ? (ssize_t) nr : -1;
+      if ( rb == 0 )
+         break;
+   }
+   return (ssize_t) nr;
+}
+
+/** Drop up to nb bytes of buffered input.
+ *  @return The number of bytes dropped. */
+
+static long ra_drop (IO_BUFFER *iobuf, long nb)
+{
+   long avail = iobuf->ra_end - iobuf->ra_pos;
+   if ( avail > nb )
+      avail = nb;
+   iobuf->ra_pos += avail;
+   return avail;
+}
+
+/* Reading through the read-ahead buffer, where active, or directly otherwise. */
+#define RAW_READ_BYTES(iobuf,buf,nb) (ra_active(iobuf) ? \
+  ra_read(iobuf,(BYTE *)(buf),(size_t)(nb)) : \
+  READ_BYTES((iobuf)->input_fileno,buf,nb) )
+
+#else
+
+#define RAW_READ_BYTES(iobuf,buf,nb) READ_BYTES((iobuf)->input_fileno,buf,nb)
+
+#endif
+
+#ifdef EVENTIO_HAVE_MMAP
+
+/* ------------------ Memory-mapped input files -------------------- */
+/*
+ *  With a memory-mapped input file, the I/O buffer of each block
+ *  just points into the mapped file contents and no data gets copied.
+ *  The buffer owned by the I/O buffer descriptor is set aside meanwhile
+ *  and is put back before any data gets written, when the input is
+ *  unmapped, or when the I/O buffer is reset or freed.
+ */
+
+/** Let the I/O buffer point to the mapped file contents at given offset. */
+
+static void mm_point_buffer (IO_BUFFER *iobuf, size_t pos)
+{
+   if ( iobuf->mm_buffer == (BYTE *) NULL )
+   {
+      iobuf->mm_buffer = iobuf->buffer;
+      iobuf->mm_buflen = iobuf->buflen;
+      iobuf->mm_is_allocated = iobuf->is_allocated;
+   }
+   iobuf->buffer = iobuf->data = iobuf->mm_data + pos;
+   iobuf->buflen = (long) (iobuf->mm_length - pos);
+   iobuf->is_allocated = 0;
+}
+
+/** Put the buffer owned by the I/O buffer descriptor back in place. */
+
+static void mm_restore_buffer (IO_BUFFER *iobuf)
+{
+   if ( iobuf->mm_buffer == (BYTE *) NULL )
+      return;
+   iobuf->buffer = iobuf->data = iobuf->mm_buffer;
+   iobuf->buflen = iobuf->mm_buflen;
+   iobuf->is_allocated = iobuf->mm_is_allocated;
+   iobuf->mm_buffer = (BYTE *) NULL;
+   iobuf->mm_buflen = 0;
+}
+
+/* ------------------- map_io_buffer_input -------------------- */
+/**
+ *  @short Use a memory-mapped regular file as input for the I/O buffer.
+ *
+ *  The whole file is mapped (copy-on-write, so that the file itself
+ *  is never modified) and subsequent find_io_block(), read_io_block()
+ *  and skip_io_block() calls use the mapped data without copying
+ *  it into the I/O buffer. Reading starts at the current position
+ *  of the file descriptor, which should therefore be called right
+ *  after opening the file and before any data was read through stdio.
+ *  The file descriptor is not needed any more once this succeeded.
+ *  Data in a block obtained this way must not be modified in place
+ *  as far as the application expects it to go back to the file.
+ *  The mapping ends with unmap_io_buffer_input(), reset_io_block(),
+ *  or free_io_buffer().
+ *
+ *  @param iobuf The I/O buffer descriptor.
+ *  @param fd    File descriptor of the input file.
+ *
+ *  @return 0 (O.k.), -1 (cannot be mapped, for example not a regular
+ *          file; normal input should be used instead).
+ */
+
+int map_io_buffer_input (IO_BUFFER *iobuf, int fd)
+{
+   struct stat st;
+   off_t pos;
+   void *addr;
+
+   if ( iobuf == (IO_BUFFER *) NULL || fd < 0 )
+      return -1;
+   unmap_io_buffer_input(iobuf);
+   if ( fstat(fd,&st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 )
+      return -1;
+   if ( (off_t) (size_t) st.st_size != st.st_size ) /* Too large for address space */
+      return -1;
+   if ( (pos = lseek(fd,(off_t)0,SEEK_CUR)) < 0 )
+      pos = 0;
+   if ( pos >= st.st_size )
+      return -1;
+   addr = mmap(NULL,(size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,(off_t)0);
+   if ( addr == MAP_FAILED )
+      return -1;
+#ifdef MADV_SEQUENTIAL
+   (void) madvise(addr,(size_t)st.st_size,MADV_SEQUENTIAL);
+#endif
+   iobuf->mm_data = (BYTE *) addr;
+   iobuf->mm_length = (size_t) st.st_size;
+   iobuf->mm_pos = (size_t) pos;
+   iobuf->regular = 1;
+   return 0;
+}
+
+/* ------------------ unmap_io_buffer_input ------------------- */
+/**
+ *  @short End using a memory-mapped input file with the I/O buffer.
+ *
+ *  The I/O buffer gets its own data buffer back. Data of the last
+ *  block read is no longer accessible after this.
+ */
+
+void unmap_io_buffer_input (IO_BUFFER *iobuf)
+{
+   if ( iobuf == (IO_BUFFER *) NULL || iobuf->mm_data == (BYTE *) NULL )
+      return;
+   mm_restore_buffer(iobuf);
+   (void) munmap((void *)iobuf->mm_data,iobuf->mm_length);
+   iobuf->mm_data = (BYTE *) NULL;
+   iobuf->mm_length = iobuf->mm_pos = 0;
+}
+
+#endif
+
 /* ----------------------- find_io_block ------------------------ */
 /**
  *  @short Find the beginning of the next I/O data block in the input.
@@ -4799,6 +6701,8 @@ int write_io_block (IO_BUFFER *iobuf)
  *  Read byte for byte from the input file specified
  *  for the I/O buffer and look for the sync-tag (magic
  *  number in little-endian or big-endian byte order.
+ *  For raw input (through input_fileno) the input is rather
+ *  scanned in the read-ahead buffer, if that is not disabled.
  *  As long as the input is properly synchronized this
  *  sync-tag should be found in the first four bytes.
  *  Otherwise, input data is skipped until the next
@@ -4832,7 +6736,12 @@ int find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       Warning("You forgot to read or skip the data of the previous I/O block");
       return -1;
    }
+   if ( iobuf->input_hooks != NULL ) /* Already read by the background thread */
+      return (*iobuf->input_hooks->find_block)(iobuf,item_header);
    iobuf->item_level = 0;
+#ifdef EVENTIO_HAVE_MMAP
+   mm_restore_buffer(iobuf);
+#endif
    iobuf->data = iobuf->buffer;
    iobuf->w_remaining = iobuf->r_remaining = -1L;
    iobuf->item_extension[0] = 0;
@@ -4842,85 +6751,131 @@ int find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       return -1;
    }
    if ( iobuf->input_fileno < 0 && iobuf->input_file == (FILE *) NULL &&
-        iobuf->user_function == NULL )
+        iobuf->user_function == NULL
+#ifdef EVENTIO_HAVE_MMAP
+        && iobuf->mm_data == (BYTE *) NULL
+#endif
+      )
    {
       Warning("No file specified from which I/O buffer should be read");
       return -1;
    }
 
+#ifdef EVENTIO_HAVE_MMAP
+   if ( iobuf->mm_data != (BYTE *) NULL )
+   {
+      size_t avail = iobuf->mm_length - iobuf->mm_pos;
+      long off = (avail >= 16) ? 
+         find_sync_tag(iobuf->mm_data+iobuf->mm_pos,(long)avail) : -1;
+      if ( off < 0 || avail - (size_t) off < 16 )
+      {
+         iobuf->mm_pos = iobuf->mm_length;
+         item_header->type = 0;
+         iobuf->item_length[0] = 0;
+         return -2;
+      }
+      sync_count = off;
+      iobuf->mm_pos += (size_t) off;
+      mm_point_buffer(iobuf,iobuf->mm_pos);
+      iobuf->mm_pos += 16;
+      rc = 12;
+   }
+   else
+#endif
    if ( iobuf->input_fileno >= 0 || iobuf->input_file != (FILE *) NULL )
    {
-      for ( sync_count=(-4L), block_found=byte_number=byte_order=0;
-            !block_found; sync_count++ )
+#ifdef EVENTIO_HAVE_READ_AHEAD
+      if ( ra_active(iobuf) )
       {
-         if ( iobuf->input_fileno >= 0 )  /* Use system read function */
-            rc = READ_BYTES(iobuf->input_fileno,
-                 (char *)(iobuf->buffer+byte_number),1L);
-         else if ( (char) (*(char *)(iobuf->buffer+byte_number) = (char)
-              getc(iobuf->input_file)) != (char) EOF )   /* Use getc macro */
-            rc = 1;
-         else if ( ferror(iobuf->input_file) )  /* EOF may be valid byte */
+         sync_count = 0;
+         if ( (rc = ra_find_sync(iobuf,&sync_count)) > 0 )
          {
-            clearerr(iobuf->input_file);
-            rc = -1;
-         }
-         else if ( feof(iobuf->input_file) )
-         {
-#ifdef OS_OS9
-            cleareof(iobuf->input_file);
-#else
-            clearerr(iobuf->input_file);
-#endif
-            rc = 0;
+            /* Sync tag plus 12 more bytes of header (type, ident, length). */
+            if ( (rc = (int) ra_read(iobuf,iobuf->buffer,16L)) > 0 )
+               rc -= 4;
          }
-         if ( rc <= 0 )  /* End-of-file or read error */
+         else if ( rc == 0 ) /* End-of-file */
          {
             item_header->type = 0;
             iobuf->item_length[0] = 0;
-            if ( rc == 0 ) /* EOF */
-               return -2;
-            else           /* input error */
-               return -1;
-         }
-         if ( byte_order == 0 )
-         {
-            if ( *iobuf->buffer == (BYTE) sync_tag_byte[0] )
-               byte_order = 1;
-            else if ( *iobuf->buffer == (BYTE) sync_tag_byte[3] )
-               byte_order = -1;
-            else
-               continue;
-            byte_number = 1;
+            return -2;
          }
-         else if ( byte_order == 1 )
+      }
+      else
+#endif
+      {
+         for ( sync_count=(-4L), block_found=byte_number=byte_order=0;
+               !block_found; sync_count++ )
          {
-            if ( iobuf->buffer[byte_number] != sync_tag_byte[byte_number] )
+            if ( iobuf->input_fileno >= 0 )  /* Use system read function */
+               rc = READ_BYTES(iobuf->input_fileno,
+                    (char *)(iobuf->buffer+byte_number),1L);
+            else if ( (char) (*(char *)(iobuf->buffer+byte_number) = (char)
+                 getc(iobuf->input_file)) != (char) EOF )   /* Use getc macro */
+               rc = 1;
+            else if ( ferror(iobuf->input_file) )  /* EOF may be valid byte */
             {
-               byte_order = byte_number = 0;
-               continue;
+               clearerr(iobuf->input_file);
+               rc = -1;
             }
-            byte_number++;
-         }
-         else if ( byte_order == -1 )
-         {
-            if ( iobuf->buffer[byte_number] != sync_tag_byte[3-byte_number] )
+            else if ( feof(iobuf->input_file) )
             {
-               byte_order = byte_number = 0;
-               continue;
+#ifdef OS_OS9
+               cleareof(iobuf->input_file);
+#else
+               clearerr(iobuf->input_file);
+#endif
+               rc = 0;
+            }
+            if ( rc <= 0 )  /* End-of-file or read error */
+            {
+               item_header->type = 0;
+               iobuf->item_length[0] = 0;
+               if ( rc == 0 ) /* EOF */
+                  return -2;
+               else           /* input error */
+                  return -1;
+            }
+            if ( byte_order == 0 )
+            {
+               if ( *iobuf->buffer == (BYTE) sync_tag_byte[0] )
+                  byte_order = 1;
+               else if ( *iobuf->buffer == (BYTE) sync_tag_byte[3] )
+                  byte_order = -1;
+               else
+                  continue;
+               byte_number = 1;
             }
-            byte_number++;
+            else if ( byte_order == 1 )
+            {
+               if ( iobuf->buffer[byte_number] != sync_tag_byte[byte_number] )
+               {
+                  byte_order = byte_number = 0;
+                  continue;
+               }
+               byte_number++;
+            }
+            else if ( byte_order == -1 )
+            {
+               if ( iobuf->buffer[byte_number] != sync_tag_byte[3-byte_number] )
+               {
+                  byte_order = byte_number = 0;
+                  continue;
+               }
+               byte_number++;
+            }
+            if ( byte_number == 4 )
+               block_found = 1;
          }
-         if ( byte_number == 4 )
-            block_found = 1;
-      }
 
-      if ( iobuf->input_fileno >= 0 )  /* Use system read function */
-         rc = READ_BYTES(iobuf->input_fileno,(char *)(iobuf->buffer+4),12L);
-      else if ( (rc = fread((void *)(iobuf->buffer+4),(size_t)1,(size_t)12,
-              iobuf->input_file)) == 0 )
-      {
-         if ( ferror(iobuf->input_file) )
-            rc = -1;
+         if ( iobuf->input_fileno >= 0 )  /* Use system read function */
+            rc = READ_BYTES(iobuf->input_fileno,(char *)(iobuf->buffer+4),12L);
+         else if ( (rc = fread((void *)(iobuf->buffer+4),(size_t)1,(size_t)12,
+                 iobuf->input_file)) == 0 )
+         {
+            if ( ferror(iobuf->input_file) )
+               rc = -1;
+         }
       }
       if ( rc > 0 && rc != 12 )
       {
@@ -4970,10 +6925,24 @@ int find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       xbit = len1 & (uint32_t)0x80000000UL;
       if ( xbit ) /* Really need to get the extension field now */
       {
+#ifdef EVENTIO_HAVE_MMAP
+         if ( iobuf->mm_data != (BYTE *) NULL )
+         {
+            /* Already in place, just need to advance. */
+            if ( iobuf->mm_length - iobuf->mm_pos < 4 )
+            {
+               iobuf->mm_pos = iobuf->mm_length;
+               Warning("Wrong number of bytes were read (end of mapped file)");
+               return -1;
+            }
+            iobuf->mm_pos += 4;
+         }
+         else
+#endif
          if ( iobuf->input_fileno >= 0 || iobuf->input_file != (FILE *) NULL )
          {
             if ( iobuf->input_fileno >= 0 )  /* Use system read function */
-               rc = READ_BYTES(iobuf->input_fileno,(char *)(iobuf->buffer+16),4L);
+               rc = RAW_READ_BYTES(iobuf,(char *)(iobuf->buffer+16),4L);
             else if ( (rc = fread((void *)(iobuf->buffer+16),(size_t)1,(size_t)4,
                     iobuf->input_file)) == 0 )
             {
@@ -5032,43 +7001,26 @@ int find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       char msg[256];
       (void) sprintf(msg,
          "Synchronization error. %ld bytes of data have been skipped.",
-         sync_count);
-      Warning(msg);
-      (void) sprintf(msg,"Now at %sitem type %lu, version %u, ID %ld, length %ld.",
-         item_header->use_extension?"extended ":"",  item_header->type,
-         item_header->version, item_header->ident, iobuf->item_length[0]);
-      Warning(msg);
-      if ( iobuf->sync_err_count++ >= iobuf->sync_err_max )
-      {
-         (void) sprintf(msg, "Too many synchronization errors.");
-         Warning(msg);
-         return -1;
-      }
-   }
-
-   return 0;
-}
-
-/* ------------------------ read_io_block ------------------------ */
-/**
- *  @short Read the data of an I/O block from the input.
- *
- *  This function is called for reading data after an I/O data block 
- *  has been found (with find_io_block) on input. 
- *  The type of I/O (raw, buffered, or user-defined) depends
- *  on the settings of the I/O block.
- *
- *  @param  iobuf       The I/O buffer descriptor.
- *  @param  item_header The item header descriptor.
- *
- *  @return  0 (O.k.),
- *          -1 (error),
- *          -2 (end-of-file),
- *          -3 (block skipped because it is too large)
- *
- */
+         sync_count);
+      Warning(msg);
+      (void) sprintf(msg,"Now at %sitem type %lu, version %u, ID %ld, length %ld.",
+         item_header->use_extension?"extended ":"",  item_header->type,
+         item_header->version, item_header->ident, iobuf->item_length[0]);
+      Warning(msg);
+      if ( iobuf->sync_err_count++ >= iobuf->sync_err_max )
+      {
+         (void) sprintf(msg, "Too many synchronization errors.");
+         Warning(msg);
+         return -1;
+      }
+   }
 
-int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
+   return 0;
+}
+
+/* Actual work of read_io_block(), see below. */
+
+static int read_io_block_body (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
 {
    int rc = 0;
    size_t length, rb = 0;
@@ -5084,6 +7036,8 @@ int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       Warning("You must find an I/O block before you can read it");
       return -1;
    }
+   if ( iobuf->input_hooks != NULL )
+      return (*iobuf->input_hooks->read_block)(iobuf,item_header);
 
    if ( iobuf->item_level != 0 ||
       iobuf->item_length[0] < 0 )
@@ -5102,6 +7056,36 @@ int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    if ( iobuf->buffer == (BYTE *) NULL )
       return -1;
 
+#ifdef EVENTIO_HAVE_MMAP
+   /* With a memory-mapped input file the data is already in place. */
+   if ( iobuf->mm_data != (BYTE *) NULL )
+   {
+      size_t avail = iobuf->mm_length - iobuf->mm_pos;
+      if ( avail < length )
+      {
+         item_header->type = 0;
+         iobuf->item_length[0] = 0;
+         iobuf->mm_pos = iobuf->mm_length;
+         if ( avail == 0 ) /* EOF */
+            return -2;
+         else
+         {
+            char msg[256];
+            sprintf(msg,
+              "Wrong number of bytes were read (%zu instead of %zu)",avail,length);
+            Warning(msg);
+            return -1;
+         }
+      }
+      iobuf->mm_pos += length;
+#ifdef EVENTIO_HAVE_TOTAL
+      iobuf->total_input += iobuf->item_length[0]+header_length;
+#endif
+      iobuf->data_pending = 0;
+      return 0;
+   }
+#endif
+
    if ( iobuf->item_length[0] > 0 )
    {
       if ( iobuf->buflen < iobuf->item_length[0]+header_length )
@@ -5122,7 +7106,7 @@ int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
          /* Both read and fread return the number of bytes actually read */
          if ( iobuf->input_fileno >= 0 )
          {
-            rb = READ_BYTES(iobuf->input_fileno,
+            rb = RAW_READ_BYTES(iobuf,
                (char *)(iobuf->buffer+header_length),length);
          }
          else if ( (rb = fread((void *)(iobuf->buffer+header_length),(size_t)1,(size_t)length,
@@ -5174,6 +7158,40 @@ int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    return 0;
 }
 
+/* ------------------------ read_io_block ------------------------ */
+/**
+ *  @short Read the data of an I/O block from the input.
+ *
+ *  This function is called for reading data after an I/O data block 
+ *  has been found (with find_io_block) on input. 
+ *  The type of I/O (raw, buffered, or user-defined) depends
+ *  on the settings of the I/O block.
+ *
+ *  @param  iobuf       The I/O buffer descriptor.
+ *  @param  item_header The item header descriptor.
+ *
+ *  @return  0 (O.k.),
+ *          -1 (error),
+ *          -2 (end-of-file),
+ *          -3 (block skipped because it is too large)
+ *
+ */
+
+int read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
+{
+   int rc;
+
+   if ( !io_stats_active || iobuf == (IO_BUFFER *) NULL || 
+        item_header == (IO_ITEM_HEADER *) NULL )
+      return read_io_block_body(iobuf,item_header);
+
+   (*io_stats_hooks->block_begin)(iobuf);
+   rc = read_io_block_body(iobuf,item_header);
+   (*io_stats_hooks->block_end)(iobuf, IO_STATS_READ, item_header->type, (rc == 0) ?
+      16 + (iobuf->item_extension[0]?4:0) + iobuf->item_length[0] : 0);
+   return rc;
+}
+
 /* ------------------------ skip_io_block ------------------------ */
 /**
  *  @short Skip the data of an I/O block from the input.
@@ -5211,6 +7229,8 @@ int skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       Warning("You must find an I/O block before you can skip it");
       return -1;
    }
+   if ( iobuf->input_hooks != NULL )
+      return (*iobuf->input_hooks->skip_block)(iobuf,item_header);
    if ( iobuf->item_level != 0 || iobuf->item_length[0] < 0 )
       return -1;
    length = iobuf->item_length[0];
@@ -5228,6 +7248,34 @@ int skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       return((iobuf->user_function)(iobuf->buffer,length,4));
    }
 
+#ifdef EVENTIO_HAVE_MMAP
+   if ( iobuf->mm_data != (BYTE *) NULL )
+   {
+      iobuf->item_length[0] = iobuf->sub_item_length[0] = -1;
+      iobuf->data_pending = 0;
+      if ( iobuf->mm_length - iobuf->mm_pos < (size_t) length )
+      {
+         iobuf->mm_pos = iobuf->mm_length;
+         return -2;
+      }
+      iobuf->mm_pos += (size_t) length;
+      return 0;
+   }
+#endif
+
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   /* Data already in the read-ahead buffer needs no seeking or reading. */
+   if ( ra_active(iobuf) )
+   {
+      if ( (length -= ra_drop(iobuf,length)) == 0 )
+      {
+         iobuf->item_length[0] = iobuf->sub_item_length[0] = -1;
+         iobuf->data_pending = 0;
+         return 0;
+      }
+   }
+#endif
+
 #ifndef FSTAT_NOT_AVAILABLE
    if ( iobuf->regular >= 0 )
    {
@@ -5267,9 +7315,9 @@ int skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
       {
          if ( iobuf->regular == 0 ) /* Don't know yet, need to find out */
          {
-            fstat(fileno(iobuf->input_file),&st);
 #ifdef S_IFREG
-            if ( st.st_mode & S_IFREG )
+            if ( fstat(fileno(iobuf->input_file),&st) == 0 &&
+                 (st.st_mode & S_IFREG) )
                iobuf->regular = 1;
             else
 #endif
@@ -5329,6 +7377,148 @@ int skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
    return 0;
 }
 
+/* -------------------- input_position ------------------------ */
+/**
+ *  The current position in the input, as far as consumed by eventio,
+ *  or -1 if that is not known (pipes, user functions).
+ */
+
+static int64_t input_position (IO_BUFFER *iobuf)
+{
+   int64_t pos = -1;
+
+#ifdef EVENTIO_HAVE_MMAP
+   if ( iobuf->mm_data != (BYTE *) NULL )
+      return (int64_t) iobuf->mm_pos;
+#endif
+   if ( iobuf->input_fileno > 0 ) /* Using low-level I/O */
+   {
+#ifdef __USE_LARGEFILE64
+      pos = (int64_t) lseek64(iobuf->input_fileno,(off64_t)0,SEEK_CUR);
+#else
+      pos = (int64_t) lseek(iobuf->input_fileno,(off_t)0,SEEK_CUR);
+#endif
+   }
+   else if ( iobuf->input_fileno == 0 || iobuf->input_file != (FILE *) NULL )
+   {
+      /* Note that READ_BYTES() uses buffered I/O for standard input. */
+      FILE *f = (iobuf->input_fileno == 0) ? stdin : iobuf->input_file;
+#ifdef __USE_LARGEFILE64
+      pos = (int64_t) ftello64(f);
+#else
+      pos = (int64_t) ftello(f);
+#endif
+   }
+   if ( pos < 0 )
+      return -1;
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   /* Data in the read-ahead buffer was not consumed yet. */
+   if ( iobuf->input_fileno >= 0 && iobuf->ra_buffer != (BYTE *) NULL &&
+        iobuf->ra_fileno == iobuf->input_fileno )
+      pos -= (int64_t) (iobuf->ra_end - iobuf->ra_pos);
+#endif
+   return pos;
+}
+
+/* --------------------- io_block_offset ----------------------- */
+/**
+ *  @short Get the position in the input of the I/O block just found.
+ *
+ *  This is only available after find_io_block() and before
+ *  read_io_block() or skip_io_block() for the same block.
+ *
+ *  @param  iobuf   The I/O buffer descriptor.
+ *
+ *  @return  Byte offset of the sync tag of the block in the input
+ *           or -1 (no block pending or position not available).
+ */
+
+int64_t io_block_offset (IO_BUFFER *iobuf)
+{
+   int64_t pos;
+   if ( iobuf == (IO_BUFFER *) NULL || iobuf->data_pending <= 0 )
+      return -1;
+   if ( iobuf->input_hooks != NULL )
+      return (*iobuf->input_hooks->block_offset)(iobuf);
+   if ( (pos = input_position(iobuf)) < 0 )
+      return -1;
+   pos -= 16 + (iobuf->item_extension[0] ? 4 : 0);
+   return (pos >= 0) ? pos : -1;
+}
+
+/* ---------------------- seek_io_block ------------------------ */
+/**
+ *  @short Position the input at a given byte offset.
+ *
+ *  The offset should be that of the sync tag of an I/O block,
+ *  as obtained from io_block_offset() or from a block index
+ *  (see io_index.h), such that the next find_io_block() gets
+ *  that block. Any block found but not yet read or skipped
+ *  is discarded. This only works for input from regular files
+ *  (or memory-mapped input), not for pipes or user functions.
+ *  Background prefetching, if active, is stopped first.
+ *
+ *  @param  iobuf   The I/O buffer descriptor.
+ *  @param  offset  The byte offset from the start of the input.
+ *
+ *  @return  0 (O.k.),  -1 (error)
+ */
+
+int seek_io_block (IO_BUFFER *iobuf, int64_t offset)
+{
+   int rc = -1;
+
+   if ( iobuf == (IO_BUFFER *) NULL || offset < 0 )
+      return -1;
+   if ( iobuf->input_hooks != NULL )
+      (*iobuf->input_hooks->stop)(iobuf);
+
+#ifdef EVENTIO_HAVE_MMAP
+   if ( iobuf->mm_data != (BYTE *) NULL )
+   {
+      if ( (uint64_t) offset <= (uint64_t) iobuf->mm_length )
+      {
+         iobuf->mm_pos = (size_t) offset;
+         rc = 0;
+      }
+   }
+   else
+#endif
+   if ( iobuf->input_fileno > 0 ) /* Using low-level I/O */
+   {
+#ifdef __USE_LARGEFILE64
+      if ( lseek64(iobuf->input_fileno,(off64_t)offset,SEEK_SET) != -1 )
+#else
+      if ( lseek(iobuf->input_fileno,(off_t)offset,SEEK_SET) != -1 )
+#endif
+         rc = 0;
+   }
+   else if ( iobuf->input_fileno == 0 || iobuf->input_file != (FILE *) NULL )
+   {
+      FILE *f = (iobuf->input_fileno == 0) ? stdin : iobuf->input_file;
+#ifdef __USE_LARGEFILE64
+      if ( fseeko64(f,(off64_t)offset,SEEK_SET) != -1 )
+#else
+      if ( fseeko(f,(off_t)offset,SEEK_SET) != -1 )
+#endif
+         rc = 0;
+   }
+
+   if ( rc != 0 )
+   {
+      Warning("Cannot seek to the requested position in the input");
+      return -1;
+   }
+
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   iobuf->ra_pos = iobuf->ra_end = 0;
+#endif
+   iobuf->item_length[0] = iobuf->sub_item_length[0] = -1;
+   iobuf->item_level = 0;
+   iobuf->data_pending = 0;
+   return 0;
+}
+
 /* ---------------------- list_io_blocks ------------------------- */
 /**
  *  Show the top-level item of an I/O block on standard output.
@@ -5486,6 +7676,72 @@ int copy_item_to_io_block (IO_BUFFER *iobuf2, IO_BUFFER *iobuf,
    return 0;
 }
 
+/* ------------------ write_item_as_io_block -------------------- */
+/**
+ *  @short Write a sub-item as a top-level item without copying it.
+ *
+ *  Same result as copy_item_to_io_block() followed by write_io_block()
+ *  on the target I/O buffer, but the sub-item header and data are
+ *  written directly from the source I/O buffer (see write_io_block_gather()).
+ *  The source I/O buffer is advanced to the end of the sub-item.
+ *
+ *  @param  iobuf2        I/O buffer descriptor for the output.
+ *  @param  iobuf         Source I/O buffer descriptor.
+ *  @param  item_header   Header for the item in iobuf that
+ *                        should be written as a block.
+ *
+ *  @return  0 (o.k.),  -1 (error),  -2 (not enough memory etc.)
+ *
+ */
+
+int write_item_as_io_block (IO_BUFFER *iobuf2, IO_BUFFER *iobuf, 
+   const IO_ITEM_HEADER *item_header)
+{
+   IO_SEGMENT seg[2];
+   long length;
+   int ilevel;
+   int ie4 = 0;
+
+   if ( iobuf == (IO_BUFFER *) NULL || iobuf2 == (const IO_BUFFER *) NULL ||
+        item_header == (const IO_ITEM_HEADER *) NULL )
+      return -1;
+   if ( iobuf->buffer == (BYTE *) NULL )
+      return -1;
+
+   if ( item_header->level != iobuf->item_level-1 )
+   {
+      Warning("Item level is inconsistent");
+      return -1;
+   }
+   if (iobuf->item_level > 0 && iobuf->item_level <= MAX_IO_ITEM_LEVEL)
+      ilevel = iobuf->item_level-1;
+   else
+      return -1;
+   if ( (length = iobuf->item_length[ilevel]) < 0 )
+      return -1;
+   if ( iobuf2->item_level > 0 )
+   {
+      Warning("Output cancelled because item level is not 0");
+      return -1;
+   }
+   
+   if ( iobuf->item_extension[ilevel] )
+      ie4 = 4;
+
+   /* Sync tag in the byte order of the source, then the item as it is. */
+   seg[0].data = iobuf->buffer;
+   seg[0].length = 4;
+   seg[1].data = iobuf->buffer+iobuf->item_start_offset[ilevel]-12-ie4;
+   seg[1].length = (size_t)(12+ie4+length);
+   iobuf2->byte_order = iobuf->byte_order;
+
+   iobuf->data = iobuf->buffer+iobuf->item_start_offset[ilevel]+length;
+   iobuf->r_remaining -= length;
+
+   return write_io_segments(iobuf2, seg, 2, (size_t)(16+ie4+length),
+      length, ie4 != 0);
+}
+
 /* ---------------- append_io_block_as_item ------------------ */
 /**
  *  @short Append data from one I/O block into another one.
@@ -5570,6 +7826,87 @@ int append_io_block_as_item (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
    return 0;
 }
 
+/* ---------------- append_io_sub_items ------------------ */
+/**
+ *  @short Append the sub-items filled into one I/O buffer to
+ *         the item being filled in another one.
+ *
+ *  This allows sub-items to be filled independently (for example
+ *  in separate threads) into scratch I/O buffers, each with a
+ *  top-level item started but not finished, and to be combined
+ *  afterwards in the intended order. The source buffer is not
+ *  modified; its top-level item should be dropped with unput_item()
+ *  before the buffer gets re-used.
+ *
+ *  @param  iobuf      The target I/O buffer descriptor,
+ *                     must be 'opened' for 'writing',
+ *                     i.e. 'put_item_begin()' must be called.
+ *  @param  from       The source I/O buffer descriptor, with exactly
+ *                     one top-level item started and only complete
+ *                     sub-items put into it.
+ *
+ *  @return  0 (o.k.),  -1 (error),  -2 (not enough memory etc.)
+ *
+ */
+
+int append_io_sub_items (IO_BUFFER *iobuf, IO_BUFFER *from)
+{
+   int ilevel;
+   long length;
+
+   if ( iobuf == (IO_BUFFER *) NULL || from == (IO_BUFFER *) NULL )
+      return -1;
+   if ( iobuf->buffer == (BYTE *) NULL || from->buffer == (BYTE *) NULL )
+      return -1;
+
+   if ( iobuf->item_level <= 0 )
+   {
+      Warning("Cannot append to empty I/O block");
+      return -1;
+   }
+   ilevel = iobuf->item_level - 1;
+   if ( iobuf->w_remaining == -1 )
+   {
+      Warning("Cannot append to I/O block");
+      return -1;
+   }
+   if ( from->item_level != 1 || from->w_remaining < 0 )
+   {
+      Warning("No sub-items being filled in I/O block to be appended");
+      return -1;
+   }
+   length = (long) (from->data - from->buffer) - from->item_start_offset[0];
+   if ( length != from->sub_item_length[0] )
+   {
+      Warning("Data to be appended is not a sequence of complete items");
+      return -1;
+   }
+   if ( iobuf->byte_order != from->byte_order )
+   {
+      Warning("Cannot append to I/O block with different byte ordering");
+      return -1;
+   }
+   if ( length == 0 )
+      return 0;
+
+   if ( iobuf->w_remaining < length )
+   {
+      if ( extend_io_buffer(iobuf,256,length) == -1 )
+      {
+         Warning("I/O buffer too small: nothing appended");
+         return -2;
+      }
+   }
+
+   memcpy((void *)iobuf->data,(void *)(from->buffer+from->item_start_offset[0]),
+      (size_t)(length));
+   iobuf->data += length;
+   iobuf->w_remaining -= length;
+   iobuf->sub_item_length[ilevel] += length;
+
+   return 0;
+}
+
 /* ======== Interface to registry of well-known data block type ========= */
 /* The implementation is available outside of the core eventio code and */
 /* a function pointer has to be set up before it is used. */
@@ -194,11 +194,9 @@ int main (int argc, char **argv)
          case IO_TYPE_HISTORY:           /* 70 */
          case IO_TYPE_METAPARAM:         /* 75 */
             /* Copy it to output. */
-            reset_io_block(iobuf2);
             get_item_begin(iobuf,&item_header);
-            copy_item_to_io_block(iobuf2,iobuf,&item_header);
+            write_item_as_io_block(iobuf2,iobuf,&item_header);
             get_item_end(iobuf,&item_header);
-            write_io_block(iobuf2);
             break;
 
          /* =================================================== */
@@ -212,9 +210,8 @@ int main (int argc, char **argv)
                item_header2.type = IO_TYPE_SIMTEL_EVENT;
                if ( (rc = get_item_begin(iobuf,&item_header2)) < 0 )
                   continue;
-               copy_item_to_io_block(iobuf2,iobuf,&item_header2);
+               write_item_as_io_block(iobuf2,iobuf,&item_header2);
                get_item_end(iobuf,&item_header2);
-               write_io_block(iobuf2);
             }
             get_item_end(iobuf,&item_header);
             break;
@@ -230,9 +227,8 @@ int main (int argc, char **argv)
                item_header2.type = IO_TYPE_MC_TELARRAY;
                if ( (rc = get_item_begin(iobuf,&item_header2)) < 0 )
                   continue;
-               copy_item_to_io_block(iobuf2,iobuf,&item_header2);
+               write_item_as_io_block(iobuf2,iobuf,&item_header2);
                get_item_end(iobuf,&item_header2);
-               write_io_block(iobuf2);
             }
             get_item_end(iobuf,&item_header);
             break;
@@ -76,6 +76,7 @@ Options:
                        This option can be used multiple times.
                        Note that the number set by '--min-trg-tel' must still be matched.
      --verbose       : Show events being extracted.
+     --write-behind n : Queue up to n output blocks for writing in the background.
 @endverbatim
  *
  *  @author  Konrad Bernloehr
@@ -95,6 +96,7 @@ Options:
 #include "fileopen.h"
 #include "straux.h"
 #include "warning.h"
+#include "io_writebehind.h"
 #include "io_trgmask.h"
 #include "eventio_version.h"
 #include "unused.h"
@@ -162,6 +164,7 @@ static void syntax (const char *program)
    printf("                       This option can be used multiple times.\n");
    printf("                       Note that the number set by '--min-trg-tel' must still be matched.\n");
    printf("     --verbose       : Show events being extracted.\n");
+   printf("     --write-behind n : Queue up to n output blocks for writing in the background.\n");
    printf("\nCompiled for a maximum of %d telescopes before and after extracting.\n", H_MAX_TEL);
    printf("Linked against eventIO/hessio library\n");
 #ifdef EVENTIO_VERSION
@@ -388,19 +391,24 @@ int got_a_trigger (CentralEvent *ce)
 
 /* ----------------------------------------------------------------------- */
 /** 
- *  Write an I/O block as-is to another file than foreseen for the I/O buffer.
+ *  Write an I/O block as-is to the output file of another I/O buffer.
+ *  Anything still queued for asynchronous output in that buffer goes first.
  */
 
-int write_io_block_to_file (IO_BUFFER *iobuf, FILE *f);
+int write_io_block_to_file (IO_BUFFER *iobuf, IO_BUFFER *iobuf_out);
 
-int write_io_block_to_file (IO_BUFFER *iobuf, FILE *f)
+int write_io_block_to_file (IO_BUFFER *iobuf, IO_BUFFER *iobuf_out)
 {
    int rc = 0;
+   FILE *f = (iobuf_out != NULL) ? iobuf_out->output_file : NULL;
    if ( iobuf != NULL && f != NULL )
    {
       FILE *t = iobuf->output_file;
+      if ( flush_io_writebehind(iobuf_out) != 0 )
+         rc = -1;
       iobuf->output_file = f;
-      rc = write_io_block(iobuf);
+      if ( write_io_block(iobuf) != 0 )
+         rc = -1;
       iobuf->output_file = t;
    }
    return rc;
@@ -575,7 +583,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
          {
             if ( hsdata->event.teldata[itel].raw != NULL )
             {
-               free(hsdata->event.teldata[itel].raw);
+               free_adc_data(hsdata->event.teldata[itel].raw);
                hsdata->event.teldata[itel].raw = NULL;
             }
             if ( hsdata->event.teldata[itel].pixtm != NULL )
@@ -602,7 +610,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
             {
                if ( hsdata_out->event.teldata[itel3].raw != NULL )
                {
-                  free(hsdata_out->event.teldata[itel3].raw);
+                  free_adc_data(hsdata_out->event.teldata[itel3].raw);
                   hsdata_out->event.teldata[itel3].raw = NULL;
                }
                if ( hsdata_out->event.teldata[itel3].pixtm != NULL )
@@ -834,7 +842,7 @@ printf("Run header written\n");
          /* Except for the detector simulation version, which could differ, */
          /* pretty much everything should be identical. */
          /* Nevertheless, record both MC run headers as they came in. */
-         rc = write_io_block_to_file (iobuf,iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
 #ifdef DEBUG_MERGE
 printf("MC run header written\n");
 #endif
@@ -842,7 +850,7 @@ printf("MC run header written\n");
       /* =================================================== */
       case IO_TYPE_MC_INPUTCFG: /* 1212 */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing input cfg to output, rc=%d\n", rc);
 #ifdef DEBUG_MERGE
@@ -853,7 +861,7 @@ printf("MC input configuration written\n");
       /* =================================================== */
       case IO_TYPE_MC_ATMPROF: /* 1216 */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing atmospheric density profile to output, rc=%d\n", rc);
 #ifdef DEBUG_MERGE
@@ -864,7 +872,7 @@ printf("Atmospheric density profile written\n");
       /* =================================================== */
       case IO_TYPE_HISTORY: /* 70: How sim_hessarray was run and how it was configured. */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing history to output, rc=%d\n", rc);
 #ifdef DEBUG_MERGE
@@ -1308,6 +1316,9 @@ printf("Tracking setup written for tel. ID %d -> %d\n", tel_id, tel_id3);
                   if ( adi != NULL && ado != NULL )
                   {
                    ado->known = adi->known;
+                   if ( ado->known && alloc_adc_samples(ado,
+                          adi->num_gains,adi->num_pixels,adi->num_samples) != 0 )
+                      ado->known = 0;
                    if ( ado->known )
                    {
                      int kg, kp, ks;
@@ -1333,7 +1344,7 @@ printf("Tracking setup written for tel. ID %d -> %d\n", tel_id, tel_id3);
                            ado->adc_known[kg][kp] = adi->adc_known[kg][kp];
                            ado->adc_sum[kg][kp] = adi->adc_sum[kg][kp];
                            for ( ks=0; ks<ado->num_samples; ks++ )
-                              ado->adc_sample[kg][kp][ks] = adi->adc_sample[kg][kp][ks];
+                              ADC_SAMPLES(ado,kg,kp)[ks] = ADC_SAMPLES(adi,kg,kp)[ks];
                         }
                      }
                    }
@@ -1488,7 +1499,7 @@ exit(1);
             }
             memcpy(&hsdata_out->mc_shower,&hsdata->mc_shower,sizeof(hsdata->mc_shower));
             /* Write the original data block to the output file. */
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          }
          else
          {
@@ -1554,7 +1565,7 @@ exit(1);
             }
             /* Write the original data block to the output file. */
             /* The other data reset above is not part of the I/O block. */
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          }
          else
          {
@@ -1741,7 +1752,7 @@ printf("Ignoring photons/photo-electrons data block\n");
          memcpy(&hsdata_out->run_stat,&hsdata->run_stat,sizeof(hsdata->run_stat));
          /* Copy the data block from input 1 and ignore that from input 2. */
          if ( ifile == 1 )
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -1759,7 +1770,7 @@ printf("Ignoring photons/photo-electrons data block\n");
          memcpy(&hsdata_out->mc_run_stat,&hsdata->mc_run_stat,sizeof(hsdata->mc_run_stat));
           /* Copy the data block from input 1 and ignore that from input 2. */
          if ( ifile == 1 )
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -1802,7 +1813,7 @@ printf("Ignoring photons/photo-electrons data block\n");
             if ( nhist > 0 )
                write_histograms(h_list,nhist,iobuf_out);
          }
-         // rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         // rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -2078,6 +2089,7 @@ int main (int argc, char **argv)
    int this_type1 = 0;
    int read_from = 1;
    int rc = 0;
+   int writebehind_blocks = 0;
    
    H_CHECK_MAX();
 
@@ -2137,6 +2149,12 @@ int main (int argc, char **argv)
             iarg++;
             continue;
          }
+         else if ( strcmp(argv[iarg],"--write-behind") == 0 && iarg+1<argc )
+         {
+            writebehind_blocks = atoi(argv[iarg+1]);
+            iarg++;
+            continue;
+         }
          else if ( strcmp(argv[iarg],"--max-list") == 0 && iarg+1<argc )
          {
             max_list = atoi(argv[iarg+1]);
@@ -2269,6 +2287,8 @@ int main (int argc, char **argv)
       perror(output_fname);
       exit(1);
    }
+   if ( writebehind_blocks > 0 )
+      (void) start_io_writebehind(iobuf3,writebehind_blocks);
    write_history(9,iobuf3);
 
    for (;;) /* Loop over all data in both input files */
@@ -2410,6 +2430,7 @@ printf("Type1 = %d, ID = %ld\n", this_type1, item_header1.ident);
 
    }
    
+   stop_io_writebehind(iobuf3);
    fileclose(iobuf1->input_file);
    fileclose(iobuf3->output_file);
    /* Avoid cppcheck false positives: */
@@ -43,6 +43,18 @@
  *      @c .lzo ), @c lzma (for extension  @c .lzma ) as well as
  *      @c xz (for extension @ .xz ) and @c lz4 (for extension @c .lz4 ) are handled
  *      on the fly. No check is made if these programs are installed.
+ *  @li When compiled with HAVE_ZLIB and/or HAVE_ZSTD (and with the GNU C
+ *      library), @c gzip and @c zstd (extension @c .zst ) compressed files
+ *      are (de-)compressed within the process instead of through an external
+ *      program, saving the fork/exec and the extra pipe. Such input files
+ *      also remain seekable (backwards by decompressing again from the start).
+ *      With FILEOPEN_NO_INPROC set in the environment, or with FILEOPEN_PARALLEL
+ *      for gzip output, the external programs are used as before.
+ *  @li zstd output can be written in the seekable format (independent
+ *      frames of complete I/O blocks plus a seek table, see set_seekable_zstd()).
+ *      Reading such files with in-process decompression then only
+ *      decompresses the frames needed, with worker threads decompressing
+ *      the next frames ahead if FILEOPEN_PARALLEL is set.
  *  @li URIs (uniform resource identifiers) starting with @c http:,
  *      @c https:, or @c ftp: will also be opened in a pipe, with optional
  *      decompression, depending on the ending of the URI name.
@@ -63,6 +75,12 @@
  *  @date    Nov. 2000 to 2023
  */
 
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE 1 /* For fopencookie() */
+# endif
+#endif
+
 #include "initial.h"
 #include "straux.h"
 #include "fileopen.h"
@@ -73,6 +91,21 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#if ( defined(HAVE_ZLIB) || defined(HAVE_ZSTD) ) && defined(__GLIBC__)
+# define WITH_INPROC_CODECS 1
+# ifdef HAVE_ZLIB
+#  define ZLIB_CONST 1
+#  include <zlib.h>
+# endif
+# ifdef HAVE_ZSTD
+#  include <zstd.h>
+#  if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+#   define ZST_THREADS 1
+#   include <pthread.h>
+#  endif
+# endif
+#endif
+
 #ifndef PATH_MAX
 # define PATH_MAX 4096
 #endif
@@ -81,6 +114,10 @@
 static int verbose = 0, parallel = 0, report = 0;
 static int with_fallback = 1;
 static int with_exec = 1;
+#ifdef WITH_INPROC_CODECS
+static int with_inproc = 1;
+#endif
+static int zst_frame_blocks = 0;
 #ifdef SAVE_ERRNO
 static int s_errno = 0;
 #endif
@@ -102,6 +139,8 @@ static void fileopen_env_init(void);
  *   - FILEOPEN_NO_EXEC
  *   - FILEOPEN_REPORT
  *   - FILEOPEN_LIST
+ *   - FILEOPEN_NO_INPROC
+ *   - FILEOPEN_ZSTD_SEEKABLE
  */ 
 
 static void fileopen_env_init(void)
@@ -119,6 +158,12 @@ static void fileopen_env_init(void)
       with_fallback = 0;
    if ( getenv("FILEOPEN_NO_EXEC") != NULL )
       with_exec = 0;
+#ifdef WITH_INPROC_CODECS
+   if ( getenv("FILEOPEN_NO_INPROC") != NULL )
+      with_inproc = 0;
+#endif
+   if ( (s=getenv("FILEOPEN_ZSTD_SEEKABLE")) != NULL )
+      zst_frame_blocks = atoi(s);
    if ( (s=getenv("FILEOPEN_REPORT")) != NULL )
    {
       report = atoi(s);
@@ -322,6 +367,1003 @@ static FILE *fopenx(const char *fname, const char *mode)
    return f;
 }
 
+#ifdef WITH_INPROC_CODECS
+
+/* ----------- In-process (de-)compression behind a FILE stream ----------- */
+
+#define ZF_BUFSIZE 131072
+
+#ifdef HAVE_ZSTD
+
+/* ------- Seekable zstd: independent frames followed by a seek table ------- */
+
+#define ZST_SKIPPABLE_MAGIC 0x184D2A5EUL  /**< Skippable frame holding the seek table */
+#define ZST_SEEKABLE_MAGIC  0x8F92EAB1UL  /**< At the very end of a seekable file */
+#define ZST_MAX_FRAME_SIZE  (1UL<<30)     /**< Frames end after this much data anyway */
+
+static uint32_t zst_get32 (const unsigned char *p)
+{
+   return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+          ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void zst_put32 (unsigned char *p, uint32_t v)
+{
+   p[0] = (unsigned char) (v & 0xff);
+   p[1] = (unsigned char) ((v >> 8) & 0xff);
+   p[2] = (unsigned char) ((v >> 16) & 0xff);
+   p[3] = (unsigned char) ((v >> 24) & 0xff);
+}
+
+enum { ZST_FREE, ZST_QUEUED, ZST_BUSY, ZST_DONE, ZST_FAILED };
+
+/** One frame, decompressed as a whole. */
+struct zst_slot
+{
+   unsigned long frame;    /**< Frame number held or to be held */
+   int state;              /**< ZST_FREE ... ZST_FAILED */
+   unsigned char *data;    /**< The uncompressed frame */
+   size_t cap;             /**< Allocated size of 'data' */
+};
+
+/** Frame-wise input from a seekable zstd file. */
+struct zst_reader
+{
+   int fd;                 /**< The compressed file, only read with pread() */
+   unsigned long nframes;  /**< Number of frames in the seek table */
+   uint64_t *coff;         /**< Compressed offsets of all frames, plus end */
+   uint64_t *doff;         /**< Uncompressed offsets of all frames, plus end */
+   unsigned long cur;      /**< Frame containing the current position */
+   unsigned long last;     /**< Frame last requested */
+   int nslots;             /**< Frame i goes to slot i%nslots */
+   struct zst_slot *slot;
+   ZSTD_DCtx *dctx;        /**< Used without worker threads */
+   unsigned char *cbuf;    /**< Compressed frame data, idem */
+   size_t ccap;
+#ifdef ZST_THREADS
+   int nthreads;           /**< Worker threads decompressing frames ahead */
+   pthread_t *thread;
+   pthread_mutex_t mlock;
+   pthread_cond_t cond;
+   int stop;
+#endif
+};
+
+/** Read and decompress one complete frame into a slot. */
+
+static int zst_decompress_frame (const struct zst_reader *zr, unsigned long f,
+   struct zst_slot *s, ZSTD_DCtx *dctx, unsigned char **cbuf, size_t *ccap)
+{
+   size_t csize = (size_t) (zr->coff[f+1] - zr->coff[f]);
+   size_t dsize = (size_t) (zr->doff[f+1] - zr->doff[f]);
+   size_t nr = 0, rc;
+
+   if ( csize > *ccap )
+   {
+      unsigned char *t = (unsigned char *) realloc(*cbuf,csize);
+      if ( t == NULL )
+         return -1;
+      *cbuf = t;
+      *ccap = csize;
+   }
+   while ( nr < csize )
+   {
+      ssize_t r = pread(zr->fd,*cbuf+nr,csize-nr,(off_t)(zr->coff[f]+nr));
+      if ( r < 0 && errno == EINTR )
+         continue;
+      if ( r <= 0 )
+         return -1;
+      nr += (size_t) r;
+   }
+   if ( dsize > s->cap || s->data == NULL )
+   {
+      unsigned char *t = (unsigned char *) realloc(s->data,dsize+1);
+      if ( t == NULL )
+         return -1;
+      s->data = t;
+      s->cap = dsize;
+   }
+   rc = ZSTD_decompressDCtx(dctx,s->data,dsize,*cbuf,csize);
+   if ( ZSTD_isError(rc) || rc != dsize )
+      return -1;
+   return 0;
+}
+
+#ifdef ZST_THREADS
+/** Worker thread: decompress queued frames, lowest frame number first. */
+
+static void *zst_worker (void *arg)
+{
+   struct zst_reader *zr = (struct zst_reader *) arg;
+   ZSTD_DCtx *dctx = ZSTD_createDCtx();
+   unsigned char *cbuf = NULL;
+   size_t ccap = 0;
+
+   pthread_mutex_lock(&zr->mlock);
+   while ( !zr->stop )
+   {
+      struct zst_slot *s = NULL;
+      int i, rc;
+      for ( i=0; i<zr->nslots; i++ )
+         if ( zr->slot[i].state == ZST_QUEUED &&
+              (s == NULL || zr->slot[i].frame < s->frame) )
+            s = &zr->slot[i];
+      if ( s == NULL )
+      {
+         pthread_cond_wait(&zr->cond,&zr->mlock);
+         continue;
+      }
+      s->state = ZST_BUSY; /* Now neither frame nor data get touched by others. */
+      pthread_mutex_unlock(&zr->mlock);
+      rc = (dctx != NULL) ? zst_decompress_frame(zr,s->frame,s,dctx,&cbuf,&ccap) : -1;
+      pthread_mutex_lock(&zr->mlock);
+      s->state = (rc == 0) ? ZST_DONE : ZST_FAILED;
+      pthread_cond_broadcast(&zr->cond);
+   }
+   pthread_mutex_unlock(&zr->mlock);
+
+   ZSTD_freeDCtx(dctx);
+   free(cbuf);
+   return NULL;
+}
+#endif
+
+/** Get a frame in decompressed form, with worker threads busy on the next ones. */
+
+static struct zst_slot *zst_frame (struct zst_reader *zr, unsigned long f)
+{
+   struct zst_slot *s = &zr->slot[f % (unsigned long) zr->nslots];
+
+#ifdef ZST_THREADS
+   if ( zr->nthreads > 0 )
+   {
+      /* Reading ahead only pays off for sequential access. */
+      unsigned long nq = (f == zr->last+1) ?
+         (unsigned long) zr->nslots : 1UL;
+      zr->last = f;
+      pthread_mutex_lock(&zr->mlock);
+      for (;;)
+      {
+         unsigned long j;
+         int queued = 0;
+         /* This and the following frames go into slots not in use otherwise. */
+         for ( j=f; j<f+nq && j<zr->nframes; j++ )
+         {
+            struct zst_slot *t = &zr->slot[j % (unsigned long) zr->nslots];
+            if ( (t->frame != j || t->state == ZST_FREE) && t->state != ZST_BUSY )
+            {
+               t->frame = j;
+               t->state = ZST_QUEUED;
+               queued = 1;
+            }
+         }
+         if ( queued )
+            pthread_cond_broadcast(&zr->cond);
+         if ( s->frame == f && (s->state == ZST_DONE || s->state == ZST_FAILED) )
+            break;
+         pthread_cond_wait(&zr->cond,&zr->mlock);
+      }
+      pthread_mutex_unlock(&zr->mlock);
+      return (s->state == ZST_DONE) ? s : NULL;
+   }
+#endif
+
+   if ( s->frame != f || s->state == ZST_FREE )
+   {
+      s->frame = f;
+      s->state = (zr->dctx != NULL &&
+         zst_decompress_frame(zr,f,s,zr->dctx,&zr->cbuf,&zr->ccap) == 0) ?
+         ZST_DONE : ZST_FAILED;
+   }
+   return (s->state == ZST_DONE) ? s : NULL;
+}
+
+/** Stop the worker threads and release everything. */
+
+static void zst_close_reader (struct zst_reader *zr)
+{
+   int i;
+   if ( zr == NULL )
+      return;
+#ifdef ZST_THREADS
+   if ( zr->nthreads > 0 )
+   {
+      pthread_mutex_lock(&zr->mlock);
+      zr->stop = 1;
+      pthread_cond_broadcast(&zr->cond);
+      pthread_mutex_unlock(&zr->mlock);
+      for ( i=0; i<zr->nthreads; i++ )
+         pthread_join(zr->thread[i],NULL);
+   }
+   if ( zr->thread != NULL )
+   {
+      pthread_mutex_destroy(&zr->mlock);
+      pthread_cond_destroy(&zr->cond);
+      free(zr->thread);
+   }
+#endif
+   if ( zr->slot != NULL )
+      for ( i=0; i<zr->nslots; i++ )
+         free(zr->slot[i].data);
+   free(zr->slot);
+   free(zr->coff);
+   free(zr->doff);
+   free(zr->cbuf);
+   if ( zr->dctx != NULL )
+      ZSTD_freeDCtx(zr->dctx);
+   free(zr);
+}
+
+/** Read exactly 'n' bytes at a given offset. */
+
+static int zst_pread (int fd, unsigned char *p, size_t n, off_t offset)
+{
+   while ( n > 0 )
+   {
+      ssize_t r = pread(fd,p,n,offset);
+      if ( r < 0 && errno == EINTR )
+         continue;
+      if ( r <= 0 )
+         return -1;
+      p += r;
+      n -= (size_t) r;
+      offset += (off_t) r;
+   }
+   return 0;
+}
+
+/**
+ *  @short Check for a seek table at the end of a zstd compressed file
+ *         and, if there is a valid one, set up frame-wise input.
+ *
+ *  The seek table is expected in the format of the zstd 'seekable'
+ *  contrib library. It must describe the whole file before it,
+ *  otherwise (e.g. after appending to the file) it gets ignored
+ *  and the file will be decompressed as a stream.
+ *  With FILEOPEN_PARALLEL set (n>1: number of threads, else 4),
+ *  worker threads decompress the next frames in parallel.
+ *
+ *  @return Frame-wise input descriptor or NULL.
+ */
+
+static struct zst_reader *zst_open_reader (FILE *raw)
+{
+   struct zst_reader *zr;
+   struct stat st;
+   unsigned char foot[9], *tab;
+   uint64_t size, tsize;
+   unsigned long n, i;
+   int fd = fileno(raw), es;
+
+   if ( fd < 0 || fstat(fd,&st) != 0 || !S_ISREG(st.st_mode) )
+      return NULL;
+   size = (uint64_t) st.st_size;
+   if ( size < 17 || zst_pread(fd,foot,9,(off_t)(size-9)) != 0 )
+      return NULL;
+   if ( zst_get32(foot+5) != ZST_SEEKABLE_MAGIC || (foot[4] & 0x7c) != 0 )
+      return NULL;
+   n = (unsigned long) zst_get32(foot);
+   es = (foot[4] & 0x80) ? 12 : 8; /* With or without checksums */
+   tsize = (uint64_t) n * (uint64_t) es + 9;
+   if ( size < tsize + 8 )
+      return NULL;
+   if ( (tab = (unsigned char *) malloc((size_t)tsize+8)) == NULL )
+      return NULL;
+   if ( zst_pread(fd,tab,(size_t)tsize+8,(off_t)(size-tsize-8)) != 0 ||
+        zst_get32(tab) != ZST_SKIPPABLE_MAGIC || zst_get32(tab+4) != tsize ||
+        (zr = (struct zst_reader *) calloc(1,sizeof(struct zst_reader))) == NULL )
+   {
+      free(tab);
+      return NULL;
+   }
+   zr->fd = fd;
+   zr->nframes = n;
+   zr->coff = (uint64_t *) malloc((n+1)*sizeof(uint64_t));
+   zr->doff = (uint64_t *) malloc((n+1)*sizeof(uint64_t));
+   if ( zr->coff == NULL || zr->doff == NULL )
+   {
+      free(tab);
+      zst_close_reader(zr);
+      return NULL;
+   }
+   zr->coff[0] = zr->doff[0] = 0;
+   for ( i=0; i<n; i++ )
+   {
+      zr->coff[i+1] = zr->coff[i] + zst_get32(tab+8+i*es);
+      zr->doff[i+1] = zr->doff[i] + zst_get32(tab+8+i*es+4);
+   }
+   free(tab);
+   if ( zr->coff[n] != size - tsize - 8 ) /* Not (only) what the table describes */
+   {
+      zst_close_reader(zr);
+      return NULL;
+   }
+
+#ifdef ZST_THREADS
+   if ( parallel )
+      zr->nthreads = (parallel > 1) ? parallel : 4;
+#endif
+   zr->nslots = 1;
+#ifdef ZST_THREADS
+   if ( zr->nthreads > 0 )
+      zr->nslots = 2 * zr->nthreads;
+#endif
+   if ( (zr->slot = (struct zst_slot *) calloc((size_t)zr->nslots,sizeof(struct zst_slot))) == NULL )
+   {
+      zst_close_reader(zr);
+      return NULL;
+   }
+#ifdef ZST_THREADS
+   if ( zr->nthreads > 0 )
+   {
+      int k;
+      if ( (zr->thread = (pthread_t *) calloc((size_t)zr->nthreads,sizeof(pthread_t))) == NULL )
+      {
+         zst_close_reader(zr);
+         return NULL;
+      }
+      pthread_mutex_init(&zr->mlock,NULL);
+      pthread_cond_init(&zr->cond,NULL);
+      for ( k=0; k<zr->nthreads; k++ )
+         if ( pthread_create(&zr->thread[k],NULL,zst_worker,zr) != 0 )
+            break;
+      if ( k == 0 ) /* Decompress frames synchronously then. */
+         zr->nslots = 1;
+      zr->nthreads = k;
+   }
+#endif
+   if ( (zr->dctx = ZSTD_createDCtx()) == NULL )
+   {
+      zst_close_reader(zr);
+      return NULL;
+   }
+   if ( verbose >= 2 )
+      fprintf(stderr,"Seekable zstd input with %lu frames.\n", n);
+
+   return zr;
+}
+
+#endif
+
+/** State of an in-process (de-)compression stream. */
+struct zfile
+{
+   FILE *raw;              /**< The compressed file (or pipe) */
+   int raw_is_pipe;        /**< Close 'raw' with pclose() rather than fclose() */
+   int compression;        /**< As in fileopen(): 1 (gzip) or 10 (zstd) */
+   int writing;            /**< Compressing output rather than decompressing input */
+   int eof;                /**< End of compressed input reached */
+   int in_frame;           /**< Inside a compressed stream/frame not yet completed */
+   int err;                /**< Unrecoverable (de-)compression error */
+   off64_t pos;            /**< Position in the uncompressed data */
+   unsigned char *buf;     /**< Buffer for compressed data */
+#ifdef HAVE_ZLIB
+   z_stream zs;
+#endif
+#ifdef HAVE_ZSTD
+   ZSTD_DStream *zds;
+   ZSTD_CCtx *zcc;
+   ZSTD_inBuffer zin;      /**< Compressed input not yet consumed */
+   struct zst_reader *zr;  /**< Frame-wise input with a seek table, or NULL */
+   int frame_blocks;       /**< Writes (blocks) per frame for seekable output, or 0 */
+   int nblk;               /**< Writes into the current frame so far */
+   uint64_t fcsize;        /**< Compressed size of the current frame so far */
+   uint64_t fdsize;        /**< Uncompressed size of the current frame so far */
+   uint32_t *ftab;         /**< Compressed and uncompressed sizes of completed frames */
+   unsigned long nftab;    /**< Number of completed frames */
+   unsigned long aftab;    /**< Number of frames with space allocated in 'ftab' */
+#endif
+};
+
+/** Get more compressed input, if none is left; returns 0 at end of input. */
+
+static size_t zf_fill (struct zfile *z, const unsigned char **next, size_t avail)
+{
+   size_t nr;
+   if ( avail > 0 )
+      return avail;
+   if ( (nr = fread(z->buf,1,ZF_BUFSIZE,z->raw)) == 0 )
+   {
+      if ( ferror(z->raw) )
+         z->err = 1;
+      else if ( z->in_frame )
+      {
+         fprintf(stderr,"Compressed input ends unexpectedly.\n");
+         z->err = 1;
+      }
+      z->eof = 1;
+   }
+   *next = z->buf;
+   return nr;
+}
+
+/** Write out what the compressor has produced so far. */
+
+static int zf_flush_buf (struct zfile *z, size_t have)
+{
+   if ( have > 0 && fwrite(z->buf,1,have,z->raw) != have )
+   {
+      z->err = 1;
+      return -1;
+   }
+   return 0;
+}
+
+#ifdef HAVE_ZSTD
+/** Reading from a seekable zstd file, frame by frame. */
+
+static size_t zst_read (struct zfile *z, char *out, size_t n)
+{
+   struct zst_reader *zr = z->zr;
+   size_t done = 0;
+
+   while ( done < n && (uint64_t) z->pos < zr->doff[zr->nframes] )
+   {
+      struct zst_slot *s;
+      size_t off, k;
+      while ( (uint64_t) z->pos >= zr->doff[zr->cur+1] )
+         zr->cur++;
+      if ( (s = zst_frame(zr,zr->cur)) == NULL )
+      {
+         fprintf(stderr,"zstd decompression of frame %lu failed.\n", zr->cur);
+         z->err = 1;
+         break;
+      }
+      off = (size_t) ((uint64_t) z->pos - zr->doff[zr->cur]);
+      k = (size_t) (zr->doff[zr->cur+1] - (uint64_t) z->pos);
+      if ( k > n - done )
+         k = n - done;
+      memcpy(out+done,s->data+off,k);
+      done += k;
+      z->pos += (off64_t) k;
+   }
+   return done;
+}
+
+/** Complete the current zstd frame and, for seekable output, note its sizes. */
+
+static int zst_end_frame (struct zfile *z)
+{
+   ZSTD_inBuffer in;
+   size_t left = 1;
+
+   in.src = NULL;
+   in.size = in.pos = 0;
+   while ( left != 0 && !z->err )
+   {
+      ZSTD_outBuffer zout;
+      zout.dst = z->buf;
+      zout.size = ZF_BUFSIZE;
+      zout.pos = 0;
+      left = ZSTD_compressStream2(z->zcc,&zout,&in,ZSTD_e_end);
+      if ( ZSTD_isError(left) )
+      {
+         fprintf(stderr,"zstd compression failed: %s\n", ZSTD_getErrorName(left));
+         z->err = 1;
+      }
+      else if ( zf_flush_buf(z,zout.pos) == 0 )
+         z->fcsize += zout.pos;
+   }
+   if ( z->err )
+      return -1;
+
+   if ( z->frame_blocks > 0 )
+   {
+      if ( z->nftab >= z->aftab )
+      {
+         unsigned long na = (z->aftab > 0) ? 2*z->aftab : 1024;
+         uint32_t *t = (uint32_t *) realloc(z->ftab,2*na*sizeof(uint32_t));
+         if ( t == NULL )
+         {
+            z->err = 1;
+            return -1;
+         }
+         z->ftab = t;
+         z->aftab = na;
+      }
+      z->ftab[2*z->nftab] = (uint32_t) z->fcsize;
+      z->ftab[2*z->nftab+1] = (uint32_t) z->fdsize;
+      z->nftab++;
+   }
+   z->nblk = 0;
+   z->fcsize = z->fdsize = 0;
+   return 0;
+}
+
+/** Append the seek table (as a skippable frame) after the last frame. */
+
+static int zst_write_seek_table (struct zfile *z)
+{
+   size_t tsize = 8*z->nftab + 9, i;
+   unsigned char *t = (unsigned char *) malloc(tsize+8);
+   int rc = 0;
+
+   if ( t == NULL )
+      return -1;
+   zst_put32(t,(uint32_t) ZST_SKIPPABLE_MAGIC);
+   zst_put32(t+4,(uint32_t) tsize);
+   for ( i=0; i<z->nftab; i++ )
+   {
+      zst_put32(t+8+8*i,z->ftab[2*i]);
+      zst_put32(t+12+8*i,z->ftab[2*i+1]);
+   }
+   zst_put32(t+8+8*z->nftab,(uint32_t) z->nftab);
+   t[12+8*z->nftab] = 0; /* No checksums */
+   zst_put32(t+13+8*z->nftab,(uint32_t) ZST_SEEKABLE_MAGIC);
+   if ( fwrite(t,1,tsize+8,z->raw) != tsize+8 )
+      rc = -1;
+   free(t);
+   return rc;
+}
+#endif
+
+/** The read function of the cookie stream. */
+
+static ssize_t zf_read (void *cookie, char *out, size_t n)
+{
+   struct zfile *z = (struct zfile *) cookie;
+   size_t done = 0;
+
+   if ( z->err )
+      return -1;
+   if ( n > (1UL<<30) )
+      n = (1UL<<30);
+
+#ifdef HAVE_ZSTD
+   if ( z->zr != NULL )
+   {
+      done = zst_read(z,out,n);
+      return ( done == 0 && z->err ) ? -1 : (ssize_t) done;
+   }
+#endif
+
+#ifdef HAVE_ZLIB
+   if ( z->compression == 1 )
+   {
+      z->zs.next_out = (Bytef *) out;
+      z->zs.avail_out = (uInt) n;
+      while ( z->zs.avail_out > 0 && !z->eof && !z->err )
+      {
+         int rc;
+         z->zs.avail_in = (uInt) zf_fill(z,&z->zs.next_in,(size_t)z->zs.avail_in);
+         if ( z->zs.avail_in == 0 )
+            break;
+         rc = inflate(&z->zs,Z_NO_FLUSH);
+         if ( rc == Z_STREAM_END )
+         {
+            /* Concatenated gzip members just continue the data. */
+            inflateReset(&z->zs);
+            z->in_frame = 0;
+         }
+         else if ( rc == Z_OK || rc == Z_BUF_ERROR )
+            z->in_frame = 1;
+         else
+         {
+            fprintf(stderr,"gzip decompression failed: %s\n",
+               z->zs.msg != NULL ? z->zs.msg : "corrupt data");
+            z->err = 1;
+         }
+      }
+      done = n - z->zs.avail_out;
+   }
+#endif
+#ifdef HAVE_ZSTD
+   if ( z->compression == 10 )
+   {
+      ZSTD_outBuffer zout;
+      zout.dst = out;
+      zout.size = n;
+      zout.pos = 0;
+      while ( zout.pos < zout.size && !z->eof && !z->err )
+      {
+         size_t rc;
+         if ( z->zin.pos >= z->zin.size )
+         {
+            const unsigned char *next = NULL;
+            if ( (z->zin.size = zf_fill(z,&next,0)) == 0 )
+               break;
+            z->zin.src = next;
+            z->zin.pos = 0;
+         }
+         rc = ZSTD_decompressStream(z->zds,&zout,&z->zin);
+         if ( ZSTD_isError(rc) )
+         {
+            fprintf(stderr,"zstd decompression failed: %s\n", ZSTD_getErrorName(rc));
+            z->err = 1;
+         }
+         else
+            z->in_frame = (rc != 0);
+      }
+      done = zout.pos;
+   }
+#endif
+
+   if ( done == 0 && z->err )
+      return -1;
+   z->pos += (off64_t) done;
+   return (ssize_t) done;
+}
+
+/** The write function of the cookie stream. */
+
+static ssize_t zf_write (void *cookie, const char *data, size_t n)
+{
+   struct zfile *z = (struct zfile *) cookie;
+
+   if ( z->err )
+      return -1;
+   if ( n > (1UL<<30) )
+      n = (1UL<<30);
+
+#ifdef HAVE_ZLIB
+   if ( z->compression == 1 )
+   {
+      z->zs.next_in = (const Bytef *) data;
+      z->zs.avail_in = (uInt) n;
+      while ( z->zs.avail_in > 0 )
+      {
+         z->zs.next_out = z->buf;
+         z->zs.avail_out = ZF_BUFSIZE;
+         if ( deflate(&z->zs,Z_NO_FLUSH) == Z_STREAM_ERROR )
+         {
+            z->err = 1;
+            return -1;
+         }
+         if ( zf_flush_buf(z,ZF_BUFSIZE-z->zs.avail_out) != 0 )
+            return -1;
+      }
+   }
+#endif
+#ifdef HAVE_ZSTD
+   if ( z->compression == 10 )
+   {
+      ZSTD_inBuffer in;
+      in.src = data;
+      in.size = n;
+      in.pos = 0;
+      while ( in.pos < in.size )
+      {
+         ZSTD_outBuffer zout;
+         size_t rc;
+         zout.dst = z->buf;
+         zout.size = ZF_BUFSIZE;
+         zout.pos = 0;
+         rc = ZSTD_compressStream2(z->zcc,&zout,&in,ZSTD_e_continue);
+         if ( ZSTD_isError(rc) )
+         {
+            fprintf(stderr,"zstd compression failed: %s\n", ZSTD_getErrorName(rc));
+            z->err = 1;
+            return -1;
+         }
+         if ( zf_flush_buf(z,zout.pos) != 0 )
+            return -1;
+         z->fcsize += zout.pos;
+      }
+      z->fdsize += n;
+      /* With an unbuffered stream, each write is one complete I/O block. */
+      if ( z->frame_blocks > 0 && (++z->nblk >= z->frame_blocks ||
+           z->fdsize >= ZST_MAX_FRAME_SIZE) )
+      {
+         if ( zst_end_frame(z) != 0 )
+            return -1;
+      }
+   }
+#endif
+
+   z->pos += (off64_t) n;
+   return (ssize_t) n;
+}
+
+/** Restart decompression from the beginning of the compressed data. */
+
+static void zf_restart (struct zfile *z)
+{
+#ifdef HAVE_ZLIB
+   if ( z->compression == 1 )
+   {
+      inflateReset(&z->zs);
+      z->zs.avail_in = 0;
+   }
+#endif
+#ifdef HAVE_ZSTD
+   if ( z->compression == 10 )
+   {
+      ZSTD_initDStream(z->zds);
+      z->zin.size = z->zin.pos = 0;
+   }
+#endif
+   z->eof = z->in_frame = z->err = 0;
+   z->pos = 0;
+}
+
+/**
+ *  The seek function of the cookie stream. Input can be positioned
+ *  anywhere, by decompressing and discarding data up to the target,
+ *  after restarting from the beginning if the target is behind us.
+ *  Output is only positioned at its current end.
+ */
+
+static int zf_seek (void *cookie, off64_t *offset, int whence)
+{
+   struct zfile *z = (struct zfile *) cookie;
+   off64_t target;
+   char skip[16384];
+
+   if ( whence == SEEK_SET )
+      target = *offset;
+   else if ( whence == SEEK_CUR )
+      target = z->pos + *offset;
+#ifdef HAVE_ZSTD
+   else if ( whence == SEEK_END && z->zr != NULL )
+      target = (off64_t) z->zr->doff[z->zr->nframes] + *offset;
+#endif
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+   if ( target < 0 )
+   {
+      errno = EINVAL;
+      return -1;
+   }
+   if ( z->writing )
+   {
+      if ( target != z->pos )
+      {
+         errno = ESPIPE;
+         return -1;
+      }
+      *offset = z->pos;
+      return 0;
+   }
+
+#ifdef HAVE_ZSTD
+   if ( z->zr != NULL ) /* Just find the frame with the target position. */
+   {
+      struct zst_reader *zr = z->zr;
+      unsigned long lo = 0, hi = zr->nframes;
+      while ( hi - lo > 1 )
+      {
+         unsigned long mid = (lo + hi) / 2;
+         if ( zr->doff[mid] <= (uint64_t) target )
+            lo = mid;
+         else
+            hi = mid;
+      }
+      zr->cur = lo;
+      z->pos = target;
+      z->eof = z->err = 0;
+      *offset = z->pos;
+      return 0;
+   }
+#endif
+
+   if ( target < z->pos )
+   {
+      if ( z->raw_is_pipe || fseeko(z->raw,(off_t)0,SEEK_SET) != 0 )
+      {
+         errno = ESPIPE;
+         return -1;
+      }
+      clearerr(z->raw);
+      zf_restart(z);
+   }
+   while ( z->pos < target && !z->eof )
+   {
+      size_t nb = (target - z->pos > (off64_t) sizeof(skip)) ?
+         sizeof(skip) : (size_t) (target - z->pos);
+      if ( zf_read(z,skip,nb) <= 0 )
+         break;
+   }
+   if ( z->err )
+      return -1;
+   *offset = z->pos;
+   return 0;
+}
+
+/** The close function of the cookie stream: finish output and close the file. */
+
+static int zf_close (void *cookie)
+{
+   struct zfile *z = (struct zfile *) cookie;
+   int rc = 0;
+
+#ifdef HAVE_ZLIB
+   if ( z->compression == 1 )
+   {
+      if ( z->writing )
+      {
+         int zrc = Z_OK;
+         z->zs.avail_in = 0;
+         while ( zrc == Z_OK && !z->err )
+         {
+            z->zs.next_out = z->buf;
+            z->zs.avail_out = ZF_BUFSIZE;
+            zrc = deflate(&z->zs,Z_FINISH);
+            if ( zrc != Z_OK && zrc != Z_STREAM_END )
+               z->err = 1;
+            else
+               (void) zf_flush_buf(z,ZF_BUFSIZE-z->zs.avail_out);
+         }
+         deflateEnd(&z->zs);
+      }
+      else
+         inflateEnd(&z->zs);
+   }
+#endif
+#ifdef HAVE_ZSTD
+   if ( z->compression == 10 )
+   {
+      if ( z->writing )
+      {
+         if ( z->frame_blocks <= 0 || z->fdsize > 0 )
+            (void) zst_end_frame(z);
+         if ( z->frame_blocks > 0 && !z->err && zst_write_seek_table(z) != 0 )
+            z->err = 1;
+         ZSTD_freeCCtx(z->zcc);
+         free(z->ftab);
+      }
+      else
+      {
+         ZSTD_freeDStream(z->zds);
+         zst_close_reader(z->zr);
+      }
+   }
+#endif
+
+   if ( z->writing && z->err )
+      rc = -1;
+   if ( z->raw_is_pipe )
+   {
+      if ( pclose(z->raw) != 0 )
+         rc = -1;
+   }
+   else if ( fclose(z->raw) != 0 )
+      rc = -1;
+   free(z->buf);
+   free(z);
+   return rc;
+}
+
+/** Check if a compression type can be handled within the process. */
+
+static int inproc_codec (int compression, int mode)
+{
+   if ( !with_inproc )
+      return 0;
+#ifdef HAVE_ZLIB
+   if ( compression == 1 && (mode == 'r' || !parallel) )
+      return 1; /* Leaving parallel compression to 'pigz' */
+#endif
+#ifdef HAVE_ZSTD
+   if ( compression == 10 )
+      return 1;
+#endif
+   return 0;
+}
+
+/**
+ *  @short Wrap an already opened compressed file (or pipe) into a stream
+ *         with in-process decompression (mode 'r') or compression (else).
+ *
+ *  The raw file is closed together with the returned stream but is
+ *  left open if this function fails.
+ */
+
+static FILE *zfile_open (FILE *raw, int raw_is_pipe, const char *mode, int compression)
+{
+   struct zfile *z;
+   cookie_io_functions_t zf_funcs;
+   FILE *f;
+   int ok = 0;
+
+   if ( (z = (struct zfile *) calloc(1,sizeof(struct zfile))) == NULL )
+      return NULL;
+   if ( (z->buf = (unsigned char *) malloc(ZF_BUFSIZE)) == NULL )
+   {
+      free(z);
+      return NULL;
+   }
+   z->raw = raw;
+   z->raw_is_pipe = raw_is_pipe;
+   z->compression = compression;
+   z->writing = (*mode != 'r');
+
+#ifdef HAVE_ZLIB
+   if ( compression == 1 )
+   {
+      if ( z->writing ) /* Window bits +16: gzip format, like 'gzip -c' */
+         ok = (deflateInit2(&z->zs,Z_DEFAULT_COMPRESSION,Z_DEFLATED,
+                  15+16,8,Z_DEFAULT_STRATEGY) == Z_OK);
+      else /* Window bits +32: gzip or zlib format, as detected */
+         ok = (inflateInit2(&z->zs,15+32) == Z_OK);
+   }
+#endif
+#ifdef HAVE_ZSTD
+   if ( compression == 10 )
+   {
+      if ( z->writing )
+      {
+         ok = ( (z->zcc = ZSTD_createCCtx()) != NULL &&
+                !ZSTD_isError(ZSTD_CCtx_setParameter(z->zcc,
+                   ZSTD_c_compressionLevel,ZSTD_CLEVEL_DEFAULT)) );
+         /* Multi-threaded compression, if supported by the library. */
+         if ( ok && parallel )
+            (void) ZSTD_CCtx_setParameter(z->zcc,ZSTD_c_nbWorkers,
+               (parallel > 1) ? parallel : 4);
+         if ( *mode == 'w' )
+            z->frame_blocks = zst_frame_blocks;
+      }
+      else
+      {
+         ok = ( (z->zds = ZSTD_createDStream()) != NULL &&
+                !ZSTD_isError(ZSTD_initDStream(z->zds)) );
+         if ( ok && !raw_is_pipe )
+            z->zr = zst_open_reader(raw);
+      }
+   }
+#endif
+   if ( !ok )
+   {
+      fprintf(stderr,"Cannot initialize in-process (de-)compression.\n");
+#ifdef HAVE_ZSTD
+      if ( z->zcc != NULL )
+         ZSTD_freeCCtx(z->zcc);
+      if ( z->zds != NULL )
+         ZSTD_freeDStream(z->zds);
+      zst_close_reader(z->zr);
+#endif
+      free(z->buf);
+      free(z);
+      return NULL;
+   }
+
+   zf_funcs.read = zf_read;
+   zf_funcs.write = zf_write;
+   zf_funcs.seek = zf_seek;
+   zf_funcs.close = zf_close;
+   if ( (f = fopencookie(z,z->writing ? "w" : "r",zf_funcs)) == NULL )
+   {
+      z->raw = NULL;
+      z->raw_is_pipe = 0;
+      /* Release the codec but not the raw file. */
+#ifdef HAVE_ZLIB
+      if ( compression == 1 )
+      {
+         if ( z->writing )
+            deflateEnd(&z->zs);
+         else
+            inflateEnd(&z->zs);
+      }
+#endif
+#ifdef HAVE_ZSTD
+      if ( z->zcc != NULL )
+         ZSTD_freeCCtx(z->zcc);
+      if ( z->zds != NULL )
+         ZSTD_freeDStream(z->zds);
+      zst_close_reader(z->zr);
+#endif
+      free(z->buf);
+      free(z);
+      return NULL;
+   }
+#ifdef HAVE_ZSTD
+   /* Frames end after complete I/O blocks, each written with a single fwrite(). */
+   if ( z->frame_blocks > 0 )
+      (void) setvbuf(f,NULL,_IONBF,0);
+   else
+#endif
+   {
+      /* Large reads then mostly go directly into the caller's buffer. */
+      (void) setvbuf(f,NULL,_IOFBF,ZF_BUFSIZE);
+   }
+
+   return f;
+}
+
+#endif
+
 /** The starting element of include paths. */
 static struct incpath *root_path = NULL;
 
@@ -358,6 +1400,28 @@ void disable_permissive_pipes()
    permissive_pipes = 0;
 }
 
+/**
+ *  @short Write zstd compressed output files as seekable files.
+ *
+ *  Output to files opened afterwards (for writing, with in-process
+ *  compression) is compressed as independent zstd frames, each
+ *  covering 'blocks_per_frame' complete I/O blocks (or anything else
+ *  written with a single fwrite() call), and a seek table is added
+ *  at the end. Such files can be read by any zstd decompressor but
+ *  fileopen() input can then also seek without decompressing everything
+ *  before the target position, and decompress frames in parallel.
+ *  Same as setting FILEOPEN_ZSTD_SEEKABLE in the environment.
+ *
+ *  @param blocks_per_frame  Number of blocks per frame, 0 to disable.
+ */
+
+void set_seekable_zstd (int blocks_per_frame)
+{
+   if ( !foei_done )
+      fileopen_env_init();
+   zst_frame_blocks = (blocks_per_frame > 0) ? blocks_per_frame : 0;
+}
+
 struct incpath *get_include_path(void)
 {
    return root_path;
@@ -744,6 +1808,25 @@ static FILE *cmp_popen (const char *fname, const char *mode, int compression)
    if ( fname == NULL || mode == NULL )
       return NULL;
 
+#ifdef WITH_INPROC_CODECS
+   if ( inproc_codec(compression,*mode) )
+   {
+      FILE *raw = fopenx(fname,(*mode=='r') ? "r" : (*mode=='a') ? "a" : "w");
+      if ( raw == NULL )
+         return NULL;
+      if ( (f = zfile_open(raw,0,mode,compression)) == NULL )
+         fclose(raw);
+      if ( verbose )
+      {
+         if ( f != NULL )
+            fprintf(stderr,"Fileopen success: mode '%s' with in-process (de-)compression on file '%s'\n", mode, fname);
+         else
+            fprintf(stderr,"Fileopen failed: mode '%s' with in-process (de-)compression on file '%s'\n", mode, fname);
+      }
+      return f;
+   }
+#endif
+
    errno = 0;
    switch ( *mode )
    {
@@ -996,6 +2079,10 @@ static FILE *uri_popen (const char *fname, const char *mode, int compression)
          cmp_cmd = " | tar xOf - | zstd -d";
          break;
    }
+#ifdef WITH_INPROC_CODECS
+   if ( inproc_codec(compression,'r') )
+      cmp_cmd = ""; /* Decompressed below */
+#endif
 
    s = (char *) malloc(strlen(get_cmd)+strlen(fname)+strlen(cmp_cmd)+3);
    if ( s == NULL )
@@ -1007,6 +2094,14 @@ static FILE *uri_popen (const char *fname, const char *mode, int compression)
    strcat(s,cmp_cmd);
 
    f = popenx(s,"r");
+#ifdef WITH_INPROC_CODECS
+   if ( f != NULL && inproc_codec(compression,'r') )
+   {
+      FILE *raw = f;
+      if ( (f = zfile_open(raw,1,"r",compression)) == NULL )
+         pclose(raw);
+   }
+#endif
    if ( verbose )
    {
       if ( f != NULL )
@@ -1116,6 +2211,10 @@ static FILE *ssh_popen (const char *fname, const char *mode, int compression)
          cmp_cmd = " | tar xOf - | zstd -d";
          break;
    }
+#ifdef WITH_INPROC_CODECS
+   if ( inproc_codec(compression,'r') )
+      cmp_cmd = ""; /* Decompressed below */
+#endif
 
    n = strlen(get_cmd)+strlen(fname)+strlen(cmp_cmd)+1;
    t = (char *) malloc(n);
@@ -1124,6 +2223,14 @@ static FILE *ssh_popen (const char *fname, const char *mode, int compression)
    snprintf(t,n,get_cmd,remote_loc,remote_fn,cmp_cmd);
 
    f = popenx(t,"r");
+#ifdef WITH_INPROC_CODECS
+   if ( f != NULL && inproc_codec(compression,'r') )
+   {
+      FILE *raw = f;
+      if ( (f = zfile_open(raw,1,"r",compression)) == NULL )
+         pclose(raw);
+   }
+#endif
    if ( verbose )
    {
       if ( f != NULL )
@@ -1507,6 +2614,12 @@ int fileclose (FILE *f)
    /* Check what kind of stream we have */
    if ( (fno=fileno(f)) == -1 )
    {
+#ifdef WITH_INPROC_CODECS
+      /* In-process (de-)compression streams have no file handle of their own. */
+      if ( (rc = fclose(f)) != 0 && errno == 0 )
+         errno = EIO;
+      return rc;
+#endif
       fprintf(stderr,"Trying to close stream: no file handle\n");
       errno = EBADF;
       return -1;
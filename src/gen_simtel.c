@@ -0,0 +1,348 @@
+/* ============================================================================
+
+Copyright (C) 2026  agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/**
+ *  @file gen_simtel.c
+ *  @short Generate synthetic sim_telarray data files for benchmarking.
+ *
+ *  The file has the same structure as real simulated data (run header,
+ *  MC run header, per-telescope configuration blocks, then MC shower,
+ *  MC event and array event blocks for each event) and is written
+ *  with the normal write_simtel_...() functions. The pixel data are
+ *  pedestals with noise and, for a contiguous group of pixels per
+ *  triggered telescope, a pulse. With zero suppression only that
+ *  group is marked as significant. A fixed seed makes the output
+ *  reproducible.
+ *
+ *  @author agent
+ *  @date   2026
+ */
+
+/** @defgroup gen_simtel_c The gen_simtel program */
+/** @{ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "mc_tel.h"
+#include "io_hess.h"
+#include "fileopen.h"
+
+/** Deterministic pseudo-random numbers (64-bit LCG). */
+static uint64_t rnd_state = 12345;
+static double rndm (void)
+{
+   rnd_state = rnd_state * 6364136223846793005ULL + 1442695040888963407ULL;
+   return (double) (rnd_state >> 11) * (1.0/9007199254740992.0);
+}
+
+/** Approximately Gaussian noise (sum of uniform numbers). */
+static double rnd_noise (double sigma)
+{
+   return sigma * (rndm() + rndm() + rndm() + rndm() - 2.) * 1.732;
+}
+
+static void syntax (const char *prg)
+{
+   fprintf(stderr,"Generate a synthetic sim_telarray data file.\n");
+   fprintf(stderr,"Syntax: %s [ options ] output-file\n", prg);
+   fprintf(stderr,"Options:\n");
+   fprintf(stderr,"  -n events     Number of events (default: 100).\n");
+   fprintf(stderr,"  -t ntel       Number of telescopes (default: 4, max. %d).\n", H_MAX_TEL);
+   fprintf(stderr,"  -p npix       Number of pixels per camera (default: 1855, max. %d).\n", H_MAX_PIX);
+   fprintf(stderr,"  -s nsamples   Number of samples per pixel (default: 40, max. %d).\n", H_MAX_SLICES);
+   fprintf(stderr,"  -g ngains     Number of gains (1 or 2, default: %d).\n", H_MAX_GAINS>=2 ? 2 : 1);
+   fprintf(stderr,"  -r mode       Readout mode: 0 (sums), 1 (samples), 2 (both; default: 1).\n");
+   fprintf(stderr,"  -z fraction   Zero suppression, keeping that fraction of pixels (default: 1 = none).\n");
+   fprintf(stderr,"  -P prob       Trigger probability of each telescope (default: 0.5).\n");
+   fprintf(stderr,"  -S seed       Seed for the random numbers (default: 12345).\n");
+   fprintf(stderr,"The output file name may end in .gz or .zst for compressed output.\n");
+   exit(1);
+}
+
+/* ---------------------- setup_telescope ------------------------ */
+/**
+ *  Fill the configuration of one telescope: square pixel grid,
+ *  one drawer per 16 pixels, trigger sectors of 4x4 pixels.
+ */
+
+static void setup_telescope (AllHessData *hsdata, int itel, int npix, int ngains,
+   int nsamples, int zero_sup)
+{
+   int tel_id = hsdata->run_header.tel_id[itel];
+   CameraSettings *cs = &hsdata->camera_set[itel];
+   CameraOrganisation *co = &hsdata->camera_org[itel];
+   PixelSetting *ps = &hsdata->pixel_set[itel];
+   CameraSoftSet *css = &hsdata->cam_soft_set[itel];
+   int nx = (int) ceil(sqrt((double) npix));
+   int ipix, igain;
+
+   cs->tel_id = co->tel_id = ps->tel_id = css->tel_id = tel_id;
+   hsdata->pixel_disabled[itel].tel_id = tel_id;
+   hsdata->tracking_set[itel].tel_id = tel_id;
+   hsdata->point_cor[itel].tel_id = tel_id;
+
+   cs->num_pixels = npix;
+   cs->flen = cs->eff_flen = 16.;
+   cs->num_mirrors = 100;
+   cs->mirror_area = 100.;
+   cs->pixels_parallel = 1;
+   cs->common_pixel_shape = 2;
+   for ( ipix=0; ipix<npix; ipix++ )
+   {
+      cs->xpix[ipix] = 0.05 * (ipix % nx - 0.5*(nx-1));
+      cs->ypix[ipix] = 0.05 * (ipix / nx - 0.5*(nx-1));
+      cs->area[ipix] = 0.05*0.05;
+      cs->size[ipix] = 0.05;
+      cs->pixel_shape[ipix] = 2;
+   }
+
+   co->num_pixels = npix;
+   co->num_gains = ngains;
+   co->num_drawers = (npix+15) / 16;
+   co->num_sectors = npix;
+   for ( ipix=0; ipix<npix; ipix++ )
+   {
+      co->drawer[ipix] = ipix / 16;
+      for ( igain=0; igain<ngains; igain++ )
+      {
+         co->card[ipix][igain] = ipix / 16;
+         co->chip[ipix][igain] = (ipix % 16) / 4;
+         co->channel[ipix][igain] = ipix % 4;
+      }
+      co->nsect[ipix] = 1;
+      co->sectors[ipix][0] = ipix;
+      co->sector_type[ipix] = 0;
+      co->sector_threshold[ipix] = 4.;
+      co->sector_pixthresh[ipix] = 5.;
+   }
+
+   ps->num_pixels = npix;
+   ps->min_pixel_mult = 4;
+   ps->time_slice = 1.;
+   ps->sum_bins = nsamples;
+   ps->sum_offset = 4;
+
+   css->zero_sup_mode = zero_sup;
+   css->zero_sup_num_thr = zero_sup ? 1 : 0;
+   css->zero_sup_thresholds[0] = 20;
+}
+
+/* ---------------------- fill_telescope ------------------------ */
+/**
+ *  Fill the raw data of a triggered telescope.
+ */
+
+static void fill_telescope (TelEvent *te, int npix, int ngains, int nsamples,
+   int readout_mode, double zs_fraction, int ievt)
+{
+   AdcData *raw = te->raw;
+   int nsig = (int) (zs_fraction * npix + 0.5);
+   int first = (int) (rndm() * (npix - nsig + 1));
+   int ipix, igain, isamp;
+   double peak = 0.3*nsamples + rndm()*0.4*nsamples;
+
+   if ( nsig > npix )
+      nsig = npix;
+   if ( first + nsig > npix )
+      first = npix - nsig;
+
+   te->known = 1;
+   te->loc_count = te->glob_count = ievt;
+   te->trg_source = 1;
+   te->readout_mode = readout_mode;
+   te->num_list_trgsect = 1;
+   te->list_trgsect[0] = first;
+
+   raw->known = 1;
+   raw->num_pixels = npix;
+   raw->num_gains = ngains;
+   raw->num_samples = (readout_mode != 0) ? nsamples : 0;
+   raw->zero_sup_mode = (zs_fraction < 1.) ? 0x21 : 0;
+   raw->data_red_mode = 0;
+   raw->list_known = 0;
+   raw->threshold = 0;
+
+   for ( ipix=0; ipix<npix; ipix++ )
+   {
+      int sig = ( raw->zero_sup_mode == 0 || (ipix >= first && ipix < first+nsig) );
+      double amp = (ipix >= first && ipix < first+nsig) ? 5. + 200.*rndm()*rndm() : 0.;
+      raw->significant[ipix] = sig ? 0x21 : 0;
+      for ( igain=0; igain<ngains; igain++ )
+      {
+         uint32_t sum = 0;
+         double a = (igain == 0) ? amp : 0.1*amp;
+         raw->adc_known[igain][ipix] = sig ? 3 : 0;
+         for ( isamp=0; isamp<nsamples; isamp++ )
+         {
+            double dt = (isamp - peak) / 2.;
+            double v = 300. + rnd_noise(3.) + a * exp(-0.5*dt*dt);
+            uint16_t s = (uint16_t) (v < 0. ? 0 : v > 65535. ? 65535 : v);
+            if ( readout_mode != 0 )
+               ADC_SAMPLES(raw,igain,ipix)[isamp] = s;
+            sum += s;
+         }
+         raw->adc_sum[igain][ipix] = sum;
+      }
+   }
+}
+
+int main (int argc, char **argv)
+{
+   const char *prg = argv[0];
+   int nevents = 100, ntel = 4, npix = 1855, nsamples = 40;
+   int ngains = (H_MAX_GAINS >= 2) ? 2 : 1, readout_mode = 1;
+   double zs_fraction = 1., trg_prob = 0.5;
+   IO_BUFFER *iobuf;
+   AllHessData *hsdata;
+   FILE *output;
+   int itel, ievt, rc = 0;
+   const int what = RAWDATA_FLAG | RAWSUM_FLAG;
+
+   while ( argc > 2 && argv[1][0] == '-' && argv[1][1] != '\0' && argv[1][2] == '\0' )
+   {
+      switch ( argv[1][1] )
+      {
+         case 'n': nevents = atoi(argv[2]); break;
+         case 't': ntel = atoi(argv[2]); break;
+         case 'p': npix = atoi(argv[2]); break;
+         case 's': nsamples = atoi(argv[2]); break;
+         case 'g': ngains = atoi(argv[2]); break;
+         case 'r': readout_mode = atoi(argv[2]); break;
+         case 'z': zs_fraction = atof(argv[2]); break;
+         case 'P': trg_prob = atof(argv[2]); break;
+         case 'S': rnd_state = (uint64_t) strtoull(argv[2],NULL,0); break;
+         default: syntax(prg);
+      }
+      argc -= 2;
+      argv += 2;
+   }
+   if ( argc != 2 || argv[1][0] == '-' )
+      syntax(prg);
+   if ( ntel < 1 || ntel > H_MAX_TEL || npix < 1 || npix > H_MAX_PIX ||
+        nsamples < 1 || nsamples >= H_MAX_SLICES || ngains < 1 || ngains > H_MAX_GAINS ||
+        readout_mode < 0 || readout_mode > 2 || zs_fraction <= 0. || zs_fraction > 1. )
+   {
+      fprintf(stderr,"%s: parameter out of range.\n", prg);
+      syntax(prg);
+   }
+
+   if ( (output = fileopen(argv[1],"w")) == NULL )
+   {
+      perror(argv[1]);
+      exit(1);
+   }
+   if ( (iobuf = allocate_io_buffer(5000000)) == NULL ||
+        (hsdata = (AllHessData *) calloc(1,sizeof(AllHessData))) == NULL )
+   {
+      fprintf(stderr,"%s: not enough memory\n", prg);
+      exit(1);
+   }
+   iobuf->max_length = 200000000;
+   iobuf->output_file = output;
+
+   /* Run header and MC run header */
+   hsdata->run_header.run = 1;
+   hsdata->run_header.time = 1700000000;
+   hsdata->run_header.run_type = -1;
+   hsdata->run_header.direction[1] = 70. * (M_PI/180.);
+   hsdata->run_header.ntel = ntel;
+   hsdata->run_header.min_tel_trig = 1;
+   for ( itel=0; itel<ntel; itel++ )
+   {
+      hsdata->run_header.tel_id[itel] = itel + 1;
+      hsdata->run_header.tel_pos[itel][0] = 100. * (itel % 6);
+      hsdata->run_header.tel_pos[itel][1] = 100. * (itel / 6);
+   }
+   rc |= write_simtel_runheader(iobuf,&hsdata->run_header);
+   hsdata->mc_run_header.shower_prog_id = 1;
+   hsdata->mc_run_header.detector_prog_id = 1;
+   hsdata->mc_run_header.obsheight = 1800.;
+   hsdata->mc_run_header.num_showers = nevents;
+   hsdata->mc_run_header.num_use = 1;
+   hsdata->mc_run_header.core_pos_mode = 1;
+   hsdata->mc_run_header.core_range[1] = 500.;
+   hsdata->mc_run_header.alt_range[0] = hsdata->mc_run_header.alt_range[1] = 70. * (M_PI/180.);
+   hsdata->mc_run_header.E_range[0] = 0.01;
+   hsdata->mc_run_header.E_range[1] = 100.;
+   hsdata->mc_run_header.spectral_index = -2.;
+   rc |= write_simtel_mcrunheader(iobuf,&hsdata->mc_run_header);
+
+   /* Per-telescope configuration */
+   for ( itel=0; itel<ntel; itel++ )
+   {
+      setup_telescope(hsdata,itel,npix,ngains,nsamples,zs_fraction < 1.);
+      rc |= write_simtel_camsettings(iobuf,&hsdata->camera_set[itel]);
+      rc |= write_simtel_camorgan(iobuf,&hsdata->camera_org[itel]);
+      rc |= write_simtel_pixelset(iobuf,&hsdata->pixel_set[itel]);
+      rc |= write_simtel_pixeldis(iobuf,&hsdata->pixel_disabled[itel]);
+      rc |= write_simtel_camsoftset(iobuf,&hsdata->cam_soft_set[itel]);
+      rc |= write_simtel_pointingcor(iobuf,&hsdata->point_cor[itel]);
+      rc |= write_simtel_trackset(iobuf,&hsdata->tracking_set[itel]);
+
+      hsdata->event.teldata[itel].tel_id = hsdata->run_header.tel_id[itel];
+      hsdata->event.trackdata[itel].tel_id = hsdata->run_header.tel_id[itel];
+      if ( (hsdata->event.teldata[itel].raw = (AdcData *) calloc(1,sizeof(AdcData))) == NULL ||
+           alloc_adc_samples(hsdata->event.teldata[itel].raw,ngains,npix,nsamples) != 0 )
+      {
+         fprintf(stderr,"%s: not enough memory\n", prg);
+         exit(1);
+      }
+      hsdata->event.teldata[itel].raw->tel_id = hsdata->run_header.tel_id[itel];
+   }
+   hsdata->event.num_tel = ntel;
+
+   /* The events */
+   for ( ievt=1; ievt<=nevents && rc == 0; ievt++ )
+   {
+      int ntrg = 0;
+      hsdata->mc_shower.shower_num = ievt;
+      hsdata->mc_shower.energy = 0.01 / (1. - rndm()*0.999);
+      hsdata->mc_shower.altitude = 70. * (M_PI/180.);
+      hsdata->mc_shower.xmax = 250. + 100.*rndm();
+      rc |= write_simtel_mc_shower(iobuf,&hsdata->mc_shower);
+      hsdata->mc_event.event = 100*ievt;
+      hsdata->mc_event.shower_num = ievt;
+      hsdata->mc_event.xcore = 500. * (rndm() - 0.5);
+      hsdata->mc_event.ycore = 500. * (rndm() - 0.5);
+      rc |= write_simtel_mc_event(iobuf,&hsdata->mc_event);
+
+      hsdata->event.central.glob_count = 100*ievt;
+      hsdata->event.central.num_teltrg = hsdata->event.central.num_teldata = 0;
+      for ( itel=0; itel<ntel; itel++ )
+      {
+         TelEvent *te = &hsdata->event.teldata[itel];
+         te->known = 0;
+         if ( rndm() < trg_prob || (itel == ntel-1 && ntrg == 0) )
+         {
+            fill_telescope(te,npix,ngains,nsamples,readout_mode,zs_fraction,100*ievt);
+            ntrg++;
+         }
+      }
+      rc |= write_simtel_event(iobuf,&hsdata->event,what);
+   }
+
+   if ( rc != 0 )
+      fprintf(stderr,"%s: writing the data failed.\n", prg);
+   fileclose(output);
+   iobuf->output_file = NULL;
+   free_io_buffer(iobuf);
+   return rc ? 1 : 0;
+}
+
+/** @} */
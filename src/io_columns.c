@@ -0,0 +1,1028 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_columns.c
+ *  @short Column-wise tables of event-level quantities in eventio format.
+ *
+ *  All blocks of a table carry the table ID as their ident:
+
+@verbatim
+    IO_TYPE_COLUMN_TABLE (version 0):
+       string   table name
+       count    number of columns
+       per column: string name, count type
+    IO_TYPE_COLUMN_STATS (version 0):
+       count    number of rows
+       count    number of columns
+       per column: count number of values, double minimum, double maximum
+    IO_TYPE_COLUMN_CHUNK (version 0):
+       count    number of rows
+       per column a sub-item IO_TYPE_COLUMN_DATA (ident: column index):
+          count    number of values
+          (array columns only) count per row: number of values
+          byte     encoding: 0 (plain), 1 (zlib-compressed, byte-shuffled)
+          int32    number of bytes following
+          the values as a vector of int32, float, or double
+@endverbatim
+
+ *  Compressed values are byte-shuffled (first all first bytes of the
+ *  values, then all second bytes, and so on) before compression, which
+ *  helps a lot for floating-point data of limited dynamic range.
+ *  Missing values in a row are NaN, or 0 for integer columns.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "io_columns.h"
+#include "warning.h"
+#include <math.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define COL_ENC_PLAIN 0
+#define COL_ENC_ZLIB  1
+
+/** Bytes per value of a column as stored. */
+
+static size_t col_elsize (int type)
+{
+   return ((type & 0x0f) == COL_DOUBLE) ? 8 : 4;
+}
+
+/* ---------------------- allocate_column_table -------------------- */
+/**
+ *  @short Allocate a new column table without any columns yet.
+ *
+ *  @param name      The table name (for writing) or NULL (for reading).
+ *  @param table_id  Ident used for all blocks of this table.
+ *  @param max_rows  Rows per chunk when writing (0: default of 10000).
+ *
+ *  @return Pointer to the new table or NULL.
+ */
+
+IO_COLUMN_TABLE *allocate_column_table (const char *name, int table_id,
+   size_t max_rows)
+{
+   IO_COLUMN_TABLE *tab = (IO_COLUMN_TABLE *) calloc(1,sizeof(IO_COLUMN_TABLE));
+   if ( tab == NULL )
+   {
+      Warning("Not enough memory for column table");
+      return NULL;
+   }
+   if ( name != NULL )
+      strncpy(tab->name,name,COL_NAME_LEN-1);
+   tab->table_id = table_id;
+   tab->max_rows = (max_rows > 0) ? max_rows : 10000;
+#ifdef HAVE_ZLIB
+   tab->compress = 1;
+#endif
+   return tab;
+}
+
+/* Release the values of all columns. */
+
+static void clear_columns (IO_COLUMN_TABLE *tab)
+{
+   int icol;
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      free(tab->column[icol].values);
+      free(tab->column[icol].first);
+   }
+   memset(tab->column,0,sizeof(tab->column));
+   tab->num_columns = 0;
+   tab->num_rows = tab->max_row_index = 0;
+}
+
+/* ------------------------- free_column_table --------------------- */
+/**
+ *  @short Release a column table. Any rows not yet written are lost,
+ *         see flush_column_chunk().
+ */
+
+void free_column_table (IO_COLUMN_TABLE *tab)
+{
+   if ( tab == NULL )
+      return;
+   clear_columns(tab);
+   if ( tab->scratch != NULL )
+      free_io_buffer(tab->scratch);
+   free(tab);
+}
+
+/* Make space for at least num values in a column. */
+
+static int col_reserve (IO_COLUMN *col, size_t num)
+{
+   double *v;
+   size_t n;
+   if ( num <= col->max_values )
+      return 0;
+   n = (col->max_values > 0) ? 2*col->max_values : 1024;
+   if ( n < num )
+      n = num;
+   if ( (v = (double *) realloc(col->values,n*sizeof(double))) == NULL )
+   {
+      Warning("Not enough memory for column values");
+      return -2;
+   }
+   col->values = v;
+   col->max_values = n;
+   return 0;
+}
+
+/* Make space for row indices of array columns for at least num rows. */
+
+static int col_reserve_rows (IO_COLUMN_TABLE *tab, size_t num)
+{
+   int icol;
+   size_t n;
+   if ( num+1 <= tab->max_row_index )
+      return 0;
+   n = (tab->max_row_index > 0) ? 2*tab->max_row_index : 1024;
+   if ( n < num+1 )
+      n = num+1;
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      IO_COLUMN *col = &tab->column[icol];
+      size_t *f;
+      if ( !(col->type & COL_ARRAY) )
+         continue;
+      if ( (f = (size_t *) realloc(col->first,n*sizeof(size_t))) == NULL )
+      {
+         Warning("Not enough memory for column row indices");
+         return -2;
+      }
+      if ( tab->max_row_index == 0 || col->first == NULL )
+         f[0] = 0;
+      col->first = f;
+   }
+   tab->max_row_index = n;
+   return 0;
+}
+
+/* ----------------------------- add_column ------------------------ */
+/**
+ *  @short Add a column to a table before anything is written.
+ *
+ *  @param tab   The column table.
+ *  @param name  Unique name of the column.
+ *  @param type  COL_INT32, COL_FLOAT, or COL_DOUBLE, with COL_ARRAY
+ *               added for a variable number of values per row.
+ *
+ *  @return The column index or -1 (error).
+ */
+
+int add_column (IO_COLUMN_TABLE *tab, const char *name, int type)
+{
+   IO_COLUMN *col;
+   int k = type & 0x0f;
+
+   if ( tab == NULL || name == NULL )
+      return -1;
+   if ( (k != COL_INT32 && k != COL_FLOAT && k != COL_DOUBLE) ||
+        (type & ~(0x0f|COL_ARRAY)) != 0 )
+   {
+      Warning("Unsupported column type");
+      return -1;
+   }
+   if ( tab->num_columns >= COL_MAX_COLUMNS )
+   {
+      Warning("Too many columns in table");
+      return -1;
+   }
+   if ( find_column(tab,name) >= 0 )
+   {
+      Warning("Duplicate column name");
+      return -1;
+   }
+   col = &tab->column[tab->num_columns];
+   memset(col,0,sizeof(IO_COLUMN));
+   strncpy(col->name,name,COL_NAME_LEN-1);
+   col->type = type;
+   if ( (type & COL_ARRAY) && tab->max_row_index > 0 )
+   {
+      if ( (col->first = (size_t *) calloc(tab->max_row_index,sizeof(size_t))) == NULL )
+      {
+         Warning("Not enough memory for column row indices");
+         return -1;
+      }
+   }
+   return tab->num_columns++;
+}
+
+/* ---------------------------- find_column ------------------------ */
+/**
+ *  @short Index of a column by its name, or -1 if there is no such column.
+ */
+
+int find_column (const IO_COLUMN_TABLE *tab, const char *name)
+{
+   int icol;
+   if ( tab == NULL || name == NULL )
+      return -1;
+   for ( icol=0; icol<tab->num_columns; icol++ )
+      if ( strcmp(tab->column[icol].name,name) == 0 )
+         return icol;
+   return -1;
+}
+
+/* ------------------------ write_column_table --------------------- */
+/**
+ *  @short Write the table definition, needed before the first chunk.
+ */
+
+int write_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header;
+   int icol;
+
+   if ( iobuf == (IO_BUFFER *) NULL || tab == NULL )
+      return -1;
+
+   item_header.type = IO_TYPE_COLUMN_TABLE;
+   item_header.version = 0;
+   item_header.ident = tab->table_id;
+   put_item_begin(iobuf,&item_header);
+   put_string(tab->name,iobuf);
+   put_count(tab->num_columns,iobuf);
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      put_string(tab->column[icol].name,iobuf);
+      put_count(tab->column[icol].type,iobuf);
+   }
+   return put_item_end(iobuf,&item_header);
+}
+
+/* ------------------------- set_column_value ---------------------- */
+/**
+ *  @short Set the value of a column in the current row (or, for array
+ *         columns, append one value).
+ *
+ *  @return 0 (o.k.), -1 (error), -2 (not enough memory)
+ */
+
+int set_column_value (IO_COLUMN_TABLE *tab, int icol, double value)
+{
+   IO_COLUMN *col;
+   int rc;
+
+   if ( tab == NULL || icol < 0 || icol >= tab->num_columns )
+      return -1;
+   col = &tab->column[icol];
+   if ( (col->type & COL_ARRAY) )
+      return set_column_values(tab,icol,&value,1);
+   if ( (rc = col_reserve(col,tab->num_rows+1)) != 0 )
+      return rc;
+   col->values[tab->num_rows] = value;
+   col->num_values = tab->num_rows+1;
+   return 0;
+}
+
+/* ------------------------- set_column_values --------------------- */
+/**
+ *  @short Append values of an array column in the current row.
+ *
+ *  @return 0 (o.k.), -1 (error), -2 (not enough memory)
+ */
+
+int set_column_values (IO_COLUMN_TABLE *tab, int icol, const double *values, size_t num)
+{
+   IO_COLUMN *col;
+   int rc;
+
+   if ( tab == NULL || icol < 0 || icol >= tab->num_columns ||
+        (values == NULL && num > 0) )
+      return -1;
+   col = &tab->column[icol];
+   if ( !(col->type & COL_ARRAY) )
+   {
+      if ( num != 1 )
+      {
+         Warning("Only one value per row in a scalar column");
+         return -1;
+      }
+      return set_column_value(tab,icol,values[0]);
+   }
+   if ( (rc = col_reserve_rows(tab,tab->num_rows+1)) != 0 ||
+        (rc = col_reserve(col,col->num_values+num)) != 0 )
+      return rc;
+   if ( num > 0 )
+      memcpy(col->values+col->num_values,values,num*sizeof(double));
+   col->num_values += num;
+   return 0;
+}
+
+/* -------------------------- end_column_row ----------------------- */
+/**
+ *  @short Complete the current row, with missing values of scalar
+ *         columns set to NaN (or 0 for integer columns), and write
+ *         the chunk when it is full.
+ *
+ *  @return 0 (o.k.), -1 (error), -2 (not enough memory)
+ */
+
+int end_column_row (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   int icol, rc;
+
+   if ( tab == NULL )
+      return -1;
+   if ( (rc = col_reserve_rows(tab,tab->num_rows+1)) != 0 )
+      return rc;
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      IO_COLUMN *col = &tab->column[icol];
+      if ( (col->type & COL_ARRAY) )
+         col->first[tab->num_rows+1] = col->num_values;
+      else if ( col->num_values <= tab->num_rows )
+      {
+         if ( (rc = col_reserve(col,tab->num_rows+1)) != 0 )
+            return rc;
+         col->values[tab->num_rows] =
+            ((col->type & 0x0f) == COL_INT32) ? 0. : NAN;
+         col->num_values = tab->num_rows+1;
+      }
+   }
+   tab->num_rows++;
+   tab->total_rows++;
+   if ( tab->num_rows >= tab->max_rows )
+      return flush_column_chunk(iobuf,tab);
+   return 0;
+}
+
+/* Values as stored, in their own byte order, from a column. */
+
+static int put_column_values (IO_COLUMN *col, IO_BUFFER *iobuf)
+{
+   size_t i, n = col->num_values;
+   int k = col->type & 0x0f;
+
+   if ( n == 0 )
+      return 0;
+   if ( k == COL_DOUBLE )
+      put_vector_of_double(col->values,(int)n,iobuf);
+   else if ( k == COL_FLOAT )
+   {
+      float *v = (float *) malloc(n*sizeof(float));
+      if ( v == NULL )
+         return -2;
+      for ( i=0; i<n; i++ )
+         v[i] = (float) col->values[i];
+      put_vector_of_float(v,(int)n,iobuf);
+      free(v);
+   }
+   else
+   {
+      int32_t *v = (int32_t *) malloc(n*sizeof(int32_t));
+      if ( v == NULL )
+         return -2;
+      for ( i=0; i<n; i++ )
+         v[i] = (int32_t) col->values[i];
+      put_vector_of_int32(v,(int)n,iobuf);
+      free(v);
+   }
+   return 0;
+}
+
+#ifdef HAVE_ZLIB
+/* Compress the values just put into the I/O buffer in place, if that helps. */
+
+static int compress_column_values (IO_BUFFER *iobuf, long offset, size_t elsize)
+{
+   size_t nb = (size_t) ((iobuf->data - iobuf->buffer) - offset);
+   size_t n = nb / elsize, i, j;
+   uLongf clen = compressBound(nb);
+   BYTE *shuffled, *packed;
+   BYTE *src = iobuf->buffer + offset;
+
+   if ( nb < 64 )
+      return COL_ENC_PLAIN;
+   if ( (shuffled = (BYTE *) malloc(nb)) == NULL )
+      return COL_ENC_PLAIN;
+   if ( (packed = (BYTE *) malloc(clen)) == NULL )
+   {
+      free(shuffled);
+      return COL_ENC_PLAIN;
+   }
+   for ( j=0; j<elsize; j++ )
+      for ( i=0; i<n; i++ )
+         shuffled[j*n+i] = src[i*elsize+j];
+   if ( compress2(packed,&clen,shuffled,(uLong)nb,Z_DEFAULT_COMPRESSION) != Z_OK ||
+        clen >= nb )
+   {
+      free(packed);
+      free(shuffled);
+      return COL_ENC_PLAIN;
+   }
+   memcpy(src,packed,clen);
+   iobuf->data = src + clen;
+   iobuf->w_remaining += (long) (nb - clen);
+   free(packed);
+   free(shuffled);
+   return COL_ENC_ZLIB;
+}
+#endif
+
+/* Write the sub-item with the values of one column in the current chunk. */
+
+static int write_column_data (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab, int icol)
+{
+   IO_ITEM_HEADER item_header;
+   IO_COLUMN *col = &tab->column[icol];
+   long pos_enc, pos_values;
+   int enc = COL_ENC_PLAIN, rc;
+   size_t irow;
+   BYTE *save_data_ptr;
+
+   item_header.type = IO_TYPE_COLUMN_DATA;
+   item_header.version = 0;
+   item_header.ident = icol;
+   put_item_begin(iobuf,&item_header);
+   put_count(col->num_values,iobuf);
+   if ( (col->type & COL_ARRAY) )
+      for ( irow=0; irow<tab->num_rows; irow++ )
+         put_count(col->first[irow+1]-col->first[irow],iobuf);
+   /* Positions as offsets since the buffer may get extended. */
+   pos_enc = (long) (iobuf->data - iobuf->buffer);
+   put_byte(COL_ENC_PLAIN,iobuf);
+   put_long(0L,iobuf);
+   pos_values = (long) (iobuf->data - iobuf->buffer);
+   if ( (rc = put_column_values(col,iobuf)) != 0 )
+   {
+      unput_item(iobuf,&item_header);
+      return rc;
+   }
+   if ( iobuf->w_remaining < 0 )
+   {
+      unput_item(iobuf,&item_header);
+      return -1;
+   }
+#ifdef HAVE_ZLIB
+   if ( tab->compress )
+      enc = compress_column_values(iobuf,pos_values,col_elsize(col->type));
+#endif
+   /* Now fill in encoding and length of the values. */
+   save_data_ptr = iobuf->data;
+   iobuf->data = iobuf->buffer + pos_enc;
+   iobuf->w_remaining += 5;
+   put_byte(enc,iobuf);
+   put_long((long)((save_data_ptr - iobuf->buffer) - pos_values),iobuf);
+   iobuf->data = save_data_ptr;
+
+   return put_item_end(iobuf,&item_header);
+}
+
+/* ------------------------ flush_column_chunk --------------------- */
+/**
+ *  @short Write the rows collected so far as a chunk, preceded by
+ *         its statistics, and start a new chunk.
+ *
+ *  Must be called after the last row, before closing the output.
+ *
+ *  @return 0 (o.k.), -1 (error), -2 (not enough memory)
+ */
+
+int flush_column_chunk (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header;
+   int icol, rc;
+   size_t i;
+
+   if ( iobuf == (IO_BUFFER *) NULL || tab == NULL )
+      return -1;
+   if ( tab->num_rows == 0 )
+      return 0;
+
+   /* Range of values of each column, ignoring NaN */
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      IO_COLUMN *col = &tab->column[icol];
+      col->vmin = HUGE_VAL;
+      col->vmax = -HUGE_VAL;
+      for ( i=0; i<col->num_values; i++ )
+      {
+         double v = col->values[i];
+         if ( v < col->vmin )
+            col->vmin = v;
+         if ( v > col->vmax )
+            col->vmax = v;
+      }
+   }
+
+   item_header.type = IO_TYPE_COLUMN_STATS;
+   item_header.version = 0;
+   item_header.ident = tab->table_id;
+   put_item_begin(iobuf,&item_header);
+   put_count(tab->num_rows,iobuf);
+   put_count(tab->num_columns,iobuf);
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      put_count(tab->column[icol].num_values,iobuf);
+      put_double(tab->column[icol].vmin,iobuf);
+      put_double(tab->column[icol].vmax,iobuf);
+   }
+   if ( (rc = put_item_end(iobuf,&item_header)) != 0 )
+      return rc;
+
+   item_header.type = IO_TYPE_COLUMN_CHUNK;
+   item_header.version = 0;
+   item_header.ident = tab->table_id;
+   put_item_begin(iobuf,&item_header);
+   put_count(tab->num_rows,iobuf);
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      if ( (rc = write_column_data(iobuf,tab,icol)) != 0 )
+      {
+         unput_item(iobuf,&item_header);
+         return rc;
+      }
+   }
+   if ( (rc = put_item_end(iobuf,&item_header)) != 0 )
+      return rc;
+
+   tab->num_chunks++;
+   tab->num_rows = 0;
+   for ( icol=0; icol<tab->num_columns; icol++ )
+      tab->column[icol].num_values = 0;
+
+   return 0;
+}
+
+/* ------------------------- read_column_table --------------------- */
+/**
+ *  @short Get the table definition from an I/O block of type
+ *         IO_TYPE_COLUMN_TABLE already read. Any previous columns,
+ *         selections, and cuts are reset.
+ */
+
+int read_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header;
+   int icol, ncol, rc;
+
+   if ( iobuf == (IO_BUFFER *) NULL || tab == NULL )
+      return -1;
+
+   item_header.type = IO_TYPE_COLUMN_TABLE;
+   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
+      return rc;
+   if ( item_header.version != 0 )
+   {
+      Warning("Unsupported column table version");
+      get_item_end(iobuf,&item_header);
+      return -1;
+   }
+   clear_columns(tab);
+   tab->num_cuts = 0;
+   tab->num_chunks = tab->chunks_skipped = tab->total_rows = 0;
+   tab->table_id = item_header.ident;
+   get_string(tab->name,COL_NAME_LEN,iobuf);
+   ncol = (int) get_count(iobuf);
+   if ( ncol < 0 || ncol > COL_MAX_COLUMNS )
+   {
+      Warning("Too many columns in table");
+      get_item_end(iobuf,&item_header);
+      return -1;
+   }
+   for ( icol=0; icol<ncol; icol++ )
+   {
+      char name[COL_NAME_LEN];
+      int type;
+      get_string(name,COL_NAME_LEN,iobuf);
+      type = (int) get_count(iobuf);
+      if ( add_column(tab,name,type) < 0 )
+      {
+         get_item_end(iobuf,&item_header);
+         return -1;
+      }
+   }
+
+   return get_item_end(iobuf,&item_header);
+}
+
+/* ------------------------- find_column_table --------------------- */
+/**
+ *  @short Skip input up to the definition of a table with the given
+ *         name (or of any table for a NULL name) and read it.
+ *
+ *  @return 0 (found), -1 (not found before end of input or error)
+ */
+
+int find_column_table (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab, const char *name)
+{
+   IO_ITEM_HEADER item_header;
+
+   if ( iobuf == (IO_BUFFER *) NULL || tab == NULL )
+      return -1;
+
+   while ( find_io_block(iobuf,&item_header) == 0 )
+   {
+      if ( item_header.type != IO_TYPE_COLUMN_TABLE )
+      {
+         if ( skip_io_block(iobuf,&item_header) != 0 )
+            return -1;
+         continue;
+      }
+      if ( read_io_block(iobuf,&item_header) != 0 ||
+           read_column_table(iobuf,tab) != 0 )
+         return -1;
+      if ( name == NULL || strcmp(tab->name,name) == 0 )
+         return 0;
+   }
+
+   return -1;
+}
+
+/* ---------------------------- select_column ---------------------- */
+/**
+ *  @short Select a column to be decoded when reading chunks.
+ *         Without any selection, all columns are decoded.
+ *
+ *  @return The column index or -1 if there is no such column.
+ */
+
+int select_column (IO_COLUMN_TABLE *tab, const char *name)
+{
+   int icol = find_column(tab,name);
+   if ( icol >= 0 )
+      tab->column[icol].selected = 1;
+   return icol;
+}
+
+/* --------------------------- add_column_cut ---------------------- */
+/**
+ *  @short Add a range cut on a column when reading chunks.
+ *
+ *  Chunks where the range of values of the column does not overlap
+ *  with the accepted range are skipped without being decoded.
+ *  For the rows of chunks read, column_row_passes() applies all cuts.
+ *  Cuts on a column imply its selection, if any columns are selected.
+ *
+ *  @return 0 (o.k.), -1 (error)
+ */
+
+int add_column_cut (IO_COLUMN_TABLE *tab, const char *name, double vmin, double vmax)
+{
+   int icol = find_column(tab,name);
+
+   if ( icol < 0 )
+   {
+      Warning("No such column for a cut");
+      return -1;
+   }
+   if ( tab->num_cuts >= COL_MAX_CUTS )
+   {
+      Warning("Too many column cuts");
+      return -1;
+   }
+   tab->cut[tab->num_cuts].icol = icol;
+   tab->cut[tab->num_cuts].vmin = vmin;
+   tab->cut[tab->num_cuts].vmax = vmax;
+   tab->num_cuts++;
+   return 0;
+}
+
+/* Read the statistics block and check if the following chunk can pass the cuts. */
+
+static int chunk_may_pass (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header;
+   int icol, ncol, icut, rc;
+
+   item_header.type = IO_TYPE_COLUMN_STATS;
+   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
+      return rc;
+   (void) get_count(iobuf); /* Number of rows */
+   ncol = (int) get_count(iobuf);
+   if ( ncol != tab->num_columns )
+   {
+      Warning("Column statistics not matching the table definition");
+      get_item_end(iobuf,&item_header);
+      return -1;
+   }
+   for ( icol=0; icol<ncol; icol++ )
+   {
+      (void) get_count(iobuf); /* Number of values */
+      tab->column[icol].vmin = get_double(iobuf);
+      tab->column[icol].vmax = get_double(iobuf);
+   }
+   if ( (rc = get_item_end(iobuf,&item_header)) < 0 )
+      return rc;
+
+   for ( icut=0; icut<tab->num_cuts; icut++ )
+   {
+      const IO_COLUMN *col = &tab->column[tab->cut[icut].icol];
+      if ( col->vmax < tab->cut[icut].vmin || col->vmin > tab->cut[icut].vmax ||
+           col->vmin > col->vmax /* No values at all */ )
+         return 0;
+   }
+   return 1;
+}
+
+/* Decode the values of one column from its sub-item. */
+
+static int read_column_data (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab,
+   IO_COLUMN *col, size_t num_rows)
+{
+   size_t i, n, nb, irow, elsize = col_elsize(col->type);
+   IO_BUFFER *src = iobuf;
+   int enc, k = col->type & 0x0f, rc = 0;
+
+   n = (size_t) get_count(iobuf);
+   if ( (rc = col_reserve(col,n)) != 0 )
+      return rc;
+   if ( (col->type & COL_ARRAY) )
+   {
+      if ( (rc = col_reserve_rows(tab,num_rows)) != 0 )
+         return rc;
+      col->first[0] = 0;
+      for ( irow=0; irow<num_rows; irow++ )
+         col->first[irow+1] = col->first[irow] + (size_t) get_count(iobuf);
+      if ( col->first[num_rows] != n )
+      {
+         Warning("Inconsistent number of values in array column");
+         return -1;
+      }
+   }
+   else if ( n != num_rows )
+   {
+      Warning("Inconsistent number of values in column");
+      return -1;
+   }
+   enc = get_byte(iobuf);
+   nb = (size_t) get_long(iobuf);
+   if ( iobuf->r_remaining < (long) nb )
+      return -1;
+
+   if ( enc == COL_ENC_ZLIB )
+   {
+#ifdef HAVE_ZLIB
+      size_t rawlen = n * elsize, j;
+      uLongf dlen = (uLongf) rawlen;
+      BYTE *shuffled;
+      if ( tab->scratch != NULL && (size_t) tab->scratch->buflen < rawlen )
+      {
+         free_io_buffer(tab->scratch);
+         tab->scratch = NULL;
+      }
+      if ( tab->scratch == NULL &&
+           (tab->scratch = allocate_io_buffer(rawlen > 1024 ? rawlen : 1024)) == NULL )
+         return -2;
+      if ( (shuffled = (BYTE *) malloc(rawlen > 0 ? rawlen : 1)) == NULL )
+         return -2;
+      if ( uncompress(shuffled,&dlen,iobuf->data,(uLong)nb) != Z_OK || dlen != rawlen )
+      {
+         Warning("Corrupted compressed column data");
+         free(shuffled);
+         return -1;
+      }
+      for ( j=0; j<elsize; j++ )
+         for ( i=0; i<n; i++ )
+            tab->scratch->buffer[i*elsize+j] = shuffled[j*n+i];
+      free(shuffled);
+      src = tab->scratch;
+      src->data = src->buffer;
+      src->r_remaining = (long) rawlen;
+      src->byte_order = iobuf->byte_order;
+#else
+      Warning("Compressed column data but no zlib support");
+      return -1;
+#endif
+   }
+   else if ( enc != COL_ENC_PLAIN || nb != n * elsize )
+   {
+      Warning("Unsupported column data encoding");
+      return -1;
+   }
+
+   if ( n > 0 && k == COL_DOUBLE )
+      get_vector_of_double(col->values,(int)n,src);
+   else if ( n > 0 && k == COL_FLOAT )
+   {
+      float *v = (float *) malloc(n*sizeof(float));
+      if ( v == NULL )
+         return -2;
+      get_vector_of_float(v,(int)n,src);
+      for ( i=0; i<n; i++ )
+         col->values[i] = v[i];
+      free(v);
+   }
+   else if ( n > 0 )
+   {
+      int32_t *v = (int32_t *) malloc(n*sizeof(int32_t));
+      if ( v == NULL )
+         return -2;
+      get_vector_of_int32(v,(int)n,src);
+      for ( i=0; i<n; i++ )
+         col->values[i] = v[i];
+      free(v);
+   }
+   if ( src != iobuf )
+   {
+      iobuf->data += nb;
+      iobuf->r_remaining -= (long) nb;
+   }
+   col->num_values = n;
+   col->decoded = 1;
+
+   return 0;
+}
+
+/* Decode the selected columns of a chunk block already read. */
+
+static long read_chunk_columns (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header, sub_header;
+   int icol, icut, any_selected = 0, rc;
+   size_t num_rows;
+
+   item_header.type = IO_TYPE_COLUMN_CHUNK;
+   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
+      return rc;
+   num_rows = (size_t) get_count(iobuf);
+   for ( icol=0; icol<tab->num_columns; icol++ )
+   {
+      tab->column[icol].decoded = 0;
+      if ( tab->column[icol].selected )
+         any_selected = 1;
+   }
+   if ( any_selected )
+      for ( icut=0; icut<tab->num_cuts; icut++ )
+         tab->column[tab->cut[icut].icol].selected = 1;
+
+   while ( next_subitem_type(iobuf) == IO_TYPE_COLUMN_DATA )
+   {
+      sub_header.type = IO_TYPE_COLUMN_DATA;
+      if ( (rc = get_item_begin(iobuf,&sub_header)) < 0 )
+         break;
+      icol = (int) sub_header.ident;
+      if ( icol >= 0 && icol < tab->num_columns &&
+           (!any_selected || tab->column[icol].selected) )
+      {
+         if ( (rc = read_column_data(iobuf,tab,&tab->column[icol],num_rows)) != 0 )
+         {
+            get_item_end(iobuf,&sub_header);
+            get_item_end(iobuf,&item_header);
+            return rc;
+         }
+      }
+      get_item_end(iobuf,&sub_header); /* Skips unselected columns */
+   }
+   get_item_end(iobuf,&item_header);
+
+   tab->num_rows = num_rows;
+   tab->num_chunks++;
+   tab->total_rows += (long) num_rows;
+   return (long) num_rows;
+}
+
+/* ------------------------- read_column_chunk --------------------- */
+/**
+ *  @short Read the next chunk of a table which may pass the cuts.
+ *
+ *  Blocks of other tables and chunks which cannot pass the cuts are
+ *  skipped without reading their data. Only the selected columns
+ *  (or all, if none selected) get decoded, others are marked as not
+ *  decoded.
+ *
+ *  @return Number of rows in the chunk, 0 (end of input), or
+ *          negative (error).
+ */
+
+long read_column_chunk (IO_BUFFER *iobuf, IO_COLUMN_TABLE *tab)
+{
+   IO_ITEM_HEADER item_header;
+   int rc;
+
+   if ( iobuf == (IO_BUFFER *) NULL || tab == NULL )
+      return -1;
+   tab->num_rows = 0;
+
+   while ( find_io_block(iobuf,&item_header) == 0 )
+   {
+      if ( item_header.type != IO_TYPE_COLUMN_STATS ||
+           item_header.ident != tab->table_id )
+      {
+         /* Normally the chunk of another table. */
+         if ( skip_io_block(iobuf,&item_header) != 0 )
+            return -1;
+         continue;
+      }
+      if ( read_io_block(iobuf,&item_header) != 0 ||
+           (rc = chunk_may_pass(iobuf,tab)) < 0 )
+         return -1;
+      if ( find_io_block(iobuf,&item_header) != 0 ||
+           item_header.type != IO_TYPE_COLUMN_CHUNK ||
+           item_header.ident != tab->table_id )
+      {
+         Warning("Column statistics not followed by the corresponding chunk");
+         return -1;
+      }
+      if ( rc == 0 )
+      {
+         tab->chunks_skipped++;
+         if ( skip_io_block(iobuf,&item_header) != 0 )
+            return -1;
+         continue;
+      }
+      if ( read_io_block(iobuf,&item_header) != 0 )
+         return -1;
+      return read_chunk_columns(iobuf,tab);
+   }
+
+   return 0;
+}
+
+/* ------------------------- column_row_passes --------------------- */
+/**
+ *  @short Check if a row of the current chunk passes all cuts.
+ *         For array columns, any value in range is enough.
+ */
+
+int column_row_passes (const IO_COLUMN_TABLE *tab, size_t irow)
+{
+   int icut;
+
+   if ( tab == NULL || irow >= tab->num_rows )
+      return 0;
+   for ( icut=0; icut<tab->num_cuts; icut++ )
+   {
+      const double *v;
+      size_t n, i;
+      int ok = 0;
+      n = get_column_values(tab,tab->cut[icut].icol,irow,&v);
+      for ( i=0; i<n && !ok; i++ )
+         if ( v[i] >= tab->cut[icut].vmin && v[i] <= tab->cut[icut].vmax )
+            ok = 1;
+      if ( !ok )
+         return 0;
+   }
+   return 1;
+}
+
+/* ------------------------- get_column_value ---------------------- */
+/**
+ *  @short Value of a column in a row of the current chunk (for array
+ *         columns the first value), or NaN if not available.
+ */
+
+double get_column_value (const IO_COLUMN_TABLE *tab, int icol, size_t irow)
+{
+   const double *v;
+   if ( get_column_values(tab,icol,irow,&v) < 1 )
+      return NAN;
+   return v[0];
+}
+
+/* ------------------------ get_column_values ---------------------- */
+/**
+ *  @short Values of a column in a row of the current chunk.
+ *
+ *  @return The number of values (0 if not available), with a pointer
+ *          to the first one in *values.
+ */
+
+size_t get_column_values (const IO_COLUMN_TABLE *tab, int icol, size_t irow,
+   const double **values)
+{
+   const IO_COLUMN *col;
+
+   if ( values != NULL )
+      *values = NULL;
+   if ( tab == NULL || values == NULL || icol < 0 || icol >= tab->num_columns ||
+        irow >= tab->num_rows )
+      return 0;
+   col = &tab->column[icol];
+   if ( !col->decoded )
+      return 0;
+   if ( (col->type & COL_ARRAY) )
+   {
+      *values = col->values + col->first[irow];
+      return col->first[irow+1] - col->first[irow];
+   }
+   *values = col->values + irow;
+   return 1;
+}
@@ -41,6 +41,7 @@
 #include "io_basic.h"     /* This file includes others as required. */
 #include "mc_tel.h"
 #include "io_hess.h"
+#include "mem_arena.h"
 #include <assert.h>
 #include <sys/time.h>
 #include <ctype.h>
@@ -81,17 +82,182 @@ void show_hessio_max()
    printf("   H_MAX_GAINS: %d\n\n", H_MAX_GAINS);
 }
 
-static int hs_verbose = -1; /**< Should hessio print_... functions be verbose? */
-static int hs_maxprt = -1;  /**< What is the maximum number of per pixel outputs? */
-static int hs_dynamic = -1; /**< Should be check environment variables each time? */
+/** State of the hessio library which depends on the data stream being
+ *  processed: telescope index lookup tables, print settings, and
+ *  warnings already shown. Each thread starts with its own default
+ *  context; readers interleaving several data streams in one thread
+ *  can switch between contexts with use_hessio_context(). */
+
+struct hessio_context_struct
+{
+   int tel_idx[3][H_MAX_TEL+1]; /**< Telescope ID to index lookup tables */
+   int tel_idx_init[3];  /**< Which of the lookup tables have been set up */
+   int tel_idx_ref;      /**< Lookup table in use, see set_tel_idx_ref() */
+   int verbose;          /**< Should hessio print_... functions be verbose? */
+   int maxprt;           /**< What is the maximum number of per pixel outputs? */
+   int dynamic;          /**< Should be check environment variables each time? */
+   int w_sum, w_samp, w_pixtm, w_pixcal; /**< Warnings about unexpected data shown */
+   int decode_threads;   /**< Threads for decoding telescope data, see set_hessio_decode_threads() */
+   int packed_samples;   /**< Write ADC samples bit-packed, see set_hessio_packed_samples() */
+   struct hs_decode_pool *pool; /**< Worker threads for decoding and encoding, if started */
+};
+
+static void init_hessio_context (HESSIO_CONTEXT *ctx)
+{
+   memset(ctx,0,sizeof(HESSIO_CONTEXT));
+   ctx->verbose = ctx->maxprt = ctx->dynamic = -1;
+   ctx->decode_threads = -1;
+   ctx->packed_samples = -1;
+}
+
+static void stop_decode_pool (HESSIO_CONTEXT *ctx);
+
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+
+#include <pthread.h>
+
+/** What each thread keeps: its own default context and the one in use. */
+struct hessio_thread_specific
+{
+   HESSIO_CONTEXT own;
+   HESSIO_CONTEXT *current;
+};
+
+static pthread_key_t hs_tsd_key;
+static pthread_once_t hs_key_once = PTHREAD_ONCE_INIT;
+
+static void hs_destructor (void *specific)
+{
+   stop_decode_pool(&((struct hessio_thread_specific *) specific)->own);
+   free(specific);
+}
+
+static void hs_func_once (void)
+{
+   pthread_key_create(&hs_tsd_key,hs_destructor);
+}
+
+static struct hessio_thread_specific *get_hs_specific (void)
+{
+   struct hessio_thread_specific *specific;
+
+   if ( pthread_once(&hs_key_once,hs_func_once) != 0 )
+      return NULL;
+   if ( (specific = (struct hessio_thread_specific *)
+           pthread_getspecific(hs_tsd_key)) == NULL )
+   {
+      if ( (specific = (struct hessio_thread_specific *)
+              malloc(sizeof(struct hessio_thread_specific))) == NULL )
+         return NULL;
+      init_hessio_context(&specific->own);
+      specific->current = &specific->own;
+      if ( pthread_setspecific(hs_tsd_key,specific) != 0 )
+      {
+         free(specific);
+         return NULL;
+      }
+   }
+   return specific;
+}
+
+/** The context in use by the calling thread. Without memory for the
+    thread-specific data, all such threads share one fallback context. */
+
+static HESSIO_CONTEXT *hs_ctx (void)
+{
+   static HESSIO_CONTEXT fallback = { {{0}}, {0}, 0, -1, -1, -1, 0, 0, 0, 0, -1, -1, NULL };
+   struct hessio_thread_specific *specific = get_hs_specific();
+   return (specific != NULL) ? specific->current : &fallback;
+}
+
+#else
+
+static HESSIO_CONTEXT hs_default_ctx = { {{0}}, {0}, 0, -1, -1, -1, 0, 0, 0, 0, -1, -1, NULL };
+static HESSIO_CONTEXT *hs_current_ctx = &hs_default_ctx;
+#define hs_ctx() (hs_current_ctx)
+
+#endif
+
+/* ---------------------- allocate_hessio_context ------------------- */
+/**
+ *  @short Create a new context for telescope index lookup etc.,
+ *         initialized as the default context of a new thread.
+ *
+ *  @return  Pointer to the new context or NULL.
+ */
+
+HESSIO_CONTEXT *allocate_hessio_context (void)
+{
+   HESSIO_CONTEXT *ctx = (HESSIO_CONTEXT *) malloc(sizeof(HESSIO_CONTEXT));
+   if ( ctx != NULL )
+      init_hessio_context(ctx);
+   return ctx;
+}
+
+/* ------------------------ free_hessio_context --------------------- */
+/**
+ *  @short Release a context created with allocate_hessio_context().
+ *         It must not be in use by any thread.
+ */
+
+void free_hessio_context (HESSIO_CONTEXT *ctx)
+{
+   if ( ctx == NULL )
+      return;
+   stop_decode_pool(ctx);
+   free(ctx);
+}
+
+/* ------------------------ use_hessio_context ---------------------- */
+/**
+ *  @short Select the context used by the calling thread in all
+ *         following hessio calls, like set_tel_idx(), find_tel_idx(),
+ *         or reading a run header.
+ *
+ *  @param ctx  A context from allocate_hessio_context(), or NULL
+ *              to go back to the default context of the thread.
+ *
+ *  @return The context previously in use.
+ */
+
+HESSIO_CONTEXT *use_hessio_context (HESSIO_CONTEXT *ctx)
+{
+   HESSIO_CONTEXT *previous;
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+   struct hessio_thread_specific *specific = get_hs_specific();
+   if ( specific == NULL )
+      return NULL;
+   previous = specific->current;
+   specific->current = (ctx != NULL) ? ctx : &specific->own;
+#else
+   previous = hs_current_ctx;
+   hs_current_ctx = (ctx != NULL) ? ctx : &hs_default_ctx;
+#endif
+   return previous;
+}
+
+/* ---------------------- current_hessio_context -------------------- */
+/**
+ *  @short The context in use by the calling thread.
+ */
+
+HESSIO_CONTEXT *current_hessio_context (void)
+{
+   return hs_ctx();
+}
+
+#define hs_verbose (hs_ctx()->verbose)
+#define hs_maxprt (hs_ctx()->maxprt)
+#define hs_dynamic (hs_ctx()->dynamic)
 
 /** @short Allow user to override MAX_PRINT_ARRAY and PRINT_VERBOSE settings at a later time */
 
 void hs_reset_env()
 {
-   hs_verbose = -1;
-   hs_maxprt = -1;
-   hs_dynamic = -1;
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   ctx->verbose = -1;
+   ctx->maxprt = -1;
+   ctx->dynamic = -1;
 }
 
 static void hs_check_env(void);
@@ -100,31 +266,28 @@ static void hs_check_env(void);
 
 static void hs_check_env()
 {
+   HESSIO_CONTEXT *ctx = hs_ctx();
    char *s;
-   if ( hs_dynamic == 0 )
+   if ( ctx->dynamic == 0 )
       return;
 
    if ( (s = getenv("PRINT_VERBOSE")) != NULL )
    {
       if ( ! isdigit(*s) )
-         hs_verbose = 1;
+         ctx->verbose = 1;
       else
-         hs_verbose = atoi(s);
+         ctx->verbose = atoi(s);
    }
    if ( (s = getenv("MAX_PRINT_ARRAY")) != NULL )
-      hs_maxprt = atoi(s);
+      ctx->maxprt = atoi(s);
    else
-      hs_maxprt = 20;
-   hs_dynamic = (getenv("PRINT_DYNAMIC")!=NULL) ? 1 : 0;
+      ctx->maxprt = 20;
+   ctx->dynamic = (getenv("PRINT_DYNAMIC")!=NULL) ? 1 : 0;
 }
 
 static void put_time_blob (HTime *t, IO_BUFFER *iobuf);
 static void get_time_blob (HTime *t, IO_BUFFER *iobuf);
 
-static int g_tel_idx[3][H_MAX_TEL+1];
-static int g_tel_idx_init[3];
-static int g_tel_idx_ref;
-
 /* ----------------- set_tel_idx_ref ---------------------- */
 /** 
  *  Switch between multiple telescope lookup tables. 
@@ -142,7 +305,7 @@ static int g_tel_idx_ref;
 void set_tel_idx_ref (int iref)
 {
    if ( iref >= 0 && iref<3 )
-      g_tel_idx_ref = iref;
+      hs_ctx()->tel_idx_ref = iref;
    else
    {
       fprintf(stderr,"Cannot switch to telescope index lookup table %d: out of range.\n", iref);
@@ -164,26 +327,28 @@ void set_tel_idx_ref (int iref)
 
 void set_tel_idx (int ntel, int *idx)
 {
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   int *tel_idx = ctx->tel_idx[ctx->tel_idx_ref];
+   const size_t ntab = sizeof(ctx->tel_idx[0]) / sizeof(ctx->tel_idx[0][0]);
    int i;
-   for (i=0; (size_t)i<sizeof(g_tel_idx[g_tel_idx_ref]) / sizeof(g_tel_idx[g_tel_idx_ref][0]); i++)
-      g_tel_idx[g_tel_idx_ref][i] = -1;
+   for (i=0; (size_t)i<ntab; i++)
+      tel_idx[i] = -1;
    for (i=0; i<ntel; i++)
    {
-      if ( idx[i] < 0 || (size_t) idx[i] >= 
-            sizeof(g_tel_idx[g_tel_idx_ref]) / sizeof(g_tel_idx[g_tel_idx_ref][0]) )
+      if ( idx[i] < 0 || (size_t) idx[i] >= ntab )
       {
          fprintf(stderr,"Telescope ID %d is outside of valid range\n",idx[i]);
          exit(1);
       }
-      if ( g_tel_idx[g_tel_idx_ref][idx[i]] != -1 )
+      if ( tel_idx[idx[i]] != -1 )
       {
          fprintf(stderr,"Multiple telescope ID %d\n",idx[i]);
          fprintf(stderr,"Telescope ID %d is outside of valid range\n",idx[i]);
          exit(1);
       }
-      g_tel_idx[g_tel_idx_ref][idx[i]] = i;
+      tel_idx[idx[i]] = i;
    }
-   g_tel_idx_init[g_tel_idx_ref] = 1;
+   ctx->tel_idx_init[ctx->tel_idx_ref] = 1;
 }
 
 /* -------------------- find_tel_idx -------------------- */
@@ -203,12 +368,13 @@ void set_tel_idx (int ntel, int *idx)
 
 int find_tel_idx (int tel_id)
 {
-   if ( !g_tel_idx_init[g_tel_idx_ref] )
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   if ( !ctx->tel_idx_init[ctx->tel_idx_ref] )
       return -2;
    if ( tel_id < 0 || (size_t)tel_id >= 
-         sizeof(g_tel_idx[g_tel_idx_ref]) / sizeof(g_tel_idx[g_tel_idx_ref][0]) )
+         sizeof(ctx->tel_idx[0]) / sizeof(ctx->tel_idx[0][0]) )
       return -1;
-   return g_tel_idx[g_tel_idx_ref][tel_id];
+   return ctx->tel_idx[ctx->tel_idx_ref][tel_id];
 }
 
 /* -------------------- write_simtel_runheader ---------------------- */
@@ -3361,14 +3527,8 @@ void put_adcsum_differential(uint32_t *adc_sum, int n, IO_BUFFER *iobuf)
 void get_adcsum_differential(uint32_t *adc_sum, int n, IO_BUFFER *iobuf)
 {
    /* New format: store as variable-size integers. */
-   int ipix;
-   int32_t prev_amp = 0, this_amp;
-   for ( ipix=0; ipix<n; ipix++ )
-   {
-      this_amp = get_scount32(iobuf) + prev_amp;
-      prev_amp = this_amp;
-      adc_sum[ipix] = (uint32_t) this_amp;
-   }
+   /* Decoding and summing up is fused in the eventio library function. */
+   get_vector_of_uint32_scount_differential(adc_sum,n,iobuf);
 }
 
 void put_adcsample_differential(uint16_t *adc_sample, int n, IO_BUFFER *iobuf);
@@ -3393,13 +3553,8 @@ void put_adcsample_differential(uint16_t *adc_sample, int n, IO_BUFFER *iobuf)
 void get_adcsample_differential(uint16_t *adc_sample, int n, IO_BUFFER *iobuf)
 {
    /* New format: store as variable-size integers. */
-   int ibin;
-   int32_t prev_amp = 0, this_amp;
-   for ( ibin=0; ibin<n; ibin++ )
-   {
-      adc_sample[ibin] = this_amp = get_scount32(iobuf) + prev_amp;
-      prev_amp = this_amp;
-   }
+   /* Decoding and summing up is fused in the eventio library function. */
+   get_vector_of_uint16_scount_differential(adc_sample,n,iobuf);
 }
 
 /* -------------------- write_simtel_teladc_sums ----------------- */
@@ -3420,9 +3575,7 @@ int write_simtel_teladc_sums (IO_BUFFER *iobuf, AdcData *raw)
    uint32_t lgval[16], hgval[16];
    uint16_t cflags, bflags, zbits;
    uint8_t hgval8[16];
-   int zero_sup_mode = (raw->zero_sup_mode & 0x1f);
-   int data_red_mode = (raw->data_red_mode & 0x1f);
-   int list_known = raw->list_known;
+   int zero_sup_mode, data_red_mode, list_known;
 #ifdef XXDEBUG
    int mlg_tot = 0, mhg16_tot = 0, mhg8_tot = 0, m_tot = 0;
 #endif
@@ -3430,9 +3583,16 @@ int write_simtel_teladc_sums (IO_BUFFER *iobuf, AdcData *raw)
    if ( iobuf == (IO_BUFFER *) NULL || raw == NULL )
       return -1;
 
+   /* Samples read with PROJ_LAZY_SAMPLES may also provide the sums. */
+   if ( (n = decode_adc_samples(raw)) < 0 )
+      return n;
    if ( !raw->known )
       return 0;
 
+   zero_sup_mode = (raw->zero_sup_mode & 0x1f);
+   data_red_mode = (raw->data_red_mode & 0x1f);
+   list_known = raw->list_known;
+
    item_header.type = IO_TYPE_SIMTEL_TELADCSUM;  /* Data type */
    // item_header.version = 1;             /* Version 1 (revised) */
    // if ( raw->num_pixels > 4095 ) /* Strictly needed for large no. of pixels. */
@@ -4793,6 +4953,7 @@ int print_simtel_teladc_sums (IO_BUFFER *iobuf)
  *  hardware tests, where the full information has to be maintained.
  *  If large amounts of sampled data are taken, a suitable
  *  data reduction method should be inserted here.
+ *  See set_hessio_packed_samples() for a more compact encoding.
 */  
 
 int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
@@ -4800,8 +4961,7 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
    IO_ITEM_HEADER item_header;
    uint32_t flags;
    int ipix, igain, ilist;
-   int zero_sup_mode = ((raw->zero_sup_mode & 0x20) >> 5); /* More bits reserved */
-   int data_red_mode = ((raw->data_red_mode & 0x20) != 0 && zero_sup_mode != 0 ? 1 : 0); /* Only 0 and 1 supported, only together with zero-sup. */
+   int zero_sup_mode, data_red_mode;
    int pixel_list[H_MAX_PIX][2], list_size = 0;
 #if ( H_MAX_GAINS >= 2 )
    int pixel_list_lg[H_MAX_PIX][2], list_size_lg = 0;
@@ -4810,9 +4970,15 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
    if ( iobuf == (IO_BUFFER *) NULL || raw == NULL )
       return -1;
 
+   /* Samples read with PROJ_LAZY_SAMPLES are still to be decoded. */
+   if ( (ipix = decode_adc_samples(raw)) < 0 )
+      return ipix;
    if ( !raw->known )
       return 0;
 
+   zero_sup_mode = ((raw->zero_sup_mode & 0x20) >> 5); /* More bits reserved */
+   data_red_mode = ((raw->data_red_mode & 0x20) != 0 && zero_sup_mode != 0 ? 1 : 0); /* Only 0 and 1 supported, only together with zero-sup. */
+
    item_header.type = IO_TYPE_SIMTEL_TELADCSAMP;  /* Data type */
    // item_header.version = 1;             /* Version 1 (revised) */
 
@@ -4822,6 +4988,17 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
    
    if ( data_red_mode > 0 )
       item_header.version = 4;               /* Start support for low-gain suppressed sample-mode data */
+   else
+   {
+      HESSIO_CONTEXT *ctx = hs_ctx();
+      if ( ctx->packed_samples < 0 )
+      {
+         const char *s = getenv("HESSIO_PACKED_SAMPLES");
+         ctx->packed_samples = (s != NULL && atoi(s) != 0) ? 1 : 0;
+      }
+      if ( ctx->packed_samples )
+         item_header.version = 5;            /* Bit-packed samples, without low-gain data reduction */
+   }
 
    if ( raw->num_pixels < 0 || 
         (raw->num_pixels > 4095 && item_header.version < 2) ||
@@ -4830,6 +5007,16 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
       Warning("Unsupported sampled data mode");
       return -1;
    }
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   if ( raw->num_samples > 0 && (raw->adc_sample_buf == NULL ||
+        raw->num_gains > raw->sample_gains ||
+        raw->num_pixels > raw->sample_pixels ||
+        raw->num_samples > raw->sample_stride) )
+   {
+      Warning("No space allocated for the ADC samples to be written");
+      return -1;
+   }
+#endif
 
    /* Bit masks are commented out because range of values was checked */
    /* but left here to indicate range of manageable values. */
@@ -4931,7 +5118,7 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
          /* (which is actually the other way around than for sum data, never mind). */
          for ( ilist=0; ilist<list_size; ilist++ )
             for ( ipix=pixel_list[ilist][0]; ipix<=pixel_list[ilist][1]; ipix++ )
-               put_adcsample_differential(raw->adc_sample[HI_GAIN][ipix],raw->num_samples,iobuf);
+               put_adcsample_differential(ADC_SAMPLES(raw,HI_GAIN,ipix),raw->num_samples,iobuf);
          
 #if ( H_MAX_GAINS >= 2 )
          if ( raw->num_gains > 1 )
@@ -4939,7 +5126,7 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
             /* If necessary write low-gain channel data for high-amplitude significant pixels */
             for ( ilist=0; ilist<list_size_lg; ilist++ )
                for ( ipix=pixel_list_lg[ilist][0]; ipix<=pixel_list_lg[ilist][1]; ipix++ )
-                  put_adcsample_differential(raw->adc_sample[LO_GAIN][ipix],raw->num_samples,iobuf);
+                  put_adcsample_differential(ADC_SAMPLES(raw,LO_GAIN,ipix),raw->num_samples,iobuf);
          }
 #endif
       }
@@ -4948,25 +5135,80 @@ int write_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw)
          for (igain=0; igain<raw->num_gains; igain++) /* Also here first HG (0), then LG (1) if there is any */
             for ( ilist=0; ilist<list_size; ilist++ )
                for ( ipix=pixel_list[ilist][0]; ipix<=pixel_list[ilist][1]; ipix++ )
-                  put_adcsample_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               {
+                  if ( item_header.version >= 5 )
+                     put_vector_of_uint16_packed(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
+                  else
+                     put_adcsample_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
+               }
       }
    }
    else if ( item_header.version < 3 ) /* No zero-sup (and no data red.), old version) */
    {
       for (igain=0; igain<raw->num_gains; igain++) /* First HG (0), then LG (1) if there is any */
          for (ipix=0; ipix<raw->num_pixels; ipix++)
-            put_vector_of_uint16(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+            put_vector_of_uint16(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
+   }
+   else if ( item_header.version < 5 ) /* No zero-sup (and no data red.), newer version) */
+   {
+      for (igain=0; igain<raw->num_gains; igain++) /* First HG (0), then LG (1) if there is any */
+         for (ipix=0; ipix<raw->num_pixels; ipix++)
+            put_adcsample_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
    }
-   else /* No zero-sup (and no data red.), newer version) */
+   else /* No zero-sup, bit-packed samples */
    {
       for (igain=0; igain<raw->num_gains; igain++) /* First HG (0), then LG (1) if there is any */
          for (ipix=0; ipix<raw->num_pixels; ipix++)
-            put_adcsample_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+            put_vector_of_uint16_packed(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
    }
 
    return put_item_end(iobuf,&item_header);
 }
 
+static void get_pixel_ranges (int pixel_list[][2], int list_size, IO_BUFFER *iobuf);
+
+/** Read a list of pixel ranges, where single pixels are stored as -ipix-1. */
+
+static void get_pixel_ranges (int pixel_list[][2], int list_size, IO_BUFFER *iobuf)
+{
+   int ilist, ipix1;
+   for ( ilist=0; ilist<list_size; ilist++ )
+   {
+      ipix1 = get_scount32(iobuf);
+      if ( ipix1 < 0 ) /* Single pixel */
+         pixel_list[ilist][0] = pixel_list[ilist][1] = -ipix1 - 1;
+      else /* pixel range */
+      {
+         pixel_list[ilist][0] = ipix1;
+         pixel_list[ilist][1] = get_scount32(iobuf);
+      }
+   }
+}
+
+static void mark_samples_dirty (AdcData *raw, int first, int end);
+
+/** Extend the range of pixels with samples to be cleared by adc_reset(). */
+
+static void mark_samples_dirty (AdcData *raw, int first, int end)
+{
+   if ( first < 0 )
+      first = 0;
+   if ( end > H_MAX_PIX )
+      end = H_MAX_PIX;
+   if ( first >= end )
+      return;
+   if ( raw->dirty_first >= raw->dirty_end )
+   {
+      raw->dirty_first = first;
+      raw->dirty_end = end;
+      return;
+   }
+   if ( first < raw->dirty_first )
+      raw->dirty_first = first;
+   if ( end > raw->dirty_end )
+      raw->dirty_end = end;
+}
+
 /* -------------------- read_simtel_teladc_samples ----------------- */
 /**
  *  Read sampled ADC data in eventio format.
@@ -4987,10 +5229,11 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
    // raw->known = 0; /* We may have read the ADC sums before */
 
    raw->num_pixels = 0;
+   raw->slice_known = 0;
    item_header.type = IO_TYPE_SIMTEL_TELADCSAMP;  /* Data type */
    if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
       return rc;
-   if ( item_header.version > 3 )
+   if ( item_header.version > 5 || item_header.version == 4 )
    {
       fprintf(stderr,"Unsupported ADC samples version: %d.\n",
          item_header.version);
@@ -5047,9 +5290,7 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
 
    raw->num_samples = get_short(iobuf);
 
-   if ( raw->num_pixels > H_MAX_PIX ||
-        raw->num_gains > H_MAX_GAINS ||
-        raw->num_samples > H_MAX_SLICES )
+   if ( alloc_adc_samples(raw,raw->num_gains,raw->num_pixels,raw->num_samples) != 0 )
    {
       Warning("Invalid raw data block is skipped (limits exceeded).");
       fprintf(stderr,"Num_pixels=%d, num_gains=%d, num_samples=%d\n",
@@ -5061,7 +5302,7 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
 
    if ( zero_sup_mode )
    {
-      int ilist, ipix1, ipix2;
+      int ilist;
       int pixel_list[H_MAX_PIX][2], list_size = 0;
 #if ( H_MAX_GAINS >= 2 )
       int pixel_list_lg[H_MAX_PIX][2], list_size_lg = 0;
@@ -5084,19 +5325,9 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
          return -1;
       }
 
+      get_pixel_ranges(pixel_list,list_size,iobuf);
       for ( ilist=0; ilist<list_size; ilist++ )
-      {
-         ipix1 = get_scount(iobuf);
-         if ( ipix1 < 0 ) /* Single pixel */
-         {
-            ipix2 = -ipix1 - 1;
-            ipix1 = ipix2;
-         }
-         else /* pixel range */
-            ipix2 = get_scount(iobuf);
-         pixel_list[ilist][0] = ipix1;
-         pixel_list[ilist][1] = ipix2;
-      }
+         mark_samples_dirty(raw,pixel_list[ilist][0],pixel_list[ilist][1]+1);
 
 #if ( H_MAX_GAINS >= 2 )
       /* Read low-gain pixel list if needed. */
@@ -5109,24 +5340,14 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
             get_item_end(iobuf,&item_header);
             return -1;
          }
+         get_pixel_ranges(pixel_list_lg,list_size_lg,iobuf);
          for ( ilist=0; ilist<list_size_lg; ilist++ )
-         {
-            ipix1 = get_scount(iobuf);
-            if ( ipix1 < 0 ) /* Single pixel */
-            {
-               ipix2 = -ipix1 - 1;
-               ipix1 = ipix2;
-            }
-            else /* pixel range */
-               ipix2 = get_scount(iobuf);
-            pixel_list_lg[ilist][0] = ipix1;
-            pixel_list_lg[ilist][1] = ipix2;
-         }
+            mark_samples_dirty(raw,pixel_list_lg[ilist][0],pixel_list_lg[ilist][1]+1);
          for ( ilist=0; ilist<list_size; ilist++ )
          {
             for ( ipix=pixel_list[ilist][0]; ipix<=pixel_list[ilist][1]; ipix++ )
             {
-               get_vector_of_uint16_scount_differential(raw->adc_sample[HI_GAIN][ipix],raw->num_samples,iobuf);
+               get_vector_of_uint16_scount_differential(ADC_SAMPLES(raw,HI_GAIN,ipix),raw->num_samples,iobuf);
                raw->significant[ipix] |= 0x20;
                raw->adc_known[HI_GAIN][ipix] |= 2;
             }
@@ -5134,7 +5355,7 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
          for ( ilist=0; ilist<list_size_lg; ilist++ )
             for ( ipix=pixel_list_lg[ilist][0]; ipix<=pixel_list_lg[ilist][1]; ipix++ )
             {
-               get_vector_of_uint16_scount_differential(raw->adc_sample[LO_GAIN][ipix],raw->num_samples,iobuf);
+               get_vector_of_uint16_scount_differential(ADC_SAMPLES(raw,LO_GAIN,ipix),raw->num_samples,iobuf);
                raw->adc_known[LO_GAIN][ipix] |= 2;
             }
          if ( (what & RAWSUM_FLAG) )
@@ -5150,10 +5371,13 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
          {
             for ( ipix=pixel_list[ilist][0]; ipix<=pixel_list[ilist][1]; ipix++ )
             {
+               if ( item_header.version >= 5 )
+                  get_vector_of_uint16_packed(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
+               else
 #ifdef OLD_CODE
-               get_adcsample_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               get_adcsample_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
 #else
-               get_vector_of_uint16_scount_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               get_vector_of_uint16_scount_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
 #endif
                raw->significant[ipix] |= 0x20;
                
@@ -5165,7 +5389,7 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
                      /* Sum up all samples */
                      sum = 0;
                      for (isamp=0; isamp<raw->num_samples; isamp++)
-                        sum += raw->adc_sample[igain][ipix][isamp];
+                        sum += ADC_SAMPLES(raw,igain,ipix)[isamp];
 #if 1
                      raw->adc_sum[igain][ipix] = sum; /* No overflow of 32-bit unsigned assumed */
 #else                /* Back in the days when adc_sum was a 16-bit unsigned int */
@@ -5187,17 +5411,20 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
    }
    else /* No (sample data) zero suppression, no data reduction, no pixel lists. */
    {
+      mark_samples_dirty(raw,0,raw->num_pixels);
       for (igain=0; igain<raw->num_gains; igain++)
       {
          for (ipix=0; ipix<raw->num_pixels; ipix++)
          {
             if ( item_header.version < 3 )
-               get_vector_of_uint16(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               get_vector_of_uint16(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
+            else if ( item_header.version >= 5 )
+               get_vector_of_uint16_packed(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
             else
 #ifdef OLD_CODE
-               get_adcsample_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               get_adcsample_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
 #else
-               get_vector_of_uint16_scount_differential(raw->adc_sample[igain][ipix],raw->num_samples,iobuf);
+               get_vector_of_uint16_scount_differential(ADC_SAMPLES(raw,igain,ipix),raw->num_samples,iobuf);
 #endif
 
             /* Should the sampled data be summed up here? If there is preceding sum data, we keep that. */
@@ -5210,7 +5437,7 @@ int read_simtel_teladc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
                   /* Sum up all samples */
                   sum = 0;
                   for (isamp=0; isamp<raw->num_samples; isamp++)
-                     sum += raw->adc_sample[igain][ipix][isamp];
+                     sum += ADC_SAMPLES(raw,igain,ipix)[isamp];
 #if 1
                   raw->adc_sum[igain][ipix] = sum; /* No overflow of 32-bit unsigned assumed */
 #else             /* Back in the days when adc_sum was a 16-bit unsigned int */
@@ -5256,7 +5483,7 @@ int print_simtel_teladc_samples (IO_BUFFER *iobuf)
    item_header.type = IO_TYPE_SIMTEL_TELADCSAMP;  /* Data type */
    if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
       return rc;
-   if ( item_header.version > 4 )
+   if ( item_header.version > 5 )
    {
       fprintf(stderr,"Unsupported ADC samples version: %d.\n",
          item_header.version);
@@ -5312,7 +5539,7 @@ int print_simtel_teladc_samples (IO_BUFFER *iobuf)
 
       if ( zero_sup_mode )
       {
-         int ilist, ipix1, ipix2, kpix;
+         int ilist, kpix;
          int pixel_list[H_MAX_PIX][2], list_size = 0;
          list_size = get_scount32(iobuf);
          if ( list_size > H_MAX_PIX )
@@ -5321,23 +5548,14 @@ int print_simtel_teladc_samples (IO_BUFFER *iobuf)
             get_item_end(iobuf,&item_header);
             return -1;
          }
-         for ( ilist=0; ilist<list_size; ilist++ )
-         {
-            ipix1 = get_scount(iobuf);
-            if ( ipix1 < 0 ) /* Single pixel */
-            {
-               ipix2 = -ipix1 - 1;
-               ipix1 = ipix2;
-            }
-            else /* pixel range */
-               ipix2 = get_scount(iobuf);
-            pixel_list[ilist][0] = ipix1;
-            pixel_list[ilist][1] = ipix2;
-         }
+         get_pixel_ranges(pixel_list,list_size,iobuf);
          for (igain=0; igain<num_gains; igain++)
             for ( ilist=0, kpix=0; ilist<list_size; ilist++ )
                for ( ipix=pixel_list[ilist][0]; (int)ipix<=pixel_list[ilist][1]; ipix++ )
                {
+                  if ( item_header.version >= 5 )
+                     get_vector_of_uint16_packed(adc_sample,num_samples,iobuf);
+                  else
 #ifdef OLD_CODE
                   get_adcsample_differential(adc_sample,num_samples,iobuf);
 #else
@@ -5365,6 +5583,8 @@ int print_simtel_teladc_samples (IO_BUFFER *iobuf)
             {
                if ( item_header.version < 3 )
                   get_vector_of_uint16(adc_sample,num_samples,iobuf);
+               else if ( item_header.version >= 5 )
+                  get_vector_of_uint16_packed(adc_sample,num_samples,iobuf);
                else
 #ifdef OLD_CODE
                   get_adcsample_differential(adc_sample,num_samples,iobuf);
@@ -5391,139 +5611,674 @@ int print_simtel_teladc_samples (IO_BUFFER *iobuf)
    return get_item_end(iobuf,&item_header);
 }
 
-/* -------------------------------- adc_reset ------------------------- */
+/* ------------------------ malloc_aligned64 ------------------------ */
+/**
+ *  Memory aligned to 64 bytes (cache lines and the widest vector
+ *  registers), with the pointer from malloc() kept just before the
+ *  aligned block. Must be released with free_aligned64().
+ */
 
-static void adc_reset (AdcData *raw);
+static void *malloc_aligned64 (size_t size)
+{
+   void *mem = malloc(size + 64 + sizeof(void *));
+   uintptr_t p;
+   if ( mem == NULL )
+      return NULL;
+   p = ((uintptr_t) mem + sizeof(void *) + 63) & ~(uintptr_t) 63;
+   ((void **) p)[-1] = mem;
+   return (void *) p;
+}
 
-static void adc_reset (AdcData *raw)
+static void free_aligned64 (void *ptr)
 {
-   int ipix, igain;
-//   int is;
-   size_t nb;
-   if ( raw == NULL )
-      return;
-   raw->known = 0;
-   raw->list_known = 0;
-   raw->list_size = 0;
-   nb = raw->num_samples * sizeof(raw->adc_sample[0][0][0]);
-   for (igain=0; igain<raw->num_gains; igain++)
-   {
-      for (ipix=0; ipix<raw->num_pixels; ipix++)
-      {
-         raw->significant[ipix] = 0;
-         raw->adc_known[igain][ipix] = 0;
-         raw->adc_sum[igain][ipix] = 0;
-//         /* Traditionally resetting samples one by one */
-//         for (is=0; is<raw->num_samples; is++)
-//            raw->adc_sample[igain][ipix][is] = 0;
-         /* At the typical length of traces, memset is a bit faster than 
-            resetting the samples one by one. */
-         memset(&raw->adc_sample[igain][ipix][0],0,nb);
-      }
-   }
+   if ( ptr != NULL )
+      free(((void **) ptr)[-1]);
 }
 
-/* -------------------- write_simtel_aux_trace_digital ----------------- */
+/* ------------------------- alloc_adc_samples ------------------------ */
 /**
- *  @short Write auxiliary digitized traces.
+ *  @short Make sure that ADC data has space for samples of given size.
  *
- *  There is no data reduction for auxiliary traces.
- *  
-*/  
+ *  With HESSIO_DYNAMIC_SAMPLES defined, the space for sample-mode data
+ *  is sized from the data actually used rather than for the compile-time
+ *  maximum numbers of gains, pixels and samples. The layout is compact,
+ *  with the samples of each pixel following each other without padding
+ *  and the whole block aligned to 64 bytes. The memory only ever grows;
+ *  when the layout changes, all samples are reset to zero.
+ *  Without HESSIO_DYNAMIC_SAMPLES, only the limits are checked.
+ *
+ *  @param raw          The ADC data to be filled.
+ *  @param num_gains    The number of gains needed.
+ *  @param num_pixels   The number of pixels needed.
+ *  @param num_samples  The number of samples per pixel needed.
+ *
+ *  @return 0 (O.k.), -1 (limits exceeded or out of memory)
+ */
 
-int write_simtel_aux_trace_digital (IO_BUFFER *iobuf, AuxTraceD *auxd)
+int alloc_adc_samples (AdcData *raw, int num_gains, int num_pixels, int num_samples)
 {
-   IO_ITEM_HEADER item_header;
-   size_t it;
-   
-   if ( iobuf == (IO_BUFFER *) NULL )
-      return -1;
-
-   if ( auxd == NULL )
+   if ( raw == NULL )
       return -1;
-   if ( ! auxd->known || auxd->trace_data == NULL )
+   if ( num_gains < 0 || num_pixels < 0 || num_samples < 0 ||
+        num_gains > H_MAX_GAINS || num_pixels > H_MAX_PIX || num_samples > H_MAX_SLICES )
       return -1;
-   if ( auxd->trace_type <= 0 || auxd->trace_type > MAX_AUX_TRACE_D )
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   if ( raw->adc_sample_buf == NULL ||
+        num_gains != raw->sample_gains ||
+        num_pixels != raw->sample_pixels ||
+        num_samples != raw->sample_stride )
    {
-      fprintf(stderr, "Digital auxiliary trace type %d for telescope %d is out of range.\n",
-         auxd->trace_type, auxd->tel_id);
-      return -4;
+      size_t n = num_gains * (size_t) num_pixels * (size_t) num_samples;
+      if ( n == 0 )
+         return 0; /* Nothing to be stored yet */
+      if ( n > raw->sample_capacity || raw->adc_sample_buf == NULL )
+      {
+         uint16_t *buf;
+         if ( (buf = (uint16_t *) malloc_aligned64(n*sizeof(uint16_t))) == NULL )
+         {
+            Warning("Not enough memory for ADC samples");
+            return -1;
+         }
+         free_aligned64(raw->adc_sample_buf);
+         raw->adc_sample_buf = buf;
+         raw->sample_capacity = n;
+      }
+      memset(raw->adc_sample_buf,0,n*sizeof(uint16_t));
+      raw->dirty_first = raw->dirty_end = 0;
+      raw->sample_gains = num_gains;
+      raw->sample_pixels = num_pixels;
+      raw->sample_stride = num_samples;
+      raw->slice_known = 0;
    }
+#endif
+   return 0;
+}
 
-   item_header.type = IO_TYPE_SIMTEL_AUX_DIGITAL_TRACE;  /* Data type */
-   item_header.version = 0;
-   item_header.ident = auxd->trace_type;
+/* Release the buffers of ADC data allocated separately from the structure. */
 
-   put_item_begin(iobuf,&item_header);
+static void release_adc_buffers (AdcData *raw)
+{
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   free_aligned64(raw->adc_sample_buf);
+   raw->adc_sample_buf = NULL;
+   raw->sample_capacity = 0;
+#endif
+   free_aligned64(raw->slice_buf);
+   raw->slice_buf = NULL;
+   raw->slice_capacity = 0;
+   if ( raw->pending_samples != NULL )
+      free_io_buffer(raw->pending_samples);
+   raw->pending_samples = NULL;
+}
 
-   put_long(auxd->tel_id,iobuf);
-   put_real(auxd->time_scale,iobuf);
-   put_count(auxd->num_traces,iobuf);
-   put_count(auxd->len_traces,iobuf);
-   
-   for ( it=0; it<auxd->num_traces; it++ )
-      put_vector_of_uint16_scount_differential(auxd->trace_data+it*auxd->len_traces,auxd->len_traces,iobuf);
+/* --------------------------- free_adc_data -------------------------- */
+/**
+ *  @short Release ADC data allocated with malloc() or calloc(),
+ *         including any sample storage allocated separately.
+ */
 
-   return put_item_end(iobuf,&item_header);
+void free_adc_data (AdcData *raw)
+{
+   if ( raw == NULL )
+      return;
+   release_adc_buffers(raw);
+   free(raw);
 }
 
-/* -------------------- read_simtel_aux_trace_digital ----------------- */
+/* ------------------------ alloc_hess_run_data ----------------------- */
 /**
- *  @short Read auxiliary digitized traces.
+ *  @short Set up the per-telescope sub-structures for a new run.
  *
-*/  
+ *  After the run header was read, the telescope IDs are filled into all
+ *  per-telescope structures, and the requested kinds of dynamic
+ *  sub-structures of the telescope event data get allocated together
+ *  from the memory arena attached to the data (created on first use).
+ *  Structures of a previous run are released before. The arena memory
+ *  is kept from run to run, so with the same configuration the same
+ *  memory is used again, without new allocations or page faults.
+ *  With the environment variable HESSIO_HUGE_PAGES set to a non-zero
+ *  value, the arena is backed by huge pages where available.
+ *
+ *  Sub-structures set up this way must not be freed individually;
+ *  use release_hess_run_data() or free_hess_run_data() instead.
+ *
+ *  @param hsdata  The data, with the run header already filled in.
+ *  @param parts   Bit pattern of HS_ALLOC_... flags.
+ *
+ *  @return 0 (o.k.), -1 (error), -2 (not enough memory)
+ */
 
-int read_simtel_aux_trace_digital (IO_BUFFER *iobuf, AuxTraceD *auxd)
+int alloc_hess_run_data (AllHessData *hsdata, int parts)
 {
-   IO_ITEM_HEADER item_header;
-   size_t it, nt, lt;
-   int rc;
-   
-   if ( iobuf == (IO_BUFFER *) NULL )
-      return -1;
+   size_t need;
+   int itel, ntel;
 
-   if ( auxd == NULL )
+   if ( hsdata == NULL )
       return -1;
-   auxd->known = 0;
-
-   item_header.type = IO_TYPE_SIMTEL_AUX_DIGITAL_TRACE;  /* Data type */
-   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
-      return rc;
-   if ( item_header.version > 0 )
+   ntel = hsdata->run_header.ntel;
+   if ( ntel < 0 || ntel > H_MAX_TEL )
    {
-      fprintf(stderr,"Unsupported auxiliary digitized traces version: %d.\n",
-         item_header.version);
-      get_item_end(iobuf,&item_header);
+      Warning("Invalid number of telescopes for run data");
       return -1;
    }
+   release_hess_run_data(hsdata);
 
-   auxd->trace_type = item_header.ident;
-   if ( auxd->trace_type <= 0 || auxd->trace_type > MAX_AUX_TRACE_D )
+   if ( hsdata->arena == NULL )
    {
-      fprintf(stderr, "Digital auxiliary trace type %d for telescope %d is out of range.\n",
-         auxd->trace_type, auxd->tel_id);
+      const char *s = getenv("HESSIO_HUGE_PAGES");
+      int flags = (s != NULL && atoi(s) != 0) ? MEM_ARENA_HUGE_PAGES : 0;
+      if ( (hsdata->arena = allocate_mem_arena(0,flags)) == NULL )
+         return -2;
    }
+   /* Everything in one go (with some margin for alignment). */
+   need = 0;
+   if ( (parts & HS_ALLOC_RAW) )
+      need += sizeof(AdcData) + 64;
+   if ( (parts & HS_ALLOC_PIXTM) )
+      need += sizeof(PixelTiming) + 64;
+   if ( (parts & HS_ALLOC_IMG) )
+      need += 2*sizeof(ImgData) + 64;
+   if ( (parts & HS_ALLOC_PIXCAL) )
+      need += sizeof(PixelCalibrated) + 64;
+   if ( reserve_mem_arena(hsdata->arena,ntel*need) != 0 )
+      return -2;
 
-   auxd->tel_id = get_long(iobuf);
-   auxd->time_scale = get_real(iobuf);
-   nt = get_count(iobuf);
-   lt = get_count(iobuf);
-   
-   if ( nt != auxd->num_traces || lt != auxd->len_traces || auxd->trace_data == NULL )
+   hsdata->event.num_tel = ntel;
+   for (itel=0; itel<ntel; itel++)
    {
-      if ( auxd->trace_data != NULL )
-         free(auxd->trace_data);
-      auxd->trace_data = (uint16_t *) malloc(nt*lt*sizeof(uint16_t));
-      if ( auxd->trace_data == NULL )
+      int tel_id = hsdata->run_header.tel_id[itel];
+      TelEvent *te = &hsdata->event.teldata[itel];
+
+      hsdata->camera_set[itel].tel_id = tel_id;
+      hsdata->camera_org[itel].tel_id = tel_id;
+      hsdata->pixel_set[itel].tel_id = tel_id;
+      hsdata->pixel_disabled[itel].tel_id = tel_id;
+      hsdata->cam_soft_set[itel].tel_id = tel_id;
+      hsdata->tracking_set[itel].tel_id = tel_id;
+      hsdata->point_cor[itel].tel_id = tel_id;
+      hsdata->event.trackdata[itel].tel_id = tel_id;
+      hsdata->tel_moni[itel].tel_id = tel_id;
+      hsdata->tel_lascal[itel].tel_id = tel_id;
+      te->tel_id = tel_id;
+
+      if ( (parts & HS_ALLOC_RAW) )
       {
-         fprintf(stderr,
-            "Failed to allocate memory for %zu * %zu auxiliary digitized trace values.\n",
-            nt, lt);
-         get_item_end(iobuf,&item_header);
-         return -1;
+         if ( (te->raw = (AdcData *) mem_arena_calloc(hsdata->arena,1,sizeof(AdcData))) == NULL )
+            return -2;
+         te->raw->tel_id = tel_id;
+      }
+      if ( (parts & HS_ALLOC_PIXTM) )
+      {
+         if ( (te->pixtm = (PixelTiming *) mem_arena_calloc(hsdata->arena,1,sizeof(PixelTiming))) == NULL )
+            return -2;
+         te->pixtm->tel_id = tel_id;
+      }
+      if ( (parts & HS_ALLOC_IMG) )
+      {
+         if ( (te->img = (ImgData *) mem_arena_calloc(hsdata->arena,2,sizeof(ImgData))) == NULL )
+            return -2;
+         te->max_image_sets = 2;
+         te->img[0].tel_id = tel_id;
+         te->img[1].tel_id = tel_id;
+      }
+      if ( (parts & HS_ALLOC_PIXCAL) )
+      {
+         if ( (te->pixcal = (PixelCalibrated *) mem_arena_calloc(hsdata->arena,1,sizeof(PixelCalibrated))) == NULL )
+            return -2;
+         te->pixcal->tel_id = tel_id;
+      }
+   }
+
+   return 0;
+}
+
+/* ----------------------- release_hess_run_data ---------------------- */
+/**
+ *  @short Release the per-telescope sub-structures of a run set up
+ *         with alloc_hess_run_data(), keeping the arena memory for
+ *         the next run.
+ *
+ *  Sample buffers allocated separately for the ADC data and the data
+ *  of auxiliary traces get freed as well, and so do calibrated pixel
+ *  data structures allocated only when such data was found.
+ */
+
+void release_hess_run_data (AllHessData *hsdata)
+{
+   int itel, ntel, k;
+
+   if ( hsdata == NULL )
+      return;
+   ntel = hsdata->event.num_tel;
+   if ( hsdata->run_header.ntel > ntel )
+      ntel = hsdata->run_header.ntel;
+   if ( ntel > H_MAX_TEL )
+      ntel = H_MAX_TEL;
+
+   for (itel=0; itel<ntel; itel++)
+   {
+      TelEvent *te = &hsdata->event.teldata[itel];
+      for ( k=0; k<MAX_AUX_TRACE_D; k++ )
+      {
+         free(te->aux_trace_d[k].trace_data);
+         te->aux_trace_d[k].trace_data = NULL;
+         te->aux_trace_d[k].num_traces = te->aux_trace_d[k].len_traces = 0;
+         te->aux_trace_d[k].known = 0;
+      }
+      for ( k=0; k<MAX_AUX_TRACE_A; k++ )
+      {
+         free(te->aux_trace_a[k].trace_data);
+         te->aux_trace_a[k].trace_data = NULL;
+         te->aux_trace_a[k].num_traces = te->aux_trace_a[k].len_traces = 0;
+         te->aux_trace_a[k].known = 0;
+      }
+      if ( hsdata->arena == NULL )
+         continue; /* Nothing else was set up here. */
+      if ( te->raw != NULL )
+         release_adc_buffers(te->raw);
+      te->raw = NULL;
+      te->pixtm = NULL;
+      te->img = NULL;
+      /* Calibrated pixel data may also have been allocated when found. */
+      if ( te->pixcal != NULL && !mem_arena_owns(hsdata->arena,te->pixcal) )
+         free(te->pixcal);
+      te->pixcal = NULL;
+      te->num_image_sets = te->max_image_sets = 0;
+   }
+   reset_mem_arena(hsdata->arena);
+}
+
+/* ------------------------- free_hess_run_data ----------------------- */
+/**
+ *  @short Release the per-telescope sub-structures of a run and give
+ *         the arena memory back to the system.
+ */
+
+void free_hess_run_data (AllHessData *hsdata)
+{
+   if ( hsdata == NULL )
+      return;
+   release_hess_run_data(hsdata);
+   free_mem_arena(hsdata->arena);
+   hsdata->arena = NULL;
+}
+
+/* --------------------------- adc_slice_major -------------------------- */
+/**
+ *  @short A slice-major view of the ADC samples of one gain.
+ *
+ *  The samples of all pixels for the same slice follow each other,
+ *  as needed for processing many pixels at once, with each slice
+ *  starting at a multiple of 64 bytes. The element for slice isamp
+ *  and pixel ipix is at ADC_SLICE(view,raw,isamp)[ipix].
+ *  The view is a copy, built on first request after reading (or
+ *  decoding pending) samples. Code modifying the samples in other ways than reading
+ *  them must reset raw->slice_known to zero.
+ *  Building it is a full pass over the samples, more than a single
+ *  fixed-window sum costs, so it only pays off for repeated use.
+ *
+ *  @param raw    The ADC data with samples.
+ *  @param igain  The gain channel.
+ *
+ *  @return Pointer to the view or NULL (no samples, or out of memory).
+ */
+
+const uint16_t *adc_slice_major (AdcData *raw, int igain)
+{
+   size_t stride, n;
+   uint16_t *view;
+   int ipix, jpix, isamp;
+
+   /* Samples read with PROJ_LAZY_SAMPLES are decoded first. */
+   if ( decode_adc_samples(raw) < 0 )
+      return NULL;
+   if ( raw == NULL || (raw->known & 2) == 0 || igain < 0 || 
+        igain >= raw->num_gains || raw->num_samples <= 0 || raw->num_pixels <= 0 )
+      return NULL;
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   if ( raw->adc_sample_buf == NULL )
+      return NULL;
+#endif
+
+   stride = ADC_SLICE_STRIDE(raw);
+   n = stride * (size_t) raw->num_samples;
+   if ( raw->slice_buf == NULL || raw->slice_capacity < n*raw->num_gains )
+   {
+      free_aligned64(raw->slice_buf);
+      raw->slice_capacity = 0;
+      raw->slice_known = 0;
+      if ( (raw->slice_buf = (uint16_t *) 
+             malloc_aligned64(n*raw->num_gains*sizeof(uint16_t))) == NULL )
+      {
+         Warning("Not enough memory for slice-major ADC samples");
+         return NULL;
+      }
+      raw->slice_capacity = n*raw->num_gains;
+   }
+   view = raw->slice_buf + igain*n;
+   if ( (raw->slice_known & (1<<igain)) != 0 )
+      return view;
+
+   /* Transpose in blocks of 32 pixels, with the destination lines staying in cache. */
+   for ( jpix=0; jpix<raw->num_pixels; jpix+=32 )
+   {
+      int npb = (raw->num_pixels-jpix < 32) ? raw->num_pixels-jpix : 32;
+      for ( ipix=jpix; ipix<jpix+npb; ipix++ )
+      {
+         const uint16_t *src = ADC_SAMPLES(raw,igain,ipix);
+         uint16_t *dst = view + ipix;
+         for ( isamp=0; isamp<raw->num_samples; isamp++ )
+            dst[isamp*stride] = src[isamp];
       }
-      auxd->num_traces = nt;
-      auxd->len_traces = lt;
+   }
+   raw->slice_known |= (1<<igain);
+
+   return view;
+}
+
+/* -------------------------------- adc_reset ------------------------- */
+
+static void adc_reset (AdcData *raw);
+
+static void adc_reset (AdcData *raw)
+{
+   int ipix, igain, end;
+//   int is;
+   size_t nb;
+   if ( raw == NULL )
+      return;
+   raw->known = 0;
+   raw->pending_what = 0;
+   raw->list_known = 0;
+   raw->list_size = 0;
+   raw->slice_known = 0;
+   nb = raw->num_samples * sizeof(ADC_SAMPLES(raw,0,0)[0]);
+   end = raw->dirty_end;
+#ifdef HESSIO_DYNAMIC_SAMPLES
+   /* Nothing stored outside of the allocated space. */
+   if ( raw->adc_sample_buf == NULL || raw->num_samples > raw->sample_stride ||
+        raw->num_pixels > raw->sample_pixels || raw->num_gains > raw->sample_gains )
+      nb = 0;
+   if ( end > raw->sample_pixels )
+      end = raw->sample_pixels;
+#endif
+   for (igain=0; igain<raw->num_gains; igain++)
+   {
+      for (ipix=0; ipix<raw->num_pixels; ipix++)
+      {
+         raw->significant[ipix] = 0;
+         raw->adc_known[igain][ipix] = 0;
+         raw->adc_sum[igain][ipix] = 0;
+      }
+//      /* Traditionally resetting samples one by one */
+//      for (is=0; is<raw->num_samples; is++)
+//         ADC_SAMPLES(raw,igain,ipix)[is] = 0;
+      /* At the typical length of traces, memset is a bit faster than 
+         resetting the samples one by one. Only pixels for which samples
+         were stored can have any (typically few with zero suppression). */
+      if ( nb > 0 )
+         for (ipix=raw->dirty_first; ipix<end; ipix++)
+            memset(&ADC_SAMPLES(raw,igain,ipix)[0],0,nb);
+   }
+   raw->dirty_first = raw->dirty_end = 0;
+}
+
+/* ---------------------------- copy_subitem ------------------------- */
+/**
+ *  @short Copy the next sub-item into a private I/O buffer (allocated
+ *         if needed), from where it can be read like a block just read.
+ */
+
+static int copy_subitem (IO_BUFFER *iobuf, IO_BUFFER **pbuf, unsigned long type)
+{
+   IO_ITEM_HEADER item_header;
+   IO_BUFFER *buf2;
+   int rc;
+
+   if ( (buf2 = *pbuf) == NULL )
+   {
+      long len = next_subitem_length(iobuf);
+      if ( (buf2 = allocate_io_buffer(len > 0 ? (size_t) len + 32 : 1000)) == NULL )
+         return -2;
+      buf2->msg_ext = 0; /* Growing it as needed is normal here */
+      *pbuf = buf2;
+   }
+   buf2->max_length = iobuf->max_length;
+
+   item_header.type = type;
+   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
+      return rc;
+   rc = copy_item_to_io_block(buf2,iobuf,&item_header);
+   get_item_end(iobuf,&item_header);
+   if ( rc < 0 )
+      return rc;
+
+   /* Keep the buffer at the size needed, rather than shrinking it for each event. */
+   buf2->min_length = buf2->buflen;
+   buf2->data_pending = 0; /* As after read_io_block() */
+
+   return 0;
+}
+
+/* ---------------------------- keep_adc_samples ----------------------- */
+/**
+ *  @short Copy an ADC samples sub-item for later decoding instead of
+ *         decoding it right away (see decode_adc_samples()).
+ */
+
+static int keep_adc_samples (IO_BUFFER *iobuf, AdcData *raw, int what)
+{
+   int rc = copy_subitem(iobuf,&raw->pending_samples,IO_TYPE_SIMTEL_TELADCSAMP);
+   if ( rc == 0 )
+   {
+      raw->pending_what = what | RAWDATA_FLAG;
+      raw->slice_known = 0; /* Any slice-major view is from older samples */
+   }
+   return rc;
+}
+
+/* --------------------------- decode_adc_samples ---------------------- */
+/**
+ *  @short Decode ADC samples kept undecoded when reading with PROJ_LAZY_SAMPLES.
+ *
+ *  With that bit in the parts of an EventProjection, the samples sub-item
+ *  of a telescope event is only copied and marked as pending (see
+ *  ADC_SAMPLES_PENDING()). Bit 1 of raw->known, the samples, and the
+ *  sums, adc_known and significant bits derived from them are only
+ *  filled in by this function. Code accessing them should call it first;
+ *  without pending samples it does nothing. Events rejected before that
+ *  never pay for decoding the samples.
+ *
+ *  @return 0 (o.k. or nothing pending), <0 (error decoding the samples)
+ */
+
+int decode_adc_samples (AdcData *raw)
+{
+   int rc, known, what;
+
+   if ( raw == NULL )
+      return -1;
+   if ( !ADC_SAMPLES_PENDING(raw) )
+      return 0;
+
+   what = raw->pending_what;
+   raw->pending_what = 0;
+   known = raw->known;
+   if ( known == 0 )  /* No sum data preceding the samples */
+      adc_reset(raw);
+   rc = read_simtel_teladc_samples(raw->pending_samples,raw,what);
+   raw->known = known | (rc == 0 ? 2 : 0);
+
+   return rc;
+}
+
+/* ----------------------------- hs_event_recycle ----------------------- */
+/**
+ *  @short Prepare the event data for reading the next event, clearing
+ *         only what the previous event(s) actually filled in.
+ *
+ *  Only telescopes for which data was read since the last call are
+ *  touched. Their raw data is reset as with reading new data, where
+ *  the samples (by far the largest part) are only cleared for the range
+ *  of pixels for which any were stored; the pixel lists are emptied and
+ *  all other parts are marked as not known. With sparse telescope
+ *  participation and zero-suppressed samples, this is much less than
+ *  clearing all per-telescope data. Samples stored by other code than
+ *  the readers here should be accompanied by extending the
+ *  dirty_first ... dirty_end range of the AdcData.
+ *
+ *  @return Number of telescopes recycled, or -1 (no data).
+ */
+
+int hs_event_recycle (AllHessData *hsdata)
+{
+   FullEvent *ev;
+   int itel, ntel, j, n = 0;
+
+   if ( hsdata == NULL )
+      return -1;
+   ev = &hsdata->event;
+   ntel = (ev->num_tel < H_MAX_TEL) ? ev->num_tel : H_MAX_TEL;
+
+   for ( itel=0; itel<ntel; itel++ )
+   {
+      TelEvent *te = &ev->teldata[itel];
+      ev->trackdata[itel].raw_known = ev->trackdata[itel].cor_known = 0;
+      if ( !te->dirty )
+         continue;
+      te->known = 0;
+      te->readout_mode = 0;
+      te->num_list_trgsect = 0;
+      te->known_time_trgsect = 0;
+      if ( te->raw != NULL )
+         adc_reset(te->raw);
+      if ( te->pixtm != NULL )
+         te->pixtm->known = 0;
+      if ( te->pixcal != NULL )
+         te->pixcal->known = 0;
+      if ( te->img != NULL )
+         for ( j=0; j<te->num_image_sets; j++ )
+            te->img[j].known = 0;
+      te->trigger_pixels.pixels = 0;
+      te->image_pixels.pixels = 0;
+      te->pixeltrg_time.known = 0;
+      te->pixeltrg_time.num_times = 0;
+      for ( j=0; j<MAX_AUX_TRACE_D; j++ )
+         te->aux_trace_d[j].known = 0;
+      for ( j=0; j<MAX_AUX_TRACE_A; j++ )
+         te->aux_trace_a[j].known = 0;
+      te->dirty = 0;
+      n++;
+   }
+
+   ev->central.num_teltrg = ev->central.num_teldata = 0;
+   ev->num_teldata = 0;
+   ev->shower.known = 0;
+
+   return n;
+}
+
+/* -------------------- write_simtel_aux_trace_digital ----------------- */
+/**
+ *  @short Write auxiliary digitized traces.
+ *
+ *  There is no data reduction for auxiliary traces.
+ *  
+*/  
+
+int write_simtel_aux_trace_digital (IO_BUFFER *iobuf, AuxTraceD *auxd)
+{
+   IO_ITEM_HEADER item_header;
+   size_t it;
+   
+   if ( iobuf == (IO_BUFFER *) NULL )
+      return -1;
+
+   if ( auxd == NULL )
+      return -1;
+   if ( ! auxd->known || auxd->trace_data == NULL )
+      return -1;
+   if ( auxd->trace_type <= 0 || auxd->trace_type > MAX_AUX_TRACE_D )
+   {
+      fprintf(stderr, "Digital auxiliary trace type %d for telescope %d is out of range.\n",
+         auxd->trace_type, auxd->tel_id);
+      return -4;
+   }
+
+   item_header.type = IO_TYPE_SIMTEL_AUX_DIGITAL_TRACE;  /* Data type */
+   item_header.version = 0;
+   item_header.ident = auxd->trace_type;
+
+   put_item_begin(iobuf,&item_header);
+
+   put_long(auxd->tel_id,iobuf);
+   put_real(auxd->time_scale,iobuf);
+   put_count(auxd->num_traces,iobuf);
+   put_count(auxd->len_traces,iobuf);
+   
+   for ( it=0; it<auxd->num_traces; it++ )
+      put_vector_of_uint16_scount_differential(auxd->trace_data+it*auxd->len_traces,auxd->len_traces,iobuf);
+
+   return put_item_end(iobuf,&item_header);
+}
+
+/* -------------------- read_simtel_aux_trace_digital ----------------- */
+/**
+ *  @short Read auxiliary digitized traces.
+ *
+*/  
+
+int read_simtel_aux_trace_digital (IO_BUFFER *iobuf, AuxTraceD *auxd)
+{
+   IO_ITEM_HEADER item_header;
+   size_t it, nt, lt;
+   int rc;
+   
+   if ( iobuf == (IO_BUFFER *) NULL )
+      return -1;
+
+   if ( auxd == NULL )
+      return -1;
+   auxd->known = 0;
+
+   item_header.type = IO_TYPE_SIMTEL_AUX_DIGITAL_TRACE;  /* Data type */
+   if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
+      return rc;
+   if ( item_header.version > 0 )
+   {
+      fprintf(stderr,"Unsupported auxiliary digitized traces version: %d.\n",
+         item_header.version);
+      get_item_end(iobuf,&item_header);
+      return -1;
+   }
+
+   auxd->trace_type = item_header.ident;
+   if ( auxd->trace_type <= 0 || auxd->trace_type > MAX_AUX_TRACE_D )
+   {
+      fprintf(stderr, "Digital auxiliary trace type %d for telescope %d is out of range.\n",
+         auxd->trace_type, auxd->tel_id);
+   }
+
+   auxd->tel_id = get_long(iobuf);
+   auxd->time_scale = get_real(iobuf);
+   nt = get_count(iobuf);
+   lt = get_count(iobuf);
+   
+   if ( nt != auxd->num_traces || lt != auxd->len_traces || auxd->trace_data == NULL )
+   {
+      if ( auxd->trace_data != NULL )
+         free(auxd->trace_data);
+      auxd->trace_data = (uint16_t *) malloc(nt*lt*sizeof(uint16_t));
+      if ( auxd->trace_data == NULL )
+      {
+         fprintf(stderr,
+            "Failed to allocate memory for %zu * %zu auxiliary digitized trace values.\n",
+            nt, lt);
+         get_item_end(iobuf,&item_header);
+         return -1;
+      }
+      auxd->num_traces = nt;
+      auxd->len_traces = lt;
    }
    
    for ( it=0; it<auxd->num_traces; it++ )
@@ -6520,10 +7275,7 @@ int write_simtel_pixcalib (IO_BUFFER *iobuf, PixelCalibrated *pixcal)
       }
    }
    else if ( pixcal->list_known == 2 )
-   {
-      for (ipix=0; ipix<pixcal->num_pixels; ipix++)
-         put_sfloat(pixcal->pixel_pe[ipix],iobuf);
-   }
+      put_vector_of_sfloat(pixcal->pixel_pe,pixcal->num_pixels,iobuf);
 
    return put_item_end(iobuf,&item_header);
 }
@@ -6601,10 +7353,7 @@ int read_simtel_pixcalib (IO_BUFFER *iobuf, PixelCalibrated *pixcal)
       }
    }
    else if ( pixcal->list_known == 2 ) /* all pixels significant */
-   {
-      for (ipix=0; ipix<pixcal->num_pixels; ipix++)
-         pixcal->pixel_pe[ipix] = get_sfloat(iobuf);
-   }
+      get_vector_of_sfloat(pixcal->pixel_pe,pixcal->num_pixels,iobuf);
    
    pixcal->known = 1;
 
@@ -7138,7 +7887,13 @@ int write_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
    raw = te->raw;
    img = te->img;
 
-   /* Raw data is optional. */
+   /* Raw data is optional. Samples may still be pending (PROJ_LAZY_SAMPLES). */
+   if ( raw != NULL && (what & (RAWDATA_FLAG|RAWSUM_FLAG)) != 0 &&
+        (rc = decode_adc_samples(raw)) < 0 )
+   {
+      unput_item(iobuf,&item_header); /* Nothing to be written */
+      return rc;
+   }
    if ( raw != NULL && raw->known && (what & (RAWDATA_FLAG|RAWSUM_FLAG)) != 0 )
    {
       if ( (te->readout_mode & 0xff) && (what & RAWDATA_FLAG) ) /* readout_mode is normally 0 (sum) or 1 (samples) or >=2 (both) */
@@ -7279,12 +8034,111 @@ int write_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
    return put_item_end(iobuf,&item_header);
 }
 
+/* ----------------------- init_event_projection ------------------------ */
+/**
+ *  @short Set up an event projection equivalent to a plain 'what' selection.
+ *
+ *  All telescopes are selected and all kinds of sub-items which
+ *  read_simtel_event() would decode with the same 'what' flags.
+ *  Kinds not needed can then be removed from proj->parts and
+ *  telescopes be selected with add_projection_telescope().
+ */
+
+void init_event_projection (EventProjection *proj, int what)
+{
+   if ( proj == NULL )
+      return;
+   proj->what = what;
+   proj->parts = PROJ_ALL;
+   if ( (what & (RAWDATA_FLAG|RAWSUM_FLAG)) == 0 )
+      proj->parts &= ~PROJ_ADC_SUMS;
+   if ( (what & RAWDATA_FLAG) == 0 )
+      proj->parts &= ~PROJ_ADC_SAMPLES;
+   if ( (what & TIME_FLAG) == 0 )
+      proj->parts &= ~PROJ_PIXEL_TIMING;
+   if ( (what & IMAGE_FLAG) == 0 )
+      proj->parts &= ~PROJ_IMAGE;
+   proj->num_tel = 0;
+}
+
+/* --------------------- add_projection_telescope ---------------------- */
+/**
+ *  @short Add a telescope to those selected by an event projection.
+ *
+ *  As long as no telescope was added, data of all telescopes is decoded.
+ *
+ *  @return 0 (OK), -1 (invalid or too many telescopes)
+ */
+
+int add_projection_telescope (EventProjection *proj, int tel_id)
+{
+   if ( proj == NULL || tel_id < 0 )
+      return -1;
+   if ( projection_has_telescope(proj,tel_id) && proj->num_tel > 0 )
+      return 0;
+   if ( proj->num_tel >= H_MAX_TEL )
+   {
+      Warning("Too many telescopes selected in event projection");
+      return -1;
+   }
+   proj->tel_id[proj->num_tel++] = tel_id;
+   return 0;
+}
+
+/* --------------------- projection_has_telescope ---------------------- */
+/**
+ *  @short Check if data of a telescope is to be decoded with a projection.
+ *
+ *  @return 1 (selected), 0 (not selected)
+ */
+
+int projection_has_telescope (const EventProjection *proj, int tel_id)
+{
+   int j;
+   if ( proj == NULL || proj->num_tel <= 0 )
+      return 1;
+   for ( j=0; j<proj->num_tel; j++ )
+      if ( proj->tel_id[j] == tel_id )
+         return 1;
+   return 0;
+}
+
+static int read_televent_parts (IO_BUFFER *iobuf, TelEvent *te, int what, int parts);
+
 /* ----------------------- read_simtel_televent ------------------------ */
 /**
  *  Read data for one telescope camera in eventio format.
 */  
 
 int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
+{
+   return read_televent_parts(iobuf,te,what,PROJ_ALL);
+}
+
+/* ------------------ read_simtel_televent_projected ------------------- */
+/**
+ *  @short Read data for one telescope camera, decoding only the
+ *         kinds of sub-items selected in the projection.
+ *
+ *  Other sub-items are skipped silently. The telescope selection of the
+ *  projection is not checked here but in read_simtel_event_projected().
+ */
+
+int read_simtel_televent_projected (IO_BUFFER *iobuf, TelEvent *te, 
+   const EventProjection *proj)
+{
+   if ( proj == NULL )
+      return -1;
+   return read_televent_parts(iobuf,te,proj->what,proj->parts);
+}
+
+/* ----------------------- read_televent_parts ------------------------ */
+/**
+ *  Read data for one telescope camera in eventio format, with only
+ *  those sub-items decoded which are both in 'parts' and in 'what'.
+*/  
+
+static int read_televent_parts (IO_BUFFER *iobuf, TelEvent *te, int what, int parts)
 {
    IO_ITEM_HEADER item_header, sub_item_header;
    int rc;
@@ -7293,7 +8147,7 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
    int tel_id;
    int tel_img = 0;
    int iaux;
-   static int w_sum=0, w_samp=0, w_pixtm=0, w_pixcal=0;
+   HESSIO_CONTEXT *ctx = hs_ctx(); /* For warnings shown only once */
 
    if ( iobuf == (IO_BUFFER *) NULL || te == NULL )
       return -1;
@@ -7323,9 +8177,13 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
    }
 
    te->glob_count = item_header.ident;
+   te->dirty = 1;
 
    if ( (raw = te->raw) != NULL )
+   {
       raw->known = 0;
+      raw->pending_what = 0;
+   }
    if ( te->pixtm != NULL )
       te->pixtm->known = 0;
    if ( (img = te->img) != NULL )
@@ -7354,9 +8212,14 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
       switch ( nt )
       {
          case IO_TYPE_SIMTEL_TELADCSUM:
+            if ( (parts & PROJ_ADC_SUMS) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( (what & (RAWDATA_FLAG|RAWSUM_FLAG)) == 0 || raw == NULL )
             {
-               if ( w_sum++ < 1 )
+               if ( ctx->w_sum++ < 1 )
                   Warning("Telescope raw data ADC sums not selected to be read");
                rc = skip_subitem(iobuf);
                continue;
@@ -7369,9 +8232,14 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_TELADCSAMP:
+            if ( (parts & PROJ_ADC_SAMPLES) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( (what & RAWDATA_FLAG) == 0 || raw == NULL )
             {
-               if ( w_samp++ < 1 )
+               if ( ctx->w_samp++ < 1 )
                   Warning("Telescope raw data ADC samples not selected to be read");
                rc = skip_subitem(iobuf);
                continue;
@@ -7380,21 +8248,28 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
                te->readout_mode = 2; /* sum + samples (perhaps different zero suppression) */
             else
             {
-               adc_reset(raw); /* Do we need that? */
+               if ( (parts & PROJ_LAZY_SAMPLES) == 0 )
+                  adc_reset(raw); /* Do we need that? */
                te->readout_mode = 1; /* ADC samples, sums usually rebuilt */
             }
-            rc = read_simtel_teladc_samples(iobuf,raw,what);
-            if ( rc == 0 )
-            {
+            /* Lazy samples stay pending, without bit 1 in raw->known,
+               until decode_adc_samples() is called. */
+            if ( (parts & PROJ_LAZY_SAMPLES) != 0 )
+               rc = keep_adc_samples(iobuf,raw,what);
+            else if ( (rc = read_simtel_teladc_samples(iobuf,raw,what)) == 0 )
                raw->known |= 2;
-            }
             raw->tel_id = te->tel_id; /* For IDs beyond 31, bits may be missing (?) */
             break;
 
          case IO_TYPE_SIMTEL_PIXELTIMING:
+            if ( (parts & PROJ_PIXEL_TIMING) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( te->pixtm == NULL || (what & TIME_FLAG) == 0 )
             {
-               if ( w_pixtm++ < 1 )
+               if ( ctx->w_pixtm++ < 1 )
                   Warning("Telescope pixel timing data not selected to be read");
                rc = skip_subitem(iobuf);
                continue;
@@ -7405,9 +8280,14 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_PIXELCALIB:
+            if ( (parts & PROJ_PIXEL_CALIB) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( te->pixcal == NULL )
             {
-               if ( w_pixcal++ < 1 )
+               if ( ctx->w_pixcal++ < 1 )
                   Warning("Telescope calibrated pixel intensities found, allocating structures.");
                if ( (te->pixcal = 
                       (PixelCalibrated *) calloc(1,sizeof(PixelCalibrated))) == NULL )
@@ -7423,6 +8303,11 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_TELIMAGE:
+            if ( (parts & PROJ_IMAGE) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( img == NULL || (what & IMAGE_FLAG) == 0 )
                break;
             if ( tel_img >= te->max_image_sets )
@@ -7445,6 +8330,11 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             long id = sub_item_header.ident = next_subitem_ident(iobuf);
             int code = id / 1000000;
             int tid  = id % 1000000;
+            if ( (parts & PROJ_PIXEL_LISTS) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             if ( code == 0 && tid == te->tel_id )
             {
                if ( (rc = read_simtel_pixel_list(iobuf,&te->trigger_pixels,&tid)) < 0 )
@@ -7487,6 +8377,11 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_PIXELTRG_TM:
+            if ( (parts & PROJ_PIXELTRG_TIME) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             te->pixeltrg_time.tel_id = te->tel_id;
             if ( ( rc = read_simtel_pixeltrg_time(iobuf,&te->pixeltrg_time) ) < 0 )
             {
@@ -7497,6 +8392,11 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_AUX_DIGITAL_TRACE:
+            if ( (parts & PROJ_AUX_TRACES) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             iaux = next_subitem_ident(iobuf);
             if ( iaux > 0 && iaux <= MAX_AUX_TRACE_D )
             {
@@ -7515,6 +8415,11 @@ int read_simtel_televent (IO_BUFFER *iobuf, TelEvent *te, int what)
             break;
 
          case IO_TYPE_SIMTEL_AUX_ANALOG_TRACE:
+            if ( (parts & PROJ_AUX_TRACES) == 0 )
+            {
+               rc = skip_subitem(iobuf);
+               continue;
+            }
             iaux = next_subitem_ident(iobuf);
             if ( iaux > 0 && iaux <= MAX_AUX_TRACE_A )
             {
@@ -7933,6 +8838,12 @@ int print_simtel_shower (IO_BUFFER *iobuf)
    return get_item_end(iobuf,&item_header);
 }
 
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+static struct hs_decode_pool *get_decode_pool (void);
+static int encode_telescopes (struct hs_decode_pool *pool, IO_BUFFER *iobuf, 
+   FullEvent *ev, int what);
+#endif
+
 /* --------------------- write_simtel_event -------------------- */
 /**
  *  @short Write the full array data of one event in eventio format.
@@ -7946,6 +8857,9 @@ int write_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
 {
    IO_ITEM_HEADER item_header;
    int j, rc=0;
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+   struct hs_decode_pool *pool = NULL;
+#endif
 
    if ( iobuf == (IO_BUFFER *) NULL || ev == NULL )
       return -1;
@@ -7992,6 +8906,20 @@ int write_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
    /* Raw and/or image data is written on demand only */
    if ( (what & (IMAGE_FLAG | RAWDATA_FLAG | RAWSUM_FLAG | TIME_FLAG)) )
    {
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+      /* Telescopes encoded in parallel, if enabled, but appended in the same order */
+      if ( ev->num_tel > 1 && (pool = get_decode_pool()) != NULL )
+      {
+         rc = encode_telescopes(pool,iobuf,ev,what);
+         if ( rc != 0 )
+         {
+            Warning("Abort write_simtel_event() due to problem in write_simtel_televent()\n");
+            unput_item(iobuf,&item_header);
+            return rc;
+         }
+      }
+      else
+#endif
       for (j=0; j<ev->num_tel; j++)
       {
          if ( ev->teldata[j].known )
@@ -8039,18 +8967,405 @@ int write_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
    return put_item_end(iobuf,&item_header);
 }
 
+static int read_event_parts (IO_BUFFER *iobuf, FullEvent *ev, int what, 
+   const EventProjection *proj);
+
 /* --------------------- read_simtel_event -------------------- */
 /**
  *  Read the full array data of one event in eventio format.
 */  
 
 int read_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
+{
+   return read_event_parts(iobuf,ev,what,NULL);
+}
+
+/* --------------------- read_simtel_event_projected -------------------- */
+/**
+ *  @short Read the array data of one event in eventio format, decoding
+ *         only the telescopes and kinds of sub-items selected.
+ *
+ *  Everything else is skipped at the level of item headers. Telescopes
+ *  not selected are not marked as known and not included in the list
+ *  of telescopes with data, as if their data had not been there.
+ *  The central event data is always decoded.
+*/  
+
+int read_simtel_event_projected (IO_BUFFER *iobuf, FullEvent *ev, 
+   const EventProjection *proj)
+{
+   if ( proj == NULL )
+      return -1;
+   return read_event_parts(iobuf,ev,proj->what,proj);
+}
+
+/* --------------------- set_hessio_decode_threads -------------------- */
+/**
+ *  @short Set the number of threads decoding (or encoding) the telescope
+ *         data of one event in read_simtel_event() and variants
+ *         (or write_simtel_event()).
+ *
+ *  With more than one thread, the telescope event sub-items are first
+ *  copied to private I/O buffers while the central event, tracking and
+ *  shower data are read as before, and then decoded concurrently, with
+ *  the calling thread taking part. The setting applies to the hessio
+ *  context in use by the calling thread (see use_hessio_context()).
+ *  The same threads encode the telescope event items in
+ *  write_simtel_event(), each into a private I/O buffer, and these
+ *  are then appended in the original order, for unchanged output.
+ *  Without any setting, the environment variable HESSIO_DECODE_THREADS
+ *  is checked. In builds without thread support, data is always
+ *  decoded sequentially.
+ *
+ *  @param nthreads  Number of threads, 0 or 1 for sequential decoding.
+ *
+ *  @return The previous setting (-1 for not yet set).
+ */
+
+int set_hessio_decode_threads (int nthreads)
+{
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   int previous = ctx->decode_threads;
+   ctx->decode_threads = (nthreads > 0) ? nthreads : 0;
+   return previous;
+}
+
+/* --------------------- set_hessio_packed_samples -------------------- */
+/**
+ *  @short Select if write_simtel_teladc_samples() stores the ADC samples
+ *         bit-packed (item version 5) instead of with variable-length
+ *         differential encoding.
+ *
+ *  With packing, the samples of each pixel and gain are stored relative
+ *  to their minimum with the number of bits needed for the largest
+ *  difference, which is usually more compact for traces with noise
+ *  and much faster to decode. Older readers cannot read such data.
+ *  Data with low-gain data reduction is always written as before.
+ *  The setting applies to the hessio context in use by the calling
+ *  thread. Without any setting, the environment variable
+ *  HESSIO_PACKED_SAMPLES is checked.
+ *
+ *  @param on  Non-zero for bit-packed samples.
+ *
+ *  @return The previous setting (-1 for not yet set).
+ */
+
+int set_hessio_packed_samples (int on)
+{
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   int previous = ctx->packed_samples;
+   ctx->packed_samples = (on != 0);
+   return previous;
+}
+
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+
+/** Decoding (or encoding) of one telescope event in a worker thread. */
+struct hs_decode_task
+{
+   TelEvent *te;        /**< Where the data goes (or comes from). */
+   IO_BUFFER *iobuf;    /**< Private copy of the telescope event item. */
+   IO_ITEM_HEADER item_header; /**< Enclosing item in iobuf when encoding */
+   int rc;              /**< Result of decoding. */
+   int deferred;        /**< Same TelEvent as an earlier task: decode afterwards, in order */
+};
+
+/** Worker threads and tasks for decoding (or encoding) telescope events of one event. */
+struct hs_decode_pool
+{
+   int nthreads;        /**< Number of worker threads (not counting the caller) */
+   pthread_t *threads;
+   pthread_mutex_t mlock;
+   pthread_cond_t start; /**< Signalled when there are new tasks or to stop */
+   pthread_cond_t done;  /**< Signalled when all tasks are finished */
+   int stop;            /**< Set to tell the worker threads to finish */
+   int what, parts;     /**< What to decode in all tasks */
+   int encode;          /**< Tasks are for writing rather than reading */
+   int packed_samples;  /**< Setting of the calling thread when encoding */
+   int ntasks;          /**< Number of tasks of the current event */
+   int next;            /**< Next task to be taken */
+   int finished;        /**< Number of tasks finished */
+   struct hs_decode_task task[H_MAX_TEL];
+   IO_BUFFER *buf[H_MAX_TEL]; /**< Re-used across events */
+};
+
+/* --------------------- run_decode_tasks -------------------- */
+/**
+ *  Take and decode (or encode) tasks until there are no more. To be
+ *  called with the pool mutex locked. Returns with the mutex locked.
+ */
+
+static void run_decode_tasks (struct hs_decode_pool *pool)
+{
+   while ( pool->next < pool->ntasks )
+   {
+      struct hs_decode_task *t = &pool->task[pool->next++];
+      int what = pool->what, parts = pool->parts;
+      int encode = pool->encode, packed_samples = pool->packed_samples;
+      pthread_mutex_unlock(&pool->mlock);
+      if ( encode )
+      {
+         /* Same encoding options as in the thread writing the event */
+         hs_ctx()->packed_samples = packed_samples;
+         t->rc = write_simtel_televent(t->iobuf,t->te,what);
+      }
+      else if ( !t->deferred )
+         t->rc = read_televent_parts(t->iobuf,t->te,what,parts);
+      pthread_mutex_lock(&pool->mlock);
+      if ( ++pool->finished == pool->ntasks )
+         pthread_cond_broadcast(&pool->done);
+   }
+}
+
+static void *decode_worker (void *arg)
+{
+   struct hs_decode_pool *pool = (struct hs_decode_pool *) arg;
+
+   pthread_mutex_lock(&pool->mlock);
+   while ( !pool->stop )
+   {
+      if ( pool->next < pool->ntasks )
+         run_decode_tasks(pool);
+      else
+         pthread_cond_wait(&pool->start,&pool->mlock);
+   }
+   pthread_mutex_unlock(&pool->mlock);
+
+   return NULL;
+}
+
+/* --------------------- stop_decode_pool -------------------- */
+/**
+ *  Stop the worker threads of a context and release their buffers.
+ */
+
+static void stop_decode_pool (HESSIO_CONTEXT *ctx)
+{
+   struct hs_decode_pool *pool = ctx->pool;
+   int i;
+
+   if ( pool == NULL )
+      return;
+   pthread_mutex_lock(&pool->mlock);
+   pool->stop = 1;
+   pthread_cond_broadcast(&pool->start);
+   pthread_mutex_unlock(&pool->mlock);
+   for ( i=0; i<pool->nthreads; i++ )
+      pthread_join(pool->threads[i],NULL);
+   for ( i=0; i<H_MAX_TEL; i++ )
+      if ( pool->buf[i] != NULL )
+         free_io_buffer(pool->buf[i]);
+   pthread_mutex_destroy(&pool->mlock);
+   pthread_cond_destroy(&pool->start);
+   pthread_cond_destroy(&pool->done);
+   free(pool->threads);
+   free(pool);
+   ctx->pool = NULL;
+}
+
+/* --------------------- get_decode_pool -------------------- */
+/**
+ *  The pool of worker threads of the current context, started if
+ *  parallel decoding is selected, or NULL for sequential decoding.
+ */
+
+static struct hs_decode_pool *get_decode_pool (void)
+{
+   HESSIO_CONTEXT *ctx = hs_ctx();
+   struct hs_decode_pool *pool;
+   int i;
+
+   if ( ctx->decode_threads < 0 )
+   {
+      const char *s = getenv("HESSIO_DECODE_THREADS");
+      ctx->decode_threads = (s != NULL && atoi(s) > 0) ? atoi(s) : 0;
+   }
+   if ( ctx->decode_threads <= 1 )
+   {
+      if ( ctx->pool != NULL )
+         stop_decode_pool(ctx);
+      return NULL;
+   }
+   if ( ctx->pool != NULL && ctx->pool->nthreads == ctx->decode_threads-1 )
+      return ctx->pool;
+   stop_decode_pool(ctx);
+
+   if ( (pool = (struct hs_decode_pool *) calloc(1,sizeof(struct hs_decode_pool))) == NULL ||
+        (pool->threads = (pthread_t *) calloc(ctx->decode_threads-1,sizeof(pthread_t))) == NULL )
+   {
+      Warning("Not enough memory for decoding threads");
+      free(pool);
+      ctx->decode_threads = 0;
+      return NULL;
+   }
+   pthread_mutex_init(&pool->mlock,NULL);
+   pthread_cond_init(&pool->start,NULL);
+   pthread_cond_init(&pool->done,NULL);
+   ctx->pool = pool;
+   for ( i=0; i<ctx->decode_threads-1; i++ )
+   {
+      if ( pthread_create(&pool->threads[i],NULL,decode_worker,pool) != 0 )
+      {
+         Warning("Failed to start decoding thread");
+         break;
+      }
+      pool->nthreads++;
+   }
+   if ( pool->nthreads == 0 )
+   {
+      stop_decode_pool(ctx);
+      ctx->decode_threads = 0;
+      return NULL;
+   }
+   /* With fewer threads than requested, make that the setting. */
+   ctx->decode_threads = pool->nthreads + 1;
+
+   return pool;
+}
+
+/* --------------------- decode_telescopes -------------------- */
+/**
+ *  Decode all telescope event items copied for the current event,
+ *  with the calling thread taking part.
+ */
+
+static void decode_telescopes (struct hs_decode_pool *pool, int ntasks, 
+   int what, int parts)
+{
+   pthread_mutex_lock(&pool->mlock);
+   pool->what = what;
+   pool->parts = parts;
+   pool->encode = 0;
+   pool->ntasks = ntasks;
+   pool->next = pool->finished = 0;
+   pthread_cond_broadcast(&pool->start);
+   run_decode_tasks(pool);
+   while ( pool->finished < pool->ntasks )
+      pthread_cond_wait(&pool->done,&pool->mlock);
+   pool->ntasks = pool->next = pool->finished = 0;
+   pthread_mutex_unlock(&pool->mlock);
+}
+
+/* --------------------- rewind_encode_buffer -------------------- */
+/**
+ *  Drop whatever an encoding buffer holds, without releasing its memory.
+ *  Explicitly, since unput_item() depends on the state left behind by
+ *  the previous use (the buffers are also used for decoding).
+ */
+
+static void rewind_encode_buffer (IO_BUFFER *buf2)
+{
+   buf2->item_level = 0;
+   buf2->data = buf2->buffer;
+   buf2->r_remaining = buf2->w_remaining = -1L;
+}
+
+/* --------------------- encode_telescopes -------------------- */
+/**
+ *  Write the telescope event items of all telescopes with data into
+ *  private buffers, with the calling thread taking part, and then
+ *  append them to the event item in the order of the telescopes.
+ */
+
+static int encode_telescopes (struct hs_decode_pool *pool, IO_BUFFER *iobuf, 
+   FullEvent *ev, int what)
+{
+   int ntasks = 0, itask, j, rc = 0;
+
+   for (j=0; j<ev->num_tel && ntasks<H_MAX_TEL; j++)
+   {
+      struct hs_decode_task *t = &pool->task[ntasks];
+      IO_BUFFER *buf2;
+      if ( !ev->teldata[j].known )
+         continue;
+      if ( (buf2 = pool->buf[ntasks]) == NULL )
+      {
+         if ( (buf2 = allocate_io_buffer(100000)) == NULL )
+         {
+            rc = -2;
+            break;
+         }
+         buf2->msg_ext = 0; /* Growing it as needed is normal here */
+         pool->buf[ntasks] = buf2;
+      }
+      rewind_encode_buffer(buf2);
+      buf2->max_length = iobuf->max_length;
+      buf2->byte_order = iobuf->byte_order;
+      buf2->extended = iobuf->extended;
+      /* The enclosing item is never finished, only its sub-item gets appended. */
+      t->item_header.type = IO_TYPE_SIMTEL_EVENT;
+      t->item_header.version = 0;
+      t->item_header.ident = 0;
+      if ( (rc = put_item_begin(buf2,&t->item_header)) != 0 )
+      {
+         rewind_encode_buffer(buf2);
+         break;
+      }
+      t->te = &ev->teldata[j];
+      t->iobuf = buf2;
+      t->rc = 0;
+      t->deferred = 0;
+      ntasks++;
+   }
+
+   if ( rc == 0 )
+   {
+      pthread_mutex_lock(&pool->mlock);
+      pool->what = what;
+      pool->encode = 1;
+      pool->packed_samples = hs_ctx()->packed_samples;
+      pool->ntasks = ntasks;
+      pool->next = pool->finished = 0;
+      pthread_cond_broadcast(&pool->start);
+      run_decode_tasks(pool);
+      while ( pool->finished < pool->ntasks )
+         pthread_cond_wait(&pool->done,&pool->mlock);
+      pool->ntasks = pool->next = pool->finished = 0;
+      pthread_mutex_unlock(&pool->mlock);
+   }
+
+   /* Append in telescope order and release the enclosing items in any case. */
+   for ( itask=0; itask<ntasks; itask++ )
+   {
+      struct hs_decode_task *t = &pool->task[itask];
+      if ( rc == 0 && (rc = t->rc) == 0 )
+         rc = append_io_sub_items(iobuf,t->iobuf);
+      rewind_encode_buffer(t->iobuf);
+   }
+
+   return rc;
+}
+
+#else
+
+static void stop_decode_pool (HESSIO_CONTEXT *ctx)
+{
+   ctx->pool = NULL;
+}
+
+#endif
+
+/* --------------------- read_event_parts -------------------- */
+/**
+ *  Read the array data of one event, with an optional projection.
+*/  
+
+static int read_event_parts (IO_BUFFER *iobuf, FullEvent *ev, int what, 
+   const EventProjection *proj)
 {
    IO_ITEM_HEADER item_header;
    int type, tel_id, itel, id, rc, j;
+   int parts = (proj != NULL) ? proj->parts : PROJ_ALL;
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+   struct hs_decode_pool *pool = NULL;
+   int ntasks = 0;
+#endif
 
    if ( iobuf == (IO_BUFFER *) NULL || ev == NULL )
       return -1;
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+   pool = get_decode_pool();
+#endif
       
    item_header.type = IO_TYPE_SIMTEL_EVENT;  /* Data type */
    if ( (rc = get_item_begin(iobuf,&item_header)) < 0 )
@@ -8102,6 +9417,16 @@ int read_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
       {
          tel_id = (type - IO_TYPE_SIMTEL_TRACKEVENT)%100 +
                   100*((type-IO_TYPE_SIMTEL_TRACKEVENT)/1000);
+         if ( (parts & PROJ_TRACKING) == 0 || 
+              !projection_has_telescope(proj,tel_id) )
+         {
+            if ( (rc = skip_subitem(iobuf)) < 0 )
+            {
+               get_item_end(iobuf,&item_header);
+               return rc;
+            }
+            continue;
+         }
          if ( (itel = find_tel_idx(tel_id)) < 0 )
          {
             Warning("Telescope number out of range for tracking data");
@@ -8127,13 +9452,46 @@ int read_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
       {
          tel_id = (type - IO_TYPE_SIMTEL_TELEVENT)%100 +
                   100*((type-IO_TYPE_SIMTEL_TELEVENT)/1000);
+         if ( !projection_has_telescope(proj,tel_id) )
+         {
+            if ( (rc = skip_subitem(iobuf)) < 0 )
+            {
+               get_item_end(iobuf,&item_header);
+               return rc;
+            }
+            continue;
+         }
          if ( (itel = find_tel_idx(tel_id)) < 0 )
          {
             Warning("Telescope number out of range for telescope event data");
             get_item_end(iobuf,&item_header);
             return -1;
          }
-         if ( (rc = read_simtel_televent(iobuf,&ev->teldata[itel],what)) < 0 )
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+         /* Only copied now, to be decoded after all sub-items are seen */
+         if ( pool != NULL && ntasks < H_MAX_TEL )
+         {
+            if ( (rc = copy_subitem(iobuf,&pool->buf[ntasks],0)) < 0 )
+            {
+               get_item_end(iobuf,&item_header);
+               Warning("Error copying televent data sub-block");
+               return rc;
+            }
+            pool->task[ntasks].te = &ev->teldata[itel];
+            pool->task[ntasks].iobuf = pool->buf[ntasks];
+            pool->task[ntasks].rc = 0;
+            /* The same telescope more than once must not be decoded
+               concurrently. Later copies overwrite the earlier ones,
+               as without threads. */
+            pool->task[ntasks].deferred = 0;
+            for ( j=0; j<ntasks; j++ )
+               if ( pool->task[j].te == pool->task[ntasks].te )
+                  pool->task[ntasks].deferred = 1;
+            ntasks++;
+            continue;
+         }
+#endif
+         if ( (rc = read_televent_parts(iobuf,&ev->teldata[itel],what,parts)) < 0 )
          {
             get_item_end(iobuf,&item_header);
             char line[1000];
@@ -8148,6 +9506,15 @@ int read_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
       }
       else if ( type == IO_TYPE_SIMTEL_SHOWER )
       {
+         if ( (parts & PROJ_SHOWER) == 0 )
+         {
+            if ( (rc = skip_subitem(iobuf)) < 0 )
+            {
+               get_item_end(iobuf,&item_header);
+               return rc;
+            }
+            continue;
+         }
          if ( (rc = read_simtel_shower(iobuf,&ev->shower)) < 0 )
          {
             get_item_end(iobuf,&item_header);
@@ -8165,6 +9532,29 @@ int read_simtel_event (IO_BUFFER *iobuf, FullEvent *ev, int what)
       }
    }
 
+#if defined(EVENTIO_THREADS) || defined(_REENTRANT)
+   if ( ntasks > 0 )
+   {
+      decode_telescopes(pool,ntasks,what,parts);
+      for ( j=0; j<ntasks; j++ )
+      {
+         TelEvent *te = pool->task[j].te;
+         if ( pool->task[j].deferred )
+            pool->task[j].rc = read_televent_parts(pool->task[j].iobuf,te,what,parts);
+         if ( (rc = pool->task[j].rc) < 0 )
+         {
+            get_item_end(iobuf,&item_header);
+            char line[1000];
+            snprintf(line,sizeof(line)-1,"Error reading televent data sub-block for telescope ID %d.", te->tel_id);
+            Warning(line);
+            return rc;
+         }
+         if ( ev->num_teldata < H_MAX_TEL && te->known )
+            ev->teldata_list[ev->num_teldata++] = te->tel_id;
+      }
+   }
+#endif
+
    /* Fill in the list of telescopes not present in earlier versions */
    /* of the central trigger block. Assumes only triggered telescopes */
    /* are actually read out or that the array has no more than 16 telescopes. */
@@ -0,0 +1,645 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_index.c
+ *  @short Index of top-level I/O blocks for random access to eventio files.
+ *
+ *  The sidecar index file has a small header followed by one
+ *  fixed-size record per top-level I/O block:
+
+@verbatim
+    Header (32 bytes):
+       char     magic[8]        "EVIOIDX1"
+       uint32_t byte_order      0x01020304 as written by the producer
+       uint32_t record_size     32
+       int64_t  indexed_length  Bytes of the data file covered
+       uint64_t num_entries
+    Record (32 bytes):
+       int64_t  offset          Byte offset of the block sync tag
+       int64_t  length          Data length (excluding 16 or 20 byte header)
+       int32_t  ident
+       int32_t  event           Event/shower number or -1
+       uint32_t type
+       uint32_t version
+@endverbatim
+
+ *  Index files are written in native byte order and byte-swapped
+ *  as needed when reading them back.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "io_index.h"
+#include "io_hess.h"
+#ifndef FSTAT_NOT_AVAILABLE
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#define IO_INDEX_MAGIC "EVIOIDX1"
+#define IO_INDEX_RECORD_SIZE 32
+
+/** Block types for which the ident is an event (or shower) number. */
+
+static long event_number (const IO_ITEM_HEADER *item_header)
+{
+   switch ( item_header->type )
+   {
+      case IO_TYPE_SIMTEL_EVENT:
+      case IO_TYPE_SIMTEL_MC_SHOWER:
+      case IO_TYPE_SIMTEL_MC_EVENT:
+         return item_header->ident;
+      default:
+         return -1;
+   }
+}
+
+/* ------------------------- allocate_io_index -------------------------- */
+/**
+ *  @short Allocate a new, empty block index.
+ */
+
+IO_INDEX *allocate_io_index (void)
+{
+   IO_INDEX *idx = (IO_INDEX *) calloc(1,sizeof(IO_INDEX));
+   if ( idx == NULL )
+      Warning("Not enough memory for block index");
+   return idx;
+}
+
+/* --------------------------- free_io_index ---------------------------- */
+/**
+ *  @short Free a block index and all its entries.
+ */
+
+void free_io_index (IO_INDEX *idx)
+{
+   if ( idx == NULL )
+      return;
+   if ( idx->entry != NULL )
+      free(idx->entry);
+   if ( idx->by_event != NULL )
+      free(idx->by_event);
+   free(idx);
+}
+
+/* ------------------------ add_io_index_entry -------------------------- */
+/**
+ *  @short Append an entry for an I/O block to the index.
+ *
+ *  @param idx          The block index.
+ *  @param offset       Byte offset of the block in the data file.
+ *  @param item_header  The header of the block, as found by find_io_block().
+ *
+ *  @return 0 (O.k.), -1 (error)
+ */
+
+int add_io_index_entry (IO_INDEX *idx, int64_t offset,
+   const IO_ITEM_HEADER *item_header)
+{
+   IO_INDEX_ENTRY *e;
+   int64_t end;
+
+   if ( idx == NULL || item_header == NULL || offset < 0 )
+      return -1;
+   if ( idx->num_entries >= idx->max_entries )
+   {
+      size_t n = (idx->max_entries < 1024) ? 1024 : 2*idx->max_entries;
+      IO_INDEX_ENTRY *ne = (IO_INDEX_ENTRY *)
+         realloc(idx->entry, n*sizeof(IO_INDEX_ENTRY));
+      if ( ne == NULL )
+      {
+         Warning("Not enough memory for block index");
+         return -1;
+      }
+      idx->entry = ne;
+      idx->max_entries = n;
+   }
+   e = &idx->entry[idx->num_entries++];
+   idx->num_sorted = 0; /* Needs sort_io_index() for fast lookup again */
+   e->offset = offset;
+   e->length = (int64_t) item_header->length;
+   e->ident = item_header->ident;
+   e->event = event_number(item_header);
+   e->type = item_header->type;
+   e->version = item_header->version;
+
+   end = offset + 16 + (item_header->use_extension ? 4 : 0) + e->length;
+   if ( end > idx->indexed_length )
+      idx->indexed_length = end;
+   return 0;
+}
+
+/* -------------------------- build_io_index ---------------------------- */
+/**
+ *  @short Build the index by scanning the input from its current position.
+ *
+ *  All top-level I/O blocks up to the end of the input are added
+ *  to the index. Only the headers are inspected; the data is skipped.
+ *  The input needs to be a regular (or memory-mapped) file.
+ *
+ *  @param iobuf  The I/O buffer with the input to be indexed.
+ *  @param idx    The block index to which entries get added.
+ *
+ *  @return Number of entries added or -1 (error).
+ */
+
+long build_io_index (IO_BUFFER *iobuf, IO_INDEX *idx)
+{
+   IO_ITEM_HEADER item_header;
+   int64_t offset;
+   long n = 0;
+   int rc;
+
+   if ( iobuf == NULL || idx == NULL )
+      return -1;
+
+   while ( (rc = find_io_block(iobuf,&item_header)) == 0 )
+   {
+      if ( (offset = io_block_offset(iobuf)) < 0 )
+      {
+         Warning("Input position not available; cannot build block index");
+         return -1;
+      }
+      if ( add_io_index_entry(idx,offset,&item_header) != 0 )
+         return -1;
+      n++;
+      if ( (rc = skip_io_block(iobuf,&item_header)) < 0 )
+         break;
+   }
+
+   if ( rc == -1 )
+      return -1;
+   if ( sort_io_index(idx) != 0 )
+      return -1;
+   return n;
+}
+
+/* Order of event lookup entries: by event number, then in file order. */
+
+static int cmp_index_event (const void *a, const void *b)
+{
+   const IO_INDEX_EVENT *ea = (const IO_INDEX_EVENT *) a;
+   const IO_INDEX_EVENT *eb = (const IO_INDEX_EVENT *) b;
+   if ( ea->event != eb->event )
+      return (ea->event < eb->event) ? -1 : 1;
+   if ( ea->entry != eb->entry )
+      return (ea->entry < eb->entry) ? -1 : 1;
+   return 0;
+}
+
+/* ---------------------------- sort_io_index ---------------------------- */
+/**
+ *  @short Prepare the lookup of entries by event number with a binary search.
+ *
+ *  The entries themselves stay in file order. Event numbers are not
+ *  ordered in the file in general (several runs in one file, MC event
+ *  blocks of non-triggered events in between), so a separate list sorted
+ *  by event number is kept. This is done by build_io_index() and
+ *  read_io_index(); after adding entries with add_io_index_entry(),
+ *  lookups fall back to a linear search until this is called again.
+ *
+ *  @return 0 (O.k.), -1 (error)
+ */
+
+int sort_io_index (IO_INDEX *idx)
+{
+   IO_INDEX_EVENT *ev;
+   size_t i, n = 0;
+
+   if ( idx == NULL )
+      return -1;
+   idx->num_sorted = 0;
+   if ( idx->num_entries == 0 )
+      return 0;
+   if ( (ev = (IO_INDEX_EVENT *) realloc(idx->by_event,
+           idx->num_entries*sizeof(IO_INDEX_EVENT))) == NULL )
+   {
+      Warning("Not enough memory for block index");
+      return -1;
+   }
+   idx->by_event = ev;
+   for ( i=0; i<idx->num_entries; i++ )
+   {
+      if ( idx->entry[i].type == IO_TYPE_SIMTEL_MC_SHOWER )
+         continue;
+      ev[n].event = idx->entry[i].event;
+      ev[n].entry = i;
+      n++;
+   }
+   qsort(ev,n,sizeof(IO_INDEX_EVENT),cmp_index_event);
+   idx->num_sorted = idx->num_entries;
+   idx->num_by_event = n;
+   return 0;
+}
+
+/* -------------------------- write_io_index ---------------------------- */
+/**
+ *  @short Write the block index to a (sidecar) index file.
+ *
+ *  @return 0 (O.k.), -1 (error)
+ */
+
+int write_io_index (const IO_INDEX *idx, const char *fname)
+{
+   FILE *f;
+   BYTE rec[IO_INDEX_RECORD_SIZE];
+   uint32_t u32;
+   int32_t i32;
+   uint64_t u64;
+   size_t i;
+   int rc = 0;
+
+   if ( idx == NULL || fname == NULL )
+      return -1;
+   if ( (f = fopen(fname,WRITE_BINARY)) == NULL )
+   {
+      perror(fname);
+      return -1;
+   }
+
+   memcpy(rec,IO_INDEX_MAGIC,8);
+   u32 = 0x01020304U;
+   memcpy(rec+8,&u32,4);
+   u32 = IO_INDEX_RECORD_SIZE;
+   memcpy(rec+12,&u32,4);
+   memcpy(rec+16,&idx->indexed_length,8);
+   u64 = (uint64_t) idx->num_entries;
+   memcpy(rec+24,&u64,8);
+   if ( fwrite(rec,1,32,f) != 32 )
+      rc = -1;
+
+   for ( i=0; i<idx->num_entries && rc==0; i++ )
+   {
+      const IO_INDEX_ENTRY *e = &idx->entry[i];
+      memcpy(rec,&e->offset,8);
+      memcpy(rec+8,&e->length,8);
+      i32 = (int32_t) e->ident;
+      memcpy(rec+16,&i32,4);
+      i32 = (int32_t) e->event;
+      memcpy(rec+20,&i32,4);
+      u32 = (uint32_t) e->type;
+      memcpy(rec+24,&u32,4);
+      u32 = (uint32_t) e->version;
+      memcpy(rec+28,&u32,4);
+      if ( fwrite(rec,1,IO_INDEX_RECORD_SIZE,f) != IO_INDEX_RECORD_SIZE )
+         rc = -1;
+   }
+
+   if ( fclose(f) != 0 )
+      rc = -1;
+   if ( rc != 0 )
+      Warning("Error writing block index file");
+   return rc;
+}
+
+/** Copy 4 or 8 bytes, reversing the byte order if needed. */
+
+static void idx_copy (void *dst, const BYTE *src, int n, int swap)
+{
+   BYTE *d = (BYTE *) dst;
+   int j;
+   if ( swap )
+      for ( j=0; j<n; j++ )
+         d[j] = src[n-1-j];
+   else
+      memcpy(d,src,(size_t)n);
+}
+
+/* --------------------------- read_io_index ---------------------------- */
+/**
+ *  @short Read a block index from a (sidecar) index file.
+ *
+ *  @return Pointer to the new index (to be freed with free_io_index())
+ *          or NULL if the file does not exist or is not a valid index.
+ */
+
+IO_INDEX *read_io_index (const char *fname)
+{
+   FILE *f;
+   BYTE rec[IO_INDEX_RECORD_SIZE];
+   IO_INDEX *idx;
+   uint32_t u32, rsize;
+   int32_t i32;
+   uint64_t n, i;
+   long fsize;
+   int swap = 0;
+
+   if ( fname == NULL || (f = fopen(fname,READ_BINARY)) == NULL )
+      return NULL;
+
+   if ( fread(rec,1,32,f) != 32 || memcmp(rec,IO_INDEX_MAGIC,8) != 0 )
+   {
+      Warning("Not a valid block index file");
+      fclose(f);
+      return NULL;
+   }
+   memcpy(&u32,rec+8,4);
+   if ( u32 == 0x04030201U )
+      swap = 1;
+   else if ( u32 != 0x01020304U )
+   {
+      Warning("Invalid byte order in block index file");
+      fclose(f);
+      return NULL;
+   }
+   idx_copy(&rsize,rec+12,4,swap);
+   idx_copy(&n,rec+24,8,swap);
+   if ( rsize < IO_INDEX_RECORD_SIZE || rsize > 4096 )
+   {
+      Warning("Unsupported record size in block index file");
+      fclose(f);
+      return NULL;
+   }
+   /* The number of entries must fit into the file (and into memory). */
+   if ( fseek(f,0L,SEEK_END) != 0 || (fsize = ftell(f)) < 32 ||
+        fseek(f,32L,SEEK_SET) != 0 )
+   {
+      Warning("Cannot determine size of block index file");
+      fclose(f);
+      return NULL;
+   }
+   if ( n > (uint64_t) (fsize-32) / rsize ||
+        n > (uint64_t) ((size_t)-1 / sizeof(IO_INDEX_ENTRY)) )
+   {
+      Warning("Block index file is truncated or corrupted");
+      fclose(f);
+      return NULL;
+   }
+
+   if ( (idx = allocate_io_index()) == NULL )
+   {
+      fclose(f);
+      return NULL;
+   }
+   idx_copy(&idx->indexed_length,rec+16,8,swap);
+   if ( n > 0 && (idx->entry = (IO_INDEX_ENTRY *)
+         malloc((size_t)n*sizeof(IO_INDEX_ENTRY))) == NULL )
+   {
+      Warning("Not enough memory for block index");
+      free_io_index(idx);
+      fclose(f);
+      return NULL;
+   }
+   idx->max_entries = (size_t) n;
+
+   for ( i=0; i<n; i++ )
+   {
+      IO_INDEX_ENTRY *e = &idx->entry[i];
+      if ( fread(rec,1,IO_INDEX_RECORD_SIZE,f) != IO_INDEX_RECORD_SIZE ||
+           (rsize > IO_INDEX_RECORD_SIZE &&
+            fseek(f,(long)(rsize-IO_INDEX_RECORD_SIZE),SEEK_CUR) != 0) )
+      {
+         Warning("Block index file is truncated");
+         free_io_index(idx);
+         fclose(f);
+         return NULL;
+      }
+      idx_copy(&e->offset,rec,8,swap);
+      idx_copy(&e->length,rec+8,8,swap);
+      idx_copy(&i32,rec+16,4,swap);
+      e->ident = i32;
+      idx_copy(&i32,rec+20,4,swap);
+      e->event = i32;
+      idx_copy(&u32,rec+24,4,swap);
+      e->type = u32;
+      idx_copy(&u32,rec+28,4,swap);
+      e->version = u32;
+   }
+   idx->num_entries = (size_t) n;
+
+   fclose(f);
+   if ( sort_io_index(idx) != 0 )
+   {
+      free_io_index(idx);
+      return NULL;
+   }
+   return idx;
+}
+
+/* --------------------------- check_io_index ---------------------------- */
+/**
+ *  @short Check that an index read from a file still matches its data file.
+ *
+ *  An index becomes stale when the data file gets rewritten or appended
+ *  to. For uncompressed data files (starting with an eventio sync tag),
+ *  the file size must be the length covered by the index. Compressed data
+ *  files are indexed by their uncompressed offsets, so there (and in
+ *  any case) the data file must not be newer than the index file.
+ *
+ *  @param idx          The block index, as from read_io_index().
+ *  @param data_fname   Name of the data file.
+ *  @param index_fname  Name of the index file (NULL: no time check).
+ *
+ *  @return 0 (O.k.), -1 (stale index or data file not accessible)
+ */
+
+int check_io_index (const IO_INDEX *idx, const char *data_fname,
+   const char *index_fname)
+{
+   FILE *f;
+   BYTE tag[4];
+   int plain;
+
+   if ( idx == NULL || data_fname == NULL )
+      return -1;
+   if ( (f = fopen(data_fname,READ_BINARY)) == NULL )
+      return -1;
+   plain = ( fread(tag,1,4,f) == 4 &&
+             ((tag[0] == 0x37 && tag[1] == 0x8a && tag[2] == 0x1f && tag[3] == 0xd4) ||
+              (tag[0] == 0xd4 && tag[1] == 0x1f && tag[2] == 0x8a && tag[3] == 0x37)) );
+   if ( plain )
+   {
+      int64_t size = -1;
+#ifdef __USE_LARGEFILE64
+      if ( fseeko64(f,(off64_t)0,SEEK_END) == 0 )
+         size = (int64_t) ftello64(f);
+#else
+      if ( fseeko(f,(off_t)0,SEEK_END) == 0 )
+         size = (int64_t) ftello(f);
+#endif
+      if ( size != idx->indexed_length )
+      {
+         Warning("Block index does not cover the data file as it is now");
+         fclose(f);
+         return -1;
+      }
+   }
+   fclose(f);
+
+#ifndef FSTAT_NOT_AVAILABLE
+   if ( index_fname != NULL )
+   {
+      struct stat st_data, st_index;
+      if ( stat(data_fname,&st_data) == 0 && stat(index_fname,&st_index) == 0 &&
+           st_data.st_mtime > st_index.st_mtime )
+      {
+         Warning("Data file was modified after its block index was made");
+         return -1;
+      }
+   }
+#else
+   (void) index_fname;
+#endif
+
+   return 0;
+}
+
+/* --------------------------- io_index_fname ---------------------------- */
+/**
+ *  @short Name of the sidecar index file for a given data file.
+ *
+ *  @return Allocated string (to be freed by the caller) or NULL.
+ */
+
+char *io_index_fname (const char *data_fname)
+{
+   char *s;
+   size_t l;
+   if ( data_fname == NULL )
+      return NULL;
+   l = strlen(data_fname);
+   if ( (s = (char *) malloc(l+strlen(IO_INDEX_SUFFIX)+1)) == NULL )
+      return NULL;
+   memcpy(s,data_fname,l);
+   strcpy(s+l,IO_INDEX_SUFFIX);
+   return s;
+}
+
+/* ------------------------ find_io_index_event -------------------------- */
+/**
+ *  @short Find the first block of a given event in the index.
+ *
+ *  The first event block (MC event or triggered event) with the
+ *  requested event number is looked up. If the MC shower block
+ *  appears before it without another event in between (as for the
+ *  first event of each shower), the shower block is returned instead,
+ *  so that reading from there provides the complete event.
+ *  With the index prepared by sort_io_index(), this is a binary
+ *  search, otherwise a linear search.
+ *
+ *  @return Entry number or -1 (not found).
+ */
+
+long find_io_index_event (const IO_INDEX *idx, long event)
+{
+   size_t i;
+   long j;
+
+   /* Blocks without an event number are recorded with -1. */
+   if ( idx == NULL || event < 0 )
+      return -1;
+   if ( idx->num_sorted == idx->num_entries && idx->by_event != NULL )
+   {
+      /* First element not before the requested event number */
+      size_t lo = 0, hi = idx->num_by_event;
+      while ( lo < hi )
+      {
+         size_t mid = lo + (hi-lo)/2;
+         if ( idx->by_event[mid].event < event )
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+      if ( lo >= idx->num_by_event || idx->by_event[lo].event != event )
+         return -1;
+      i = idx->by_event[lo].entry;
+   }
+   else
+   {
+      for ( i=0; i<idx->num_entries; i++ )
+      {
+         const IO_INDEX_ENTRY *e = &idx->entry[i];
+         if ( e->event == event && e->type != IO_TYPE_SIMTEL_MC_SHOWER )
+            break;
+      }
+      if ( i >= idx->num_entries )
+         return -1;
+   }
+
+   for ( j=(long)i-1; j>=0; j-- )
+   {
+      const IO_INDEX_ENTRY *e = &idx->entry[j];
+      if ( e->type == IO_TYPE_SIMTEL_MC_SHOWER )
+         return j;
+      if ( e->event >= 0 && e->event != event )
+         break;
+   }
+   return (long) i;
+}
+
+/* ------------------------ find_io_index_type -------------------------- */
+/**
+ *  @short Find the k-th block (counting from 0) of a given type in the index.
+ *
+ *  @return Entry number or -1 (not found).
+ */
+
+long find_io_index_type (const IO_INDEX *idx, unsigned long type, long k)
+{
+   size_t i;
+
+   if ( idx == NULL || k < 0 )
+      return -1;
+   for ( i=0; i<idx->num_entries; i++ )
+   {
+      if ( idx->entry[i].type == type && k-- == 0 )
+         return (long) i;
+   }
+   return -1;
+}
+
+/* ---------------------------- seek_to_event ---------------------------- */
+/**
+ *  @short Position the input such that the next find_io_block() gets
+ *         the first block of the given event.
+ *
+ *  See find_io_index_event() for which block that is.
+ *
+ *  @return 0 (O.k.), -1 (event not in index or seek failed)
+ */
+
+int seek_to_event (IO_BUFFER *iobuf, const IO_INDEX *idx, long event)
+{
+   long i = find_io_index_event(idx,event);
+   if ( i < 0 )
+      return -1;
+   return seek_io_block(iobuf,idx->entry[i].offset);
+}
+
+/* ---------------------------- seek_to_type ----------------------------- */
+/**
+ *  @short Position the input such that the next find_io_block() gets
+ *         the k-th block (counting from 0) of the given type.
+ *
+ *  @return 0 (O.k.), -1 (block not in index or seek failed)
+ */
+
+int seek_to_type (IO_BUFFER *iobuf, const IO_INDEX *idx, unsigned long type, long k)
+{
+   long i = find_io_index_type(idx,type,k);
+   if ( i < 0 )
+      return -1;
+   return seek_io_block(iobuf,idx->entry[i].offset);
+}
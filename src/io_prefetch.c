@@ -0,0 +1,504 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_prefetch.c
+ *  @short Background prefetching of I/O blocks from the input of an I/O buffer.
+ *
+ *  The reader thread works on a private I/O buffer descriptor, sharing
+ *  the input file (or file descriptor or user function) of the
+ *  application's I/O buffer, which must not be read otherwise while
+ *  prefetching is active. Complete blocks (header plus data) are handed
+ *  over through a ring of slots with a single producer (the reader
+ *  thread) and a single consumer (the application). The ring indices
+ *  are updated with atomic operations only; a mutex and condition
+ *  variable are only used to sleep when the ring is empty or full.
+ *  Data buffers are passed around by swapping pointers, not copied:
+ *  the application's I/O buffer gets the buffer of the slot and the
+ *  slot gets the previous buffer of the application for re-use.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "io_prefetch.h"
+#include "unused.h"
+
+#if ( defined(_REENTRANT) || defined(EVENTIO_THREADS) ) && defined(__GNUC__)
+# define HAVE_IO_PREFETCH 1
+# include <pthread.h>
+#endif
+
+#ifdef HAVE_IO_PREFETCH
+
+#define PF_LOAD(x) __atomic_load_n(&(x),__ATOMIC_SEQ_CST)
+#define PF_STORE(x,v) __atomic_store_n(&(x),(v),__ATOMIC_SEQ_CST)
+
+/** One prefetched I/O block. */
+struct io_prefetch_slot
+{
+   BYTE *buffer;        /**< Header and data as read, or a spare buffer. */
+   long buflen;         /**< Usable length of that buffer. */
+   int byte_order;      /**< Byte order of the block. */
+   int extension;       /**< Set if the header had the extension field. */
+   int64_t offset;      /**< Input offset of the block, as from io_block_offset() */
+   int find_rc;         /**< Return code of find_io_block() */
+   int read_rc;         /**< Return code of read_io_block() */
+};
+
+/** Prefetching state, attached to the I/O buffer of the application. */
+struct io_prefetch_struct
+{
+   IO_BUFFER *rd;       /**< Private I/O buffer descriptor of the reader thread */
+   int nslots;          /**< Number of slots in the ring */
+   struct io_prefetch_slot *slot;
+   unsigned long head;  /**< Next slot for the consumer (only advanced by it) */
+   unsigned long tail;  /**< Next slot for the reader (only advanced by it) */
+   int stop;            /**< Set to tell the reader thread to finish */
+   int cons_waiting;    /**< Consumer sleeps, waiting for data */
+   int prod_waiting;    /**< Reader sleeps, waiting for a free slot */
+   int read_rc;         /**< Return code for read_io_block() of current block */
+   int64_t offset;      /**< Input offset of current block */
+   pthread_mutex_t mlock;
+   pthread_cond_t cond;
+   pthread_t thread;
+};
+
+typedef struct io_prefetch_struct IO_PREFETCH;
+
+static int prefetch_find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+static int prefetch_read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+static int prefetch_skip_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header);
+static int64_t prefetch_io_block_offset (IO_BUFFER *iobuf);
+
+/** Used by find_io_block() etc. while prefetching is active. */
+static const struct io_block_hooks prefetch_hooks =
+{
+   prefetch_find_io_block,
+   prefetch_read_io_block,
+   prefetch_skip_io_block,
+   prefetch_io_block_offset,
+   NULL,
+   stop_io_prefetch
+};
+
+/* ------------------ pf_wait_consumer, pf_wait_producer --------- */
+/**
+ *  Sleep until the condition (re-checked with the mutex locked)
+ *  is no longer true. The other side wakes us up after changing
+ *  its ring index when it sees our 'waiting' flag set.
+ */
+
+static void pf_wait_consumer (IO_PREFETCH *pf)
+{
+   pthread_mutex_lock(&pf->mlock);
+   PF_STORE(pf->cons_waiting,1);
+   while ( PF_LOAD(pf->tail) == pf->head )
+      pthread_cond_wait(&pf->cond,&pf->mlock);
+   PF_STORE(pf->cons_waiting,0);
+   pthread_mutex_unlock(&pf->mlock);
+}
+
+static void pf_wait_producer (IO_PREFETCH *pf)
+{
+   pthread_mutex_lock(&pf->mlock);
+   PF_STORE(pf->prod_waiting,1);
+   while ( pf->tail - PF_LOAD(pf->head) >= (unsigned long) pf->nslots &&
+           !PF_LOAD(pf->stop) )
+      pthread_cond_wait(&pf->cond,&pf->mlock);
+   PF_STORE(pf->prod_waiting,0);
+   pthread_mutex_unlock(&pf->mlock);
+}
+
+static void pf_wake (IO_PREFETCH *pf, int *waiting)
+{
+   if ( PF_LOAD(*waiting) )
+   {
+      pthread_mutex_lock(&pf->mlock);
+      pthread_cond_broadcast(&pf->cond);
+      pthread_mutex_unlock(&pf->mlock);
+   }
+}
+
+/* ------------------------ pf_reader --------------------------- */
+/**
+ *  The reader thread: find and read blocks into free slots until
+ *  end-of-file, an input error, or being told to stop.
+ */
+
+static void *pf_reader (void *arg)
+{
+   IO_PREFETCH *pf = (IO_PREFETCH *) arg;
+   IO_BUFFER *rd = pf->rd;
+   IO_ITEM_HEADER item_header;
+
+   for (;;)
+   {
+      struct io_prefetch_slot *s;
+      BYTE *tbuf;
+      long tlen;
+      int frc, rrc = 0;
+      int64_t offset;
+
+      if ( pf->tail - PF_LOAD(pf->head) >= (unsigned long) pf->nslots )
+         pf_wait_producer(pf);
+      if ( PF_LOAD(pf->stop) )
+         break;
+
+      item_header.type = 0;
+      offset = -1;
+      if ( (frc = find_io_block(rd,&item_header)) == 0 )
+      {
+         offset = io_block_offset(rd);
+         rrc = read_io_block(rd,&item_header);
+      }
+      rd->data_pending = 0;
+
+      /* Filled buffer into the slot, the spare buffer of the slot to the reader. */
+      s = &pf->slot[pf->tail % (unsigned long) pf->nslots];
+      tbuf = s->buffer;
+      tlen = s->buflen;
+      s->buffer = rd->buffer;
+      s->buflen = rd->buflen;
+      rd->buffer = rd->data = tbuf;
+      rd->buflen = tlen;
+      s->byte_order = rd->byte_order;
+      s->extension = rd->item_extension[0];
+      s->offset = offset;
+      s->find_rc = frc;
+      s->read_rc = rrc;
+
+      PF_STORE(pf->tail,pf->tail+1);
+      pf_wake(pf,&pf->cons_waiting);
+
+      if ( frc != 0 || rrc == -1 || rrc == -2 )
+         break; /* Nothing more to be read */
+   }
+
+   return NULL;
+}
+
+/* ----------------------- start_io_prefetch ---------------------- */
+/**
+ *  @short Start reading I/O blocks ahead in a background thread.
+ *
+ *  From now on, until stop_io_prefetch() is called, the input of the
+ *  I/O buffer is read by the background thread only. The application
+ *  continues with find_io_block(), read_io_block(), and skip_io_block()
+ *  as usual. Skipped blocks are also read completely by the reader thread.
+ *  Not applicable to memory-mapped input, where data is already in place.
+ *
+ *  @param  iobuf    The I/O buffer with its input already set up.
+ *  @param  nblocks  The number of blocks to read ahead
+ *                   (<=0: use the default).
+ *
+ *  @return 0 (O.k.), -1 (error, input continues without prefetching)
+ */
+
+int start_io_prefetch (IO_BUFFER *iobuf, int nblocks)
+{
+   IO_PREFETCH *pf;
+   IO_BUFFER *rd;
+   int i;
+
+   if ( iobuf == (IO_BUFFER *) NULL )
+      return -1;
+   if ( iobuf->prefetch != NULL )
+      return 0; /* Already running */
+   if ( !iobuf->is_allocated )
+   {
+      Warning("Prefetching needs an I/O buffer allocated by eventio");
+      return -1;
+   }
+   if ( iobuf->data_pending > 0 )
+   {
+      Warning("Cannot start prefetching before the current I/O block was read or skipped");
+      return -1;
+   }
+#ifdef EVENTIO_HAVE_MMAP
+   if ( iobuf->mm_data != (BYTE *) NULL )
+      return -1; /* Pointless with all data being in memory already */
+#endif
+   if ( iobuf->input_fileno < 0 && iobuf->input_file == (FILE *) NULL &&
+        iobuf->user_function == NULL )
+   {
+      Warning("No input to be prefetched");
+      return -1;
+   }
+   if ( nblocks <= 0 )
+      nblocks = IO_PREFETCH_DEFAULT_BLOCKS;
+
+   if ( (pf = (IO_PREFETCH *) calloc(1,sizeof(IO_PREFETCH))) == NULL )
+      return -1;
+   if ( (pf->slot = (struct io_prefetch_slot *)
+           calloc((size_t)nblocks,sizeof(struct io_prefetch_slot))) == NULL ||
+        (rd = allocate_io_buffer((size_t)IO_BUFFER_INITIAL_LENGTH)) == NULL )
+   {
+      Warning("Insufficient memory for prefetching I/O blocks");
+      free(pf->slot);
+      free(pf);
+      return -1;
+   }
+   pf->rd = rd;
+   pf->nslots = nblocks;
+   for ( i=0; i<nblocks; i++ )
+   {
+      pf->slot[i].buflen = IO_BUFFER_INITIAL_LENGTH;
+      if ( (pf->slot[i].buffer = (BYTE *) malloc((size_t)(IO_BUFFER_INITIAL_LENGTH+8))) == NULL )
+      {
+         Warning("Insufficient memory for prefetching I/O blocks");
+         while ( i-- > 0 )
+            free(pf->slot[i].buffer);
+         free_io_buffer(rd);
+         free(pf->slot);
+         free(pf);
+         return -1;
+      }
+   }
+
+   /* The reader inherits the input and its state. */
+   rd->input_fileno = iobuf->input_fileno;
+   rd->input_file = iobuf->input_file;
+   rd->user_function = iobuf->user_function;
+   rd->max_length = iobuf->max_length;
+   rd->regular = iobuf->regular;
+   rd->sync_err_count = iobuf->sync_err_count;
+   rd->sync_err_max = iobuf->sync_err_max;
+   rd->msg_ext = iobuf->msg_ext;
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   /* Data already in the read-ahead buffer must not get lost. */
+   if ( rd->ra_buffer != (BYTE *) NULL )
+      free(rd->ra_buffer);
+   rd->ra_buffer = iobuf->ra_buffer;
+   rd->ra_length = iobuf->ra_length;
+   rd->ra_pos = iobuf->ra_pos;
+   rd->ra_end = iobuf->ra_end;
+   rd->ra_fileno = iobuf->ra_fileno;
+   iobuf->ra_buffer = NULL;
+   iobuf->ra_pos = iobuf->ra_end = 0;
+#endif
+
+   pthread_mutex_init(&pf->mlock,NULL);
+   pthread_cond_init(&pf->cond,NULL);
+   if ( pthread_create(&pf->thread,NULL,pf_reader,pf) != 0 )
+   {
+      Warning("Cannot start reader thread for prefetching I/O blocks");
+#ifdef EVENTIO_HAVE_READ_AHEAD
+      iobuf->ra_buffer = rd->ra_buffer;
+      iobuf->ra_pos = rd->ra_pos;
+      iobuf->ra_end = rd->ra_end;
+      rd->ra_buffer = NULL;
+#endif
+      for ( i=0; i<nblocks; i++ )
+         free(pf->slot[i].buffer);
+      free_io_buffer(rd);
+      pthread_mutex_destroy(&pf->mlock);
+      pthread_cond_destroy(&pf->cond);
+      free(pf->slot);
+      free(pf);
+      return -1;
+   }
+
+   iobuf->prefetch = pf;
+   iobuf->input_hooks = &prefetch_hooks;
+   return 0;
+}
+
+/* ----------------------- stop_io_prefetch ---------------------- */
+/**
+ *  @short Stop the reader thread and release the buffer pool.
+ *
+ *  Blocks already prefetched but not yet taken by the application
+ *  are discarded; direct input continues after the last block read
+ *  by the reader thread. Must be called before closing the input.
+ *  Also done by free_io_buffer().
+ *
+ *  @return 0 (O.k.), -1 (prefetching was not active)
+ */
+
+int stop_io_prefetch (IO_BUFFER *iobuf)
+{
+   IO_PREFETCH *pf;
+   IO_BUFFER *rd;
+   int i;
+
+   if ( iobuf == (IO_BUFFER *) NULL || (pf = iobuf->prefetch) == NULL )
+      return -1;
+   rd = pf->rd;
+
+   PF_STORE(pf->stop,1);
+   pthread_mutex_lock(&pf->mlock);
+   pthread_cond_broadcast(&pf->cond);
+   pthread_mutex_unlock(&pf->mlock);
+   pthread_join(pf->thread,NULL);
+
+   iobuf->regular = rd->regular;
+   iobuf->sync_err_count = rd->sync_err_count;
+#ifdef EVENTIO_HAVE_READ_AHEAD
+   if ( iobuf->ra_buffer != (BYTE *) NULL )
+      free(iobuf->ra_buffer);
+   iobuf->ra_buffer = rd->ra_buffer;
+   iobuf->ra_pos = rd->ra_pos;
+   iobuf->ra_end = rd->ra_end;
+   iobuf->ra_fileno = rd->ra_fileno;
+   rd->ra_buffer = NULL;
+#endif
+   rd->input_file = (FILE *) NULL;
+   rd->input_fileno = -1;
+
+   for ( i=0; i<pf->nslots; i++ )
+      free(pf->slot[i].buffer);
+   free_io_buffer(rd);
+   pthread_mutex_destroy(&pf->mlock);
+   pthread_cond_destroy(&pf->cond);
+   free(pf->slot);
+   free(pf);
+   iobuf->prefetch = NULL;
+   iobuf->input_hooks = NULL;
+   iobuf->data_pending = 0;
+
+   return 0;
+}
+
+/* -------------------- prefetch_find_io_block -------------------- */
+/**
+ *  @short Take the next prefetched block, as find_io_block() would find it.
+ *
+ *  The whole block is then already in the buffer, with the same
+ *  state of the I/O buffer as after finding it directly.
+ *
+ *  @return  0 (O.k.),  -1 (error),  or  -2 (end-of-file)
+ */
+
+static int prefetch_find_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
+{
+   IO_PREFETCH *pf = iobuf->prefetch;
+   struct io_prefetch_slot *s;
+   BYTE *tbuf;
+   long tlen;
+
+   if ( PF_LOAD(pf->tail) == pf->head )
+      pf_wait_consumer(pf);
+   s = &pf->slot[pf->head % (unsigned long) pf->nslots];
+
+   iobuf->item_level = 0;
+   iobuf->item_extension[0] = 0;
+   if ( s->find_rc != 0 )
+   {
+      /* Stays at this final slot for any further calls. */
+      item_header->type = 0;
+      iobuf->item_length[0] = 0;
+      item_header->can_search = 0;
+      return s->find_rc;
+   }
+
+   tbuf = iobuf->buffer;
+   tlen = iobuf->buflen;
+   iobuf->buffer = s->buffer;
+   iobuf->buflen = s->buflen;
+   s->buffer = tbuf;
+   s->buflen = tlen;
+   iobuf->byte_order = s->byte_order;
+   iobuf->item_extension[0] = s->extension;
+   pf->read_rc = s->read_rc;
+   pf->offset = s->offset;
+
+   PF_STORE(pf->head,pf->head+1);
+   pf_wake(pf,&pf->prod_waiting);
+
+   iobuf->data = iobuf->buffer;
+   iobuf->w_remaining = iobuf->r_remaining = -1L;
+   item_header->type = 0;
+   iobuf->data_pending = 1;
+   if ( get_item_begin(iobuf,item_header) != 0 )
+      return -1;
+   iobuf->item_level = 0;
+
+   return 0;
+}
+
+/* -------------------- prefetch_read_io_block -------------------- */
+/**
+ *  @short Complete reading a prefetched block (data is already there).
+ *
+ *  @return  0 (O.k.), -1 (error), -2 (end-of-file), -3 (block skipped)
+ */
+
+static int prefetch_read_io_block (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header)
+{
+   IO_PREFETCH *pf = iobuf->prefetch;
+
+   iobuf->data_pending = 0;
+   if ( pf->read_rc != 0 )
+   {
+      item_header->type = 0;
+      iobuf->item_length[0] = 0;
+      return pf->read_rc;
+   }
+#ifdef EVENTIO_HAVE_TOTAL
+   iobuf->total_input += iobuf->item_length[0] +
+      (iobuf->item_extension[0] ? 20 : 16);
+#endif
+   return 0;
+}
+
+/* ------------------- prefetch_io_block_offset ------------------- */
+/**
+ *  @short Input offset of the current prefetched block, as recorded
+ *         by the reader thread.
+ */
+
+static int64_t prefetch_io_block_offset (IO_BUFFER *iobuf)
+{
+   return iobuf->prefetch->offset;
+}
+
+/* -------------------- prefetch_skip_io_block -------------------- */
+/**
+ *  @short Skip a prefetched block (nothing to do but bookkeeping).
+ *
+ *  @return  0 (O.k.)
+ */
+
+static int prefetch_skip_io_block (IO_BUFFER *iobuf, UNUSED_PAR2(IO_ITEM_HEADER *,item_header))
+{
+   iobuf->item_length[0] = iobuf->sub_item_length[0] = -1;
+   iobuf->data_pending = 0;
+   return 0;
+}
+
+#else
+
+/* Without thread support, input is always read directly. */
+
+int start_io_prefetch (UNUSED_PAR2(IO_BUFFER *,iobuf), UNUSED_PAR2(int,nblocks))
+{
+   Warning("Prefetching of I/O blocks is not available without thread support");
+   return -1;
+}
+
+int stop_io_prefetch (UNUSED_PAR2(IO_BUFFER *,iobuf))
+{
+   return -1;
+}
+
+#endif
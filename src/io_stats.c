@@ -0,0 +1,579 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_stats.c
+ *  @short Per-type timing and byte counters for decoding and block I/O.
+ *
+ *  Each I/O buffer gets its own table of counters when first used with
+ *  statistics active, such that threads working on different I/O
+ *  buffers do not compete for the same lock. The tables of all I/O
+ *  buffers are kept in a list; those of freed buffers are merged into
+ *  a table of retired counters. A report sums up all tables. Each table
+ *  has a lock of its own, taken by the thread counting into it (as
+ *  growing the table moves the counters) and by the report or reset,
+ *  so that these can be done while other threads are still busy.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "io_stats.h"
+#include <time.h>
+
+#if defined(CLOCK_MONOTONIC) && defined(CLOCK_THREAD_CPUTIME_ID)
+# define HAVE_IO_STATS 1
+#endif
+
+#if ( defined(_REENTRANT) || defined(EVENTIO_THREADS) ) && defined(__GNUC__)
+# include <pthread.h>
+/* Lock order: first the list of tables, then any table. */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+# define STATS_LOCK pthread_mutex_lock(&stats_lock)
+# define STATS_UNLOCK pthread_mutex_unlock(&stats_lock)
+# define TABLE_LOCK(st) pthread_mutex_lock(&(st)->lock)
+# define TABLE_UNLOCK(st) pthread_mutex_unlock(&(st)->lock)
+# define HAVE_TABLE_LOCK 1
+#else
+# define STATS_LOCK
+# define STATS_UNLOCK
+# define TABLE_LOCK(st)
+# define TABLE_UNLOCK(st)
+#endif
+
+/** Accumulated counters for one kind of operation, type and level. */
+struct io_stats_entry
+{
+   uint32_t key;        /**< Operation, level and type (0: unused entry) */
+   uint64_t count;      /**< Number of items or blocks */
+   uint64_t bytes;      /**< Sum of their lengths, including headers */
+   int64_t wall_ns;     /**< Wall-clock time, including sub-items */
+   int64_t cpu_ns;      /**< CPU time of the thread, including sub-items */
+   int64_t self_wall_ns;/**< Wall-clock time excluding sub-items */
+   int64_t self_cpu_ns; /**< CPU time excluding sub-items */
+};
+
+/** The counters and timing state of one I/O buffer. */
+struct io_stats_struct
+{
+   struct io_stats_struct *next; /**< Next table in the list of all tables */
+   struct io_stats_entry *entry; /**< Hash table of counters */
+   size_t nalloc;       /**< Size of hash table (a power of two) */
+   size_t n;            /**< Number of entries used */
+   int64_t wall_start[MAX_IO_ITEM_LEVEL]; /**< When each item was started */
+   int64_t cpu_start[MAX_IO_ITEM_LEVEL];
+   int64_t wall_sub[MAX_IO_ITEM_LEVEL];   /**< Time spent in its sub-items */
+   int64_t cpu_sub[MAX_IO_ITEM_LEVEL];
+   int64_t blk_wall_start, blk_cpu_start; /**< Start of block I/O */
+#ifdef HAVE_TABLE_LOCK
+   pthread_mutex_t lock; /**< Protects the hash table and its counters */
+#endif
+};
+
+static struct io_stats_struct *stats_list = NULL;
+static struct io_stats_struct retired;
+static char *stats_fname = NULL;
+static int atexit_done = 0;
+
+#define STATS_KEY(op,level,type) \
+   (((uint32_t)(op)<<24) | ((uint32_t)((level)&0xff)<<16) | ((uint32_t)(type)&0xffff))
+
+/* -------------------- stats_entry ------------------- */
+/**
+ *  @short Find or insert the entry for a given key.
+ *
+ *  The table may get reallocated, so this needs the table lock
+ *  (or the list lock for the retired counters and private tables),
+ *  which must be kept as long as the entry is used.
+ *
+ *  @return Pointer to the entry, NULL if out of memory.
+ */
+
+static struct io_stats_entry *stats_entry (struct io_stats_struct *st, uint32_t key)
+{
+   size_t i;
+
+   if ( 2*(st->n+1) > st->nalloc )
+   {
+      size_t nalloc = (st->nalloc > 0) ? 2*st->nalloc : 64, j;
+      struct io_stats_entry *e = (struct io_stats_entry *)
+         calloc(nalloc, sizeof(struct io_stats_entry));
+      if ( e == NULL )
+         return NULL;
+      for ( j=0; j<st->nalloc; j++ )
+      {
+         if ( st->entry[j].key == 0 )
+            continue;
+         for ( i=(st->entry[j].key*2654435761U) & (nalloc-1); e[i].key != 0;
+               i=(i+1) & (nalloc-1) )
+            ;
+         e[i] = st->entry[j];
+      }
+      free(st->entry);
+      st->entry = e;
+      st->nalloc = nalloc;
+   }
+
+   for ( i=(key*2654435761U) & (st->nalloc-1); st->entry[i].key != key;
+         i=(i+1) & (st->nalloc-1) )
+   {
+      if ( st->entry[i].key == 0 )
+      {
+         st->entry[i].key = key;
+         st->n++;
+         break;
+      }
+   }
+   return &st->entry[i];
+}
+
+/* -------------------- stats_merge ------------------- */
+/**
+ *  @short Add all counters of one table to another one.
+ */
+
+static void stats_merge (struct io_stats_struct *to, const struct io_stats_struct *from)
+{
+   size_t j;
+
+   for ( j=0; j<from->nalloc; j++ )
+   {
+      const struct io_stats_entry *f = &from->entry[j];
+      struct io_stats_entry *t;
+      if ( f->key == 0 || (t = stats_entry(to,f->key)) == NULL )
+         continue;
+      t->count += f->count;
+      t->bytes += f->bytes;
+      t->wall_ns += f->wall_ns;
+      t->cpu_ns += f->cpu_ns;
+      t->self_wall_ns += f->self_wall_ns;
+      t->self_cpu_ns += f->self_cpu_ns;
+   }
+}
+
+#ifdef HAVE_IO_STATS
+
+static int64_t now_ns (clockid_t clk)
+{
+   struct timespec ts;
+   if ( clock_gettime(clk,&ts) != 0 )
+      return 0;
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* -------------------- get_stats ------------------- */
+/**
+ *  @short Get the table of an I/O buffer, creating it when needed.
+ */
+
+static struct io_stats_struct *get_stats (IO_BUFFER *iobuf)
+{
+   struct io_stats_struct *st = iobuf->stats;
+
+   if ( st != NULL )
+      return st;
+   if ( (st = (struct io_stats_struct *)
+         calloc(1,sizeof(struct io_stats_struct))) == NULL )
+      return NULL;
+#ifdef HAVE_TABLE_LOCK
+   pthread_mutex_init(&st->lock,NULL);
+#endif
+   STATS_LOCK;
+   st->next = stats_list;
+   stats_list = st;
+   STATS_UNLOCK;
+   return (iobuf->stats = st);
+}
+
+#endif
+
+/* -------------------- io_stats_item_begin ------------------- */
+/**
+ *  @short Note the start of reading an item at given level.
+ *
+ *  Called by get_item_begin() after successfully reading the
+ *  item header, if statistics are active.
+ */
+
+static void io_stats_item_begin (IO_BUFFER *iobuf, int ilevel)
+{
+#ifdef HAVE_IO_STATS
+   struct io_stats_struct *st;
+   if ( ilevel < 0 || ilevel >= MAX_IO_ITEM_LEVEL ||
+        (st = get_stats(iobuf)) == NULL )
+      return;
+   st->wall_start[ilevel] = now_ns(CLOCK_MONOTONIC);
+   st->cpu_start[ilevel] = now_ns(CLOCK_THREAD_CPUTIME_ID);
+   st->wall_sub[ilevel] = st->cpu_sub[ilevel] = 0;
+#else
+   (void) iobuf; (void) ilevel;
+#endif
+}
+
+/* -------------------- io_stats_item_end ------------------- */
+/**
+ *  @short Account for an item being finished.
+ *
+ *  Called by get_item_end(), if statistics are active. The time
+ *  is charged to the item type and level and, as sub-item time,
+ *  also to the enclosing item.
+ *
+ *  @param iobuf  The I/O buffer descriptor.
+ *  @param type   The item type.
+ *  @param ilevel The nesting level of the item.
+ *  @param bytes  The length of the item, including its header.
+ */
+
+static void io_stats_item_end (IO_BUFFER *iobuf, unsigned long type, int ilevel, long bytes)
+{
+#ifdef HAVE_IO_STATS
+   struct io_stats_struct *st = iobuf->stats;
+   struct io_stats_entry *e;
+   int64_t dw, dc;
+
+   if ( st == NULL || ilevel < 0 || ilevel >= MAX_IO_ITEM_LEVEL ||
+        st->wall_start[ilevel] == 0 )
+      return; /* Item was started before statistics were activated. */
+   dw = now_ns(CLOCK_MONOTONIC) - st->wall_start[ilevel];
+   dc = now_ns(CLOCK_THREAD_CPUTIME_ID) - st->cpu_start[ilevel];
+   st->wall_start[ilevel] = 0;
+   if ( ilevel > 0 )
+   {
+      st->wall_sub[ilevel-1] += dw;
+      st->cpu_sub[ilevel-1] += dc;
+   }
+   TABLE_LOCK(st);
+   if ( (e = stats_entry(st,STATS_KEY(IO_STATS_ITEM,ilevel,type))) != NULL )
+   {
+      e->count++;
+      e->bytes += (uint64_t) bytes;
+      e->wall_ns += dw;
+      e->cpu_ns += dc;
+      e->self_wall_ns += dw - st->wall_sub[ilevel];
+      e->self_cpu_ns += dc - st->cpu_sub[ilevel];
+   }
+   TABLE_UNLOCK(st);
+#else
+   (void) iobuf; (void) type; (void) ilevel; (void) bytes;
+#endif
+}
+
+/* -------------------- io_stats_block_begin ------------------- */
+/**
+ *  @short Note the start of read_io_block() or write_io_block().
+ */
+
+static void io_stats_block_begin (IO_BUFFER *iobuf)
+{
+#ifdef HAVE_IO_STATS
+   struct io_stats_struct *st;
+   if ( (st = get_stats(iobuf)) == NULL )
+      return;
+   st->blk_wall_start = now_ns(CLOCK_MONOTONIC);
+   st->blk_cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+#else
+   (void) iobuf;
+#endif
+}
+
+/* -------------------- io_stats_block_end ------------------- */
+/**
+ *  @short Account for a block read or written.
+ *
+ *  @param iobuf  The I/O buffer descriptor.
+ *  @param op     IO_STATS_READ or IO_STATS_WRITE.
+ *  @param type   The type of the top-level item.
+ *  @param bytes  The number of bytes read or written.
+ */
+
+static void io_stats_block_end (IO_BUFFER *iobuf, int op, unsigned long type, long bytes)
+{
+#ifdef HAVE_IO_STATS
+   struct io_stats_struct *st = iobuf->stats;
+   struct io_stats_entry *e;
+   int64_t dw, dc;
+
+   if ( st == NULL || st->blk_wall_start == 0 )
+      return;
+   dw = now_ns(CLOCK_MONOTONIC) - st->blk_wall_start;
+   dc = now_ns(CLOCK_THREAD_CPUTIME_ID) - st->blk_cpu_start;
+   st->blk_wall_start = 0;
+   TABLE_LOCK(st);
+   if ( (e = stats_entry(st,STATS_KEY(op,0,type))) != NULL )
+   {
+      e->count++;
+      e->bytes += (uint64_t) bytes;
+      e->wall_ns += dw;
+      e->cpu_ns += dc;
+      e->self_wall_ns += dw;
+      e->self_cpu_ns += dc;
+   }
+   TABLE_UNLOCK(st);
+#else
+   (void) iobuf; (void) op; (void) type; (void) bytes;
+#endif
+}
+
+/* -------------------- io_stats_release ------------------- */
+/**
+ *  @short Keep the counters of an I/O buffer being freed.
+ */
+
+static void io_stats_release (IO_BUFFER *iobuf)
+{
+   struct io_stats_struct *st = iobuf->stats, **pst;
+
+   if ( st == NULL )
+      return;
+   STATS_LOCK;
+   for ( pst=&stats_list; *pst != NULL; pst=&(*pst)->next )
+   {
+      if ( *pst == st )
+      {
+         *pst = st->next;
+         break;
+      }
+   }
+   stats_merge(&retired,st);
+   STATS_UNLOCK;
+#ifdef HAVE_TABLE_LOCK
+   pthread_mutex_destroy(&st->lock);
+#endif
+   free(st->entry);
+   free(st);
+   iobuf->stats = NULL;
+}
+
+static const struct io_stats_hooks stats_hooks =
+{
+   io_stats_item_begin,
+   io_stats_item_end,
+   io_stats_block_begin,
+   io_stats_block_end,
+   io_stats_release
+};
+
+/* -------------------- report_at_exit ------------------- */
+
+static void report_at_exit (void)
+{
+   FILE *f;
+
+   if ( stats_fname == NULL )
+      return;
+   if ( strcmp(stats_fname,"-") == 0 )
+      report_io_stats(stdout);
+   else if ( strcmp(stats_fname,"+") == 0 )
+      report_io_stats(stderr);
+   else if ( (f = fopen(stats_fname,"w")) != NULL )
+   {
+      report_io_stats(f);
+      fclose(f);
+   }
+   else
+      perror(stats_fname);
+}
+
+/* -------------------- start_io_stats ------------------- */
+/**
+ *  @short Start collecting decoding and block I/O statistics.
+ *
+ *  @param fname  File to which the statistics get written at program
+ *                exit ("-": standard output, "+": standard error),
+ *                or NULL for no automatic report.
+ *
+ *  @return 0 (O.k.), -1 (not supported on this system)
+ */
+
+int start_io_stats (const char *fname)
+{
+#ifdef HAVE_IO_STATS
+   if ( fname != NULL && *fname != '\0' )
+   {
+      char *s = strdup(fname);
+      if ( s != NULL )
+      {
+         free(stats_fname);
+         stats_fname = s;
+      }
+      if ( !atexit_done )
+      {
+         atexit(report_at_exit);
+         atexit_done = 1;
+      }
+   }
+   io_stats_hooks = &stats_hooks;
+   io_stats_active = 1;
+   return 0;
+#else
+   (void) fname;
+   Warning("Decoding statistics are not supported on this system");
+   return -1;
+#endif
+}
+
+/* -------------------- stop_io_stats ------------------- */
+/**
+ *  @short Stop collecting statistics. Counters remain available.
+ */
+
+void stop_io_stats (void)
+{
+   io_stats_active = 0;
+}
+
+/* -------------------- reset_io_stats ------------------- */
+/**
+ *  @short Reset all counters to zero.
+ */
+
+void reset_io_stats (void)
+{
+   struct io_stats_struct *st;
+
+   STATS_LOCK;
+   for ( st=stats_list; st != NULL; st=st->next )
+   {
+      TABLE_LOCK(st);
+      if ( st->entry != NULL )
+         memset(st->entry,0,st->nalloc*sizeof(struct io_stats_entry));
+      st->n = 0;
+      TABLE_UNLOCK(st);
+   }
+   free(retired.entry);
+   retired.entry = NULL;
+   retired.nalloc = retired.n = 0;
+   STATS_UNLOCK;
+}
+
+/* -------------------- io_stats_check_env ------------------- */
+/**
+ *  @short Start statistics if requested by the EVENTIO_STATS variable.
+ *
+ *  With GNU C this is done automatically at program start-up.
+ *  Otherwise programs supporting EVENTIO_STATS have to call it.
+ */
+
+void io_stats_check_env (void)
+{
+   static int checked = 0;
+   const char *s;
+
+   if ( checked )
+      return;
+   checked = 1;
+   if ( (s = getenv("EVENTIO_STATS")) != NULL && *s != '\0' )
+      start_io_stats(s);
+}
+
+#ifdef __GNUC__
+static void io_stats_init (void) __attribute__((constructor));
+
+static void io_stats_init (void)
+{
+   io_stats_check_env();
+}
+#endif
+
+static int cmp_entry (const void *a, const void *b)
+{
+   uint32_t ka = ((const struct io_stats_entry *) a)->key;
+   uint32_t kb = ((const struct io_stats_entry *) b)->key;
+   return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+static void json_string (FILE *f, const char *s)
+{
+   fputc('"',f);
+   for ( ; *s != '\0'; s++ )
+   {
+      if ( *s == '"' || *s == '\\' )
+         fprintf(f,"\\%c",*s);
+      else if ( (unsigned char) *s < 0x20 )
+         fprintf(f,"\\u%04x",(unsigned char) *s);
+      else
+         fputc(*s,f);
+   }
+   fputc('"',f);
+}
+
+/* -------------------- report_io_stats ------------------- */
+/**
+ *  @short Write the accumulated statistics in JSON format.
+ *
+ *  The report is an object with an array "stats" of entries with
+ *  the operation ("item", "read", or "write"), the item type
+ *  and its registered name, the nesting level (0 for block I/O),
+ *  the count, the bytes, and the times in nanoseconds.
+ *
+ *  @param f  The output stream.
+ *
+ *  @return 0 (O.k.), -1 (error)
+ */
+
+int report_io_stats (FILE *f)
+{
+   static const char *opname[] = { "?", "item", "read", "write" };
+   struct io_stats_struct sum, *st;
+   size_t i, n;
+
+   if ( f == NULL )
+      return -1;
+   memset(&sum,0,sizeof(sum));
+   STATS_LOCK;
+   stats_merge(&sum,&retired);
+   for ( st=stats_list; st != NULL; st=st->next )
+   {
+      TABLE_LOCK(st);
+      stats_merge(&sum,st);
+      TABLE_UNLOCK(st);
+   }
+   STATS_UNLOCK;
+
+   /* Compact and sort by operation, level, and type. */
+   for ( i=n=0; i<sum.nalloc; i++ )
+      if ( sum.entry[i].key != 0 )
+         sum.entry[n++] = sum.entry[i];
+   if ( n > 0 )
+      qsort(sum.entry,n,sizeof(struct io_stats_entry),cmp_entry);
+
+   fprintf(f,"{\n \"stats\": [");
+   for ( i=0; i<n; i++ )
+   {
+      const struct io_stats_entry *e = &sum.entry[i];
+      unsigned op = e->key >> 24;
+      unsigned long type = e->key & 0xffff;
+      fprintf(f,"%s\n  { \"op\": \"%s\", \"type\": %lu, \"name\": ",
+         (i>0) ? "," : "", opname[op<4 ? op : 0], type);
+      json_string(f,eventio_registered_typename(type));
+      fprintf(f,", \"level\": %u, \"count\": %ju, \"bytes\": %ju,"
+         " \"wall_ns\": %jd, \"cpu_ns\": %jd,"
+         " \"self_wall_ns\": %jd, \"self_cpu_ns\": %jd }",
+         (e->key >> 16) & 0xff, (uintmax_t) e->count, (uintmax_t) e->bytes,
+         (intmax_t) e->wall_ns, (intmax_t) e->cpu_ns,
+         (intmax_t) e->self_wall_ns, (intmax_t) e->self_cpu_ns);
+   }
+   fprintf(f,"\n ]\n}\n");
+   free(sum.entry);
+
+   return ferror(f) ? -1 : 0;
+}
@@ -0,0 +1,408 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file io_writebehind.c
+ *  @short Asynchronous output of I/O blocks from an I/O buffer.
+ *
+ *  Completed blocks are handed over to the writer thread through a ring
+ *  of slots with a single producer (the application) and a single
+ *  consumer (the writer thread), in the same way as for prefetching
+ *  (see io_prefetch.c). Each slot also records where the block goes to,
+ *  as the application may switch the output of the I/O buffer between
+ *  blocks. The writer thread only advances its ring index after a block
+ *  was written out, thus an empty ring means that all queued output is
+ *  done. A write error is remembered and reported by the next call of
+ *  write_io_block() or flush_io_writebehind().
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "io_basic.h"
+#include "io_writebehind.h"
+#include "unused.h"
+
+#if ( defined(_REENTRANT) || defined(EVENTIO_THREADS) ) && defined(__GNUC__)
+# define HAVE_IO_WRITEBEHIND 1
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#ifdef HAVE_IO_WRITEBEHIND
+
+#define WB_LOAD(x) __atomic_load_n(&(x),__ATOMIC_SEQ_CST)
+#define WB_STORE(x,v) __atomic_store_n(&(x),(v),__ATOMIC_SEQ_CST)
+
+/** One I/O block queued for output. */
+struct io_writebehind_slot
+{
+   BYTE *buffer;        /**< Header and data of the block, or a spare buffer. */
+   long buflen;         /**< Usable length of that buffer. */
+   size_t length;       /**< Number of bytes to be written. */
+   int output_fileno;   /**< Output file descriptor at the time of queuing. */
+   FILE *output_file;   /**< Output file at the time of queuing. */
+   IO_USER_FUNCTION user_function; /**< User function at the time of queuing. */
+};
+
+/** Write-behind state, attached to the I/O buffer of the application. */
+struct io_writebehind_struct
+{
+   int nslots;          /**< Number of slots in the ring */
+   struct io_writebehind_slot *slot;
+   unsigned long head;  /**< Next slot to be written (only advanced by the writer) */
+   unsigned long tail;  /**< Next slot to be filled (only advanced by the application) */
+   int stop;            /**< Set to tell the writer thread to finish */
+   int cons_waiting;    /**< Writer sleeps, waiting for data */
+   int prod_waiting;    /**< Application sleeps, waiting for output to complete */
+   int error;           /**< Set after a write error, until reported */
+   pthread_mutex_t mlock;
+   pthread_cond_t cond;
+   pthread_t thread;
+};
+
+typedef struct io_writebehind_struct IO_WRITEBEHIND;
+
+static int writebehind_write_io_block (IO_BUFFER *iobuf, size_t length);
+
+/** Used by write_io_block() while write-behind is active. */
+static const struct io_block_hooks writebehind_hooks =
+{
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   writebehind_write_io_block,
+   stop_io_writebehind
+};
+
+/* ------------------ wb_wait_writer, wb_wait_queue --------------- */
+/**
+ *  Sleep until the condition (re-checked with the mutex locked)
+ *  is no longer true: the writer waits for a queued block (or being
+ *  told to stop), the application for no more than 'max_pending'
+ *  blocks being left in the queue.
+ */
+
+static void wb_wait_writer (IO_WRITEBEHIND *wb)
+{
+   pthread_mutex_lock(&wb->mlock);
+   WB_STORE(wb->cons_waiting,1);
+   while ( WB_LOAD(wb->tail) == wb->head && !WB_LOAD(wb->stop) )
+      pthread_cond_wait(&wb->cond,&wb->mlock);
+   WB_STORE(wb->cons_waiting,0);
+   pthread_mutex_unlock(&wb->mlock);
+}
+
+static void wb_wait_queue (IO_WRITEBEHIND *wb, unsigned long max_pending)
+{
+   pthread_mutex_lock(&wb->mlock);
+   WB_STORE(wb->prod_waiting,1);
+   while ( wb->tail - WB_LOAD(wb->head) > max_pending )
+      pthread_cond_wait(&wb->cond,&wb->mlock);
+   WB_STORE(wb->prod_waiting,0);
+   pthread_mutex_unlock(&wb->mlock);
+}
+
+static void wb_wake (IO_WRITEBEHIND *wb, int *waiting)
+{
+   if ( WB_LOAD(*waiting) )
+   {
+      pthread_mutex_lock(&wb->mlock);
+      pthread_cond_broadcast(&wb->cond);
+      pthread_mutex_unlock(&wb->mlock);
+   }
+}
+
+/* ------------------------- wb_output ---------------------------- */
+/**
+ *  Write one block to where it was meant to go, as write_io_block() does.
+ */
+
+static int wb_output (struct io_writebehind_slot *s)
+{
+   if ( s->output_fileno >= 0 )
+   {
+      if ( write(s->output_fileno,(char *)s->buffer,s->length) == -1 )
+      {
+         Warning("Output error for I/O buffer");
+         return -1;
+      }
+   }
+   else if ( s->output_file != (FILE *) NULL )
+   {
+      if ( fwrite((void *)s->buffer,(size_t)1,s->length,
+            s->output_file) != s->length )
+      {
+         if ( ferror(s->output_file) )
+         {
+            Warning("Output error for I/O buffer");
+            clearerr(s->output_file);
+            return -1;
+         }
+      }
+   }
+   else if ( s->user_function != NULL )
+      return (s->user_function)(s->buffer,(long)s->length,1);
+   else
+   {
+      Warning("Output cancelled because no output file/function set.");
+      return -1;
+   }
+   return 0;
+}
+
+/* ------------------------- wb_writer ---------------------------- */
+/**
+ *  The writer thread: write queued blocks in order until told to stop
+ *  with nothing left in the queue.
+ */
+
+static void *wb_writer (void *arg)
+{
+   IO_WRITEBEHIND *wb = (IO_WRITEBEHIND *) arg;
+
+   for (;;)
+   {
+      if ( WB_LOAD(wb->tail) == wb->head )
+      {
+         if ( WB_LOAD(wb->stop) )
+            break;
+         wb_wait_writer(wb);
+         continue;
+      }
+
+      if ( wb_output(&wb->slot[wb->head % (unsigned long) wb->nslots]) != 0 )
+         WB_STORE(wb->error,1);
+
+      WB_STORE(wb->head,wb->head+1);
+      wb_wake(wb,&wb->prod_waiting);
+   }
+
+   return NULL;
+}
+
+/* --------------------- start_io_writebehind --------------------- */
+/**
+ *  @short Start writing I/O blocks asynchronously in a background thread.
+ *
+ *  From now on, until stop_io_writebehind() is called, write_io_block()
+ *  only queues the block and the output of the I/O buffer is written
+ *  by the background thread. A user function for output gets called
+ *  from that thread. Before closing an output file or writing to it
+ *  other than through this I/O buffer, call flush_io_writebehind().
+ *
+ *  @param  iobuf    The I/O buffer to be used for output.
+ *  @param  nblocks  The maximum number of blocks queued for output
+ *                   (<=0: use the default).
+ *
+ *  @return 0 (O.k.), -1 (error, output continues synchronously)
+ */
+
+int start_io_writebehind (IO_BUFFER *iobuf, int nblocks)
+{
+   IO_WRITEBEHIND *wb;
+   int i;
+
+   if ( iobuf == (IO_BUFFER *) NULL )
+      return -1;
+   if ( iobuf->writebehind != NULL )
+      return 0; /* Already running */
+   if ( !iobuf->is_allocated )
+   {
+      Warning("Write-behind needs an I/O buffer allocated by eventio");
+      return -1;
+   }
+   if ( nblocks <= 0 )
+      nblocks = IO_WRITEBEHIND_DEFAULT_BLOCKS;
+
+   if ( (wb = (IO_WRITEBEHIND *) calloc(1,sizeof(IO_WRITEBEHIND))) == NULL )
+      return -1;
+   if ( (wb->slot = (struct io_writebehind_slot *)
+           calloc((size_t)nblocks,sizeof(struct io_writebehind_slot))) == NULL )
+   {
+      Warning("Insufficient memory for write-behind of I/O blocks");
+      free(wb);
+      return -1;
+   }
+   wb->nslots = nblocks;
+   for ( i=0; i<nblocks; i++ )
+   {
+      wb->slot[i].buflen = IO_BUFFER_INITIAL_LENGTH;
+      if ( (wb->slot[i].buffer = (BYTE *) malloc((size_t)(IO_BUFFER_INITIAL_LENGTH+8))) == NULL )
+      {
+         Warning("Insufficient memory for write-behind of I/O blocks");
+         while ( i-- > 0 )
+            free(wb->slot[i].buffer);
+         free(wb->slot);
+         free(wb);
+         return -1;
+      }
+   }
+
+   pthread_mutex_init(&wb->mlock,NULL);
+   pthread_cond_init(&wb->cond,NULL);
+   if ( pthread_create(&wb->thread,NULL,wb_writer,wb) != 0 )
+   {
+      Warning("Cannot start writer thread for write-behind of I/O blocks");
+      for ( i=0; i<nblocks; i++ )
+         free(wb->slot[i].buffer);
+      pthread_mutex_destroy(&wb->mlock);
+      pthread_cond_destroy(&wb->cond);
+      free(wb->slot);
+      free(wb);
+      return -1;
+   }
+
+   iobuf->writebehind = wb;
+   iobuf->output_hooks = &writebehind_hooks;
+   return 0;
+}
+
+/* --------------------- flush_io_writebehind --------------------- */
+/**
+ *  @short Wait until all queued blocks have been written.
+ *
+ *  This is the fence to be used before closing or switching an output
+ *  file, before writing to it in other ways, or where the order of
+ *  output must be guaranteed with respect to other outputs.
+ *  Data written to a FILE is then in its stdio buffer, as after a
+ *  direct write_io_block().
+ *
+ *  Nothing to be done if write-behind is not active.
+ *
+ *  @return 0 (O.k.), -1 (an output error happened since last reported)
+ */
+
+int flush_io_writebehind (IO_BUFFER *iobuf)
+{
+   IO_WRITEBEHIND *wb;
+
+   if ( iobuf == (IO_BUFFER *) NULL || (wb = iobuf->writebehind) == NULL )
+      return 0;
+
+   if ( wb->tail != WB_LOAD(wb->head) )
+      wb_wait_queue(wb,0UL);
+
+   return __atomic_exchange_n(&wb->error,0,__ATOMIC_SEQ_CST) ? -1 : 0;
+}
+
+/* --------------------- stop_io_writebehind ---------------------- */
+/**
+ *  @short Write out what is queued, stop the writer thread and
+ *         release the buffer pool.
+ *
+ *  Output continues synchronously afterwards.
+ *  Also done by free_io_buffer().
+ *
+ *  @return 0 (O.k.), -1 (output error or write-behind was not active)
+ */
+
+int stop_io_writebehind (IO_BUFFER *iobuf)
+{
+   IO_WRITEBEHIND *wb;
+   int rc, i;
+
+   if ( iobuf == (IO_BUFFER *) NULL || (wb = iobuf->writebehind) == NULL )
+      return -1;
+
+   rc = flush_io_writebehind(iobuf);
+
+   WB_STORE(wb->stop,1);
+   pthread_mutex_lock(&wb->mlock);
+   pthread_cond_broadcast(&wb->cond);
+   pthread_mutex_unlock(&wb->mlock);
+   pthread_join(wb->thread,NULL);
+
+   for ( i=0; i<wb->nslots; i++ )
+      free(wb->slot[i].buffer);
+   pthread_mutex_destroy(&wb->mlock);
+   pthread_cond_destroy(&wb->cond);
+   free(wb->slot);
+   free(wb);
+   iobuf->writebehind = NULL;
+   iobuf->output_hooks = NULL;
+
+   return rc;
+}
+
+/* ------------------ writebehind_write_io_block ------------------ */
+/**
+ *  @short Queue the completed top-level block for output.
+ *
+ *  The buffer with the block goes to a free slot (waiting for one
+ *  if needed) and the I/O buffer gets the spare buffer of that slot.
+ *
+ *  @param  iobuf   The I/O buffer with the complete block.
+ *  @param  length  Length of the block including its header.
+ *
+ *  @return 0 (O.k.), -1 (an earlier queued block could not be written)
+ */
+
+static int writebehind_write_io_block (IO_BUFFER *iobuf, size_t length)
+{
+   IO_WRITEBEHIND *wb = iobuf->writebehind;
+   struct io_writebehind_slot *s;
+   BYTE *tbuf;
+   long tlen;
+
+   if ( wb->tail - WB_LOAD(wb->head) >= (unsigned long) wb->nslots )
+      wb_wait_queue(wb,(unsigned long) wb->nslots-1);
+
+   s = &wb->slot[wb->tail % (unsigned long) wb->nslots];
+   tbuf = s->buffer;
+   tlen = s->buflen;
+   s->buffer = iobuf->buffer;
+   s->buflen = iobuf->buflen;
+   iobuf->buffer = iobuf->data = tbuf;
+   iobuf->buflen = tlen;
+   s->length = length;
+   s->output_fileno = iobuf->output_fileno;
+   s->output_file = iobuf->output_file;
+   s->user_function = iobuf->user_function;
+
+   WB_STORE(wb->tail,wb->tail+1);
+   wb_wake(wb,&wb->cons_waiting);
+
+   return __atomic_exchange_n(&wb->error,0,__ATOMIC_SEQ_CST) ? -1 : 0;
+}
+
+#else
+
+/* Without thread support, output is always written directly. */
+
+int start_io_writebehind (UNUSED_PAR2(IO_BUFFER *,iobuf), UNUSED_PAR2(int,nblocks))
+{
+   Warning("Write-behind of I/O blocks is not available without thread support");
+   return -1;
+}
+
+int flush_io_writebehind (UNUSED_PAR2(IO_BUFFER *,iobuf))
+{
+   return 0;
+}
+
+int stop_io_writebehind (UNUSED_PAR2(IO_BUFFER *,iobuf))
+{
+   return -1;
+}
+
+#endif
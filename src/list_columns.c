@@ -0,0 +1,213 @@
+/* ============================================================================
+
+Copyright (C) 2026  agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file list_columns.c
+ *  @short List the rows of a column table, as written by simtel2columns,
+ *         which pass range cuts.
+ *
+ *  Only the columns to be shown and those with cuts get decoded, and
+ *  chunks where no row can pass the cuts are not even read.
+ *
+ *  @author agent
+ *  @date   2026
+ */
+
+/** @defgroup list_columns_c The list_columns program */
+/** @{ */
+
+#include "initial.h"      /* This file includes others as required. */
+#include "io_basic.h"     /* This file includes others as required. */
+#include "io_history.h"
+#include "io_columns.h"
+#include "fileopen.h"
+
+#define MAX_SHOW 32
+
+/** Show program syntax */
+
+static void syntax (char *program);
+
+static void syntax (char *program)
+{
+   printf("List the rows of a column table which pass range cuts.\n\n");
+
+   printf("Syntax: %s [ options ] input_fname\n",program);
+   printf("Options:\n");
+   printf("   -t name            (Table name, default: the first one in the file.)\n");
+   printf("   -c col1,col2,...   (Columns to be shown, default: all.)\n");
+   printf("   --cut col min max  (Only rows with values in the given range.)\n");
+   printf("   --count            (Only count the rows passing the cuts.)\n");
+   exit(1);
+}
+
+/* -------------------- main program ---------------------- */
+/**
+ *  @short Main program
+ *
+ *  Main program function of list_columns.c program.
+ */
+
+int main (int argc, char **argv)
+{
+   IO_BUFFER *iobuf;
+   IO_COLUMN_TABLE *tab;
+   const char *input_fname = NULL, *table_name = NULL;
+   char *column_names = NULL;
+   char *program = argv[0];
+   int iarg, i, icol, num_show = 0, num_cuts = 0, count_only = 0;
+   int show[COL_MAX_COLUMNS];
+   const char *cut_name[COL_MAX_CUTS];
+   double cut_min[COL_MAX_CUTS], cut_max[COL_MAX_CUTS];
+   long nrows, npass = 0;
+   size_t irow;
+
+   for (iarg=1; iarg<argc; iarg++)
+   {
+      if ( strcmp(argv[iarg],"-t") == 0 && iarg+1 < argc )
+         table_name = argv[++iarg];
+      else if ( strcmp(argv[iarg],"-c") == 0 && iarg+1 < argc )
+         column_names = argv[++iarg];
+      else if ( strcmp(argv[iarg],"--cut") == 0 && iarg+3 < argc &&
+                num_cuts < COL_MAX_CUTS )
+      {
+         cut_name[num_cuts] = argv[++iarg];
+         cut_min[num_cuts] = atof(argv[++iarg]);
+         cut_max[num_cuts] = atof(argv[++iarg]);
+         num_cuts++;
+      }
+      else if ( strcmp(argv[iarg],"--count") == 0 )
+         count_only = 1;
+      else if ( argv[iarg][0] == '-' && argv[iarg][1] != '\0' )
+         syntax(program);
+      else if ( input_fname == NULL )
+         input_fname = argv[iarg];
+      else
+         syntax(program);
+   }
+   if ( input_fname == NULL )
+      syntax(program);
+
+   if ( (iobuf = allocate_io_buffer(1000000L)) == NULL ||
+        (tab = allocate_column_table(NULL,0,0)) == NULL )
+   {
+      Error("Cannot allocate I/O buffer");
+      exit(1);
+   }
+   if ( iobuf->max_length < 200000000 )
+      iobuf->max_length = 200000000;
+   if ( strcmp(input_fname ,"-") == 0 )
+      iobuf->input_file = stdin;
+   else if ( (iobuf->input_file = fileopen(input_fname,READ_BINARY)) == NULL )
+   {
+      perror(input_fname);
+      Error("Cannot open input file.");
+      exit(1);
+   }
+
+   if ( find_column_table(iobuf,tab,table_name) != 0 )
+   {
+      Error("No such table in input file.");
+      exit(1);
+   }
+
+   /* Columns to be shown (and decoded). */
+   if ( column_names != NULL )
+   {
+      char *s = column_names, *e;
+      for (;;)
+      {
+         if ( (e = strchr(s,',')) != NULL )
+            *e = '\0';
+         if ( (icol = select_column(tab,s)) < 0 )
+         {
+            fprintf(stderr,"No column '%s' in table '%s'.\n", s, tab->name);
+            exit(1);
+         }
+         if ( num_show < MAX_SHOW )
+            show[num_show++] = icol;
+         if ( e == NULL )
+            break;
+         s = e+1;
+      }
+   }
+   else if ( !count_only )
+   {
+      for ( icol=0; icol<tab->num_columns && num_show<MAX_SHOW; icol++ )
+         show[num_show++] = icol;
+   }
+   if ( count_only && column_names == NULL && num_cuts == 0 )
+   {
+      /* Decode at least one column. */
+      select_column(tab,tab->column[0].name);
+   }
+   for ( i=0; i<num_cuts; i++ )
+      if ( add_column_cut(tab,cut_name[i],cut_min[i],cut_max[i]) != 0 )
+         exit(1);
+
+   if ( !count_only )
+   {
+      printf("#");
+      for ( i=0; i<num_show; i++ )
+         printf(" %s", tab->column[show[i]].name);
+      printf("\n");
+   }
+
+   while ( (nrows = read_column_chunk(iobuf,tab)) > 0 )
+   {
+      for ( irow=0; irow<(size_t)nrows; irow++ )
+      {
+         if ( !column_row_passes(tab,irow) )
+            continue;
+         npass++;
+         if ( count_only )
+            continue;
+         for ( i=0; i<num_show; i++ )
+         {
+            const double *v;
+            size_t k, n = get_column_values(tab,show[i],irow,&v);
+            if ( (tab->column[show[i]].type & COL_ARRAY) )
+            {
+               printf("%s[%lu]", i>0 ? " " : "", (unsigned long) n);
+               for ( k=0; k<n; k++ )
+                  printf("%s%g", k>0 ? "," : "", v[k]);
+            }
+            else if ( n > 0 )
+               printf("%s%.10g", i>0 ? " " : "", v[0]);
+            else
+               printf("%s-", i>0 ? " " : "");
+         }
+         printf("\n");
+      }
+   }
+   if ( nrows < 0 )
+      Warning("Error reading column data.");
+
+   fprintf(stderr,"Table '%s': %ld of %ld rows read passed, %ld of %ld chunks skipped.\n",
+      tab->name, npass, tab->total_rows, tab->chunks_skipped,
+      tab->num_chunks + tab->chunks_skipped);
+
+   if ( iobuf->input_file != stdin )
+      fileclose(iobuf->input_file);
+   free_column_table(tab);
+   free_io_buffer(iobuf);
+
+   return 0;
+}
+
+/** @} */
@@ -29,11 +29,12 @@
     Input is from standard input by default, output to standard output.
 
 @verbatim
-    Syntax: listio [-s[n]] [-p] [filename]
+    Syntax: listio [-s[n]] [-p] [-i] [filename]
     List structure of eventio data files.
        -s : also list contained (sub-) items
        -sn: list sub-items up to depth n (n=0,1,...)
        -p : show positions of items in the file
+       -i : write a block index to 'filename.evidx' instead of listing
     If no file name given, standard input is used.
 @endverbatim
 
@@ -45,6 +46,7 @@
 #include "initial.h"
 #include "io_basic.h"
 #include "fileopen.h"
+#include "io_index.h"
 
 #if defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64
 # define USE_OFF_T 1
@@ -84,6 +86,7 @@ int main (int argc, char **argv)
    FILE *input;
    int verbosity = 0;
    int with_ext = 0;
+   int make_index = 0;
 
 #ifdef ALWAYS_WITH_REGISTRY
    /* Use default registry of known types with any compiler. */
@@ -126,9 +129,13 @@ int main (int argc, char **argv)
       {
          with_ext = 1;
       }
+      else if ( strcmp(argv[1],"-i") == 0 )
+      {
+         make_index = 1;
+      }
       else
       {
-         fprintf(stderr,"Syntax: listio [-s[n]] [-p] [filename]\n");
+         fprintf(stderr,"Syntax: listio [-s[n]] [-p] [-i] [filename]\n");
          fprintf(stderr,"List structure of eventio data files.\n");
          fprintf(stderr,"   -s : also list contained (sub-) items\n");
          fprintf(stderr,"   -sn: list sub-items up to depth n (n=0,1,...)\n");
@@ -137,6 +144,7 @@ int main (int argc, char **argv)
          fprintf(stderr,"   -d : show type names and descriptions where known\n");
          fprintf(stderr,"   -v : even more verbose than '-n' and '-d'\n");
          fprintf(stderr,"   -x : allow for extended length data blocks\n");
+         fprintf(stderr,"   -i : write a block index to 'filename.evidx' instead of listing\n");
          fprintf(stderr,"If no file name given, standard input is used.\n");
          exit(1);
       }
@@ -165,6 +173,31 @@ int main (int argc, char **argv)
    else
       iobuf->input_file = stdin;
    
+   if ( make_index )
+   {
+      IO_INDEX *idx;
+      char *idx_fname;
+      long n;
+      if ( argc <= 1 )
+      {
+         fprintf(stderr,"A block index can only be made for a named input file.\n");
+         exit(1);
+      }
+      if ( (idx = allocate_io_index()) == NULL ||
+           (idx_fname = io_index_fname(argv[1])) == NULL )
+         exit(1);
+      if ( (n = build_io_index(iobuf,idx)) < 0 ||
+           write_io_index(idx,idx_fname) != 0 )
+      {
+         fprintf(stderr,"Failed to make block index %s\n",idx_fname);
+         exit(1);
+      }
+      printf("Block index with %ld entries written to %s\n",n,idx_fname);
+      free(idx_fname);
+      free_io_index(idx);
+      exit(0);
+   }
+
    if ( show_pos && sub < 0 )
       sub = 0;
 
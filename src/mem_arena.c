@@ -0,0 +1,341 @@
+/* ============================================================================
+
+   Copyright (C) 2026  agent
+
+   This file is part of the eventio/hessio library.
+
+   The eventio/hessio library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library. If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file mem_arena.c
+ *  @short Arena (pool) allocator for data structures of the same lifetime.
+ *
+ *  On Unix-like systems the chunks are anonymous memory mappings,
+ *  which come zero-filled from the system and do not fragment the
+ *  heap. With huge pages requested, explicit huge pages are tried first
+ *  (if any are configured), then transparent huge pages are asked for.
+ *  Elsewhere the chunks come from calloc().
+ *
+ *  Memory handed out is always zeroed, like from calloc(). Since only
+ *  the part of a chunk used before a reset can be dirty, only that part
+ *  needs to be cleared again when it gets reused.
+ *
+ *  @author  agent
+ *  @date    2026
+ */
+
+#include "initial.h"
+#include "mem_arena.h"
+#include "warning.h"
+#ifdef OS_UNIX
+#include <sys/mman.h>
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#endif
+
+#define ARENA_ALIGN 64                 /**< Alignment of all pieces handed out */
+#define ARENA_HUGE_PAGE (2UL<<20)      /**< Typical huge page size */
+#define ARENA_DEFAULT_CHUNK (1UL<<20)  /**< Chunk size if none given */
+
+/** One chunk of memory, from which pieces are handed out in sequence. */
+struct mem_arena_chunk
+{
+   struct mem_arena_chunk *next;
+   unsigned char *data; /**< Start of usable memory, aligned */
+   size_t size;         /**< Usable bytes */
+   size_t used;         /**< Bytes handed out since the last reset */
+   size_t dirty;        /**< Bytes handed out at any time, to be cleared on reuse */
+   int mapped;          /**< Memory mapping (1) or from calloc() (0) */
+   void *mem;           /**< As obtained from the system */
+   size_t mem_size;     /**< Size obtained from the system */
+};
+
+struct mem_arena_struct
+{
+   struct mem_arena_chunk *first;  /**< All chunks, in the order of use */
+   struct mem_arena_chunk *last;
+   struct mem_arena_chunk *cur;    /**< Chunk currently handing out memory */
+   size_t chunk_size;              /**< Default size of new chunks */
+   int flags;                      /**< MEM_ARENA_... flags */
+};
+
+/* Get a new chunk with at least the given usable size. */
+
+static struct mem_arena_chunk *new_arena_chunk (size_t size, int flags)
+{
+   struct mem_arena_chunk *chunk;
+   size_t mem_size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN-1);
+
+   if ( (chunk = (struct mem_arena_chunk *) calloc(1,sizeof(*chunk))) == NULL )
+      return NULL;
+#ifdef OS_UNIX
+   {
+      void *mem = MAP_FAILED;
+      if ( (flags & MEM_ARENA_HUGE_PAGES) )
+      {
+         mem_size = (mem_size + ARENA_HUGE_PAGE - 1) & ~(size_t)(ARENA_HUGE_PAGE-1);
+# ifdef MAP_HUGETLB
+         mem = mmap(NULL,mem_size,PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,(off_t)0);
+# endif
+      }
+      if ( mem == MAP_FAILED )
+      {
+         mem = mmap(NULL,mem_size,PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS,-1,(off_t)0);
+# ifdef MADV_HUGEPAGE
+         if ( mem != MAP_FAILED && (flags & MEM_ARENA_HUGE_PAGES) )
+            (void) madvise(mem,mem_size,MADV_HUGEPAGE);
+# endif
+      }
+      if ( mem != MAP_FAILED )
+      {
+         /* Page-aligned and zero-filled already */
+         chunk->mem = mem;
+         chunk->mapped = 1;
+         chunk->data = (unsigned char *) mem;
+         chunk->size = chunk->mem_size = mem_size;
+         return chunk;
+      }
+   }
+#else
+   (void) flags;
+#endif
+   if ( (chunk->mem = calloc(1,mem_size+ARENA_ALIGN)) == NULL )
+   {
+      free(chunk);
+      return NULL;
+   }
+   chunk->mem_size = mem_size + ARENA_ALIGN;
+   chunk->data = (unsigned char *) (((uintptr_t) chunk->mem + ARENA_ALIGN - 1) &
+      ~(uintptr_t)(ARENA_ALIGN-1));
+   chunk->size = mem_size;
+   return chunk;
+}
+
+static void free_arena_chunk (struct mem_arena_chunk *chunk)
+{
+#ifdef OS_UNIX
+   if ( chunk->mapped )
+      munmap(chunk->mem,chunk->mem_size);
+   else
+#endif
+      free(chunk->mem);
+   free(chunk);
+}
+
+/* Append a new chunk and make it the current one. */
+
+static struct mem_arena_chunk *add_arena_chunk (MEM_ARENA *arena, size_t size)
+{
+   struct mem_arena_chunk *chunk;
+   if ( size < arena->chunk_size )
+      size = arena->chunk_size;
+   if ( (chunk = new_arena_chunk(size,arena->flags)) == NULL )
+   {
+      Warning("Not enough memory for arena chunk");
+      return NULL;
+   }
+   if ( arena->last != NULL )
+      arena->last->next = chunk;
+   else
+      arena->first = chunk;
+   arena->last = arena->cur = chunk;
+   return chunk;
+}
+
+/* ------------------------- allocate_mem_arena ------------------------ */
+/**
+ *  @short Set up a new memory arena, without any memory in it yet.
+ *
+ *  @param chunk_size  Usual size of the chunks taken from the system
+ *                     (0: default of 1 MB). Larger requests get
+ *                     chunks of their own.
+ *  @param flags       MEM_ARENA_HUGE_PAGES or 0.
+ *
+ *  @return Pointer to the arena or NULL.
+ */
+
+MEM_ARENA *allocate_mem_arena (size_t chunk_size, int flags)
+{
+   MEM_ARENA *arena = (MEM_ARENA *) calloc(1,sizeof(MEM_ARENA));
+   if ( arena == NULL )
+   {
+      Warning("Not enough memory for arena");
+      return NULL;
+   }
+   arena->chunk_size = (chunk_size > 0) ? chunk_size : ARENA_DEFAULT_CHUNK;
+   arena->flags = flags;
+   return arena;
+}
+
+/* --------------------------- free_mem_arena -------------------------- */
+/**
+ *  @short Give all memory of the arena back to the system.
+ *         Any pointers into it are invalid afterwards.
+ */
+
+void free_mem_arena (MEM_ARENA *arena)
+{
+   struct mem_arena_chunk *chunk, *next;
+   if ( arena == NULL )
+      return;
+   for ( chunk=arena->first; chunk!=NULL; chunk=next )
+   {
+      next = chunk->next;
+      free_arena_chunk(chunk);
+   }
+   free(arena);
+}
+
+/* --------------------------- reset_mem_arena ------------------------- */
+/**
+ *  @short Make all memory of the arena available again, keeping it
+ *         for later use. Any pointers into it are invalid afterwards.
+ */
+
+void reset_mem_arena (MEM_ARENA *arena)
+{
+   struct mem_arena_chunk *chunk;
+   if ( arena == NULL )
+      return;
+   for ( chunk=arena->first; chunk!=NULL; chunk=chunk->next )
+      chunk->used = 0;
+   arena->cur = arena->first;
+}
+
+/* -------------------------- reserve_mem_arena ------------------------ */
+/**
+ *  @short Make sure that the given number of bytes can be handed out
+ *         from one chunk, for bulk allocation of everything needed.
+ *
+ *  If nothing is in use and the existing chunks are too small, they are
+ *  replaced by a single chunk of the requested size, so that the arena
+ *  does not keep growing in pieces if requirements change.
+ *
+ *  @return 0 (o.k.), -1 (not enough memory)
+ */
+
+int reserve_mem_arena (MEM_ARENA *arena, size_t size)
+{
+   struct mem_arena_chunk *chunk;
+   int in_use = 0;
+
+   if ( arena == NULL )
+      return -1;
+   size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN-1);
+   for ( chunk=arena->cur; chunk!=NULL; chunk=chunk->next )
+      if ( chunk->size - chunk->used >= size )
+      {
+         arena->cur = chunk;
+         return 0;
+      }
+   for ( chunk=arena->first; chunk!=NULL; chunk=chunk->next )
+      if ( chunk->used > 0 )
+         in_use = 1;
+   if ( !in_use )
+   {
+      struct mem_arena_chunk *next;
+      for ( chunk=arena->first; chunk!=NULL; chunk=next )
+      {
+         next = chunk->next;
+         free_arena_chunk(chunk);
+      }
+      arena->first = arena->last = arena->cur = NULL;
+   }
+   return (add_arena_chunk(arena,size) != NULL) ? 0 : -1;
+}
+
+/* --------------------------- mem_arena_calloc ------------------------ */
+/**
+ *  @short Zeroed memory for num elements of given size, aligned to
+ *         64 bytes. It cannot be released individually, only with
+ *         reset_mem_arena() or free_mem_arena().
+ *
+ *  @return Pointer to the memory or NULL.
+ */
+
+void *mem_arena_calloc (MEM_ARENA *arena, size_t num, size_t size)
+{
+   struct mem_arena_chunk *chunk;
+   size_t n;
+   unsigned char *p;
+
+   if ( arena == NULL || (size > 0 && num > (size_t)-1 / size) )
+      return NULL;
+   n = (num * size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN-1);
+   if ( n == 0 )
+      n = ARENA_ALIGN;
+
+   for ( chunk=arena->cur; chunk!=NULL; chunk=chunk->next )
+      if ( chunk->size - chunk->used >= n )
+         break;
+   if ( chunk == NULL && (chunk = add_arena_chunk(arena,n)) == NULL )
+      return NULL;
+   arena->cur = chunk;
+
+   p = chunk->data + chunk->used;
+   /* Only memory handed out before can be non-zero. */
+   if ( chunk->used < chunk->dirty )
+      memset(p,0,(chunk->dirty - chunk->used < n) ? chunk->dirty - chunk->used : n);
+   chunk->used += n;
+   if ( chunk->used > chunk->dirty )
+      chunk->dirty = chunk->used;
+   return p;
+}
+
+/* --------------------------- mem_arena_used -------------------------- */
+/**
+ *  @short Number of bytes handed out since the last reset, and
+ *         (if total is not NULL) the total size of all chunks.
+ */
+
+size_t mem_arena_used (const MEM_ARENA *arena, size_t *total)
+{
+   const struct mem_arena_chunk *chunk;
+   size_t used = 0;
+   if ( total != NULL )
+      *total = 0;
+   if ( arena == NULL )
+      return 0;
+   for ( chunk=arena->first; chunk!=NULL; chunk=chunk->next )
+   {
+      used += chunk->used;
+      if ( total != NULL )
+         *total += chunk->size;
+   }
+   return used;
+}
+
+/* --------------------------- mem_arena_owns -------------------------- */
+/**
+ *  @short Check if memory at the given address is part of the arena,
+ *         as opposed to memory obtained in other ways.
+ *
+ *  @return 1 (in one of the chunks of the arena), 0 (not)
+ */
+
+int mem_arena_owns (const MEM_ARENA *arena, const void *ptr)
+{
+   const struct mem_arena_chunk *chunk;
+   uintptr_t p = (uintptr_t) ptr;
+   if ( arena == NULL || ptr == NULL )
+      return 0;
+   for ( chunk=arena->first; chunk!=NULL; chunk=chunk->next )
+      if ( p >= (uintptr_t) chunk->data && p < (uintptr_t) chunk->data + chunk->size )
+         return 1;
+   return 0;
+}
@@ -87,6 +87,8 @@ Options:
 #include "fileopen.h"
 #include "straux.h"
 #include "warning.h"
+#include "io_prefetch.h"
+#include "io_writebehind.h"
 #include "io_trgmask.h"
 #include "eventio_version.h"
 #include "unused.h"
@@ -221,19 +223,24 @@ int find_mapped_telescope (int tel_id, int ifile)
 
 /* ----------------------------------------------------------------------- */
 /** 
- *  Write an I/O block as-is to another file than foreseen for the I/O buffer.
+ *  Write an I/O block as-is to the output file of another I/O buffer.
+ *  Anything still queued for asynchronous output in that buffer goes first.
  */
 
-int write_io_block_to_file (IO_BUFFER *iobuf, FILE *f);
+int write_io_block_to_file (IO_BUFFER *iobuf, IO_BUFFER *iobuf_out);
 
-int write_io_block_to_file (IO_BUFFER *iobuf, FILE *f)
+int write_io_block_to_file (IO_BUFFER *iobuf, IO_BUFFER *iobuf_out)
 {
    int rc = 0;
+   FILE *f = (iobuf_out != NULL) ? iobuf_out->output_file : NULL;
    if ( iobuf != NULL && f != NULL )
    {
       FILE *t = iobuf->output_file;
+      if ( flush_io_writebehind(iobuf_out) != 0 )
+         rc = -1;
       iobuf->output_file = f;
-      rc = write_io_block(iobuf);
+      if ( write_io_block(iobuf) != 0 )
+         rc = -1;
       iobuf->output_file = t;
    }
    return rc;
@@ -493,7 +500,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
          {
             if ( hsdata->event.teldata[itel].raw != NULL )
             {
-               free(hsdata->event.teldata[itel].raw);
+               free_adc_data(hsdata->event.teldata[itel].raw);
                hsdata->event.teldata[itel].raw = NULL;
             }
             if ( hsdata->event.teldata[itel].pixtm != NULL )
@@ -520,7 +527,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
             {
                if ( hsdata_out->event.teldata[itel3].raw != NULL )
                {
-                  free(hsdata_out->event.teldata[itel3].raw);
+                  free_adc_data(hsdata_out->event.teldata[itel3].raw);
                   hsdata_out->event.teldata[itel3].raw = NULL;
                }
                if ( hsdata_out->event.teldata[itel3].pixtm != NULL )
@@ -831,13 +838,13 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
          /* Except for the detector simulation version, which could differ, */
          /* pretty much everything should be identical. */
          /* Nevertheless, record both MC run headers as they came in. */
-         rc = write_io_block_to_file (iobuf,iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
       case IO_TYPE_MC_INPUTCFG: /* 1212 */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing input cfg to output, rc=%d\n", rc);
          break;
@@ -845,7 +852,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
       /* =================================================== */
       case IO_TYPE_MC_ATMPROF: /* 1216 */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing atmospheric density profile to output, rc=%d\n", rc);
          break;
@@ -853,7 +860,7 @@ printf("Now processing item type %d (ID=%ld) from file %d ...\n",
       /* =================================================== */
       case IO_TYPE_HISTORY: /* 70: How sim_hessarray was run and how it was configured. */
          /* Copy to output buffer without unpacking it, if possible ... */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          if ( rc != 0 || verbose )
             printf("writing history to output, rc=%d\n", rc);
          break;
@@ -1272,6 +1279,9 @@ if ( ev_hess_event > 0 && ev_hess_event < item_header->ident )
                   if ( adi != NULL && ado != NULL )
                   {
                    ado->known = adi->known;
+                   if ( ado->known && alloc_adc_samples(ado,
+                          adi->num_gains,adi->num_pixels,adi->num_samples) != 0 )
+                      ado->known = 0;
                    if ( ado->known )
                    {
                      int kg, kp, ks;
@@ -1297,7 +1307,7 @@ if ( ev_hess_event > 0 && ev_hess_event < item_header->ident )
                            ado->adc_known[kg][kp] = adi->adc_known[kg][kp];
                            ado->adc_sum[kg][kp] = adi->adc_sum[kg][kp];
                            for ( ks=0; ks<ado->num_samples; ks++ )
-                              ado->adc_sample[kg][kp][ks] = adi->adc_sample[kg][kp][ks];
+                              ADC_SAMPLES(ado,kg,kp)[ks] = ADC_SAMPLES(adi,kg,kp)[ks];
                         }
                      }
                    }
@@ -1445,7 +1455,7 @@ exit(1);
             }
             memcpy(&hsdata_out->mc_shower,&hsdata->mc_shower,sizeof(hsdata->mc_shower));
             /* Write the original data block to the output file. */
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          }
          else
          {
@@ -1511,7 +1521,7 @@ exit(1);
             }
             /* Write the original data block to the output file. */
             /* The other data reset above is not part of the I/O block. */
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          }
          else
          {
@@ -1698,7 +1708,7 @@ if ( ev_pe_sum > 0 && ev_pe_sum < item_header->ident )
          memcpy(&hsdata_out->run_stat,&hsdata->run_stat,sizeof(hsdata->run_stat));
          /* Copy the data block from input 1 and ignore that from input 2. */
          if ( ifile == 1 )
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -1716,7 +1726,7 @@ if ( ev_pe_sum > 0 && ev_pe_sum < item_header->ident )
          memcpy(&hsdata_out->mc_run_stat,&hsdata->mc_run_stat,sizeof(hsdata->mc_run_stat));
           /* Copy the data block from input 1 and ignore that from input 2. */
          if ( ifile == 1 )
-            rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+            rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -1742,7 +1752,7 @@ if ( ev_pe_sum > 0 && ev_pe_sum < item_header->ident )
          /* typically from file 2, if available. But if file 2 has no histogram */
          /* block at a matching position, it could be from file 1.  */
          /* Thus no extra check here. */
-         rc = write_io_block_to_file(iobuf, iobuf_out->output_file);
+         rc = write_io_block_to_file(iobuf, iobuf_out);
          break;
 
       /* =================================================== */
@@ -2008,6 +2018,8 @@ static void syntax (const char *program)
    printf("     --clean-history-after n : Similar but keep first n blocks.\n");
    printf("     --no-stray-mc-runheader : Ignore MC runheaders before the main run header.\n");
    printf("     --single-corsika-inputs : Keep only the first CORSIKA inputs block.\n");
+   printf("     --prefetch n    : Read up to n blocks of each input ahead in the background.\n");
+   printf("     --write-behind n : Queue up to n output blocks for writing in the background.\n");
    printf("\nCompiled for a maximum of %d telescopes before and after merging.\n", H_MAX_TEL);
    printf("Linked against eventIO/hessio library\n");
 #ifdef EVENTIO_VERSION
@@ -2050,6 +2062,7 @@ int main (int argc, char **argv)
    int prev_type1 = 0, prev_type2 = 0;
    int this_type1 = 0, this_type2 = 0;
    int no_stray_mc = 0, single_corsika_inputs = 0, have_corsika_inputs = 0;
+   int prefetch_blocks = 0, writebehind_blocks = 0;
    
    H_CHECK_MAX();
 
@@ -2130,6 +2143,18 @@ int main (int argc, char **argv)
             iarg++;
             continue;
          }
+         else if ( strcmp(argv[iarg],"--prefetch") == 0 && iarg+1<argc )
+         {
+            prefetch_blocks = atoi(argv[iarg+1]);
+            iarg++;
+            continue;
+         }
+         else if ( strcmp(argv[iarg],"--write-behind") == 0 && iarg+1<argc )
+         {
+            writebehind_blocks = atoi(argv[iarg+1]);
+            iarg++;
+            continue;
+         }
          else
          {
             if ( strcmp(argv[iarg],"--help") != 0 && strcmp(argv[iarg],"--version") != 0 )
@@ -2213,6 +2238,13 @@ int main (int argc, char **argv)
       perror(output_fname);
       exit(1);
    }
+   if ( prefetch_blocks > 0 )
+   {
+      (void) start_io_prefetch(iobuf1,prefetch_blocks);
+      (void) start_io_prefetch(iobuf2,prefetch_blocks);
+   }
+   if ( writebehind_blocks > 0 )
+      (void) start_io_writebehind(iobuf3,writebehind_blocks);
    write_history(9,iobuf3);
 
    for (;;) /* Loop over all data in both input files */
@@ -2687,6 +2719,9 @@ printf("Type2 = %d, ID = %ld\n", this_type2, item_header2.ident);
 
    }
    
+   stop_io_prefetch(iobuf1);
+   stop_io_prefetch(iobuf2);
+   stop_io_writebehind(iobuf3);
    fileclose(iobuf1->input_file);
    fileclose(iobuf2->input_file);
    fileclose(iobuf3->output_file);
@@ -177,6 +177,8 @@ Options:
    --output-file   (Synonym to --dst-file)
    --histogram-file name (Name of histogram file.)
    -f fname        (Get list of input file names from fname.)
+   --no-mmap       (Do not memory-map uncompressed input files.)
+   --prefetch n    (Read up to n data blocks ahead in a background thread.)
 
 Parameters followed by a '*' can be type-specific if preceded by a
 '--type' option. Their interpretation is thus position-dependent.
@@ -196,11 +198,13 @@ Parameters followed by a '*' can be type-specific if preceded by a
 #include "mc_tel.h"
 #include "io_history.h"
 #include "io_hess.h"
+#include "mem_arena.h"
 #include "histogram.h"
 #include "io_histogram.h"
 #include "fileopen.h"
 #include "straux.h"
 #include "rec_tools.h"
+#include "io_prefetch.h"
 #include "reconstruct.h"
 #include "user_analysis.h"
 #include "warning.h"
@@ -638,6 +642,10 @@ static void syntax (char *program)
    printf("   --check-missing-pe-list (Check if any p.e. lists are missing.)\n");
 #endif
    printf("   -f fname        (Get list of input file names from fname.)\n");
+#ifdef EVENTIO_HAVE_MMAP
+   printf("   --no-mmap       (Do not memory-map uncompressed input files.)\n");
+#endif
+   printf("   --prefetch n    (Read up to n data blocks ahead in a background thread.)\n");
 
    printf("\nParameters followed by a '*' can be type-specific if preceded by a\n"
           "'--type' option. Their interpretation is thus position-dependent.\n");
@@ -921,6 +929,8 @@ int main (int argc, char **argv)
    const char *input_fname = NULL;
    int itel, rc = 0;
    int tel_id;
+   int alloc_parts;
+   MEM_ARENA *run_arena = NULL; /* Kept from one run to the next */
    const char *ps_fname = "none";
    int verbose = 0, ignore = 0, quiet = 0;
    int reco_flag = 0;
@@ -936,6 +946,10 @@ int main (int argc, char **argv)
    char base_program[1024];
    int showdata = 0, showhistory = 0;
    int clean_history = 0;
+#ifdef EVENTIO_HAVE_MMAP
+   int use_mmap = 1;
+#endif
+   int prefetch_blocks = 0;
    int flag_amp_tm = 0;
    size_t num_only = 0, num_not = 0, num_onlytype = 0;
    FILE *ntuple_file = NULL;
@@ -1301,6 +1315,22 @@ int main (int argc, char **argv)
          argv++;
          continue;
       }
+#ifdef EVENTIO_HAVE_MMAP
+      else if ( strcmp(argv[1],"--no-mmap") == 0 )
+      {
+         use_mmap = 0;
+         argc--;
+         argv++;
+         continue;
+      }
+#endif
+      else if ( strcmp(argv[1],"--prefetch") == 0 && argc > 2 )
+      {
+         prefetch_blocks = atoi(argv[2]);
+         argc -= 2;
+         argv += 2;
+         continue;
+      }
       else if ( strcmp(argv[1],"-s") == 0 )
       {
          showdata = 1;
@@ -2708,6 +2738,15 @@ int main (int argc, char **argv)
     }
 #endif
 
+#ifdef EVENTIO_HAVE_MMAP
+    /* Plain disk files are read without copying; pipes etc. as usual. */
+    if ( use_mmap && iobuf->input_file != NULL )
+       (void) map_io_buffer_input(iobuf,fileno(iobuf->input_file));
+#endif
+    /* Otherwise (pipes, compressed input) reading can overlap with processing. */
+    if ( prefetch_blocks > 0 && iobuf->input_file != NULL )
+       (void) start_io_prefetch(iobuf,prefetch_blocks);
+
     for (;;) /* Loop over all data in the input file */
     {
       if ( interrupted )
@@ -2862,33 +2901,12 @@ int main (int argc, char **argv)
             /* Structures might be allocated from previous run */
             if ( hsdata != NULL )
             {
-               /* Free memory allocated inside ... */
-               for (itel=0; itel<hsdata->run_header.ntel; itel++)
-               {
-                  if ( hsdata->event.teldata[itel].raw != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].raw);
-                     hsdata->event.teldata[itel].raw = NULL;
-                  }
-                  if ( hsdata->event.teldata[itel].pixtm != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].pixtm);
-                     hsdata->event.teldata[itel].pixtm = NULL;
-                  }
-                  if ( hsdata->event.teldata[itel].img != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].img);
-                     hsdata->event.teldata[itel].img = NULL;
-                  }
-                  if ( hsdata->event.teldata[itel].pixcal != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].pixcal);
-                     hsdata->event.teldata[itel].pixcal = NULL;
-                  }
-               }
+               /* Free memory allocated inside, keeping the arena for the next run ... */
+               release_hess_run_data(hsdata);
                /* Free main structure */
                if ( !dst_processing )
                {
+                  run_arena = hsdata->arena;
                   free(hsdata);
                   hsdata = NULL;
                }
@@ -2902,7 +2920,14 @@ int main (int argc, char **argv)
             nrun++;
 
             if ( hsdata == NULL )
-               hsdata = (AllHessData *) calloc(1,sizeof(AllHessData));
+            {
+               if ( (hsdata = (AllHessData *) calloc(1,sizeof(AllHessData))) == NULL )
+               {
+                  Warning("Not enough memory");
+                  exit(1);
+               }
+               hsdata->arena = run_arena;
+            }
 
             fflush(stdout);
             if ( (rc = read_simtel_runheader(iobuf,&hsdata->run_header)) < 0 )
@@ -2931,59 +2956,13 @@ int main (int argc, char **argv)
 
             /* Allocate dynamic sub-structures and set up telescope ID in all sub-structures */
 
-            for (itel=0; itel<hsdata->run_header.ntel; itel++)
+            alloc_parts = HS_ALLOC_RAW | HS_ALLOC_PIXTM | HS_ALLOC_IMG;
+            if ( do_calibrate && dst_level >= 0 ) /* Only when needed */
+               alloc_parts |= HS_ALLOC_PIXCAL;
+            if ( alloc_hess_run_data(hsdata,alloc_parts) != 0 )
             {
-               tel_id = hsdata->run_header.tel_id[itel];
-               hsdata->camera_set[itel].tel_id = tel_id;
-               hsdata->camera_org[itel].tel_id = tel_id;
-               hsdata->pixel_set[itel].tel_id = tel_id;
-               hsdata->pixel_disabled[itel].tel_id = tel_id;
-               hsdata->cam_soft_set[itel].tel_id = tel_id;
-               hsdata->tracking_set[itel].tel_id = tel_id;
-               hsdata->point_cor[itel].tel_id = tel_id;
-               hsdata->event.num_tel = hsdata->run_header.ntel;
-               hsdata->event.teldata[itel].tel_id = tel_id;
-               hsdata->event.trackdata[itel].tel_id = tel_id;
-
-               if ( (hsdata->event.teldata[itel].raw = 
-                      (AdcData *) calloc(1,sizeof(AdcData))) == NULL )
-               {
-                  Warning("Not enough memory for AdcData");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].raw->tel_id = tel_id;
-
-               if ( (hsdata->event.teldata[itel].pixtm =
-                     (PixelTiming *) calloc(1,sizeof(PixelTiming))) == NULL )
-               {
-                  Warning("Not enough memory for PixelTiming");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].pixtm->tel_id = tel_id;
-
-               if ( do_calibrate && dst_level >= 0 ) /* Only when needed */
-               {
-                  if ( (hsdata->event.teldata[itel].pixcal = 
-                         (PixelCalibrated *) calloc(1,sizeof(PixelCalibrated))) == NULL )
-                  {
-                     Warning("Not enough memory for PixelCalibrated");
-                     exit(1);
-                  }
-                  hsdata->event.teldata[itel].pixcal->tel_id = tel_id;
-               }
-
-               if ( (hsdata->event.teldata[itel].img = 
-                      (ImgData *) calloc(2,sizeof(ImgData))) == NULL )
-               {
-                  Warning("Not enough memory for ImgData");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].max_image_sets = 2;
-               hsdata->event.teldata[itel].img[0].tel_id = tel_id;
-               hsdata->event.teldata[itel].img[1].tel_id = tel_id;
-
-               hsdata->tel_moni[itel].tel_id = tel_id;
-               hsdata->tel_lascal[itel].tel_id = tel_id;
+               Warning("Not enough memory for telescope data");
+               exit(1);
             }
 
             skip_run = skip_shower = 0;
@@ -3298,6 +3277,8 @@ int main (int argc, char **argv)
                printf("Done with manual setting of disabled pixels.\n");
                disabled_list_done = 1;
             }
+            /* Only clear what the previous event filled in. */
+            hs_event_recycle(hsdata);
             rc = read_simtel_event(iobuf,&hsdata->event,-1);
             if ( verbose || rc != 0 )
                printf("read_simtel_event(), rc = %d\n",rc);
@@ -4361,6 +4342,7 @@ int main (int argc, char **argv)
     
     /* ================ Done with this input data file ============== */
 
+    stop_io_prefetch(iobuf);
     if ( iobuf->input_file != NULL && iobuf->input_file != stdin )
       fileclose(iobuf->input_file);
     iobuf->input_file = NULL;
@@ -4426,31 +4408,9 @@ int main (int argc, char **argv)
    free_all_histograms();
    histogram_hashing(0);
 
+   free_hess_run_data(hsdata);
    for (itel=0; itel<hsdata->run_header.ntel; itel++)
-   {
-      if ( hsdata->event.teldata[itel].raw != NULL )
-      {
-         free(hsdata->event.teldata[itel].raw);
-         hsdata->event.teldata[itel].raw = NULL;
-      }
-      if ( hsdata->event.teldata[itel].pixtm != NULL )
-      {
-         free(hsdata->event.teldata[itel].pixtm);
-         hsdata->event.teldata[itel].pixtm = NULL;
-      }
-      if ( hsdata->event.teldata[itel].pixcal != NULL )
-      {
-         free(hsdata->event.teldata[itel].pixcal);
-         hsdata->event.teldata[itel].pixcal = NULL;
-      }
-      if ( hsdata->event.teldata[itel].img != NULL )
-      {
-         free(hsdata->event.teldata[itel].img);
-         hsdata->event.teldata[itel].img = NULL;
-      }
-      
       deallocate_nb_list(itel);
-   }
    if ( hsdata->run_header.target != NULL )
    {
       free(hsdata->run_header.target);
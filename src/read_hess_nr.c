@@ -58,6 +58,7 @@ Options:
 #include "mc_tel.h"
 #include "io_history.h"
 #include "io_hess.h"
+#include "mem_arena.h"
 #include "histogram.h"
 #include "io_histogram.h"
 #include "fileopen.h"
@@ -265,6 +266,7 @@ int main (int argc, char **argv)
    const char *input_fname = NULL;
    int itel, rc = 0;
    int tel_id;
+   MEM_ARENA *run_arena = NULL; /* Kept from one run to the next */
    const char *ps_fname = "none";
    int verbose = 0, ignore = 0, quiet = 0;
    int reco_flag = 0;
@@ -529,25 +531,9 @@ int main (int argc, char **argv)
             /* Structures might be allocated from previous run */
             if ( hsdata != NULL )
             {
-               /* Free memory allocated inside ... */
-               for (itel=0; itel<hsdata->run_header.ntel; itel++)
-               {
-                  if ( hsdata->event.teldata[itel].raw != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].raw);
-                     hsdata->event.teldata[itel].raw = NULL;
-                  }
-                  if ( hsdata->event.teldata[itel].pixtm != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].pixtm);
-                     hsdata->event.teldata[itel].pixtm = NULL;
-                  }
-                  if ( hsdata->event.teldata[itel].img != NULL )
-                  {
-                     free(hsdata->event.teldata[itel].img);
-                     hsdata->event.teldata[itel].img = NULL;
-                  }
-               }
+               /* Free memory allocated inside, keeping the arena for the next run ... */
+               release_hess_run_data(hsdata);
+               run_arena = hsdata->arena;
                /* Free main structure */
                free(hsdata);
                hsdata = NULL;
@@ -556,6 +542,12 @@ int main (int argc, char **argv)
                
             }
             hsdata = (AllHessData *) calloc(1,sizeof(AllHessData));
+            if ( hsdata == NULL )
+            {
+               Warning("Not enough memory");
+               exit(1);
+            }
+            hsdata->arena = run_arena;
             if ( (rc = read_simtel_runheader(iobuf,&hsdata->run_header)) < 0 )
             {
                Warning("Reading run header failed.");
@@ -569,44 +561,11 @@ int main (int argc, char **argv)
             if ( showdata )
                print_simtel_runheader(iobuf);
 
-            for (itel=0; itel<hsdata->run_header.ntel; itel++)
+            /* Allocate dynamic sub-structures and set up telescope ID in all sub-structures */
+            if ( alloc_hess_run_data(hsdata,HS_ALLOC_RAW|HS_ALLOC_PIXTM|HS_ALLOC_IMG) != 0 )
             {
-               tel_id = hsdata->run_header.tel_id[itel];
-               hsdata->camera_set[itel].tel_id = tel_id;
-               hsdata->camera_org[itel].tel_id = tel_id;
-               hsdata->pixel_set[itel].tel_id = tel_id;
-               hsdata->pixel_disabled[itel].tel_id = tel_id;
-               hsdata->cam_soft_set[itel].tel_id = tel_id;
-               hsdata->tracking_set[itel].tel_id = tel_id;
-               hsdata->point_cor[itel].tel_id = tel_id;
-               hsdata->event.num_tel = hsdata->run_header.ntel;
-               hsdata->event.teldata[itel].tel_id = tel_id;
-               hsdata->event.trackdata[itel].tel_id = tel_id;
-               if ( (hsdata->event.teldata[itel].raw = 
-                      (AdcData *) calloc(1,sizeof(AdcData))) == NULL )
-               {
-                  Warning("Not enough memory");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].raw->tel_id = tel_id;
-               if ( (hsdata->event.teldata[itel].pixtm =
-                     (PixelTiming *) calloc(1,sizeof(PixelTiming))) == NULL )
-               {
-                  Warning("Not enough memory");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].pixtm->tel_id = tel_id;
-               if ( (hsdata->event.teldata[itel].img = 
-                      (ImgData *) calloc(2,sizeof(ImgData))) == NULL )
-               {
-                  Warning("Not enough memory");
-                  exit(1);
-               }
-               hsdata->event.teldata[itel].max_image_sets = 2;
-               hsdata->event.teldata[itel].img[0].tel_id = tel_id;
-               hsdata->event.teldata[itel].img[1].tel_id = tel_id;
-               hsdata->tel_moni[itel].tel_id = tel_id;
-               hsdata->tel_lascal[itel].tel_id = tel_id;
+               Warning("Not enough memory");
+               exit(1);
             }
             break;
 
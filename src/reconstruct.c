@@ -733,7 +733,7 @@ int calibrate_amplitude(AllHessData *hsdata, int itel,
    raw = te->raw;
    if ( raw == NULL )
       no_raw = 1;
-   else if ( !raw->known )
+   else if ( decode_adc_samples(raw) < 0 || !raw->known ) /* Samples may still be pending */
       no_raw = 1;
    if ( no_raw ) /* If no raw data is available but calibrated data we use that */
    {
@@ -1011,7 +1011,7 @@ double calibrate_pixel_amplitude(AllHessData *hsdata, int itel,
    raw = te->raw;
    if ( raw == NULL )
       no_raw = 1;
-   else if ( !raw->known )
+   else if ( decode_adc_samples(raw) < 0 || !raw->known ) /* Samples may still be pending */
       no_raw = 1;
    if ( no_raw ) /* If no raw data is available but calibrated data we use that */
    {
@@ -1044,13 +1044,13 @@ double calibrate_pixel_amplitude(AllHessData *hsdata, int itel,
       /* For zero-suppressed sample mode data check relevant bit */
       if ( (raw->zero_sup_mode & 0x20) != 0 && (raw->significant[i] & 0x020) == 0 )
          return 0.;
-      sig_hg = hg_known ? (raw->adc_sample[HI_GAIN][i][itime] -
+      sig_hg = hg_known ? (ADC_SAMPLES(raw,HI_GAIN,i)[itime] -
            moni->pedestal[HI_GAIN][i]/(double)raw->num_samples) : 0;
       npe = npe_hg = sig_hg * lcal->calib[HI_GAIN][i];
 #if (H_MAX_GAINS >= 2 )
       if ( lg_known )
       {
-         sig_lg = raw->adc_sample[LO_GAIN][i][itime] -
+         sig_lg = ADC_SAMPLES(raw,LO_GAIN,i)[itime] -
             moni->pedestal[LO_GAIN][i]/(double)raw->num_samples;
          npe_lg = sig_lg * lcal->calib[LO_GAIN][i];
          /* FIXME: need to make the high/low switch-over point flexible */
@@ -1198,7 +1198,7 @@ static int simple_integration(AllHessData *hsdata, int itel, int nsum, int nskip
          {
             int sum = 0;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[igain][ipix][isamp+nskip];
+               sum += ADC_SAMPLES(raw,igain,ipix)[isamp+nskip];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -1280,18 +1280,18 @@ static int global_peak_integration(AllHessData *hsdata, int itel, int nsum, int
             int significant = 0, ipeak = -1, p=0;
             for ( isamp=0; isamp<raw->num_samples; isamp++ )
             {
-               if ( raw->adc_sample[igain][ipix][isamp] - pedsamp >= sigamp[igain] )
+               if ( ADC_SAMPLES(raw,igain,ipix)[isamp] - pedsamp >= sigamp[igain] )
                {
                   int isamp2;
                   significant = 1;
                   ipeak = isamp;
-                  p = raw->adc_sample[igain][ipix][isamp];
+                  p = ADC_SAMPLES(raw,igain,ipix)[isamp];
                   for ( isamp2=isamp+1; isamp2<raw->num_samples; isamp2++ )
                   {
-                     if ( raw->adc_sample[igain][ipix][isamp2] > p )
+                     if ( ADC_SAMPLES(raw,igain,ipix)[isamp2] > p )
                      {
                         ipeak = isamp2;
-                        p = raw->adc_sample[igain][ipix][isamp2];
+                        p = ADC_SAMPLES(raw,igain,ipix)[isamp2];
                      }
                   }
                   break;
@@ -1352,7 +1352,7 @@ teldata->tel_id, npeaks, peakpos, start, integration_correction[itel][0]);
          {
             int sum = 0;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[igain][ipix][isamp+start];
+               sum += ADC_SAMPLES(raw,igain,ipix)[isamp+start];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -1432,18 +1432,18 @@ static int local_peak_integration(AllHessData *hsdata, int itel, int nsum, int n
          int significant = 0, ipeak = -1, p=0;
          for ( isamp=0; isamp<raw->num_samples; isamp++ )
          {
-            if ( raw->adc_sample[HI_GAIN][ipix][isamp] - pedsamp >= sigamp[HI_GAIN] )
+            if ( ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp] - pedsamp >= sigamp[HI_GAIN] )
             {
                int isamp2;
                significant = 1;
                ipeak = isamp;
-               p = raw->adc_sample[HI_GAIN][ipix][isamp];
+               p = ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp];
                for ( isamp2=isamp+1; isamp2<raw->num_samples; isamp2++ )
                {
-                  if ( raw->adc_sample[HI_GAIN][ipix][isamp2] > p )
+                  if ( ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp2] > p )
                   {
                      ipeak = isamp2;
-                     p = raw->adc_sample[HI_GAIN][ipix][isamp2];
+                     p = ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp2];
                   }
                }
                break;
@@ -1459,7 +1459,7 @@ static int local_peak_integration(AllHessData *hsdata, int itel, int nsum, int n
             if ( start + nsum > raw->num_samples )
                start = raw->num_samples - nsum;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[HI_GAIN][ipix][isamp+start];
+               sum += ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp+start];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -1483,18 +1483,18 @@ static int local_peak_integration(AllHessData *hsdata, int itel, int nsum, int n
          int significant = 0, ipeak = -1, p=0;
          for ( isamp=0; isamp<raw->num_samples; isamp++ )
          {
-            if ( raw->adc_sample[LO_GAIN][ipix][isamp] - pedsamp >= sigamp[LO_GAIN] )
+            if ( ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp] - pedsamp >= sigamp[LO_GAIN] )
             {
                int isamp2;
                significant = 1;
                ipeak = isamp;
-               p = raw->adc_sample[LO_GAIN][ipix][isamp];
+               p = ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp];
                for ( isamp2=isamp+1; isamp2<raw->num_samples; isamp2++ )
                {
-                  if ( raw->adc_sample[LO_GAIN][ipix][isamp2] > p )
+                  if ( ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp2] > p )
                   {
                      ipeak = isamp2;
-                     p = raw->adc_sample[LO_GAIN][ipix][isamp2];
+                     p = ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp2];
                   }
                }
                break;
@@ -1513,7 +1513,7 @@ static int local_peak_integration(AllHessData *hsdata, int itel, int nsum, int n
             if ( start + nsum > raw->num_samples )
                start = raw->num_samples - nsum;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[LO_GAIN][ipix][isamp+start];
+               sum += ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp+start];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -1614,7 +1614,7 @@ static int nb_peak_integration(AllHessData *hsdata, int lwt, int itel, int nsum,
          {
             /* No need for (flat) pedestal subtraction here since we just look for the peak position. */
             for (isamp=0; isamp<raw->num_samples; isamp++ )
-               nb_samples[isamp] += raw->adc_sample[HI_GAIN][ipix_nb][isamp];
+               nb_samples[isamp] += ADC_SAMPLES(raw,HI_GAIN,ipix_nb)[isamp];
             knb++;
          }
       }
@@ -1624,7 +1624,7 @@ static int nb_peak_integration(AllHessData *hsdata, int lwt, int itel, int nsum,
          {
             /* This plain summation assumes pixels have roughly similar response */
             for (isamp=0; isamp<raw->num_samples; isamp++ )
-               nb_samples[isamp] += raw->adc_sample[HI_GAIN][ipix][isamp] * lwt;
+               nb_samples[isamp] += ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp] * lwt;
             knb++;
          }
       }
@@ -1652,7 +1652,7 @@ static int nb_peak_integration(AllHessData *hsdata, int lwt, int itel, int nsum,
          {
             int sum = 0;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[HI_GAIN][ipix][isamp+start];
+               sum += ADC_SAMPLES(raw,HI_GAIN,ipix)[isamp+start];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -1674,7 +1674,7 @@ static int nb_peak_integration(AllHessData *hsdata, int lwt, int itel, int nsum,
          {
             int sum = 0;
             for ( isamp=0; isamp<nsum; isamp++ )
-               sum += raw->adc_sample[LO_GAIN][ipix][isamp+start];
+               sum += ADC_SAMPLES(raw,LO_GAIN,ipix)[isamp+start];
             if ( nsum != raw->num_samples )
             {
                /* Keep in mind that the calibration functions subtract a sum pedestal */
@@ -2054,7 +2054,7 @@ static int nb_fc_shaped_peak_integration(AllHessData *hsdata, int itel, int nsum
 
          bpx = bg + off_pix*ipix;
          ped = moni->pedestal[igain][ipix] / (double) raw->num_samples;
-         smp = &raw->adc_sample[igain][ipix][0];
+         smp = &ADC_SAMPLES(raw,igain,ipix)[0];
 
 #ifdef WITH_PZPSA
          if ( psopt%10 == 0 || psopt%10 == 9 ) /* Pulse shaping completely with pzpsa code but no peak detection */
@@ -2771,6 +2771,11 @@ printf("Pixel integration for telescope #%d\n",itel);
    if ( hsdata == NULL || up == NULL )
       return -1;
 
+   /* Samples may not have been decoded yet (PROJ_LAZY_SAMPLES) */
+   if ( hsdata->event.teldata[itel].raw != NULL &&
+        decode_adc_samples(hsdata->event.teldata[itel].raw) < 0 )
+      return -1;
+
    if ( integration_correction[itel][0] == 0. )
       set_integration_correction(hsdata, itel, up->i.integrator, up->i.integ_param);
 
@@ -3432,6 +3437,9 @@ static int image_reconstruct(AllHessData *hsdata, int itel, int cut_id,
    }
    if ( nimg == -2 )
       nimg = 0;
+   /* Samples may not have been decoded yet (PROJ_LAZY_SAMPLES) */
+   if ( teldata->raw != NULL && decode_adc_samples(teldata->raw) < 0 )
+      return -1;
    if ( teldata->raw != NULL && teldata->raw->known )
    {
       calibrate_amplitude(hsdata, itel, second_image_from_timing?0:flag_amp_tm, clip_amp);
@@ -3484,6 +3492,9 @@ printf("** Cleaning data in event %d telescope ID %d with method %d\n",
    teldata->glob_count, teldata->tel_id, clean_flag);
 #endif
 
+   if ( raw != NULL && decode_adc_samples(raw) < 0 )
+      return -1;
+
    if ( clean_flag == 9 ) /* Poor man's solution: rely on pixel timing significance */
    {
       teldata->readout_mode = 9; /* Not advertized and not competitive in most cases */
@@ -4077,7 +4088,8 @@ printf("Reconstruct data\n");
       {
          if ( hsdata->event.teldata[itel].known &&
               hsdata->event.teldata[itel].raw != NULL &&
-              hsdata->event.teldata[itel].raw->known )
+              (hsdata->event.teldata[itel].raw->known ||
+               ADC_SAMPLES_PENDING(hsdata->event.teldata[itel].raw)) )
          {
             have_raw_data = 1;
             break;
@@ -4089,7 +4101,8 @@ printf("Reconstruct data\n");
          {
             if ( hsdata->event.teldata[itel].known &&
                  hsdata->event.teldata[itel].raw != NULL &&
-                 hsdata->event.teldata[itel].raw->known )
+                 (hsdata->event.teldata[itel].raw->known ||
+                  ADC_SAMPLES_PENDING(hsdata->event.teldata[itel].raw)) )
             {
                int tel_type = user_get_type(itel);
                struct user_parameters *up = user_get_parameters(tel_type);
@@ -0,0 +1,530 @@
+/* ============================================================================
+
+Copyright (C) 2026  agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+============================================================================ */
+
+/** @file simtel2columns.c
+ *  @short Export event-level quantities of sim_telarray data as column tables.
+ *
+ *  Two tables are written, see io_columns.h for the format:
+ *  "events" with one row per triggered event (MC truth, trigger,
+ *  and any reconstructed shower parameters) and "telescopes" with
+ *  one row per telescope with data in an event (image parameters
+ *  and, optionally, the calibrated pixel amplitudes).
+ *  Use list_columns to look at the result.
+ *
+ *  @author agent
+ *  @date   2026
+ */
+
+/** @defgroup simtel2columns_c The simtel2columns program */
+/** @{ */
+
+#include "initial.h"      /* This file includes others as required. */
+#include "io_basic.h"     /* This file includes others as required. */
+#include "mc_tel.h"
+#include "io_history.h"
+#include "io_hess.h"
+#include "io_columns.h"
+#include "mem_arena.h"
+#include "fileopen.h"
+#include <math.h>
+
+/** Show program syntax */
+
+static void syntax (char *program);
+
+static void syntax (char *program)
+{
+   printf("Export event-level quantities of sim_telarray data as column tables.\n\n");
+
+   printf("Syntax: %s [ options ] [ - | input_fname ... ]\n",program);
+   printf("Options:\n");
+   printf("   -o fname       (Set output file name, default: hessio.columns.)\n");
+   printf("   --chunk n      (Rows per chunk, default: 10000.)\n");
+   printf("   --pixels       (Include calibrated pixel amplitudes per telescope.)\n");
+   printf("   --no-compress  (Do not compress the column data.)\n");
+   printf("   --max-events n (Stop after n triggered events.)\n");
+   printf("   -b nb          (Change maximum size of I/O buffers.)\n");
+   exit(1);
+}
+
+/** Column indices of the "events" table. */
+static struct
+{
+   int run, event, shower, primary;
+   int mc_energy, mc_az, mc_alt, mc_core_x, mc_core_y, mc_core_dist;
+   int mc_xmax, mc_h_first_int, mc_aweight;
+   int num_teltrg, num_teldata, gps_time;
+   int rec_known, rec_num_img, rec_az, rec_alt, rec_core_x, rec_core_y;
+   int rec_energy, rec_xmax, rec_mscl, rec_mscw;
+} ce;
+
+/** Column indices of the "telescopes" table. */
+static struct
+{
+   int run, event, tel_id, img_known, img_pixels;
+   int amplitude, cog_x, cog_y, phi, length, width, skewness, kurtosis;
+   int tm_slope, num_sat, pixel_amp;
+} ct;
+
+static IO_COLUMN_TABLE *define_event_table (size_t chunk)
+{
+   IO_COLUMN_TABLE *tab = allocate_column_table("events",1,chunk);
+   if ( tab == NULL )
+      return NULL;
+   ce.run = add_column(tab,"run",COL_INT32);
+   ce.event = add_column(tab,"event",COL_INT32);
+   ce.shower = add_column(tab,"shower",COL_INT32);
+   ce.primary = add_column(tab,"primary",COL_INT32);
+   ce.mc_energy = add_column(tab,"mc_energy",COL_DOUBLE);
+   ce.mc_az = add_column(tab,"mc_az",COL_FLOAT);
+   ce.mc_alt = add_column(tab,"mc_alt",COL_FLOAT);
+   ce.mc_core_x = add_column(tab,"mc_core_x",COL_FLOAT);
+   ce.mc_core_y = add_column(tab,"mc_core_y",COL_FLOAT);
+   ce.mc_core_dist = add_column(tab,"mc_core_dist",COL_FLOAT);
+   ce.mc_xmax = add_column(tab,"mc_xmax",COL_FLOAT);
+   ce.mc_h_first_int = add_column(tab,"mc_h_first_int",COL_FLOAT);
+   ce.mc_aweight = add_column(tab,"mc_aweight",COL_FLOAT);
+   ce.num_teltrg = add_column(tab,"num_teltrg",COL_INT32);
+   ce.num_teldata = add_column(tab,"num_teldata",COL_INT32);
+   ce.gps_time = add_column(tab,"gps_time",COL_DOUBLE);
+   ce.rec_known = add_column(tab,"rec_known",COL_INT32);
+   ce.rec_num_img = add_column(tab,"rec_num_img",COL_INT32);
+   ce.rec_az = add_column(tab,"rec_az",COL_FLOAT);
+   ce.rec_alt = add_column(tab,"rec_alt",COL_FLOAT);
+   ce.rec_core_x = add_column(tab,"rec_core_x",COL_FLOAT);
+   ce.rec_core_y = add_column(tab,"rec_core_y",COL_FLOAT);
+   ce.rec_energy = add_column(tab,"rec_energy",COL_FLOAT);
+   ce.rec_xmax = add_column(tab,"rec_xmax",COL_FLOAT);
+   ce.rec_mscl = add_column(tab,"rec_mscl",COL_FLOAT);
+   ce.rec_mscw = add_column(tab,"rec_mscw",COL_FLOAT);
+   return tab;
+}
+
+static IO_COLUMN_TABLE *define_telescope_table (size_t chunk, int with_pixels)
+{
+   IO_COLUMN_TABLE *tab = allocate_column_table("telescopes",2,chunk);
+   if ( tab == NULL )
+      return NULL;
+   ct.run = add_column(tab,"run",COL_INT32);
+   ct.event = add_column(tab,"event",COL_INT32);
+   ct.tel_id = add_column(tab,"tel_id",COL_INT32);
+   ct.img_known = add_column(tab,"img_known",COL_INT32);
+   ct.img_pixels = add_column(tab,"img_pixels",COL_INT32);
+   ct.amplitude = add_column(tab,"amplitude",COL_FLOAT);
+   ct.cog_x = add_column(tab,"cog_x",COL_FLOAT);
+   ct.cog_y = add_column(tab,"cog_y",COL_FLOAT);
+   ct.phi = add_column(tab,"phi",COL_FLOAT);
+   ct.length = add_column(tab,"length",COL_FLOAT);
+   ct.width = add_column(tab,"width",COL_FLOAT);
+   ct.skewness = add_column(tab,"skewness",COL_FLOAT);
+   ct.kurtosis = add_column(tab,"kurtosis",COL_FLOAT);
+   ct.tm_slope = add_column(tab,"tm_slope",COL_FLOAT);
+   ct.num_sat = add_column(tab,"num_sat",COL_INT32);
+   ct.pixel_amp = with_pixels ?
+      add_column(tab,"pixel_amp",COL_FLOAT|COL_ARRAY) : -1;
+   return tab;
+}
+
+/** Calibrated pixel amplitudes [mean p.e.] of one telescope, either as
+ *  provided in the data or from the sums with static calibration,
+ *  preferring the high gain unless close to saturation. */
+
+static size_t pixel_amplitudes (AllHessData *hsdata, int itel, double *amp)
+{
+   TelEvent *te = &hsdata->event.teldata[itel];
+   AdcData *raw = te->raw;
+   int ipix, npix = hsdata->camera_set[itel].num_pixels;
+
+   if ( npix <= 0 || npix > H_MAX_PIX )
+      return 0;
+   if ( te->pixcal != NULL && te->pixcal->known )
+   {
+      for ( ipix=0; ipix<npix; ipix++ )
+         amp[ipix] = te->pixcal->significant[ipix] ? te->pixcal->pixel_pe[ipix] : 0.;
+      return (size_t) npix;
+   }
+   if ( raw == NULL || !raw->known )
+      return 0;
+   for ( ipix=0; ipix<npix; ipix++ )
+   {
+      double sig_hg = 0., npe = 0.;
+      if ( !raw->significant[ipix] )
+      {
+         amp[ipix] = 0.;
+         continue;
+      }
+      if ( raw->adc_known[HI_GAIN][ipix] )
+      {
+         sig_hg = raw->adc_sum[HI_GAIN][ipix] - hsdata->tel_moni[itel].pedestal[HI_GAIN][ipix];
+         npe = sig_hg * hsdata->tel_lascal[itel].calib[HI_GAIN][ipix];
+      }
+#if (H_MAX_GAINS >= 2 )
+      if ( (!raw->adc_known[HI_GAIN][ipix] || sig_hg >= 10000 || sig_hg <= -1000) &&
+           raw->num_gains >= 2 && raw->adc_known[LO_GAIN][ipix] )
+         npe = (raw->adc_sum[LO_GAIN][ipix] - hsdata->tel_moni[itel].pedestal[LO_GAIN][ipix]) *
+               hsdata->tel_lascal[itel].calib[LO_GAIN][ipix];
+#endif
+      amp[ipix] = npe;
+   }
+   return (size_t) npix;
+}
+
+/** Fill one row of each table per telescope with data in an event,
+ *  and then the row of the event itself. */
+
+static int export_event (IO_BUFFER *iobuf, AllHessData *hsdata,
+   IO_COLUMN_TABLE *evtab, IO_COLUMN_TABLE *teltab, double *amp)
+{
+   FullEvent *ev = &hsdata->event;
+   ShowerParameters *sp = &ev->shower;
+   int run = hsdata->run_header.run, itel, rc;
+   int event = ev->central.glob_count;
+   int rb = sp->known ? sp->result_bits : 0;
+
+   for ( itel=0; itel<hsdata->run_header.ntel; itel++ )
+   {
+      TelEvent *te = &ev->teldata[itel];
+      ImgData *img = (te->img != NULL && te->num_image_sets > 0) ? &te->img[0] : NULL;
+      if ( !te->known )
+         continue;
+      set_column_value(teltab,ct.run,run);
+      set_column_value(teltab,ct.event,event);
+      set_column_value(teltab,ct.tel_id,te->tel_id);
+      if ( img != NULL && img->known )
+      {
+         set_column_value(teltab,ct.img_known,1);
+         set_column_value(teltab,ct.img_pixels,img->pixels);
+         set_column_value(teltab,ct.amplitude,img->amplitude);
+         set_column_value(teltab,ct.cog_x,img->x);
+         set_column_value(teltab,ct.cog_y,img->y);
+         set_column_value(teltab,ct.phi,img->phi);
+         set_column_value(teltab,ct.length,img->l);
+         set_column_value(teltab,ct.width,img->w);
+         set_column_value(teltab,ct.skewness,img->skewness);
+         set_column_value(teltab,ct.kurtosis,img->kurtosis);
+         set_column_value(teltab,ct.tm_slope,img->tm_slope);
+         set_column_value(teltab,ct.num_sat,img->num_sat);
+      }
+      if ( ct.pixel_amp >= 0 )
+         set_column_values(teltab,ct.pixel_amp,amp,pixel_amplitudes(hsdata,itel,amp));
+      if ( (rc = end_column_row(iobuf,teltab)) != 0 )
+         return rc;
+   }
+
+   set_column_value(evtab,ce.run,run);
+   set_column_value(evtab,ce.event,event);
+   if ( hsdata->mc_event.event == event )
+   {
+      set_column_value(evtab,ce.shower,hsdata->mc_shower.shower_num);
+      set_column_value(evtab,ce.primary,hsdata->mc_shower.primary_id);
+      set_column_value(evtab,ce.mc_energy,hsdata->mc_shower.energy);
+      set_column_value(evtab,ce.mc_az,hsdata->mc_shower.azimuth);
+      set_column_value(evtab,ce.mc_alt,hsdata->mc_shower.altitude);
+      set_column_value(evtab,ce.mc_xmax,hsdata->mc_shower.xmax);
+      set_column_value(evtab,ce.mc_h_first_int,hsdata->mc_shower.h_first_int);
+      set_column_value(evtab,ce.mc_core_x,hsdata->mc_event.xcore);
+      set_column_value(evtab,ce.mc_core_y,hsdata->mc_event.ycore);
+      set_column_value(evtab,ce.mc_core_dist,
+         sqrt(hsdata->mc_event.xcore*hsdata->mc_event.xcore +
+              hsdata->mc_event.ycore*hsdata->mc_event.ycore));
+      set_column_value(evtab,ce.mc_aweight,hsdata->mc_event.aweight);
+   }
+   set_column_value(evtab,ce.num_teltrg,ev->central.num_teltrg);
+   set_column_value(evtab,ce.num_teldata,ev->num_teldata);
+   set_column_value(evtab,ce.gps_time,
+      ev->central.gps_time.seconds + 1e-9*ev->central.gps_time.nanoseconds);
+   set_column_value(evtab,ce.rec_known,sp->known);
+   if ( sp->known )
+   {
+      set_column_value(evtab,ce.rec_num_img,sp->num_img);
+      if ( (rb & 0x01) )
+      {
+         set_column_value(evtab,ce.rec_az,sp->Az);
+         set_column_value(evtab,ce.rec_alt,sp->Alt);
+      }
+      if ( (rb & 0x04) )
+      {
+         set_column_value(evtab,ce.rec_core_x,sp->xc);
+         set_column_value(evtab,ce.rec_core_y,sp->yc);
+      }
+      if ( (rb & 0x10) )
+      {
+         set_column_value(evtab,ce.rec_mscl,sp->mscl);
+         set_column_value(evtab,ce.rec_mscw,sp->mscw);
+      }
+      if ( (rb & 0x40) )
+         set_column_value(evtab,ce.rec_energy,sp->energy);
+      if ( (rb & 0x100) )
+         set_column_value(evtab,ce.rec_xmax,sp->xmax);
+   }
+   return end_column_row(iobuf,evtab);
+}
+
+/* -------------------- main program ---------------------- */
+/**
+ *  @short Main program
+ *
+ *  Main program function of simtel2columns.c program.
+ */
+
+int main (int argc, char **argv)
+{
+   IO_BUFFER *iobuf, *iobuf2;
+   IO_ITEM_HEADER item_header;
+   const char *input_fname = NULL, *output_fname = "hessio.columns";
+   char *program = argv[0];
+   int iarg, itel, tel_id, rc;
+   size_t chunk = 10000;
+   int with_pixels = 0, compress = 1;
+   long max_events = 0, nev = 0;
+   AllHessData *hsdata = NULL;
+   MEM_ARENA *run_arena = NULL;
+   IO_COLUMN_TABLE *evtab, *teltab;
+   static double amp[H_MAX_PIX];
+
+   push_command_history(argc,argv);
+
+   if ( (iobuf = allocate_io_buffer(1000000L)) == NULL )
+   {
+      Error("Cannot allocate I/O buffer");
+      exit(1);
+   }
+   if ( iobuf->max_length < 200000000 )
+      iobuf->max_length = 200000000;
+   if ( (iobuf2 = allocate_io_buffer(1000000L)) == NULL )
+   {
+      Error("Cannot allocate I/O buffer 2");
+      exit(1);
+   }
+   if ( iobuf2->max_length < 200000000 )
+      iobuf2->max_length = 200000000;
+
+   for (iarg=1; iarg<argc; iarg++)
+   {
+      if ( strcmp(argv[iarg],"-o") == 0 && iarg+1 < argc )
+        output_fname = argv[++iarg];
+      else if ( strncmp(argv[iarg],"-o",2) == 0 && strlen(argv[iarg]) > 2 )
+        output_fname = argv[iarg]+2;
+      else if ( strcmp(argv[iarg],"--chunk") == 0 && iarg+1 < argc )
+         chunk = (size_t) atol(argv[++iarg]);
+      else if ( strcmp(argv[iarg],"--pixels") == 0 )
+         with_pixels = 1;
+      else if ( strcmp(argv[iarg],"--no-compress") == 0 )
+         compress = 0;
+      else if ( strcmp(argv[iarg],"--max-events") == 0 && iarg+1 < argc )
+         max_events = atol(argv[++iarg]);
+      else if ( strcmp(argv[iarg],"-b") == 0 && iarg+1 < argc )
+         iobuf->max_length = iobuf2->max_length = atol(argv[++iarg]);
+      else if ( argv[iarg][0] == '-' && argv[iarg][1] != '\0' )
+        syntax(program);
+      else
+         break;
+   }
+   if ( iarg >= argc )
+   {
+      Error("No input file.\n");
+      syntax(program);
+   }
+
+   if ( (evtab = define_event_table(chunk)) == NULL ||
+        (teltab = define_telescope_table(chunk,with_pixels)) == NULL )
+      exit(1);
+   if ( !compress )
+      evtab->compress = teltab->compress = 0;
+
+   if ( (iobuf2->output_file = fileopen(output_fname,WRITE_BINARY)) == NULL )
+   {
+      perror(output_fname);
+      Error("Cannot open output file.");
+      exit(1);
+   }
+   printf("\nOutput file '%s' has been opened.\n",output_fname);
+
+   /* Save the command line history and the table definitions */
+   write_history(0,iobuf2);
+   if ( write_column_table(iobuf2,evtab) != 0 ||
+        write_column_table(iobuf2,teltab) != 0 )
+   {
+      Error("Cannot write table definitions.");
+      exit(1);
+   }
+
+   for ( ; iarg<argc && (max_events <= 0 || nev < max_events); iarg++ )
+   {
+      input_fname = argv[iarg];
+      if ( strcmp(input_fname ,"-") == 0 )
+         iobuf->input_file = stdin;
+      else if ( (iobuf->input_file = fileopen(input_fname,READ_BINARY)) == NULL )
+      {
+         perror(input_fname);
+         Error("Cannot open input file.");
+         continue;
+      }
+      printf("\nInput file '%s' has been opened.\n",input_fname);
+
+      while ( max_events <= 0 || nev < max_events ) /* Loop over all data in the input file */
+      {
+         /* Find and read the next block of data. */
+         /* In case of problems with the data, just give up. */
+         if ( find_io_block(iobuf,&item_header) != 0 )
+            break;
+         if ( read_io_block(iobuf,&item_header) != 0 )
+            break;
+
+         if ( hsdata == NULL &&
+              item_header.type > IO_TYPE_SIMTEL_RUNHEADER &&
+              item_header.type < IO_TYPE_SIMTEL_RUNHEADER + 200)
+         {
+            fprintf(stderr,"Trying to read event data before run header.\n");
+            fprintf(stderr,"Skipping this data block.\n");
+            continue;
+         }
+
+         rc = 0;
+         switch ( (int) item_header.type )
+         {
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_RUNHEADER:
+               if ( hsdata != NULL )
+               {
+                  /* Keep the arena for the telescope data of the new run. */
+                  release_hess_run_data(hsdata);
+                  run_arena = hsdata->arena;
+                  free(hsdata);
+               }
+               if ( (hsdata = (AllHessData *) calloc(1,sizeof(AllHessData))) == NULL )
+               {
+                  Warning("Not enough memory");
+                  exit(1);
+               }
+               hsdata->arena = run_arena;
+               if ( (rc = read_simtel_runheader(iobuf,&hsdata->run_header)) < 0 )
+               {
+                  Warning("Reading run header failed.");
+                  exit(1);
+               }
+               fprintf(stderr,"\nStarting run %d\n",hsdata->run_header.run);
+               if ( alloc_hess_run_data(hsdata,HS_ALLOC_ALL) != 0 )
+               {
+                  Warning("Not enough memory");
+                  exit(1);
+               }
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_CAMSETTINGS:
+               tel_id = item_header.ident; // Telescope ID is in the header
+               if ( (itel = find_tel_idx(tel_id)) < 0 )
+               {
+                  Warning("Camera settings for unknown telescope.");
+                  break;
+               }
+               rc = read_simtel_camsettings(iobuf,&hsdata->camera_set[itel]);
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_TEL_MONI:
+               // Telescope ID among others in the header
+               tel_id = (item_header.ident & 0xff) |
+                        ((item_header.ident & 0x3f000000) >> 16);
+               if ( (itel = find_tel_idx(tel_id)) < 0 )
+               {
+                  Warning("Telescope monitor block for unknown telescope.");
+                  break;
+               }
+               rc = read_simtel_tel_monitor(iobuf,&hsdata->tel_moni[itel]);
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_LASCAL:
+               tel_id = item_header.ident; // Telescope ID is in the header
+               if ( (itel = find_tel_idx(tel_id)) < 0 )
+               {
+                  Warning("Laser/LED calibration for unknown telescope.");
+                  break;
+               }
+               rc = read_simtel_laser_calib(iobuf,&hsdata->tel_lascal[itel]);
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_MC_SHOWER:
+               rc = read_simtel_mc_shower(iobuf,&hsdata->mc_shower);
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_MC_EVENT:
+               rc = read_simtel_mc_event(iobuf,&hsdata->mc_event);
+               break;
+
+            /* =================================================== */
+            case IO_TYPE_SIMTEL_EVENT:
+               if ( (rc = read_simtel_event(iobuf,&hsdata->event,-1)) < 0 )
+                  break;
+               if ( export_event(iobuf2,hsdata,evtab,teltab,amp) != 0 )
+               {
+                  Error("Writing column data failed.");
+                  exit(1);
+               }
+               nev++;
+               break;
+
+            /* =================================================== */
+            default:
+               /* Nothing needed from it. */
+               break;
+         }
+         if ( rc < 0 )
+         {
+            char msg[256];
+            snprintf(msg,sizeof(msg)-1,
+               "Error reading block of type %lu.", (unsigned long) item_header.type);
+            Warning(msg);
+         }
+      }
+
+      if ( iobuf->input_file != stdin )
+         fileclose(iobuf->input_file);
+      iobuf->input_file = NULL;
+      reset_io_block(iobuf);
+   }
+
+   if ( flush_column_chunk(iobuf2,evtab) != 0 ||
+        flush_column_chunk(iobuf2,teltab) != 0 )
+   {
+      Error("Writing column data failed.");
+      exit(1);
+   }
+   printf("%ld events with %ld telescope rows written in %ld + %ld chunks.\n",
+      evtab->total_rows, teltab->total_rows, evtab->num_chunks, teltab->num_chunks);
+
+   fileclose(iobuf2->output_file);
+   if ( hsdata != NULL )
+   {
+      free_hess_run_data(hsdata);
+      free(hsdata);
+   }
+   free_column_table(evtab);
+   free_column_table(teltab);
+   free_io_buffer(iobuf);
+   free_io_buffer(iobuf2);
+
+   return 0;
+}
+
+/** @} */
@@ -181,6 +181,10 @@ int main (int argc, char **argv)
    if ( argc < 2 )
       input_fname = "iact.out";
 
+   /* The same I/O buffer is used for input and output: most blocks are */
+   /* written out as read, and the run header is decoded after that. */
+   /* Write-behind (see io_writebehind.h) would hand the buffer over */
+   /* to the writer thread and is therefore not offered here. */
    if ( (iobuf = allocate_io_buffer(5000000L)) == NULL )
    {
       Error("Cannot allocate I/O buffer");
@@ -553,7 +557,7 @@ int main (int argc, char **argv)
                {
                   if ( hsdata->event.teldata[itel].raw != NULL )
                   {
-                     free(hsdata->event.teldata[itel].raw);
+                     free_adc_data(hsdata->event.teldata[itel].raw);
                      hsdata->event.teldata[itel].raw = NULL;
                   }
                   if ( hsdata->event.teldata[itel].pixtm != NULL )
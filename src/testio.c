@@ -31,6 +31,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "warning.h"
 #include "io_basic.h"
 #include "fileopen.h"
+#include "io_index.h"
+#include "io_prefetch.h"
+#include "io_writebehind.h"
+#include "io_hess.h"
+#include "io_columns.h"
+#include "mem_arena.h"
 
 struct test_struct
 {
@@ -1012,6 +1018,1610 @@ int read_test_lrg (IO_BUFFER *iobuf)
    return(get_item_end(iobuf,&item_header));
 }
 
+/* ---------------------- scratch_name ---------------------- */
+/**
+ *  @short Name of a scratch file for the feature tests, derived
+ *         from the name of the main test file.
+ */
+
+static const char *scratch_name (const char *fname, const char *tag);
+
+static const char *scratch_name (const char *fname, const char *tag)
+{
+   static char name[1024];
+   snprintf(name,sizeof(name),"%s.%s.tmp",fname,tag);
+   return name;
+}
+
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+/* ---------------------- same_file_contents ---------------------- */
+/**
+ *  @short Check if two files have exactly the same contents.
+ *
+ *  @return 1 (same), 0 (different or not readable)
+ */
+
+static int same_file_contents (const char *name1, const char *name2);
+
+static int same_file_contents (const char *name1, const char *name2)
+{
+   FILE *f1 = NULL, *f2 = NULL;
+   int c1 = 0, c2 = 1;
+
+   if ( (f1 = fopen(name1,READ_BINARY)) != NULL &&
+        (f2 = fopen(name2,READ_BINARY)) != NULL )
+   {
+      do
+      {
+         c1 = getc(f1);
+         c2 = getc(f2);
+      } while ( c1 == c2 && c1 != EOF );
+   }
+   if ( f1 != NULL )
+      fclose(f1);
+   if ( f2 != NULL )
+      fclose(f2);
+   return (c1 == c2);
+}
+#endif
+
+/* ---------------------- write_test_blocks ---------------------- */
+/**
+ *  @short Write a sequence of top-level blocks looking like two runs
+ *         of simulated events, with the same event numbers in both
+ *         runs and with MC shower blocks ahead of every tenth event.
+ *         A run summary block at the end is written from separate pieces.
+ *
+ *  @param fname        Output file name.
+ *  @param writebehind  Number of blocks to be queued for asynchronous
+ *                      output (0: write directly).
+ *
+ *  @return Number of blocks written or -1.
+ */
+
+static long write_test_blocks (const char *fname, int writebehind);
+
+static long write_test_blocks (const char *fname, int writebehind)
+{
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER item_header;
+   long n = 0;
+   int run, ev, rc = 0;
+
+   if ( (iobuf = allocate_io_buffer(1000)) == NULL )
+      return -1;
+   /* Compressed output for names ending in .gz or .zst */
+   if ( (iobuf->output_file = fileopen(fname,WRITE_BINARY)) == NULL )
+   {
+      perror(fname);
+      free_io_buffer(iobuf);
+      return -1;
+   }
+   if ( writebehind > 0 && start_io_writebehind(iobuf,writebehind) != 0 )
+      rc = -1;
+   for ( run=1; run<=2 && rc==0; run++ )
+   {
+      for ( ev=1; ev<=50 && rc==0; ev++ )
+      {
+         int k;
+         for ( k=0; k<3 && rc==0; k++ )
+         {
+            if ( k == 0 )
+            {
+               if ( ev%10 != 1 )
+                  continue;
+               item_header.type = IO_TYPE_SIMTEL_MC_SHOWER;
+               item_header.ident = ev;
+            }
+            else if ( k == 1 )
+            {
+               item_header.type = IO_TYPE_SIMTEL_MC_EVENT;
+               item_header.ident = ev;
+            }
+            else
+            {
+               /* Only some of the events trigger. */
+               if ( ev%3 == 0 )
+                  continue;
+               item_header.type = IO_TYPE_SIMTEL_EVENT;
+               item_header.ident = ev;
+            }
+            item_header.version = 0;
+            put_item_begin(iobuf,&item_header);
+            put_int32(run,iobuf);
+            put_int32(ev,iobuf);
+            put_vector_of_int32(NULL,ev,iobuf); /* Various lengths */
+            /* Top-level items get written when finished. */
+            if ( (rc = put_item_end(iobuf,&item_header)) == 0 )
+               n++;
+         }
+      }
+   }
+   if ( rc == 0 )
+   {
+      static const int32_t counts[3] = { 2, 100, 66 };
+      static const char note[] = "end of test data";
+      IO_SEGMENT seg[2];
+      seg[0].data = counts;
+      seg[0].length = sizeof(counts);
+      seg[1].data = note;
+      seg[1].length = sizeof(note);
+      item_header.type = IO_TYPE_SIMTEL_RUNSTAT;
+      item_header.version = 0;
+      item_header.ident = 2;
+      item_header.user_flag = 0;
+      item_header.can_search = 0;
+      if ( (rc = write_io_block_gather(iobuf,&item_header,seg,2)) == 0 )
+         n++;
+   }
+   if ( writebehind > 0 && stop_io_writebehind(iobuf) != 0 )
+      rc = -1;
+   if ( fileclose(iobuf->output_file) != 0 )
+      rc = -1;
+   iobuf->output_file = NULL;
+   free_io_buffer(iobuf);
+   return (rc == 0) ? n : -1;
+}
+
+/* ------------------------ test_index ------------------------ */
+/**
+ *  @short Check the block index: building it, writing and reading
+ *         it back, looking up events (the same with the binary and
+ *         the linear search), seeking to them, and rejecting a stale
+ *         index or an index file with an impossible number of entries.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_index (const char *fname);
+
+int test_index (const char *fname)
+{
+   const char *dname = scratch_name(fname,"index");
+   char *xname = NULL;
+   IO_BUFFER *iobuf = NULL;
+   IO_ITEM_HEADER item_header;
+   IO_INDEX *idx = NULL, *idx2 = NULL;
+   long nblocks, ev;
+   size_t k;
+   int ok = 0;
+
+   if ( (nblocks = write_test_blocks(dname,0)) <= 0 ||
+        (iobuf = allocate_io_buffer(1000)) == NULL ||
+        (iobuf->input_file = fopen(dname,READ_BINARY)) == NULL ||
+        (idx = allocate_io_index()) == NULL )
+      goto done;
+
+   if ( build_io_index(iobuf,idx) != nblocks ||
+        (xname = io_index_fname(dname)) == NULL ||
+        write_io_index(idx,xname) != 0 ||
+        (idx2 = read_io_index(xname)) == NULL )
+   {
+      Warning("Building, writing or reading the block index failed");
+      goto done;
+   }
+   if ( idx2->num_entries != idx->num_entries ||
+        idx2->indexed_length != idx->indexed_length )
+   {
+      Warning("Block index read back does not match");
+      goto done;
+   }
+   for ( k=0; k<idx->num_entries; k++ )
+   {
+      const IO_INDEX_ENTRY *e1 = &idx->entry[k], *e2 = &idx2->entry[k];
+      if ( e1->offset != e2->offset || e1->length != e2->length ||
+           e1->ident != e2->ident || e1->event != e2->event ||
+           e1->type != e2->type || e1->version != e2->version )
+      {
+         Warning("Block index entry read back does not match");
+         goto done;
+      }
+   }
+
+   for ( ev=-2; ev<=52; ev++ )
+   {
+      size_t ns = idx2->num_sorted;
+      long ib = find_io_index_event(idx2,ev), il;
+      idx2->num_sorted = 0; /* Force a linear search */
+      il = find_io_index_event(idx2,ev);
+      idx2->num_sorted = ns;
+      if ( ib != il || ((ev >= 1 && ev <= 50) != (ib >= 0)) )
+      {
+         Warning("Binary and linear search in block index disagree");
+         goto done;
+      }
+      if ( ib < 0 )
+         continue;
+      /* Always the first run, starting at the MC shower if directly before. */
+      if ( seek_to_event(iobuf,idx2,ev) != 0 ||
+           find_io_block(iobuf,&item_header) != 0 ||
+           read_io_block(iobuf,&item_header) != 0 ||
+           get_int32(iobuf) != 1 || get_int32(iobuf) != ev ||
+           item_header.type != (unsigned long) ((ev%10 == 1) ?
+              IO_TYPE_SIMTEL_MC_SHOWER : IO_TYPE_SIMTEL_MC_EVENT) )
+      {
+         Warning("Seeking to an event with the block index failed");
+         goto done;
+      }
+   }
+   /* The third triggered event block in the file */
+   if ( seek_to_type(iobuf,idx2,IO_TYPE_SIMTEL_EVENT,2) != 0 ||
+        find_io_block(iobuf,&item_header) != 0 ||
+        item_header.type != IO_TYPE_SIMTEL_EVENT || item_header.ident != 4 )
+   {
+      Warning("Seeking to a block type with the block index failed");
+      goto done;
+   }
+
+   /* An index no longer covering the data file as it is must be rejected. */
+   if ( check_io_index(idx2,dname,xname) != 0 )
+   {
+      Warning("Block index of unchanged data file rejected");
+      goto done;
+   }
+   {
+      FILE *f;
+      BYTE extra[32];
+      memset(extra,0,sizeof(extra));
+      if ( (f = fopen(dname,"ab")) == NULL || fwrite(extra,1,sizeof(extra),f) != sizeof(extra) ||
+           fclose(f) != 0 )
+         goto done;
+      Information("(A warning about a stale block index is expected next.)");
+      if ( check_io_index(idx2,dname,xname) == 0 )
+      {
+         Warning("Block index of data file appended to accepted");
+         goto done;
+      }
+   }
+
+   /* A header claiming more entries than the file has must be rejected. */
+   {
+      FILE *f;
+      BYTE hdr[32];
+      uint64_t n = ((uint64_t) 1) << 40;
+      if ( (f = fopen(xname,"r+b")) == NULL || fread(hdr,1,32,f) != 32 )
+         goto done;
+      memcpy(hdr+24,&n,8);
+      rewind(f);
+      if ( fwrite(hdr,1,32,f) != 32 || fclose(f) != 0 )
+         goto done;
+      free_io_index(idx2);
+      Information("(A warning about a corrupted block index is expected next.)");
+      if ( (idx2 = read_io_index(xname)) != NULL )
+      {
+         Warning("Block index with impossible number of entries accepted");
+         goto done;
+      }
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL && iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   if ( iobuf != NULL )
+      free_io_buffer(iobuf);
+   free_io_index(idx);
+   free_io_index(idx2);
+   if ( xname != NULL )
+   {
+      remove(xname);
+      free(xname);
+   }
+   remove(dname);
+   return ok ? 0 : -1;
+}
+
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+
+/* ----------------------- digest_blocks ----------------------- */
+/**
+ *  @short Read all blocks from the input of an I/O buffer, skipping
+ *         every fourth one, and sum up what was seen of them
+ *         (header, offset and contents) into a single number.
+ *
+ *  @return Number of blocks seen or -1.
+ */
+
+static long digest_blocks (IO_BUFFER *iobuf, unsigned long *digest);
+
+static long digest_blocks (IO_BUFFER *iobuf, unsigned long *digest)
+{
+   IO_ITEM_HEADER item_header;
+   unsigned long d = 0;
+   long n = 0;
+   int rc;
+
+   while ( (rc = find_io_block(iobuf,&item_header)) == 0 )
+   {
+      d = d*31 + item_header.type;
+      d = d*31 + (unsigned long) item_header.ident;
+      d = d*31 + (unsigned long) io_block_offset(iobuf);
+      if ( n%4 == 3 )
+      {
+         if ( skip_io_block(iobuf,&item_header) != 0 )
+            return -1;
+      }
+      else
+      {
+         if ( read_io_block(iobuf,&item_header) != 0 )
+            return -1;
+         d = d*31 + (unsigned long) iobuf->item_length[0];
+         d = d*31 + (unsigned long) get_int32(iobuf);
+         d = d*31 + (unsigned long) get_int32(iobuf);
+      }
+      n++;
+   }
+   *digest = d;
+   return (rc == -2) ? n : -1;
+}
+
+#endif
+
+/* ----------------------- test_prefetch ----------------------- */
+/**
+ *  @short Check that reading with background prefetching sees the
+ *         same blocks, at the same offsets and with the same contents,
+ *         as direct input, including skipped blocks and a seek in the
+ *         middle (which stops the prefetching).
+ *
+ *  @return 0 (ok or not available), -1 (failed)
+ */
+
+int test_prefetch (const char *fname);
+
+int test_prefetch (const char *fname)
+{
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   const char *dname = scratch_name(fname,"prefetch");
+   FILE *f = NULL;
+   IO_BUFFER *iobuf = NULL;
+   unsigned long d1 = 0, d2 = 0, d3 = 0;
+   long nblocks, n1, n2, n3;
+   int ok = 0, pass;
+
+   if ( (nblocks = write_test_blocks(dname,0)) <= 0 ||
+        (iobuf = allocate_io_buffer(1000)) == NULL )
+      goto done;
+   for ( pass=0; pass<2; pass++ )
+   {
+      /* Through the C stream and through its file descriptor */
+      if ( (f = fopen(dname,READ_BINARY)) == NULL )
+         goto done;
+      if ( pass == 0 )
+         iobuf->input_file = f;
+      else
+         iobuf->input_fileno = fileno(f);
+
+      n1 = digest_blocks(iobuf,&d1);
+      if ( seek_io_block(iobuf,0) != 0 || start_io_prefetch(iobuf,3) != 0 )
+         goto done;
+      n2 = digest_blocks(iobuf,&d2);
+      /* Seeking stops the prefetching, which can be started again. */
+      if ( seek_io_block(iobuf,0) != 0 || iobuf->prefetch != NULL ||
+           start_io_prefetch(iobuf,0) != 0 )
+         goto done;
+      n3 = digest_blocks(iobuf,&d3);
+      stop_io_prefetch(iobuf);
+      if ( n1 != nblocks || n2 != n1 || n3 != n1 || d2 != d1 || d3 != d1 )
+      {
+         Warning("Prefetched input differs from direct input");
+         goto done;
+      }
+      iobuf->input_file = NULL;
+      iobuf->input_fileno = -1;
+      fclose(f);
+      f = NULL;
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL )
+   {
+      stop_io_prefetch(iobuf);
+      free_io_buffer(iobuf);
+   }
+   if ( f != NULL )
+      fclose(f);
+   remove(dname);
+   return ok ? 0 : -1;
+#else
+   (void) fname;
+   Information("(Prefetching not tested without thread support.)");
+   return 0;
+#endif
+}
+
+/* ---------------------- test_writebehind --------------------- */
+/**
+ *  @short Check that output with write-behind (including gather
+ *         output, which then goes through the I/O buffer) results
+ *         in exactly the same file as direct output.
+ *
+ *  @return 0 (ok or not available), -1 (failed)
+ */
+
+int test_writebehind (const char *fname);
+
+int test_writebehind (const char *fname)
+{
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   char dname[1024];
+   const char *wname = scratch_name(fname,"writebehind");
+   long n1, n2;
+   int ok = 0;
+
+   strncpy(dname,scratch_name(fname,"direct"),sizeof(dname)-1);
+   dname[sizeof(dname)-1] = '\0';
+   /* A short queue, to have the application wait for the writer as well */
+   if ( (n1 = write_test_blocks(dname,0)) <= 0 ||
+        (n2 = write_test_blocks(wname,2)) != n1 )
+   {
+      Warning("Writing test data with and without write-behind failed");
+      goto done;
+   }
+   if ( !same_file_contents(dname,wname) )
+   {
+      Warning("Output with write-behind differs from direct output");
+      goto done;
+   }
+   ok = 1;
+
+ done:
+   remove(dname);
+   remove(wname);
+   return ok ? 0 : -1;
+#else
+   (void) fname;
+   Information("(Write-behind not tested without thread support.)");
+   return 0;
+#endif
+}
+
+/* -------------------- test_seekable_zstd --------------------- */
+/**
+ *  @short Check random access to a zstd compressed file written in
+ *         the seekable format: events looked up with the block index
+ *         in scrambled order must be found just like in a plain file.
+ *
+ *  @return 0 (ok or not available), -1 (failed)
+ */
+
+int test_seekable_zstd (const char *fname);
+
+int test_seekable_zstd (const char *fname)
+{
+#if defined(HAVE_ZSTD) && defined(__GLIBC__)
+   char zname[1024];
+   IO_BUFFER *iobuf = NULL;
+   IO_ITEM_HEADER item_header;
+   IO_INDEX *idx = NULL;
+   FILE *f;
+   BYTE tail[4];
+   long nblocks, k;
+   int ok = 0;
+
+   if ( getenv("FILEOPEN_NO_INPROC") != NULL )
+   {
+      Information("(Seekable zstd files not tested without in-process compression.)");
+      return 0;
+   }
+   snprintf(zname,sizeof(zname),"%s.zst",scratch_name(fname,"seekable"));
+   /* Frames of 7 blocks each, not aligned with anything in the data */
+   set_seekable_zstd(7);
+   nblocks = write_test_blocks(zname,0);
+   set_seekable_zstd(0);
+   if ( nblocks <= 0 )
+      goto done;
+
+   /* The file must end with the seek table. */
+   if ( (f = fopen(zname,READ_BINARY)) == NULL )
+      goto done;
+   if ( fseek(f,-4L,SEEK_END) != 0 || fread(tail,1,4,f) != 4 ||
+        tail[0] != 0xb1 || tail[1] != 0xea || tail[2] != 0x92 || tail[3] != 0x8f )
+   {
+      fclose(f);
+      Warning("Compressed file has no seek table");
+      goto done;
+   }
+   fclose(f);
+
+   if ( (iobuf = allocate_io_buffer(1000)) == NULL ||
+        (iobuf->input_file = fileopen(zname,READ_BINARY)) == NULL ||
+        (idx = allocate_io_index()) == NULL ||
+        build_io_index(iobuf,idx) != nblocks )
+   {
+      Warning("Indexing the compressed file failed");
+      goto done;
+   }
+   /* Back and forth through the file, across frame boundaries */
+   for ( k=0; k<50; k++ )
+   {
+      long ev = (k*17)%50 + 1;
+      if ( seek_to_event(iobuf,idx,ev) != 0 ||
+           find_io_block(iobuf,&item_header) != 0 ||
+           read_io_block(iobuf,&item_header) != 0 ||
+           get_int32(iobuf) != 1 || get_int32(iobuf) != ev ||
+           item_header.ident != ev )
+      {
+         Warning("Random access to an event in a seekable zstd file failed");
+         goto done;
+      }
+   }
+   if ( seek_to_type(iobuf,idx,IO_TYPE_SIMTEL_RUNSTAT,0) != 0 ||
+        find_io_block(iobuf,&item_header) != 0 ||
+        item_header.type != IO_TYPE_SIMTEL_RUNSTAT )
+   {
+      Warning("Seeking to the last block of a seekable zstd file failed");
+      goto done;
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL && iobuf->input_file != NULL )
+      fileclose(iobuf->input_file);
+   if ( iobuf != NULL )
+      free_io_buffer(iobuf);
+   free_io_index(idx);
+   remove(zname);
+   return ok ? 0 : -1;
+#else
+   (void) fname;
+   Information("(Seekable zstd files not tested without zstd support.)");
+   return 0;
+#endif
+}
+
+/* ----------------------- linear_search ----------------------- */
+/**
+ *  @short Reference search for a sub-item by walking through all
+ *         sub-item headers from the start of the item.
+ *
+ *  @return Index of the sub-item found, -2 (none), or -1 (error)
+ */
+
+static int linear_search (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+   unsigned long type, int match_ident, long ident);
+
+static int linear_search (IO_BUFFER *iobuf, IO_ITEM_HEADER *item_header,
+   unsigned long type, int match_ident, long ident)
+{
+   IO_ITEM_HEADER sub_item_header;
+   int index = 0, rc;
+
+   if ( rewind_item(iobuf,item_header) != 0 )
+      return -1;
+   for (;;)
+   {
+      sub_item_header.type = 0;
+      if ( (rc = get_item_begin(iobuf,&sub_item_header)) != 0 )
+         return (rc == -2) ? -2 : -1;
+      if ( sub_item_header.type == type &&
+           (!match_ident || sub_item_header.ident == ident) )
+         return index;
+      if ( get_item_end(iobuf,&sub_item_header) != 0 )
+         return -1;
+      index++;
+   }
+}
+
+/* ----------------------- test_sub_items ----------------------- */
+/**
+ *  @short Check the searches for sub-items through the sub-item
+ *         directory against a linear search through the headers,
+ *         as well as positioning with goto_sub_item() and skipping
+ *         sub-items with the directory, including nested items.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_sub_items (const char *fname);
+
+int test_sub_items (const char *fname)
+{
+   const char *dname = scratch_name(fname,"subitems");
+   const int nsub = 40;
+   IO_BUFFER *iobuf = NULL;
+   IO_ITEM_HEADER item_header, sub_item_header, sub2_header;
+   const IO_SUB_ITEM_ENTRY *dir = NULL;
+   int i, n, rc, ok = 0;
+   unsigned long type;
+   long ident;
+
+   if ( (iobuf = allocate_io_buffer(20000)) == NULL )
+      return -1;
+   if ( (iobuf->output_file = fopen(dname,WRITE_BINARY)) == NULL )
+      goto done;
+   /* Sub-items of types 1000 to 1004, with identifiers repeated */
+   /* between types, every eighth with sub-items of its own. */
+   item_header.type = 2000;
+   item_header.version = 0;
+   item_header.ident = 1;
+   put_item_begin(iobuf,&item_header);
+   for ( i=0; i<nsub; i++ )
+   {
+      sub_item_header.type = 1000 + i%5;
+      sub_item_header.version = 0;
+      sub_item_header.ident = (i/2)*3;
+      put_item_begin(iobuf,&sub_item_header);
+      if ( i%8 == 7 )
+      {
+         int j;
+         for ( j=0; j<3; j++ )
+         {
+            sub2_header.type = 1100 + j;
+            sub2_header.version = 0;
+            sub2_header.ident = i;
+            put_item_begin(iobuf,&sub2_header);
+            put_int32(1000*i+j,iobuf);
+            put_item_end(iobuf,&sub2_header);
+         }
+      }
+      else
+      {
+         put_int32(i,iobuf);
+         put_vector_of_int32(NULL,i%7,iobuf);
+      }
+      put_item_end(iobuf,&sub_item_header);
+   }
+   rc = put_item_end(iobuf,&item_header);
+   fclose(iobuf->output_file);
+   iobuf->output_file = NULL;
+   if ( rc != 0 || (iobuf->input_file = fopen(dname,READ_BINARY)) == NULL ||
+        find_io_block(iobuf,&item_header) != 0 ||
+        read_io_block(iobuf,&item_header) != 0 ||
+        get_item_begin(iobuf,&item_header) != 0 || !item_header.can_search )
+      goto done;
+
+   /* The directory lists all sub-items as written. */
+   if ( (n = get_sub_item_directory(iobuf,&item_header,&dir)) != nsub )
+   {
+      Warning("Sub-item directory is incomplete");
+      goto done;
+   }
+   for ( i=0; i<nsub; i++ )
+      if ( dir[i].type != (unsigned long) (1000 + i%5) || dir[i].ident != (i/2)*3 ||
+           dir[i].can_search != (i%8 == 7) )
+      {
+         Warning("Sub-item directory does not match the data");
+         goto done;
+      }
+
+   /* Search by type, and by type and identifier, including missing ones. */
+   for ( type=999; type<=1005; type++ )
+   {
+      for ( ident=-1; ident<=(nsub/2)*3+1; ident++ )
+      {
+         int match_ident = (ident >= 0), il, id = -2;
+         il = linear_search(iobuf,&item_header,type,match_ident,ident);
+         if ( rewind_item(iobuf,&item_header) != 0 )
+            goto done;
+         sub_item_header.type = type;
+         rc = match_ident ? 
+            search_sub_item_ident(iobuf,&item_header,&sub_item_header,ident) :
+            search_sub_item(iobuf,&item_header,&sub_item_header);
+         if ( rc == 0 )
+         {
+            /* Positioned at the header of the sub-item found */
+            long pos = (long) (iobuf->data-iobuf->buffer);
+            for ( id=0; id<nsub && dir[id].offset != pos; id++ )
+               ;
+            if ( id >= nsub || get_item_begin(iobuf,&sub_item_header) != 0 ||
+                 sub_item_header.type != type ||
+                 (match_ident && sub_item_header.ident != ident) )
+               id = -1;
+            else
+               get_item_end(iobuf,&sub_item_header);
+         }
+         else if ( rc != -2 )
+            id = -1;
+         if ( il != id )
+         {
+            Warning("Search through sub-item directory differs from linear search");
+            goto done;
+         }
+      }
+   }
+
+   /* Successive searches continue after the sub-item found before. */
+   rewind_item(iobuf,&item_header);
+   for ( i=2; ; i+=5 )
+   {
+      sub_item_header.type = 1002;
+      if ( (rc = search_sub_item(iobuf,&item_header,&sub_item_header)) != 0 )
+         break;
+      if ( get_item_begin(iobuf,&sub_item_header) != 0 ||
+           (i%8 != 7 && get_int32(iobuf) != i) )
+         goto done;
+      get_item_end(iobuf,&sub_item_header);
+   }
+   if ( rc != -2 || i < nsub )
+   {
+      Warning("Successive searches for sub-items failed");
+      goto done;
+   }
+
+   /* Direct positioning and skipping, in a nested item too. */
+   for ( i=nsub-1; i>=0; i-=3 )
+   {
+      sub_item_header.type = 0;
+      if ( goto_sub_item(iobuf,&item_header,i) != 0 ||
+           get_item_begin(iobuf,&sub_item_header) != 0 ||
+           sub_item_header.type != (unsigned long) (1000 + i%5) )
+      {
+         Warning("Positioning at a sub-item failed");
+         goto done;
+      }
+      if ( i%8 == 7 )
+      {
+         sub2_header.type = 1102;
+         if ( search_sub_item(iobuf,&sub_item_header,&sub2_header) != 0 ||
+              get_item_begin(iobuf,&sub2_header) != 0 ||
+              get_int32(iobuf) != 1000*i+2 ||
+              get_item_end(iobuf,&sub2_header) != 0 )
+         {
+            Warning("Search in a nested item failed");
+            goto done;
+         }
+      }
+      else if ( get_int32(iobuf) != i )
+         goto done;
+      get_item_end(iobuf,&sub_item_header);
+   }
+   rewind_item(iobuf,&item_header);
+   for ( i=0; i<nsub-2; i++ )
+      if ( skip_subitem(iobuf) != 0 )
+         goto done;
+   sub_item_header.type = 0;
+   if ( get_item_begin(iobuf,&sub_item_header) != 0 ||
+        sub_item_header.type != (unsigned long) (1000 + (nsub-2)%5) ||
+        get_int32(iobuf) != nsub-2 )
+   {
+      Warning("Skipping sub-items failed");
+      goto done;
+   }
+   get_item_end(iobuf,&sub_item_header);
+   ok = 1;
+
+ done:
+   if ( iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   free_io_buffer(iobuf);
+   remove(dname);
+   return ok ? 0 : -1;
+}
+
+/* -------------------- fill_test_samples ---------------------- */
+/**
+ *  @short Fill the ADC samples of a telescope event with a pattern
+ *         depending on the event number, for sample mode readout.
+ *         With zero suppression, only a group of eight pixels
+ *         (at a position also depending on the event) has samples.
+ */
+
+static void fill_test_samples (TelEvent *te, int ievt, int zero_sup);
+
+static void fill_test_samples (TelEvent *te, int ievt, int zero_sup)
+{
+   AdcData *raw = te->raw;
+   const int npix = 64, nsamp = 24;
+   int ngains = (H_MAX_GAINS >= 2) ? 2 : 1;
+   int ipix, igain, isamp;
+   int first = zero_sup ? (ievt*5) % (npix-8) : 0;
+   int end = zero_sup ? first+8 : npix;
+
+   te->known = 1;
+   te->glob_count = te->loc_count = ievt;
+   te->readout_mode = 1;
+   raw->tel_id = te->tel_id;
+   raw->known = 1;
+   raw->num_pixels = npix;
+   raw->num_gains = ngains;
+   raw->num_samples = nsamp;
+   raw->zero_sup_mode = zero_sup ? 0x20 : 0;
+   raw->data_red_mode = 0;
+   (void) alloc_adc_samples(raw,ngains,npix,nsamp);
+   for ( igain=0; igain<ngains; igain++ )
+      for ( ipix=0; ipix<npix; ipix++ )
+      {
+         int sig = (ipix >= first && ipix < end);
+         raw->adc_known[igain][ipix] = sig ? 3 : 0;
+         raw->adc_sum[igain][ipix] = 0;
+         for ( isamp=0; isamp<nsamp; isamp++ )
+         {
+            uint16_t v = sig ? (uint16_t) (200 + (ipix*7 + isamp*13 + ievt*31 + igain) % 97) : 0;
+            ADC_SAMPLES(raw,igain,ipix)[isamp] = v;
+            raw->adc_sum[igain][ipix] += v;
+         }
+      }
+   for ( ipix=0; ipix<npix; ipix++ )
+      raw->significant[ipix] = (ipix >= first && ipix < end) ? 0x21 : 0;
+}
+
+/* -------------------- same_test_samples ---------------------- */
+
+static int same_test_samples (AdcData *raw, AdcData *ref);
+
+static int same_test_samples (AdcData *raw, AdcData *ref)
+{
+   int ipix, igain, isamp;
+
+   if ( (raw->known & 2) == 0 || raw->num_pixels != ref->num_pixels ||
+        raw->num_gains != ref->num_gains || raw->num_samples != ref->num_samples )
+      return 0;
+   for ( igain=0; igain<ref->num_gains; igain++ )
+      for ( ipix=0; ipix<ref->num_pixels; ipix++ )
+         for ( isamp=0; isamp<ref->num_samples; isamp++ )
+            if ( ADC_SAMPLES(raw,igain,ipix)[isamp] != ADC_SAMPLES(ref,igain,ipix)[isamp] )
+               return 0;
+   return 1;
+}
+
+/* --------------------- test_lazy_samples --------------------- */
+/**
+ *  @short Check reading telescope events with an EventProjection:
+ *         samples not selected are skipped, and samples read with
+ *         PROJ_LAZY_SAMPLES stay pending until they are needed, either
+ *         for the slice-major view or for writing the event again.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_lazy_samples (const char *fname);
+
+int test_lazy_samples (const char *fname)
+{
+   const char *dname = scratch_name(fname,"lazy");
+   char cname[1024];
+   const int nevt = 3;
+   IO_BUFFER *iobuf = NULL, *iobuf2 = NULL;
+   IO_ITEM_HEADER item_header;
+   EventProjection proj;
+   TelEvent te, ref;
+   const uint16_t *view;
+   int ievt, ipix, isamp, ok = 0;
+
+   snprintf(cname,sizeof(cname),"%s",scratch_name(fname,"lazycopy"));
+   memset(&te,0,sizeof(te));
+   memset(&ref,0,sizeof(ref));
+   te.tel_id = ref.tel_id = 5;
+   if ( (te.raw = (AdcData *) calloc(1,sizeof(AdcData))) == NULL ||
+        (ref.raw = (AdcData *) calloc(1,sizeof(AdcData))) == NULL ||
+        (iobuf = allocate_io_buffer(100000)) == NULL ||
+        (iobuf2 = allocate_io_buffer(100000)) == NULL )
+      goto done;
+
+   if ( (iobuf->output_file = fopen(dname,WRITE_BINARY)) == NULL )
+      goto done;
+   for ( ievt=0; ievt<nevt; ievt++ )
+   {
+      fill_test_samples(&ref,ievt,0);
+      if ( write_simtel_televent(iobuf,&ref,RAWDATA_FLAG) != 0 )
+         break;
+   }
+   fclose(iobuf->output_file);
+   iobuf->output_file = NULL;
+   if ( ievt < nevt || (iobuf->input_file = fopen(dname,READ_BINARY)) == NULL )
+      goto done;
+
+   /* Samples not selected are skipped. */
+   init_event_projection(&proj,RAWDATA_FLAG);
+   proj.parts &= ~PROJ_ADC_SAMPLES;
+   if ( find_io_block(iobuf,&item_header) != 0 ||
+        read_io_block(iobuf,&item_header) != 0 ||
+        read_simtel_televent_projected(iobuf,&te,&proj) != 0 ||
+        te.raw->known != 0 || ADC_SAMPLES_PENDING(te.raw) )
+   {
+      Warning("Samples not selected were decoded");
+      goto done;
+   }
+
+   /* Lazy samples are pending until the slice-major view is asked for. */
+   proj.parts |= PROJ_ADC_SAMPLES | PROJ_LAZY_SAMPLES;
+   fill_test_samples(&ref,1,0);
+   if ( find_io_block(iobuf,&item_header) != 0 ||
+        read_io_block(iobuf,&item_header) != 0 ||
+        read_simtel_televent_projected(iobuf,&te,&proj) != 0 ||
+        te.raw->known != 0 || !ADC_SAMPLES_PENDING(te.raw) )
+   {
+      Warning("Lazy samples are not pending");
+      goto done;
+   }
+   if ( (view = adc_slice_major(te.raw,0)) == NULL ||
+        ADC_SAMPLES_PENDING(te.raw) || !same_test_samples(te.raw,ref.raw) )
+   {
+      Warning("Pending samples were not decoded as needed");
+      goto done;
+   }
+   for ( ipix=0; ipix<ref.raw->num_pixels; ipix++ )
+      for ( isamp=0; isamp<ref.raw->num_samples; isamp++ )
+         if ( ADC_SLICE(view,te.raw,isamp)[ipix] != ADC_SAMPLES(ref.raw,0,ipix)[isamp] )
+         {
+            Warning("Slice-major view of decoded samples is wrong");
+            goto done;
+         }
+
+   /* Pending samples written again come out as they went in. */
+   fill_test_samples(&ref,2,0);
+   if ( find_io_block(iobuf,&item_header) != 0 ||
+        read_io_block(iobuf,&item_header) != 0 ||
+        read_simtel_televent_projected(iobuf,&te,&proj) != 0 ||
+        !ADC_SAMPLES_PENDING(te.raw) )
+      goto done;
+   if ( (iobuf2->output_file = fopen(cname,WRITE_BINARY)) == NULL )
+      goto done;
+   if ( write_simtel_televent(iobuf2,&te,RAWDATA_FLAG) != 0 )
+   {
+      fclose(iobuf2->output_file);
+      iobuf2->output_file = NULL;
+      goto done;
+   }
+   fclose(iobuf2->output_file);
+   iobuf2->output_file = NULL;
+   if ( (iobuf2->input_file = fopen(cname,READ_BINARY)) == NULL ||
+        find_io_block(iobuf2,&item_header) != 0 ||
+        read_io_block(iobuf2,&item_header) != 0 ||
+        read_simtel_televent(iobuf2,&te,RAWDATA_FLAG) != 0 ||
+        !same_test_samples(te.raw,ref.raw) )
+   {
+      Warning("Pending samples were not written correctly");
+      goto done;
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL && iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   if ( iobuf2 != NULL && iobuf2->input_file != NULL )
+      fclose(iobuf2->input_file);
+   free_io_buffer(iobuf);
+   free_io_buffer(iobuf2);
+   free_adc_data(te.raw);
+   free_adc_data(ref.raw);
+   remove(dname);
+   remove(cname);
+   return ok ? 0 : -1;
+}
+
+#define TEST_NTEL 4
+
+/* -------------------- test_tel_in_event ---------------------- */
+/**
+ *  @short Each test telescope takes part in two out of three events.
+ */
+
+static int test_tel_in_event (int ievt, int itel);
+
+static int test_tel_in_event (int ievt, int itel)
+{
+   return ( (ievt+itel) % 3 != 0 );
+}
+
+/* --------------------- new_test_data ------------------------- */
+/**
+ *  @short Set up event data for TEST_NTEL telescopes with raw data.
+ */
+
+static AllHessData *new_test_data (void);
+
+static AllHessData *new_test_data (void)
+{
+   AllHessData *hsdata = (AllHessData *) calloc(1,sizeof(AllHessData));
+   int ids[TEST_NTEL], itel;
+
+   if ( hsdata == NULL )
+      return NULL;
+   hsdata->run_header.ntel = hsdata->event.num_tel = TEST_NTEL;
+   for ( itel=0; itel<TEST_NTEL; itel++ )
+   {
+      ids[itel] = hsdata->run_header.tel_id[itel] = 
+         hsdata->event.teldata[itel].tel_id = itel+1;
+      hsdata->event.trackdata[itel].tel_id = itel+1;
+      if ( (hsdata->event.teldata[itel].raw = 
+             (AdcData *) calloc(1,sizeof(AdcData))) == NULL )
+         break;
+   }
+   if ( itel < TEST_NTEL )
+   {
+      while ( itel-- > 0 )
+         free_adc_data(hsdata->event.teldata[itel].raw);
+      free(hsdata);
+      return NULL;
+   }
+   set_tel_idx(TEST_NTEL,ids);
+   return hsdata;
+}
+
+static void free_test_data (AllHessData *hsdata);
+
+static void free_test_data (AllHessData *hsdata)
+{
+   int itel;
+   if ( hsdata == NULL )
+      return;
+   for ( itel=0; itel<TEST_NTEL; itel++ )
+      free_adc_data(hsdata->event.teldata[itel].raw);
+   free(hsdata);
+}
+
+/* -------------------- write_test_events ---------------------- */
+/**
+ *  @short Write array events with sample data of the test telescopes,
+ *         every other telescope with zero-suppressed samples.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+static int write_test_events (const char *dname, AllHessData *hsdata, int nevt);
+
+static int write_test_events (const char *dname, AllHessData *hsdata, int nevt)
+{
+   FullEvent *ev = &hsdata->event;
+   IO_BUFFER *iobuf;
+   int ievt, itel;
+
+   if ( (iobuf = allocate_io_buffer(1000000)) == NULL )
+      return -1;
+   if ( (iobuf->output_file = fopen(dname,WRITE_BINARY)) == NULL )
+   {
+      free_io_buffer(iobuf);
+      return -1;
+   }
+   for ( ievt=0; ievt<nevt; ievt++ )
+   {
+      ev->central.num_teltrg = ev->central.num_teldata = 0;
+      ev->central.glob_count = ievt+1;
+      for ( itel=0; itel<ev->num_tel; itel++ )
+      {
+         if ( test_tel_in_event(ievt,itel) )
+            fill_test_samples(&ev->teldata[itel],ievt*TEST_NTEL+itel,itel%2);
+         else
+            ev->teldata[itel].known = 0;
+      }
+      if ( write_simtel_event(iobuf,ev,RAWDATA_FLAG) != 0 )
+         break;
+   }
+   fclose(iobuf->output_file);
+   iobuf->output_file = NULL;
+   free_io_buffer(iobuf);
+   return (ievt == nevt) ? 0 : -1;
+}
+
+/* -------------------- read_test_events ----------------------- */
+/**
+ *  @short Read back the events of write_test_events(), recycling the
+ *         event data in between, and compare all samples, including
+ *         that none are left over from earlier events.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+static int read_test_events (const char *dname, AllHessData *hsdata, int nevt);
+
+static int read_test_events (const char *dname, AllHessData *hsdata, int nevt)
+{
+   FullEvent *ev = &hsdata->event;
+   IO_BUFFER *iobuf = NULL;
+   IO_ITEM_HEADER item_header;
+   TelEvent ref;
+   int ievt, itel, igain, ipix, isamp, nrecycle = 0, ok = 0;
+
+   memset(&ref,0,sizeof(ref));
+   for ( itel=0; itel<TEST_NTEL; itel++ )
+      if ( ev->teldata[itel].dirty )
+         nrecycle++;
+   if ( (ref.raw = (AdcData *) calloc(1,sizeof(AdcData))) == NULL ||
+        (iobuf = allocate_io_buffer(1000000)) == NULL ||
+        (iobuf->input_file = fopen(dname,READ_BINARY)) == NULL )
+      goto done;
+
+   for ( ievt=0; ievt<nevt; ievt++ )
+   {
+      /* Only telescopes read in since the last recycling are touched. */
+      if ( hs_event_recycle(hsdata) != (ievt == 0 ? nrecycle : 
+            test_tel_in_event(ievt-1,0) + test_tel_in_event(ievt-1,1) +
+            test_tel_in_event(ievt-1,2) + test_tel_in_event(ievt-1,3)) )
+      {
+         Warning("Wrong number of telescopes recycled");
+         goto done;
+      }
+      for ( itel=0; itel<TEST_NTEL; itel++ )
+      {
+         AdcData *raw = ev->teldata[itel].raw;
+         if ( ev->teldata[itel].known || raw->known )
+            goto done;
+         for ( igain=0; igain<raw->num_gains; igain++ )
+            for ( ipix=0; ipix<raw->num_pixels; ipix++ )
+               for ( isamp=0; isamp<raw->num_samples; isamp++ )
+                  if ( ADC_SAMPLES(raw,igain,ipix)[isamp] != 0 )
+                  {
+                     Warning("Samples left over after recycling event data");
+                     goto done;
+                  }
+      }
+
+      if ( find_io_block(iobuf,&item_header) != 0 ||
+           read_io_block(iobuf,&item_header) != 0 ||
+           read_simtel_event(iobuf,ev,RAWDATA_FLAG) != 0 ||
+           ev->central.glob_count != ievt+1 )
+         goto done;
+      for ( itel=0; itel<TEST_NTEL; itel++ )
+      {
+         TelEvent *te = &ev->teldata[itel];
+         if ( !test_tel_in_event(ievt,itel) )
+         {
+            if ( te->known )
+               goto done;
+            continue;
+         }
+         ref.tel_id = te->tel_id;
+         fill_test_samples(&ref,ievt*TEST_NTEL+itel,itel%2);
+         if ( !te->known || !same_test_samples(te->raw,ref.raw) )
+         {
+            Warning("Telescope samples differ from those written");
+            goto done;
+         }
+      }
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL && iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   free_io_buffer(iobuf);
+   free_adc_data(ref.raw);
+   return ok ? 0 : -1;
+}
+
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+/* ------------------- read_duplicate_televents ---------------- */
+/**
+ *  @short Write an event with several data blocks for the same
+ *         telescope and check that reading it, with the given number
+ *         of decoding threads, ends up with the last of them.
+ *
+ *  @return Number of telescope data blocks listed or -1 (failed).
+ */
+
+static int read_duplicate_televents (const char *dname, AllHessData *hsdata,
+   AllHessData *hsdata2, int nthreads);
+
+static int read_duplicate_televents (const char *dname, AllHessData *hsdata,
+   AllHessData *hsdata2, int nthreads)
+{
+   FullEvent *ev = &hsdata->event;
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER item_header;
+   int k, n = -1;
+
+   if ( (iobuf = allocate_io_buffer(1000000)) == NULL )
+      return -1;
+   if ( (iobuf->output_file = fopen(dname,WRITE_BINARY)) == NULL )
+   {
+      free_io_buffer(iobuf);
+      return -1;
+   }
+   item_header.type = IO_TYPE_SIMTEL_EVENT;
+   item_header.version = 0;
+   item_header.ident = 1;
+   put_item_begin(iobuf,&item_header);
+   fill_test_samples(&ev->teldata[0],0,0);
+   write_simtel_televent(iobuf,&ev->teldata[0],RAWDATA_FLAG);
+   for ( k=1; k<=3; k++ )
+   {
+      fill_test_samples(&ev->teldata[1],k,0);
+      write_simtel_televent(iobuf,&ev->teldata[1],RAWDATA_FLAG);
+   }
+   put_item_end(iobuf,&item_header);
+   fclose(iobuf->output_file);
+   iobuf->output_file = NULL;
+
+   (void) set_hessio_decode_threads(nthreads);
+   if ( (iobuf->input_file = fopen(dname,READ_BINARY)) != NULL &&
+        find_io_block(iobuf,&item_header) == 0 &&
+        read_io_block(iobuf,&item_header) == 0 &&
+        read_simtel_event(iobuf,&hsdata2->event,RAWDATA_FLAG) == 0 &&
+        hsdata2->event.teldata[1].glob_count == 3 &&
+        same_test_samples(hsdata2->event.teldata[1].raw,ev->teldata[1].raw) &&
+        same_test_samples(hsdata2->event.teldata[0].raw,ev->teldata[0].raw) )
+      n = hsdata2->event.num_teldata;
+   if ( iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   free_io_buffer(iobuf);
+   return n;
+}
+#endif
+
+/* -------------------- test_event_decode ---------------------- */
+/**
+ *  @short Check reading array events, with the telescope data decoded
+ *         sequentially or in parallel, and with recycling of the event
+ *         data in between instead of clearing everything.
+ *         Events with the telescope data encoded in parallel must
+ *         come out exactly the same as with sequential encoding.
+ *         Repeated data for a telescope must not be decoded in parallel.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_event_decode (const char *fname);
+
+int test_event_decode (const char *fname)
+{
+   char dname[1024];
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   char pname[1024];
+#endif
+   const int nevt = 12;
+   AllHessData *hsdata = NULL, *hsdata2 = NULL;
+   int rc = -1;
+
+   snprintf(dname,sizeof(dname),"%s",scratch_name(fname,"events"));
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   snprintf(pname,sizeof(pname),"%s",scratch_name(fname,"pevents"));
+#endif
+
+   if ( (hsdata = new_test_data()) == NULL || (hsdata2 = new_test_data()) == NULL )
+   {
+      free_test_data(hsdata);
+      return -1;
+   }
+   (void) set_hessio_decode_threads(1);
+   if ( (rc = write_test_events(dname,hsdata,nevt)) != 0 )
+      Warning("Writing test events failed");
+   else if ( (rc = read_test_events(dname,hsdata2,nevt)) != 0 )
+      Warning("Sequential decoding of test events failed");
+#if defined(_REENTRANT) || defined(EVENTIO_THREADS)
+   else
+   {
+      (void) set_hessio_decode_threads(3);
+      if ( (rc = read_test_events(dname,hsdata2,nevt)) != 0 )
+         Warning("Parallel decoding of test events failed");
+      else if ( (rc = write_test_events(pname,hsdata,nevt)) != 0 )
+         Warning("Parallel encoding of test events failed");
+      else if ( !same_file_contents(dname,pname) )
+      {
+         Warning("Parallel encoding differs from sequential encoding");
+         rc = -1;
+      }
+      else if ( read_duplicate_televents(dname,hsdata,hsdata2,3) !=
+                read_duplicate_televents(dname,hsdata,hsdata2,1) ||
+                read_duplicate_televents(dname,hsdata,hsdata2,1) != 4 )
+      {
+         Warning("Repeated telescope data in one event read differently");
+         rc = -1;
+      }
+   }
+   remove(pname);
+#endif
+   (void) set_hessio_decode_threads(0);
+
+   free_test_data(hsdata);
+   free_test_data(hsdata2);
+   remove(dname);
+   return rc;
+}
+
+/* -------------------- count_packed_samples ------------------- */
+/**
+ *  @short Count the telescopes in the first event of a file which
+ *         have their samples written bit-packed (item version 5).
+ *
+ *  @return Number of such telescopes or -1 (failed).
+ */
+
+static int count_packed_samples (const char *dname);
+
+static int count_packed_samples (const char *dname)
+{
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER item_header, tel_header, samp_header;
+   int npacked = -1;
+
+   if ( (iobuf = allocate_io_buffer(1000000)) == NULL )
+      return -1;
+   if ( (iobuf->input_file = fopen(dname,READ_BINARY)) != NULL &&
+        find_io_block(iobuf,&item_header) == 0 &&
+        read_io_block(iobuf,&item_header) == 0 &&
+        get_item_begin(iobuf,&item_header) == 0 )
+   {
+      npacked = 0;
+      for (;;)
+      {
+         tel_header.type = 0;
+         if ( search_sub_item(iobuf,&item_header,&tel_header) != 0 )
+            break;
+         if ( tel_header.type <= IO_TYPE_SIMTEL_TELEVENT ||
+              tel_header.type > IO_TYPE_SIMTEL_TELEVENT + TEST_NTEL )
+         {
+            skip_subitem(iobuf);
+            continue;
+         }
+         if ( get_item_begin(iobuf,&tel_header) != 0 )
+            break;
+         samp_header.type = IO_TYPE_SIMTEL_TELADCSAMP;
+         if ( search_sub_item(iobuf,&tel_header,&samp_header) == 0 &&
+              samp_header.version == 5 )
+            npacked++;
+         get_item_end(iobuf,&tel_header);
+      }
+   }
+   if ( iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   free_io_buffer(iobuf);
+   return npacked;
+}
+
+/* -------------------- test_packed_samples -------------------- */
+/**
+ *  @short Check that array events with bit-packed ADC samples, with
+ *         and without zero suppression, read back the same as written.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_packed_samples (const char *fname);
+
+int test_packed_samples (const char *fname)
+{
+   const char *dname = scratch_name(fname,"packed");
+   const int nevt = 12;
+   AllHessData *hsdata = NULL, *hsdata2 = NULL;
+   int itel, ntel0 = 0, rc = -1;
+
+   if ( (hsdata = new_test_data()) == NULL || (hsdata2 = new_test_data()) == NULL )
+   {
+      free_test_data(hsdata);
+      return -1;
+   }
+   for ( itel=0; itel<TEST_NTEL; itel++ )
+      ntel0 += test_tel_in_event(0,itel);
+
+   (void) set_hessio_packed_samples(1);
+   if ( (rc = write_test_events(dname,hsdata,nevt)) != 0 )
+      Warning("Writing test events with packed samples failed");
+   else if ( count_packed_samples(dname) != ntel0 )
+   {
+      Warning("Samples were not written bit-packed");
+      rc = -1;
+   }
+   else if ( (rc = read_test_events(dname,hsdata2,nevt)) != 0 )
+      Warning("Packed samples differ from those written");
+   (void) set_hessio_packed_samples(0);
+
+   free_test_data(hsdata);
+   free_test_data(hsdata2);
+   remove(dname);
+   return rc;
+}
+
+/* -------------------- test_column_chunks --------------------- */
+/**
+ *  @short Check reading a column table with a range cut: chunks that
+ *         cannot pass are skipped, without being confused by the
+ *         interleaved chunks of another table, and only the selected
+ *         columns are decoded.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_column_chunks (const char *fname);
+
+int test_column_chunks (const char *fname)
+{
+   const char *dname = scratch_name(fname,"columns");
+   const int nrows = 100;
+   IO_BUFFER *iobuf = NULL;
+   IO_COLUMN_TABLE *tab = NULL, *tab2 = NULL;
+   int irow, k, ok = 0;
+   int c_event, c_energy, c_amp, c_other;
+   long n, npass = 0;
+
+   if ( (iobuf = allocate_io_buffer(100000)) == NULL ||
+        (tab = allocate_column_table("test",7,10)) == NULL ||
+        (tab2 = allocate_column_table("other",8,3)) == NULL )
+      goto done;
+   if ( (c_event = add_column(tab,"event",COL_INT32)) < 0 ||
+        (c_energy = add_column(tab,"energy",COL_DOUBLE)) < 0 ||
+        (c_amp = add_column(tab,"amp",COL_FLOAT|COL_ARRAY)) < 0 ||
+        (c_other = add_column(tab2,"x",COL_DOUBLE)) < 0 )
+      goto done;
+
+   /* Energies of 10-row chunks 30..39, 40..49, 50..59 overlap the cut below. */
+   if ( (iobuf->output_file = fopen(dname,WRITE_BINARY)) == NULL )
+      goto done;
+   if ( write_column_table(iobuf,tab) != 0 || write_column_table(iobuf,tab2) != 0 )
+      goto done;
+   for ( irow=0; irow<nrows; irow++ )
+   {
+      double amp[3];
+      for ( k=0; k<irow%4; k++ )
+         amp[k] = irow*0.5 + k;
+      if ( set_column_value(tab,c_event,(double)irow) != 0 ||
+           set_column_value(tab,c_energy,irow+0.25) != 0 ||
+           set_column_values(tab,c_amp,amp,(size_t)(irow%4)) != 0 ||
+           end_column_row(iobuf,tab) != 0 )
+         goto done;
+      if ( irow%4 == 0 &&
+           (set_column_value(tab2,c_other,irow+0.25) != 0 ||
+            end_column_row(iobuf,tab2) != 0) )
+         goto done;
+   }
+   if ( flush_column_chunk(iobuf,tab) != 0 || flush_column_chunk(iobuf,tab2) != 0 )
+      goto done;
+   fclose(iobuf->output_file);
+   iobuf->output_file = NULL;
+
+   /* Read back with a cut on the energy, and the amplitudes selected. */
+   free_column_table(tab);
+   if ( (tab = allocate_column_table(NULL,0,0)) == NULL ||
+        (iobuf->input_file = fopen(dname,READ_BINARY)) == NULL )
+      goto done;
+   if ( find_column_table(iobuf,tab,"test") != 0 || tab->table_id != 7 ||
+        select_column(tab,"amp") != c_amp ||
+        add_column_cut(tab,"energy",35.,52.5) != 0 )
+   {
+      Warning("Column table definition not found");
+      goto done;
+   }
+   while ( (n = read_column_chunk(iobuf,tab)) > 0 )
+   {
+      const double *v;
+      for ( irow=0; irow<(int)n; irow++ )
+      {
+         double e = get_column_value(tab,c_energy,(size_t)irow);
+         int ievt = (int) e;
+         if ( !column_row_passes(tab,(size_t)irow) )
+            continue;
+         npass++;
+         if ( e < 35. || e > 52.5 ||
+              get_column_values(tab,c_event,(size_t)irow,&v) != 0 ||
+              get_column_values(tab,c_amp,(size_t)irow,&v) != (size_t)(ievt%4) )
+         {
+            Warning("Wrong rows or columns decoded");
+            goto done;
+         }
+         for ( k=0; k<ievt%4; k++ )
+            if ( v[k] != ievt*0.5 + k )
+            {
+               Warning("Wrong values in array column");
+               goto done;
+            }
+      }
+   }
+   if ( n < 0 || npass != 18 || tab->num_chunks != 3 || tab->chunks_skipped != 7 )
+   {
+      Warning("Column chunks not skipped as expected");
+      goto done;
+   }
+   ok = 1;
+
+ done:
+   if ( iobuf != NULL && iobuf->output_file != NULL )
+      fclose(iobuf->output_file);
+   if ( iobuf != NULL && iobuf->input_file != NULL )
+      fclose(iobuf->input_file);
+   free_io_buffer(iobuf);
+   free_column_table(tab);
+   free_column_table(tab2);
+   remove(dname);
+   return ok ? 0 : -1;
+}
+
+/* ----------------------- test_arena_reuse -------------------- */
+/**
+ *  @short Check that memory from an arena is zeroed, that the same
+ *         addresses come back after a reset, and that the telescope
+ *         data of a run set up from the arena is at the same place
+ *         again for the next run with the same configuration.
+ *
+ *  @return 0 (ok), -1 (failed)
+ */
+
+int test_arena_reuse (void);
+
+int test_arena_reuse (void)
+{
+   MEM_ARENA *arena;
+   AllHessData *hsdata = NULL;
+   unsigned char *p1, *p2, *q1, *q2, *big;
+   AdcData *raw[2];
+   size_t used, total, total2, i;
+   int itel, ok = 0;
+
+   if ( (arena = allocate_mem_arena(4096,0)) == NULL )
+      return -1;
+   if ( (p1 = (unsigned char *) mem_arena_calloc(arena,1,100)) == NULL ||
+        (p2 = (unsigned char *) mem_arena_calloc(arena,3,200)) == NULL )
+      goto done;
+   /* Pieces are aligned to 64 bytes. */
+   if ( ((uintptr_t) p1 % 64) != 0 || ((uintptr_t) p2 % 64) != 0 ||
+        (used = mem_arena_used(arena,&total)) != 128+640 || total < 4096 )
+   {
+      Warning("Unexpected arena layout");
+      goto done;
+   }
+   memset(p1,0xff,100);
+   memset(p2,0xff,600);
+
+   reset_mem_arena(arena);
+   if ( mem_arena_used(arena,&total2) != 0 || total2 != total )
+   {
+      Warning("Arena not reset as expected");
+      goto done;
+   }
+   if ( (q1 = (unsigned char *) mem_arena_calloc(arena,1,100)) != p1 ||
+        (q2 = (unsigned char *) mem_arena_calloc(arena,3,200)) != p2 )
+   {
+      Warning("Arena memory not reused after reset");
+      goto done;
+   }
+   for ( i=0; i<100; i++ )
+      if ( q1[i] != 0 )
+         break;
+   if ( i < 100 )
+   {
+      Warning("Reused arena memory not zeroed");
+      goto done;
+   }
+   for ( i=0; i<600; i++ )
+      if ( q2[i] != 0 )
+         break;
+   if ( i < 600 )
+   {
+      Warning("Reused arena memory not zeroed");
+      goto done;
+   }
+   /* Larger than a chunk: goes into a chunk of its own. */
+   if ( (big = (unsigned char *) mem_arena_calloc(arena,1,10000)) == NULL ||
+        !mem_arena_owns(arena,big+9999) || mem_arena_owns(arena,&total) ||
+        mem_arena_used(arena,&total2) != 128+640+10048 || total2 < total+10000 )
+   {
+      Warning("Large piece not handed out from the arena as expected");
+      goto done;
+   }
+
+   /* The same telescope data for a second run of the same configuration */
+   if ( (hsdata = (AllHessData *) calloc(1,sizeof(AllHessData))) == NULL )
+      goto done;
+   hsdata->run_header.ntel = 2;
+   hsdata->run_header.tel_id[0] = 3;
+   hsdata->run_header.tel_id[1] = 7;
+   if ( alloc_hess_run_data(hsdata,HS_ALLOC_RAW) != 0 )
+      goto done;
+   for ( itel=0; itel<2; itel++ )
+   {
+      raw[itel] = hsdata->event.teldata[itel].raw;
+      raw[itel]->known = 1;
+   }
+   /* Like calibrated pixel data allocated when found in a file */
+   if ( (hsdata->event.teldata[1].pixcal = 
+          (PixelCalibrated *) calloc(1,sizeof(PixelCalibrated))) == NULL )
+      goto done;
+   if ( alloc_hess_run_data(hsdata,HS_ALLOC_RAW) != 0 )
+      goto done;
+   for ( itel=0; itel<2; itel++ )
+   {
+      TelEvent *te = &hsdata->event.teldata[itel];
+      if ( te->raw != raw[itel] || te->raw->known != 0 ||
+           te->raw->tel_id != hsdata->run_header.tel_id[itel] ||
+           te->pixcal != NULL )
+      {
+         Warning("Telescope data of the next run not set up again in place");
+         goto done;
+      }
+   }
+   ok = 1;
+
+ done:
+   if ( hsdata != NULL )
+   {
+      free_hess_run_data(hsdata);
+      free(hsdata);
+   }
+   free_mem_arena(arena);
+   return ok ? 0 : -1;
+}
+
 /* ---------------------- perror ------------------------- */
 /**
  *  @short Replacement for function missing on OS-9
@@ -1026,6 +2636,185 @@ int perror(text)
 }
 #endif
 
+/* ------------------------ test_sfloat_vectors --------------------- */
+/**
+ *  @short Check that the bulk 16-bit float conversion, whichever
+ *         implementation was selected, gives bit for bit the same
+ *         results as the single-element functions, for all 16-bit
+ *         values and for 32-bit float bit patterns.
+ *
+ *  @param all  If non-zero, check all 2^32 float bit patterns,
+ *              otherwise only every 61st (which takes about a minute
+ *              less in a build without optimization).
+ */
+
+int test_sfloat_vectors (int all);
+
+int test_sfloat_vectors (int all)
+{
+   const size_t chunk = 65536;
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER item_header;
+   union { float f; uint32_t u; } *fvec = NULL, ref;
+   uint16_t *svec = NULL, sref;
+   uint32_t base = 0, step = all ? 1 : 61;
+   size_t i;
+   long nbad = 0;
+
+   if ( (iobuf = allocate_io_buffer(2*chunk+1024)) == NULL )
+      return -1;
+   iobuf->max_length = 2*chunk+1024;
+   if ( (fvec = calloc(chunk,sizeof(fvec[0]))) == NULL ||
+        (svec = (uint16_t *) calloc(chunk,sizeof(uint16_t))) == NULL )
+   {
+      free(fvec);
+      free_io_buffer(iobuf);
+      return -1;
+   }
+   fprintf(stderr,"(Using the '%s' method.)\n",eventio_sfloat_method());
+
+   /* All 16-bit values expanded to floats. */
+   for ( i=0; i<chunk; i++ )
+      svec[i] = (uint16_t) i;
+   item_header.type = 99;
+   item_header.version = 0;
+   item_header.ident = 0;
+   put_item_begin(iobuf,&item_header);
+   put_vector_of_uint16(svec,(int)chunk,iobuf);
+   iobuf->data = iobuf->buffer + 16;
+   iobuf->r_remaining = (long) (2*chunk);
+   get_vector_of_sfloat(&fvec[0].f,(int)chunk,iobuf);
+   iobuf->item_level = 0;
+   iobuf->data = iobuf->buffer;
+   for ( i=0; i<chunk; i++ )
+   {
+      ref.f = (float) dbl_from_sfloat(&svec[i]);
+      if ( fvec[i].u != ref.u )
+      {
+         if ( nbad++ < 10 )
+            Warning("16-bit float expanded differently.");
+      }
+   }
+
+   /* Float bit patterns, in chunks, packed to 16-bit floats.
+      The odd step still goes through all combinations of lower bits. */
+   do
+   {
+      for ( i=0; i<chunk; i++ )
+         fvec[i].u = base + (uint32_t) i * step;
+      put_item_begin(iobuf,&item_header);
+      put_vector_of_sfloat(&fvec[0].f,(int)chunk,iobuf);
+      iobuf->data = iobuf->buffer + 16;
+      iobuf->r_remaining = (long) (2*chunk);
+      get_vector_of_uint16(svec,(int)chunk,iobuf);
+      iobuf->item_level = 0;
+      iobuf->data = iobuf->buffer;
+      for ( i=0; i<chunk; i++ )
+      {
+         fltp_to_sfloat(&fvec[i].f,&sref);
+         if ( svec[i] != sref )
+         {
+            if ( nbad++ < 10 )
+            {
+               char msg[128];
+               snprintf(msg,sizeof(msg),"Float 0x%08x packed to 0x%04x"
+                  " instead of 0x%04x.",(unsigned) fvec[i].u,
+                  (unsigned) svec[i],(unsigned) sref);
+               Warning(msg);
+            }
+         }
+      }
+      base += (uint32_t) chunk * step;
+   } while ( base >= (uint32_t) chunk * step );
+
+   free(svec);
+   free(fvec);
+   free_io_buffer(iobuf);
+   return (nbad == 0) ? 0 : -1;
+}
+
+/* ------------------------ bench_vectors --------------------- */
+/**
+ *  @short Compare the throughput of vector functions for data in
+ *         native and in reversed byte order.
+ */
+
+int bench_vectors (void);
+
+int bench_vectors (void)
+{
+   const int num = 1<<20, nrep = 50;
+   IO_BUFFER *iobuf;
+   IO_ITEM_HEADER item_header;
+   void *vec;
+   int bo, ty, irep, i;
+   static const char *tname[] = { "uint16", "int32", "float", "double" };
+   static const int tsize[] = { 2, 4, 4, 8 };
+
+   if ( (iobuf = allocate_io_buffer((size_t)(8*num+1024))) == NULL )
+      return -1;
+   iobuf->max_length = 8*num+1024;
+   if ( (vec = calloc((size_t)num,8)) == NULL )
+      return -1;
+   for ( i=0; i<num; i++ )
+      ((uint16_t *) vec)[i] = (uint16_t) (i*7);
+
+   fprintf(stderr,"Byte order conversion of vectors uses the '%s' method.\n",
+      eventio_swap_method());
+   fprintf(stderr,"Bulk conversion of 16-bit floats uses the '%s' method.\n",
+      eventio_sfloat_method());
+   fprintf(stderr,"%-8s %10s %12s %12s\n","Type","Order","Put [MB/s]","Get [MB/s]");
+   for ( ty=0; ty<4; ty++ )
+   {
+      for ( bo=0; bo<=1; bo++ )
+      {
+         double mbytes = (double) nrep * num * tsize[ty] / 1e6;
+         double tput = 0., tget = 0.;
+         clock_t t0;
+         iobuf->byte_order = bo;
+         for ( irep=0; irep<nrep; irep++ )
+         {
+            item_header.type = 99;
+            item_header.version = 0;
+            item_header.ident = irep;
+            put_item_begin(iobuf,&item_header);
+            t0 = clock();
+            switch ( ty )
+            {
+               case 0: put_vector_of_uint16((uint16_t *) vec,num,iobuf); break;
+               case 1: put_vector_of_int32((int32_t *) vec,num,iobuf); break;
+               case 2: put_vector_of_float((float *) vec,num,iobuf); break;
+               case 3: put_vector_of_double((double *) vec,num,iobuf); break;
+            }
+            tput += (double) (clock()-t0) / CLOCKS_PER_SEC;
+            /* Read back from the start of the data, as if just read from a file. */
+            iobuf->data = iobuf->buffer + 16;
+            iobuf->r_remaining = (long) num * tsize[ty];
+            t0 = clock();
+            switch ( ty )
+            {
+               case 0: get_vector_of_uint16((uint16_t *) vec,num,iobuf); break;
+               case 1: get_vector_of_int32((int32_t *) vec,num,iobuf); break;
+               case 2: get_vector_of_float((float *) vec,num,iobuf); break;
+               case 3: get_vector_of_double((double *) vec,num,iobuf); break;
+            }
+            tget += (double) (clock()-t0) / CLOCKS_PER_SEC;
+            /* Start from scratch for the next round. */
+            iobuf->item_level = 0;
+            iobuf->data = iobuf->buffer;
+            iobuf->w_remaining = -1;
+         }
+         fprintf(stderr,"%-8s %10s %12.1f %12.1f\n", tname[ty],
+            bo ? "reversed" : "native",
+            tput > 0. ? mbytes/tput : 0., tget > 0. ? mbytes/tget : 0.);
+      }
+   }
+
+   free(vec);
+   free_io_buffer(iobuf);
+   return 0;
+}
+
 /* ---------------------- syntax ------------------------- */
 
 void syntax(const char *prg);
@@ -1034,10 +2823,14 @@ void syntax(const char *prg)
 {
    fprintf(stderr,"Test basic EventIO write and read functions.\n");
    fprintf(stderr,"Syntax: %s [ -e ] filename\n", prg); 
+   fprintf(stderr,"   or:  %s -b\n", prg); 
    fprintf(stderr,"Options:\n");
    fprintf(stderr,"  -e  Use the extension field for all I/O block headers.\n");
    fprintf(stderr,"  -x  Include tests for large data blocks\n"
-                  "      (filename extension .zst or .gz is recommended!).\n");
+                  "      (filename extension .zst or .gz is recommended!)\n"
+                  "      and of 16-bit float conversion for all floats.\n");
+   fprintf(stderr,"  -b  Benchmark vector functions with native and reversed\n"
+                  "      byte order (no file needed).\n");
    exit(1);
 }
 
@@ -1215,6 +3008,8 @@ int main (int argc, char **argv)
    {
       if ( strcmp(argv[1],"--help") == 0 )
          syntax(program);
+      else if ( strcmp(argv[1],"-b") == 0 )
+         exit(bench_vectors() == 0 ? 0 : 1);
       else if ( strcmp(argv[1],"-e") == 0 )
       {
          iobuf->extended = 1;
@@ -1432,6 +3227,75 @@ int main (int argc, char **argv)
    }
    
    Information("Read tests done\n");
+
+   /* Functionality beyond basic reading and writing */
+   fprintf(stderr,"Block index and seeking to events.\n");
+   if ( test_index(argv[1]) != 0 )
+   {
+      Error("*** Block index test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Searching for sub-items.\n");
+   if ( test_sub_items(argv[1]) != 0 )
+   {
+      Error("*** Sub-item search test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Selective and lazy decoding of telescope data.\n");
+   if ( test_lazy_samples(argv[1]) != 0 )
+   {
+      Error("*** Lazy decoding test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Decoding and recycling of array events.\n");
+   if ( test_event_decode(argv[1]) != 0 )
+   {
+      Error("*** Event decoding test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Bit-packed ADC samples.\n");
+   if ( test_packed_samples(argv[1]) != 0 )
+   {
+      Error("*** Packed samples test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Bulk conversion of 16-bit floats.\n");
+   if ( test_sfloat_vectors(lrg_test) != 0 )
+   {
+      Error("*** 16-bit float conversion test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Skipping chunks of column tables.\n");
+   if ( test_column_chunks(argv[1]) != 0 )
+   {
+      Error("*** Column table test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Reuse of arena memory.\n");
+   if ( test_arena_reuse() != 0 )
+   {
+      Error("*** Arena reuse test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Prefetching of input blocks.\n");
+   if ( test_prefetch(argv[1]) != 0 )
+   {
+      Error("*** Prefetching test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Write-behind of output blocks.\n");
+   if ( test_writebehind(argv[1]) != 0 )
+   {
+      Error("*** Write-behind test failed");
+      ok = 0;
+   }
+   fprintf(stderr,"Random access to seekable zstd files.\n");
+   if ( test_seekable_zstd(argv[1]) != 0 )
+   {
+      Error("*** Seekable zstd test failed");
+      ok = 0;
+   }
+   Information("Feature tests done\n");
    
    if ( ok )
       Information("Everything is ok. Congratulations!\n");